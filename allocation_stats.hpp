@@ -0,0 +1,343 @@
+// Accounting of the memory allocated by each part of the converter.
+// Copyright 2014 by Brian Davis.
+
+#ifndef allocation_stats_HEADER
+#define allocation_stats_HEADER
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+
+namespace jrl
+{
+
+/**
+ * Process wide counters of the bytes allocated under each tag: current
+ * and peak bytes and the number of allocations.  Counting is off until
+ * enable() is called, which has to happen before anything counted is
+ * allocated, so that frees always match counted allocations; while off
+ * each allocation costs one relaxed load.
+ *
+ * Allocations are counted by CountingAllocator for containers, by
+ * deriving from AllocationCounted for objects allocated one at a time,
+ * or by calling add() and remove() directly for memory obtained some
+ * other way.
+ */
+class AllocationStatistics
+{
+public:
+
+  // Types
+
+  enum Tag {
+    PARSER_TAG,  // Xerces internals
+    ATTRIBUTE_TAG,  // Per element scratch buffers
+    MODEL_TAG,  // Parsed board records
+    STRING_TAG,  // Interned string tables
+    OUTPUT_TAG,  // Output write buffers
+    TAG_COUNT
+  };
+
+  struct Counters
+  {
+    std::int64_t current;
+    std::int64_t peak;
+    std::uint64_t count;
+  };
+
+  /**
+   * Bytes counted under any tag by one thread while it is installed
+   * with setThreadMeter(), e.g. for the work of a single request.
+   */
+  struct Meter
+  {
+    std::int64_t current;
+    std::int64_t peak;
+  };
+
+  // Member functions
+
+  static void
+  enable()
+  {
+    getEnabled().store(true, std::memory_order_relaxed);
+  }
+
+  static bool
+  isEnabled()
+  {
+    return getEnabled().load(std::memory_order_relaxed);
+  }
+
+  static void
+  add(const Tag tag,
+      const std::size_t bytes)
+  {
+    if (!isEnabled()) {
+      return;
+    }
+    Meter * const meter = getThreadMeter();
+    if (NULL != meter) {
+      meter->current += bytes;
+      meter->peak = std::max(meter->peak, meter->current);
+    }
+    Slot &slot = getSlots()[tag];
+    const std::int64_t current =
+      slot.current.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    slot.count.fetch_add(1, std::memory_order_relaxed);
+    std::int64_t peak = slot.peak.load(std::memory_order_relaxed);
+    while ((current > peak) &&
+           (!slot.peak.compare_exchange_weak(peak, current,
+                                             std::memory_order_relaxed))) {
+    }
+  }
+
+  static void
+  remove(const Tag tag,
+         const std::size_t bytes)
+  {
+    if (!isEnabled()) {
+      return;
+    }
+    Meter * const meter = getThreadMeter();
+    if (NULL != meter) {
+      meter->current -= bytes;
+    }
+    getSlots()[tag].current.fetch_sub(bytes, std::memory_order_relaxed);
+  }
+
+  /**
+   * Account for a buffer which grew or shrank from one size to another
+   * by reallocation.
+   */
+  static void
+  resize(const Tag tag,
+         const std::size_t from,
+         const std::size_t to)
+  {
+    if (from != to) {
+      add(tag, to);
+      remove(tag, from);
+    }
+  }
+
+  static Counters
+  get(const Tag tag)
+  {
+    const Slot &slot = getSlots()[tag];
+    Counters counters;
+    counters.current = slot.current.load(std::memory_order_relaxed);
+    counters.peak = slot.peak.load(std::memory_order_relaxed);
+    counters.count = slot.count.load(std::memory_order_relaxed);
+    return counters;
+  }
+
+  /**
+   * Also count what the calling thread allocates in meter, until
+   * replaced (NULL to stop).  Returns the meter replaced.
+   */
+  static Meter *
+  setThreadMeter(Meter * const meter)
+  {
+    Meter * const previous = getThreadMeter();
+    getThreadMeter() = meter;
+    return previous;
+  }
+
+  static const char *
+  getName(const Tag tag)
+  {
+    static const char * const NAMES[TAG_COUNT] = {
+      "parser", "attribute scratch", "model records", "strings",
+      "output buffers"
+    };
+    return NAMES[tag];
+  }
+
+private:
+
+  // Types
+
+  // NOTE: a cache line each, tags are updated from different threads.
+  struct alignas(64) Slot
+  {
+    std::atomic<std::int64_t> current;
+    std::atomic<std::int64_t> peak;
+    std::atomic<std::uint64_t> count;
+  };
+
+  // Member functions
+
+  // NOTE: zero initialized statics, so no initialization guard.
+  static std::atomic<bool> &
+  getEnabled()
+  {
+    static std::atomic<bool> isEnabled(false);
+    return isEnabled;
+  }
+
+  static Slot *
+  getSlots()
+  {
+    static Slot slots[TAG_COUNT];
+    return slots;
+  }
+
+  static Meter *&
+  getThreadMeter()
+  {
+    static thread_local Meter *meter = NULL;
+    return meter;
+  }
+};
+
+/**
+ * Standard allocator counting what it allocates under TAG.
+ */
+template <typename T, AllocationStatistics::Tag TAG>
+class CountingAllocator
+{
+public:
+
+  // Types
+
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind
+  {
+    typedef CountingAllocator<U, TAG> other;
+  };
+
+  // Constructors/destructors
+
+  CountingAllocator()
+  {
+  }
+
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U, TAG> &)
+  {
+  }
+
+  // Member functions
+
+  T *
+  allocate(const std::size_t count)
+  {
+    T *result = static_cast<T *>(::operator new(count * sizeof(T)));
+    AllocationStatistics::add(TAG, count * sizeof(T));
+    return result;
+  }
+
+  void
+  deallocate(T *pointer,
+             const std::size_t count)
+  {
+    AllocationStatistics::remove(TAG, count * sizeof(T));
+    ::operator delete(pointer);
+  }
+};
+
+template <typename T, typename U, AllocationStatistics::Tag TAG>
+bool
+operator==(const CountingAllocator<T, TAG> &,
+           const CountingAllocator<U, TAG> &)
+{
+  return true;
+}
+
+template <typename T, typename U, AllocationStatistics::Tag TAG>
+bool
+operator!=(const CountingAllocator<T, TAG> &,
+           const CountingAllocator<U, TAG> &)
+{
+  return false;
+}
+
+/**
+ * Base class counting objects of derived classes allocated with new
+ * under TAG.  Objects have to be deleted through a pointer to their
+ * own class, or a base with a virtual destructor, for the size freed
+ * to be right.
+ */
+template <AllocationStatistics::Tag TAG>
+class AllocationCounted
+{
+public:
+
+  // Member functions
+
+  static void *
+  operator new(const std::size_t size)
+  {
+    void *result = ::operator new(size);
+    AllocationStatistics::add(TAG, size);
+    return result;
+  }
+
+  static void
+  operator delete(void *pointer,
+                  const std::size_t size)
+  {
+    AllocationStatistics::remove(TAG, size);
+    ::operator delete(pointer);
+  }
+};
+
+/**
+ * Counts the capacity of a reused buffer under TAG, for buffers whose
+ * type can't take a CountingAllocator: call update() with the capacity
+ * in bytes after the buffer may have grown.
+ */
+template <AllocationStatistics::Tag TAG>
+class CapacityCounter
+{
+public:
+
+  // Constructors/destructors
+
+  CapacityCounter()
+    : bytes_(0)
+  {
+  }
+
+  ~CapacityCounter()
+  {
+    AllocationStatistics::remove(TAG, bytes_);
+  }
+
+  CapacityCounter(const CapacityCounter &)
+    : bytes_(0)
+  {
+  }
+
+  CapacityCounter &
+  operator=(const CapacityCounter &)
+  {
+    return *this;
+  }
+
+  // Member functions
+
+  void
+  update(const std::size_t bytes)
+  {
+    if (bytes != bytes_) {
+      AllocationStatistics::resize(TAG, bytes_, bytes);
+      bytes_ = bytes;
+    }
+  }
+
+private:
+
+  // Data members
+
+  std::size_t bytes_;
+};
+
+}
+
+#endif
@@ -0,0 +1,504 @@
+// Input decompressed on a separate thread.
+// Copyright 2014 by Brian Davis.
+
+#ifndef compressed_input_HEADER
+#define compressed_input_HEADER
+
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <zlib.h>
+
+#if defined(__has_include)
+#if __has_include(<zstd.h>)
+#include <zstd.h>
+#define compressed_input_HAVE_ZSTD
+#endif
+#endif
+
+namespace jrl
+{
+
+/**
+ * Fixed size byte queue between one writing and one reading thread.
+ *
+ * write() blocks while the ring is full and read() while it is empty,
+ * until the writer calls finish() (read() then drains what is left
+ * and returns 0) or the reader calls cancel() (write() then discards
+ * everything).  The time each side spends blocked is accumulated.
+ */
+class ByteRing
+{
+public:
+
+  // Constructors/destructors
+
+  explicit ByteRing(const std::size_t capacity)
+    : buffer_(capacity),
+      head_(0),
+      size_(0),
+      isFinished_(false),
+      isCancelled_(false),
+      readWait_(0),
+      writeWait_(0)
+  {
+  }
+
+  ByteRing(const ByteRing &) = delete;
+
+  ByteRing &
+  operator=(const ByteRing &) = delete;
+
+  // Member functions
+
+  /**
+   * Append bytes, returning false once the reader has cancelled.
+   */
+  bool
+  write(const char *bytes,
+        std::size_t length)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (0 < length) {
+      if ((!isCancelled_) && (buffer_.size() == size_)) {
+        const Clock::time_point start = Clock::now();
+        while ((!isCancelled_) && (buffer_.size() == size_)) {
+          notFull_.wait(lock);
+        }
+        writeWait_ += Clock::now() - start;
+      }
+      if (isCancelled_) {
+        return false;
+      }
+      const std::size_t tail = (head_ + size_) % buffer_.size();
+      const std::size_t count =
+        std::min(length, std::min(buffer_.size() - size_, buffer_.size() - tail));
+      std::memcpy(&buffer_[tail], bytes, count);
+      size_ += count;
+      bytes += count;
+      length -= count;
+      notEmpty_.notify_one();
+    }
+    return true;
+  }
+
+  /**
+   * Take up to length bytes, returning 0 only at the end of the data.
+   */
+  std::size_t
+  read(char *bytes,
+       const std::size_t length)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if ((!isFinished_) && (0 == size_)) {
+      const Clock::time_point start = Clock::now();
+      while ((!isFinished_) && (0 == size_)) {
+        notEmpty_.wait(lock);
+      }
+      readWait_ += Clock::now() - start;
+    }
+    const std::size_t count =
+      std::min(length, std::min(size_, buffer_.size() - head_));
+    std::memcpy(bytes, &buffer_[head_], count);
+    head_ = (head_ + count) % buffer_.size();
+    size_ -= count;
+    notFull_.notify_one();
+    return count;
+  }
+
+  void
+  finish()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isFinished_ = true;
+    notEmpty_.notify_one();
+  }
+
+  void
+  cancel()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isCancelled_ = true;
+    notFull_.notify_one();
+  }
+
+  /** Time read() spent waiting for data, in seconds. */
+  double
+  getReadWaitSeconds()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return readWait_.count();
+  }
+
+  /** Time write() spent waiting for space, in seconds. */
+  double
+  getWriteWaitSeconds()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writeWait_.count();
+  }
+
+private:
+
+  // Types
+
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::duration<double> Seconds;
+
+  // Data members
+
+  std::vector<char> buffer_;
+  std::size_t head_;
+  std::size_t size_;
+  bool isFinished_;
+  bool isCancelled_;
+  Seconds readWait_;
+  Seconds writeWait_;
+  std::mutex mutex_;
+  std::condition_variable notEmpty_;
+  std::condition_variable notFull_;
+};
+
+/**
+ * Reads a file descriptor on its own thread, decompressing gzip and
+ * zstd data as identified by their magic bytes and passing
+ * anything else through unchanged, so that reading and decompression
+ * overlap with whatever consumes the data.
+ *
+ * The descriptor is read in large blocks into a ring holding two of
+ * them, so one block is read while the other is consumed, which hides
+ * the latency of pipes and network file systems.
+ *
+ * Concatenated compressed streams, as written by appending .gz files,
+ * are decompressed in turn.  Once read() returns 0 getError() is empty
+ * unless the input couldn't be read or decompressed.
+ */
+class DecompressingReader
+{
+public:
+
+  // Types
+
+  enum Compression {
+    NO_COMPRESSION,
+    GZIP_COMPRESSION,
+    ZSTD_COMPRESSION
+  };
+
+  struct Statistics
+  {
+    /** Bytes read from the descriptor. */
+    std::uint64_t inputBytes;
+    /** Bytes passed on after decompression. */
+    std::uint64_t outputBytes;
+    std::uint64_t readCount;
+    /** Time spent in read(2). */
+    double readSeconds;
+    /** Time the consumer waited for data, the stalls hidden otherwise. */
+    double stallSeconds;
+    /** Time the reading thread waited for the consumer. */
+    double idleSeconds;
+  };
+
+  // Constructors/destructors
+
+  /**
+   * Start reading fd, which is closed afterwards if isOwningFd.
+   */
+  DecompressingReader(const int fd,
+                      const bool isOwningFd)
+    : fd_(fd),
+      isOwningFd_(isOwningFd),
+      position_(0),
+      compression_(NO_COMPRESSION),
+      inputBytes_(0),
+      readCount_(0),
+      readTime_(0),
+      isStopped_(false),
+      ring_(2 * READ_SIZE),
+      thread_(&DecompressingReader::run, this)
+  {
+  }
+
+  ~DecompressingReader()
+  {
+    stop();
+    if (isOwningFd_) {
+      ::close(fd_);
+    }
+  }
+
+  DecompressingReader(const DecompressingReader &) = delete;
+
+  DecompressingReader &
+  operator=(const DecompressingReader &) = delete;
+
+  // Member functions
+
+  /**
+   * Identify the compression of data starting with bytes.
+   */
+  static Compression
+  detect(const char *bytes,
+         const std::size_t length)
+  {
+    static const unsigned char GZIP_MAGIC[] = { 0x1f, 0x8b };
+    static const unsigned char ZSTD_MAGIC[] = { 0x28, 0xb5, 0x2f, 0xfd };
+    if ((sizeof(GZIP_MAGIC) <= length) &&
+        (0 == std::memcmp(bytes, GZIP_MAGIC, sizeof(GZIP_MAGIC)))) {
+      return GZIP_COMPRESSION;
+    }
+    if ((sizeof(ZSTD_MAGIC) <= length) &&
+        (0 == std::memcmp(bytes, ZSTD_MAGIC, sizeof(ZSTD_MAGIC)))) {
+      return ZSTD_COMPRESSION;
+    }
+    return NO_COMPRESSION;
+  }
+
+  /**
+   * Take up to length decompressed bytes, blocking until some are
+   * available.  Returns 0 at the end of the input.
+   */
+  std::size_t
+  read(char *bytes,
+       const std::size_t length)
+  {
+    const std::size_t count = ring_.read(bytes, length);
+    position_ += count;
+    return count;
+  }
+
+  /** Decompressed bytes read so far. */
+  std::uint64_t
+  getPosition() const
+  {
+    return position_;
+  }
+
+  /**
+   * Abandon any remaining input and wait for the reading thread.
+   */
+  void
+  stop()
+  {
+    if (!isStopped_) {
+      ring_.cancel();
+      thread_.join();
+      isStopped_ = true;
+    }
+  }
+
+  /** Only valid once read() has returned 0 or after stop(). */
+  Statistics
+  getStatistics()
+  {
+    Statistics statistics;
+    statistics.inputBytes = inputBytes_;
+    statistics.outputBytes = position_;
+    statistics.readCount = readCount_;
+    statistics.readSeconds = readTime_.count();
+    statistics.stallSeconds = ring_.getReadWaitSeconds();
+    statistics.idleSeconds = ring_.getWriteWaitSeconds();
+    return statistics;
+  }
+
+  /** Only valid once read() has returned 0. */
+  Compression
+  getCompression() const
+  {
+    return compression_;
+  }
+
+  /** Only valid once read() has returned 0. */
+  const std::string &
+  getError() const
+  {
+    return error_;
+  }
+
+private:
+
+  // Constants
+
+  static const std::size_t READ_SIZE = 512 << 10;
+  static const std::size_t OUTPUT_SIZE = 64 << 10;
+  static const std::size_t MAGIC_SIZE = 4;
+
+  // Member functions
+
+  /**
+   * Fill input from the descriptor, returning false at its end.
+   */
+  bool
+  fill(std::vector<char> &input,
+       std::size_t &inputSize,
+       const std::size_t offset = 0)
+  {
+    const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+    ssize_t count;
+    do {
+      count = ::read(fd_, &input[offset], input.size() - offset);
+      ++readCount_;
+    } while ((0 > count) && (EINTR == errno));
+    readTime_ += std::chrono::steady_clock::now() - start;
+    if (0 > count) {
+      error_ = "unable to read input";
+      return false;
+    }
+    inputSize = offset + count;
+    inputBytes_ += count;
+    return 0 < count;
+  }
+
+  void
+  run()
+  {
+    std::vector<char> input(READ_SIZE);
+    std::size_t inputSize = 0;
+    if (fill(input, inputSize)) {
+      // Pipes may deliver less than the magic bytes at first.
+      while ((MAGIC_SIZE > inputSize) && fill(input, inputSize, inputSize)) {
+      }
+      compression_ = detect(&input[0], inputSize);
+      switch (compression_) {
+      case GZIP_COMPRESSION:
+        decompressGzip(input, inputSize);
+        break;
+      case ZSTD_COMPRESSION:
+        decompressZstd(input, inputSize);
+        break;
+      default:
+        while (ring_.write(&input[0], inputSize) && fill(input, inputSize)) {
+        }
+        break;
+      }
+    }
+    ring_.finish();
+  }
+
+  void
+  decompressGzip(std::vector<char> &input,
+                 std::size_t inputSize)
+  {
+    std::vector<char> output(OUTPUT_SIZE);
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 32 selects automatic gzip or zlib header detection.
+    if (Z_OK != ::inflateInit2(&stream, MAX_WBITS + 32)) {
+      error_ = "unable to initialize zlib";
+      return;
+    }
+    stream.next_in = reinterpret_cast<Bytef *>(&input[0]);
+    stream.avail_in = inputSize;
+    bool isInStream = true;
+    bool isOutputFull = false;
+    for (;;) {
+      // A full output buffer may leave output pending without input.
+      if ((0 == stream.avail_in) && (!isOutputFull)) {
+        if (!fill(input, inputSize)) {
+          break;
+        }
+        stream.next_in = reinterpret_cast<Bytef *>(&input[0]);
+        stream.avail_in = inputSize;
+      }
+      if (!isInStream) {
+        ::inflateReset(&stream);
+        isInStream = true;
+      }
+      stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+      stream.avail_out = output.size();
+      const int status = ::inflate(&stream, Z_NO_FLUSH);
+      if ((Z_OK != status) && (Z_STREAM_END != status) && (Z_BUF_ERROR != status)) {
+        error_ = std::string("corrupt gzip input: ") +
+          ((NULL != stream.msg) ? stream.msg : "unknown error");
+        break;
+      }
+      isOutputFull = (0 == stream.avail_out);
+      if (!ring_.write(&output[0], output.size() - stream.avail_out)) {
+        break;
+      }
+      if (Z_STREAM_END == status) {
+        isInStream = false;
+      }
+    }
+    if (isInStream && error_.empty()) {
+      error_ = "truncated gzip input";
+    }
+    ::inflateEnd(&stream);
+  }
+
+#ifdef compressed_input_HAVE_ZSTD
+  void
+  decompressZstd(std::vector<char> &input,
+                 std::size_t inputSize)
+  {
+    std::vector<char> output(ZSTD_DStreamOutSize());
+    ZSTD_DCtx *context = ZSTD_createDCtx();
+    ZSTD_inBuffer in = { &input[0], inputSize, 0 };
+    std::size_t status = 0;
+    bool isOutputFull = false;
+    for (;;) {
+      if ((in.pos == in.size) && (!isOutputFull)) {
+        if (!fill(input, inputSize)) {
+          break;
+        }
+        in.src = &input[0];
+        in.size = inputSize;
+        in.pos = 0;
+      }
+      ZSTD_outBuffer out = { &output[0], output.size(), 0 };
+      status = ZSTD_decompressStream(context, &out, &in);
+      if (ZSTD_isError(status)) {
+        error_ = std::string("corrupt zstd input: ") + ZSTD_getErrorName(status);
+        break;
+      }
+      isOutputFull = (out.pos == out.size);
+      if (!ring_.write(&output[0], out.pos)) {
+        break;
+      }
+    }
+    if ((0 != status) && error_.empty()) {
+      error_ = "truncated zstd input";
+    }
+    ZSTD_freeDCtx(context);
+  }
+#else
+  void
+  decompressZstd(std::vector<char> &,
+                 std::size_t)
+  {
+    error_ = "zstd compressed input is not supported by this build";
+  }
+#endif
+
+  // Data members
+
+  int fd_;
+  bool isOwningFd_;
+  std::uint64_t position_;
+  Compression compression_;
+  std::string error_;
+  std::uint64_t inputBytes_;
+  std::uint64_t readCount_;
+  std::chrono::duration<double> readTime_;
+  bool isStopped_;
+  ByteRing ring_;
+  // NOTE: must follow the members used by run().
+  std::thread thread_;
+};
+
+}
+
+#endif
@@ -0,0 +1,862 @@
+// Conversion requests served over a Unix domain socket.
+// Copyright 2014 by Brian Davis.
+
+#ifndef conversion_server_HEADER
+#define conversion_server_HEADER
+
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <streambuf>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "allocation_stats.hpp"
+
+namespace jrl
+{
+
+/**
+ * Thrown by RequestLimits when a request runs out of time or memory.
+ */
+class RequestLimitExceeded : public std::runtime_error
+{
+public:
+
+  // Constructors/destructors
+
+  explicit RequestLimitExceeded(const std::string &what)
+    : std::runtime_error(what)
+  {
+  }
+};
+
+/**
+ * Time and memory limits of one request, checked by poll() from the
+ * thread doing the work.  What the thread allocates is metered (see
+ * AllocationStatistics::setThreadMeter()) for as long as the limits
+ * exist, so allocation counting must be enabled for the memory limit
+ * to apply.
+ *
+ * NOTE: the memory limit is approximate.  Only the parsed model is
+ * counted as it is allocated; the input and the output, the other
+ * large buffers of a request, are charged with charge() (see
+ * RequestOutputBuffer), while short lived temporaries go uncounted.
+ */
+class RequestLimits
+{
+public:
+
+  // Types
+
+  typedef std::chrono::steady_clock Clock;
+
+  // Constructors/destructors
+
+  RequestLimits(const Clock::duration timeout,
+                const std::uint64_t memoryLimit)
+    : start_(Clock::now()),
+      deadline_(start_ + timeout),
+      memoryLimit_(memoryLimit),
+      pollCount_(0)
+  {
+    meter_.current = 0;
+    meter_.peak = 0;
+    previousMeter_ = AllocationStatistics::setThreadMeter(&meter_);
+  }
+
+  ~RequestLimits()
+  {
+    AllocationStatistics::setThreadMeter(previousMeter_);
+  }
+
+  RequestLimits(const RequestLimits &) = delete;
+
+  RequestLimits &
+  operator=(const RequestLimits &) = delete;
+
+  // Member functions
+
+  /**
+   * Cheap enough to call per parsed element: only checks every so
+   * many calls.
+   */
+  void
+  poll()
+  {
+    if (0 == (++pollCount_ % POLL_INTERVAL)) {
+      check();
+    }
+  }
+
+  /**
+   * Count bytes the request holds outside of the counted allocations,
+   * throwing RequestLimitExceeded if that exceeds a limit.
+   */
+  void
+  charge(const std::size_t bytes)
+  {
+    meter_.current += bytes;
+    meter_.peak = std::max(meter_.peak, meter_.current);
+    check();
+  }
+
+  /**
+   * Throw RequestLimitExceeded if either limit has been exceeded.
+   */
+  void
+  check() const
+  {
+    if (Clock::now() > deadline_) {
+      throw RequestLimitExceeded("time limit exceeded");
+    }
+    if (static_cast<std::int64_t>(memoryLimit_) < meter_.current) {
+      throw RequestLimitExceeded("memory limit exceeded");
+    }
+  }
+
+  double
+  getElapsedSeconds() const
+  {
+    return std::chrono::duration<double>(Clock::now() - start_).count();
+  }
+
+  /** Most bytes allocated at once by the request so far. */
+  std::int64_t
+  getPeakBytes() const
+  {
+    return meter_.peak;
+  }
+
+private:
+
+  // Constants
+
+  static const unsigned POLL_INTERVAL = 1024;
+
+  // Data members
+
+  Clock::time_point start_;
+  Clock::time_point deadline_;
+  std::uint64_t memoryLimit_;
+  unsigned pollCount_;
+  AllocationStatistics::Meter meter_;
+  AllocationStatistics::Meter *previousMeter_;
+};
+
+/**
+ * Output of a request, collected in a string whose growth is charged
+ * to the request's limits (which are checked, time included, whenever
+ * the buffer fills).  Write to it through an ostream with
+ * exceptions(ios::badbit) set, so that RequestLimitExceeded reaches the
+ * caller rather than just failing the stream.
+ */
+class RequestOutputBuffer : public std::streambuf
+{
+public:
+
+  // Constructors/destructors
+
+  explicit RequestOutputBuffer(RequestLimits &limits)
+    : limits_(limits), buffer_(BUFFER_SIZE)
+  {
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+  }
+
+  RequestOutputBuffer(const RequestOutputBuffer &) = delete;
+
+  RequestOutputBuffer &
+  operator=(const RequestOutputBuffer &) = delete;
+
+  // Member functions
+
+  /**
+   * Hand over everything written so far.
+   */
+  std::string
+  release()
+  {
+    flush();
+    return std::move(output_);
+  }
+
+protected:
+
+  virtual int_type
+  overflow(const int_type c)
+  {
+    flush();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  virtual int
+  sync()
+  {
+    flush();
+    return 0;
+  }
+
+private:
+
+  // Constants
+
+  static const std::size_t BUFFER_SIZE = 65536;
+
+  // Member functions
+
+  void
+  flush()
+  {
+    const std::size_t capacity = output_.capacity();
+    output_.append(pbase(), pptr() - pbase());
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+    if (output_.capacity() > capacity) {
+      limits_.charge(output_.capacity() - capacity);
+    }
+    else {
+      limits_.check();
+    }
+  }
+
+  // Data members
+
+  RequestLimits &limits_;
+  std::vector<char> buffer_;
+  std::string output_;
+};
+
+/**
+ * Request or response of the conversion protocol.  On the wire a
+ * message is a command (or status) line, then "key value" field lines,
+ * an empty line and a body of as many bytes as its "size" field says,
+ * for example:
+ *
+ *   CONVERT
+ *   option check-nets
+ *   timeout-ms 5000
+ *   size 12345
+ *
+ *   <12345 bytes of Eagle board>
+ *
+ * Fields may repeat, and "size" is added when a message is written.
+ */
+class ServerMessage
+{
+public:
+
+  // Types
+
+  typedef std::vector<std::pair<std::string, std::string> > Fields;
+
+  // Member functions
+
+  const std::string &
+  getCommand() const
+  {
+    return command_;
+  }
+
+  void
+  setCommand(const std::string &command)
+  {
+    command_ = command;
+  }
+
+  const Fields &
+  getFields() const
+  {
+    return fields_;
+  }
+
+  void
+  add(const std::string &key,
+      const std::string &value)
+  {
+    fields_.push_back(std::make_pair(key, value));
+  }
+
+  /**
+   * Value of the first key field, if any.
+   */
+  bool
+  tryGet(const std::string &key,
+         std::string &value) const
+  {
+    for (Fields::const_iterator field = fields_.begin();
+         field != fields_.end(); ++field) {
+      if (key == field->first) {
+        value = field->second;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool
+  has(const std::string &key,
+      const std::string &value) const
+  {
+    for (Fields::const_iterator field = fields_.begin();
+         field != fields_.end(); ++field) {
+      if ((key == field->first) && (value == field->second)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const std::string &
+  getBody() const
+  {
+    return body_;
+  }
+
+  std::string &
+  getBody()
+  {
+    return body_;
+  }
+
+  void
+  clear()
+  {
+    command_.clear();
+    fields_.clear();
+    body_.clear();
+  }
+
+private:
+
+  // Data members
+
+  std::string command_;
+  Fields fields_;
+  std::string body_;
+};
+
+/**
+ * Reads and writes ServerMessages on a connected socket.
+ */
+class MessageChannel
+{
+public:
+
+  // Constructors/destructors
+
+  explicit MessageChannel(const int fd)
+    : fd_(fd), position_(0)
+  {
+  }
+
+  // Member functions
+
+  /**
+   * Connect to a server listening at path, returns the socket or -1.
+   */
+  static int
+  connect(const std::string &path,
+          std::string &error)
+  {
+    sockaddr_un address;
+    if (!makeAddress(path, address, error)) {
+      return -1;
+    }
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if ((0 > fd) ||
+        (0 != ::connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                        sizeof(address)))) {
+      error = "unable to connect to '" + path + "': " + std::strerror(errno);
+      if (0 <= fd) {
+        ::close(fd);
+      }
+      return -1;
+    }
+    return fd;
+  }
+
+  static bool
+  makeAddress(const std::string &path,
+              sockaddr_un &address,
+              std::string &error)
+  {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+      error = "socket path '" + path + "' is too long";
+      return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+  }
+
+  /**
+   * Read the next message, whose body may be up to maxBodySize bytes.
+   * Returns false with an empty error at the end of the stream.
+   */
+  bool
+  read(ServerMessage &message,
+       const std::size_t maxBodySize,
+       std::string &error)
+  {
+    message.clear();
+    error.clear();
+    std::string line;
+    if (!readLine(line, error)) {
+      return false;
+    }
+    message.setCommand(line);
+    std::size_t bodySize = 0;
+    for (;;) {
+      if (!readLine(line, error)) {
+        if (error.empty()) {
+          error = "incomplete message";
+        }
+        return false;
+      }
+      if (line.empty()) {
+        break;
+      }
+      const std::size_t space = line.find(' ');
+      const std::string key = line.substr(0, space);
+      const std::string value =
+        (std::string::npos == space) ? std::string() : line.substr(space + 1);
+      if (SIZE_FIELD == key) {
+        char *end = NULL;
+        bodySize = std::strtoull(value.c_str(), &end, 10);
+        if (value.empty() || ('\0' != *end)) {
+          error = "malformed size '" + value + "'";
+          return false;
+        }
+      }
+      else {
+        message.add(key, value);
+      }
+    }
+    if (bodySize > maxBodySize) {
+      error = "message body of " + std::to_string(bodySize) +
+        " bytes is too large";
+      return false;
+    }
+    std::string &body = message.getBody();
+    body.reserve(bodySize);
+    while (body.size() < bodySize) {
+      if ((position_ == buffer_.size()) && (!fill(error))) {
+        if (error.empty()) {
+          error = "incomplete message";
+        }
+        return false;
+      }
+      const std::size_t count =
+        std::min(bodySize - body.size(), buffer_.size() - position_);
+      body.append(buffer_, position_, count);
+      position_ += count;
+    }
+    return true;
+  }
+
+  bool
+  write(const ServerMessage &message,
+        std::string &error)
+  {
+    std::string header = message.getCommand() + "\n";
+    const ServerMessage::Fields &fields = message.getFields();
+    for (ServerMessage::Fields::const_iterator field = fields.begin();
+         field != fields.end(); ++field) {
+      // NOTE: line breaks would end the field early.
+      std::string value = field->second;
+      for (std::string::iterator c = value.begin(); c != value.end(); ++c) {
+        if ('\n' == *c) {
+          *c = ' ';
+        }
+      }
+      header += field->first + " " + value + "\n";
+    }
+    header += std::string(SIZE_FIELD) + " " + std::to_string(message.getBody().size()) + "\n\n";
+    return writeAll(header.data(), header.size(), error) &&
+      writeAll(message.getBody().data(), message.getBody().size(), error);
+  }
+
+private:
+
+  // Constants
+
+  static constexpr const char *SIZE_FIELD = "size";
+  static const std::size_t MAX_LINE_SIZE = 64 << 10;
+  static const std::size_t READ_SIZE = 256 << 10;
+
+  // Member functions
+
+  bool
+  readLine(std::string &line,
+           std::string &error)
+  {
+    line.clear();
+    for (;;) {
+      const std::size_t end = buffer_.find('\n', position_);
+      if (std::string::npos != end) {
+        line.append(buffer_, position_, end - position_);
+        position_ = end + 1;
+        return true;
+      }
+      line.append(buffer_, position_, std::string::npos);
+      position_ = buffer_.size();
+      if (line.size() > MAX_LINE_SIZE) {
+        error = "message line too long";
+        return false;
+      }
+      if (!fill(error)) {
+        if (error.empty() && (!line.empty())) {
+          error = "incomplete message";
+        }
+        return false;
+      }
+    }
+  }
+
+  /**
+   * Replace the consumed buffer with newly received bytes, returns
+   * false with an empty error at the end of the stream.
+   */
+  bool
+  fill(std::string &error)
+  {
+    buffer_.resize(READ_SIZE);
+    position_ = 0;
+    for (;;) {
+      const ssize_t count = ::recv(fd_, &buffer_[0], buffer_.size(), 0);
+      if (0 <= count) {
+        buffer_.resize(count);
+        return 0 < count;
+      }
+      if (EINTR != errno) {
+        error = (EAGAIN == errno) || (EWOULDBLOCK == errno) ?
+          std::string("timed out waiting for the client") :
+          std::string("unable to read request: ") + std::strerror(errno);
+        buffer_.clear();
+        return false;
+      }
+    }
+  }
+
+  bool
+  writeAll(const char *data,
+           std::size_t size,
+           std::string &error)
+  {
+    while (0 < size) {
+      // NOTE: MSG_NOSIGNAL so that a client going away isn't fatal.
+      const ssize_t count = ::send(fd_, data, size, MSG_NOSIGNAL);
+      if (0 > count) {
+        if (EINTR == errno) {
+          continue;
+        }
+        error = std::string("unable to write response: ") +
+          std::strerror(errno);
+        return false;
+      }
+      data += count;
+      size -= count;
+    }
+    return true;
+  }
+
+  // Data members
+
+  int fd_;
+  std::string buffer_;
+  std::size_t position_;
+};
+
+/**
+ * Listens on a Unix domain socket and hands each connection to one of
+ * a pool of worker threads, which reads CONVERT requests from it and
+ * answers each with the Converter until the client closes it.  Every
+ * response starts with "OK" or "ERROR <reason>".
+ */
+class ConversionServer
+{
+public:
+
+  // Types
+
+  class Converter
+  {
+  public:
+
+    virtual
+    ~Converter()
+    {
+    }
+
+    /**
+     * Answer request on behalf of worker (from 0), which only ever
+     * handles one request at a time.
+     */
+    virtual void
+    convert(const unsigned worker,
+            const ServerMessage &request,
+            ServerMessage &response) = 0;
+  };
+
+  // Constants
+
+  static constexpr const char *CONVERT_COMMAND = "CONVERT";
+
+  // Constructors/destructors
+
+  ConversionServer(const std::string &path,
+                   const unsigned workerCount,
+                   const std::size_t maxRequestSize,
+                   Converter &converter)
+    : path_(path),
+      workerCount_(workerCount),
+      maxRequestSize_(maxRequestSize),
+      converter_(converter),
+      listenFd_(-1),
+      isStopping_(false)
+  {
+  }
+
+  ~ConversionServer()
+  {
+    stop();
+    for (std::vector<std::thread>::iterator worker = workers_.begin();
+         worker != workers_.end(); ++worker) {
+      worker->join();
+    }
+    for (std::deque<int>::iterator fd = connections_.begin();
+         fd != connections_.end(); ++fd) {
+      ::close(*fd);
+    }
+    if (0 <= listenFd_) {
+      ::close(listenFd_);
+      ::unlink(path_.c_str());
+    }
+  }
+
+  ConversionServer(const ConversionServer &) = delete;
+
+  ConversionServer &
+  operator=(const ConversionServer &) = delete;
+
+  // Member functions
+
+  /**
+   * Bind the socket and start the workers.  A socket left behind by a
+   * server which is gone is replaced, one still served is an error.
+   */
+  bool
+  open(std::string &error)
+  {
+    sockaddr_un address;
+    if (!MessageChannel::makeAddress(path_, address, error)) {
+      return false;
+    }
+    listenFd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (0 > listenFd_) {
+      error = std::string("unable to create socket: ") + std::strerror(errno);
+      return false;
+    }
+    if (0 != bind(address)) {
+      const int bindError = errno;
+      std::string ignored;
+      const int fd = (EADDRINUSE == bindError) ?
+        MessageChannel::connect(path_, ignored) : -1;
+      struct stat status;
+      errno = bindError;
+      if ((EADDRINUSE != bindError) || (0 <= fd) ||
+          (0 != ::lstat(path_.c_str(), &status)) || (!S_ISSOCK(status.st_mode)) ||
+          (0 != ::unlink(path_.c_str())) || (0 != bind(address))) {
+        error = "unable to serve '" + path_ + "': " +
+          ((0 <= fd) ? std::string("already being served") :
+           std::string(std::strerror(errno)));
+        if (0 <= fd) {
+          ::close(fd);
+        }
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+      }
+    }
+    if (0 != ::listen(listenFd_, SOMAXCONN)) {
+      error = "unable to listen on '" + path_ + "': " + std::strerror(errno);
+      return false;
+    }
+    for (unsigned worker = 0; worker < workerCount_; ++worker) {
+      workers_.push_back(std::thread(&ConversionServer::runWorker, this, worker));
+    }
+    return true;
+  }
+
+  /**
+   * Accept connections until stop() is called.
+   */
+  void
+  run()
+  {
+    for (;;) {
+      const int fd = ::accept4(listenFd_, NULL, NULL, SOCK_CLOEXEC);
+      if (0 > fd) {
+        if (isStopped()) {
+          return;
+        }
+        if ((EINTR != errno) && (ECONNABORTED != errno)) {
+          // NOTE: e.g. out of file descriptors, back off.
+          usleep(ACCEPT_RETRY_USEC);
+        }
+        continue;
+      }
+      // An idle client doesn't hold on to a worker forever.
+      timeval timeout = { IDLE_TIMEOUT_SEC, 0 };
+      ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      std::lock_guard<std::mutex> lock(mutex_);
+      connections_.push_back(fd);
+      queued_.notify_one();
+    }
+  }
+
+  /**
+   * Make run() return and the workers finish, may be called from any
+   * thread.
+   */
+  void
+  stop()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+    queued_.notify_all();
+    if (0 <= listenFd_) {
+      ::shutdown(listenFd_, SHUT_RDWR);
+    }
+    for (std::set<int>::const_iterator fd = active_.begin();
+         fd != active_.end(); ++fd) {
+      ::shutdown(*fd, SHUT_RDWR);
+    }
+  }
+
+private:
+
+  // Constants
+
+  static const long IDLE_TIMEOUT_SEC = 30;
+  static const unsigned ACCEPT_RETRY_USEC = 100000;
+
+  // Member functions
+
+  int
+  bind(const sockaddr_un &address)
+  {
+    return ::bind(listenFd_, reinterpret_cast<const sockaddr *>(&address),
+                  sizeof(address));
+  }
+
+  bool
+  isStopped()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return isStopping_;
+  }
+
+  void
+  runWorker(const unsigned worker)
+  {
+    for (;;) {
+      int fd = -1;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while ((!isStopping_) && connections_.empty()) {
+          queued_.wait(lock);
+        }
+        if (isStopping_) {
+          return;
+        }
+        fd = connections_.front();
+        connections_.pop_front();
+        active_.insert(fd);
+      }
+      serve(worker, fd);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_.erase(fd);
+      }
+      ::close(fd);
+    }
+  }
+
+  void
+  serve(const unsigned worker,
+        const int fd)
+  {
+    MessageChannel channel(fd);
+    ServerMessage request;
+    std::string error;
+    while (channel.read(request, maxRequestSize_, error)) {
+      ServerMessage response;
+      if (CONVERT_COMMAND != request.getCommand()) {
+        response.setCommand("ERROR unknown command '" + request.getCommand() + "'");
+      }
+      else {
+        try {
+          converter_.convert(worker, request, response);
+        }
+        catch (const std::exception &exc) {
+          response.clear();
+          response.setCommand(std::string("ERROR ") + exc.what());
+        }
+      }
+      if (!channel.write(response, error)) {
+        return;
+      }
+    }
+    if (!error.empty()) {
+      // NOTE: the rest of the stream can't be trusted, so the
+      // connection is closed after reporting.
+      ServerMessage response;
+      response.setCommand("ERROR " + error);
+      std::string ignored;
+      channel.write(response, ignored);
+    }
+  }
+
+  // Data members
+
+  const std::string path_;
+  const unsigned workerCount_;
+  const std::size_t maxRequestSize_;
+  Converter &converter_;
+  int listenFd_;
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::deque<int> connections_;
+  std::set<int> active_;  // Connections being served.
+  bool isStopping_;
+  std::vector<std::thread> workers_;
+};
+
+}
+
+#endif
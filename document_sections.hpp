@@ -0,0 +1,211 @@
+// Split of an Eagle board file into separately parseable sections.
+// Copyright 2014 by Brian Davis.
+
+#ifndef document_sections_HEADER
+#define document_sections_HEADER
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "eagle_subtrees.hpp"
+
+namespace jrl
+{
+
+/**
+ * Splits a board file into sections which can be parsed independently
+ * of each other: each <plain>, <library> and <elements> subtree and
+ * runs of adjacent <signal> subtrees.
+ *
+ * Each section is parsed as a fragment, wrapped in its parent element
+ * where it can't stand on its own.  What is left of the document, the
+ * skeleton, holds an empty PLACEHOLDER element in place of each
+ * section, so that the events of the parsed sections can be spliced
+ * back into those of the skeleton in document order.  A section is
+ * replaced by as many line breaks as it spans, so line numbers in the
+ * skeleton match the document.  The document type declaration is
+ * blanked from the skeleton, since the placeholder isn't part of the
+ * DTD.
+ */
+class SectionSplitter
+{
+public:
+
+  // Types
+
+  struct Section
+  {
+    Subtree::Kind kind;
+    std::size_t begin;
+    std::size_t end;
+    /** Parent element to wrap the section in, if any. */
+    const char *wrapper;
+    /** Line of the document the section starts on, from 1. */
+    std::size_t line;
+  };
+
+  // Constants
+
+  static constexpr const char *PLACEHOLDER = "eagle2gedapcb-section";
+
+  // Member functions
+
+  /**
+   * Split a complete document, returns false if its markup is not
+   * structured as expected.
+   */
+  bool
+  split(const std::string &document)
+  {
+    sections_.clear();
+    skeleton_.clear();
+    if (!scanner_.scan(document.data(), document.size())) {
+      return false;
+    }
+    const std::vector<Subtree> &subtrees = scanner_.getSubtrees();
+    for (std::vector<Subtree>::const_iterator subtree = subtrees.begin();
+         subtree != subtrees.end(); ++subtree) {
+      const char *wrapper = NULL;
+      switch (subtree->getKind()) {
+      case Subtree::PLAIN:
+        wrapper = "board";
+        break;
+      case Subtree::LIBRARY:
+        wrapper = "libraries";
+        break;
+      case Subtree::SIGNAL:
+        wrapper = "signals";
+        if ((!sections_.empty()) && (Subtree::SIGNAL == sections_.back().kind) &&
+            (SIGNAL_BATCH_SIZE > sections_.back().end - sections_.back().begin) &&
+            isBlank(document, sections_.back().end, subtree->getBegin())) {
+          sections_.back().end = subtree->getEnd();
+          continue;
+        }
+        break;
+      case Subtree::ELEMENTS:
+        break;
+      case Subtree::PACKAGE:
+        // Parsed as part of its library.
+        continue;
+      }
+      const Section section = {
+        subtree->getKind(), subtree->getBegin(), subtree->getEnd(), wrapper, 0
+      };
+      sections_.push_back(section);
+    }
+
+    skeleton_.reserve(document.size());
+    std::size_t position = 0;
+    std::size_t line = 1;
+    for (std::vector<Section>::iterator section = sections_.begin();
+         section != sections_.end(); ++section) {
+      skeleton_.append(document, position, section->begin - position);
+      line += std::count(document.begin() + position,
+                         document.begin() + section->begin, '\n');
+      section->line = line;
+      skeleton_ += '<';
+      skeleton_ += PLACEHOLDER;
+      skeleton_ += "/>";
+      const std::size_t lineCount =
+        std::count(document.begin() + section->begin,
+                   document.begin() + section->end, '\n');
+      skeleton_.append(lineCount, '\n');
+      line += lineCount;
+      position = section->end;
+    }
+    skeleton_.append(document, position, std::string::npos);
+    blankDoctype();
+    return true;
+  }
+
+  const std::vector<Section> &
+  getSections() const
+  {
+    return sections_;
+  }
+
+  const std::string &
+  getSkeleton() const
+  {
+    return skeleton_;
+  }
+
+  /**
+   * Text of a section as a standalone fragment.
+   */
+  std::string
+  getFragment(const std::string &document,
+              const std::size_t index) const
+  {
+    const Section &section = sections_[index];
+    std::string fragment;
+    if (NULL != section.wrapper) {
+      fragment = std::string("<") + section.wrapper + ">";
+    }
+    fragment.append(document, section.begin, section.end - section.begin);
+    if (NULL != section.wrapper) {
+      fragment += std::string("</") + section.wrapper + ">";
+    }
+    return fragment;
+  }
+
+private:
+
+  // Constants
+
+  /** Adjacent signals are parsed together up to about this size. */
+  static const std::size_t SIGNAL_BATCH_SIZE = 256 << 10;
+
+  // Member functions
+
+  static bool
+  isBlank(const std::string &document,
+          const std::size_t begin,
+          const std::size_t end)
+  {
+    for (std::size_t index = begin; index < end; ++index) {
+      if (NULL == std::strchr(" \t\r\n", document[index])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void
+  blankDoctype()
+  {
+    // NOTE: only the prolog, before the first section, is searched.
+    const std::size_t begin = skeleton_.find("<!DOCTYPE");
+    if ((std::string::npos == begin) ||
+        (begin > skeleton_.find(std::string("<") + PLACEHOLDER))) {
+      return;
+    }
+    // NOTE: an internal subset may contain '>'.
+    std::size_t end = skeleton_.find_first_of("[>", begin);
+    if ((std::string::npos != end) && ('[' == skeleton_[end])) {
+      end = skeleton_.find("]", end);
+      end = (std::string::npos == end) ? end : skeleton_.find('>', end);
+    }
+    if (std::string::npos == end) {
+      return;
+    }
+    for (std::size_t index = begin; index <= end; ++index) {
+      if ('\n' != skeleton_[index]) {
+        skeleton_[index] = ' ';
+      }
+    }
+  }
+
+  // Data members
+
+  SubtreeScanner scanner_;
+  std::vector<Section> sections_;
+  std::string skeleton_;
+};
+
+}
+
+#endif
@@ -9,13 +9,36 @@
 #include <cstdlib>
 #include <cassert>
 #include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+
+// System includes
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // STL includes
 #include <queue>
+#include <deque>
 #include <iostream>
 #include <string>
 #include <stdexcept>
 #include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 // Boost includes
 #include <boost/program_options/options_description.hpp>
@@ -24,6 +47,8 @@
 #include <boost/units/io.hpp>
 #include <boost/units/systems/si.hpp>
 #include <boost/units/base_units/us/mil.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/utility/string_ref.hpp>
 
 // Xerces includes
 #include <xercesc/sax/HandlerBase.hpp>
@@ -33,1695 +58,1688 @@
 #include <xercesc/util/TransService.hpp>
 #include <xercesc/parsers/SAXParser.hpp>
 #include <xercesc/util/OutOfMemoryException.hpp>
-#include <xercesc/framework/StdInInputSource.hpp>
+#include <xercesc/sax/InputSource.hpp>
+#include <xercesc/util/BinInputStream.hpp>
+#include <xercesc/framework/MemBufInputSource.hpp>
 #include <xercesc/sax/Locator.hpp>
+#include <xercesc/framework/MemoryManager.hpp>
 
 // Local includes
 #include "boost_unit_extras.hpp"
+#include "eagle_transform.hpp"
+#include "eagle_subtrees.hpp"
+#include "union_find.hpp"
+#include "interner.hpp"
+#include "spatial_grid.hpp"
+#include "polygon_clip.hpp"
+#include "model_snapshot.hpp"
+#include "parse_cache.hpp"
+#include "compressed_input.hpp"
+#include "document_sections.hpp"
+#include "output_writer.hpp"
+#include "spill_file.hpp"
+#include "allocation_stats.hpp"
+#include "conversion_server.hpp"
+#include "gedapcb.hpp"
+#include "eagle_handler.hpp"
 
 using namespace std;
 using namespace xercesc;
 namespace po = boost::program_options;
 XERCES_CPP_NAMESPACE_USE
 
-namespace jrl
-{
-
-static const double INCHES_PER_MM = 0.0393701;
 
-string
-getStlString(const XMLCh * const xmlString)
-{
-  char * transcoded = XMLString::transcode(xmlString);
-  string result(transcoded);
-  XMLString::release(&transcoded);
-  return result;
-}
+// Version of the converter's parsed model, part of the --cache-dir key.
+// Change it whenever SAXHandler records different events for the same
+// input, so that snapshots cached by older versions aren't used.
+static const char *CONVERTER_VERSION = "eagle2gedapcb model 6";
+// Default --cache-size, in megabytes.
+static const unsigned DEFAULT_CACHE_SIZE = 256;
 
-ostream &
-operator<<(ostream &target, const XMLCh * const &outgoing)
-{
-  char * transcoded = XMLString::transcode(outgoing);
-  target << transcoded;
-  XMLString::release(&transcoded);
-  return target;
-}
+using namespace jrl;
 
-class SAXHandler : public HandlerBase
+/**
+ * Xerces stream over a DecompressingReader, so that plain, gzip and
+ * zstd input is read and decompressed on another thread while it is
+ * parsed.  The reader's statistics are copied to statistics, if it
+ * isn't NULL, when the parser is done with the stream.
+ */
+class DecompressingInputStream : public BinInputStream
 {
 public:
 
   // Constructors/destructors
 
-  SAXHandler()
-    : locator_(NULL), 
-      isDefiningLayers_(false), isDefiningBoard_(false),
-      isDefiningPlain_(false), isDefiningText_(false),
-      isDefiningDescription_(false), isDefiningNote_(false),
-      isDefiningLibraries_(false), isDefiningLibrary_(false),
-      isDefiningPackages_(false), isDefiningPackage_(false),
-      currentText_(NULL), currentPackage_(NULL)
+  DecompressingInputStream(const int fd,
+                           const bool isOwningFd,
+                           const string &name,
+                           DecompressingReader::Statistics *statistics)
+    : reader_(fd, isOwningFd),
+      name_(name),
+      statistics_(statistics)
   {
   }
 
   virtual
-  ~SAXHandler(void)
+  ~DecompressingInputStream()
   {
-    delete locator_;
+    if (NULL != statistics_) {
+      reader_.stop();
+      *statistics_ = reader_.getStatistics();
+    }
   }
 
   // Member functions
 
-  void
-  finalize()
+  virtual XMLFilePos
+  curPos() const
   {
-    for (CountIterator entry = elementCounts_.begin();
-         entry != elementCounts_.end(); ++entry) {
-      cerr << "DBG element " << entry->first << " -> " << entry->second << endl;
-    }
-    // for (CountIterator entry = layerCounts_.begin();
-    //      entry != layerCounts_.end(); ++entry) {
-    //   string mapping = layerNames_[entry->first];
-    //   cerr << "DBG layer " << mapping << " (" << entry->first << ") -> "
-    //        << entry->second << endl;
-    // }
+    return reader_.getPosition();
   }
 
-  // DocumentHandler overrides
-
-  void
-  startDocument()
+  virtual XMLSize_t
+  readBytes(XMLByte *const toFill,
+            const XMLSize_t maxToRead)
   {
-    cerr << "DBG start of document" << endl;
+    const XMLSize_t count =
+      reader_.read(reinterpret_cast<char *>(toFill), maxToRead);
+    if ((0 == count) && !reader_.getError().empty()) {
+      cerr << "ERR " << reader_.getError() << " in '" << name_ << "'" << endl;
+    }
+    return count;
   }
 
-  void
-  endDocument()
+  virtual const XMLCh *
+  getContentType() const
   {
-    cerr << "DBG end of document" << endl;
+    return NULL;
   }
 
-  void
-  startElement(const XMLCh * const elementName,
-               AttributeList &attributes)
-  {
-    // string name = StrX(elementName).stringForm();
-    string name(getStlString(elementName));
-    ++elementCounts_[name];
-    if (LAYERS == name) {
-      // No attributes expected for layers element
-      assert(0 == attributes.getLength());
-      assert(!isDefiningLayers_);
-      assert(!isDefiningBoard_);
-      assert(!isDefiningPlain_);
-      isDefiningLayers_ = true;
-    }
-    else if (BOARD == name) {
-      assert(!isDefiningLayers_);
-      assert(!isDefiningBoard_);
-      assert(!isDefiningPlain_);
-      isDefiningBoard_ = true;
-    }
-    else if (PLAIN == name) {
-      assert(!isDefiningLayers_);
-      assert(isDefiningBoard_);
-      assert(!isDefiningPlain_);
-      isDefiningPlain_ = true;
-    }
-    else if (LAYER == name) {
-      // NOTE: singular LAYER here instead of plural LAYERS
-      assert(isDefiningLayers_);
-      assert(!isDefiningBoard_);
-      assert(!isDefiningPlain_);
-      // handleLayerDefinition(attributes);
-    }
-    else if (TEXT == name) {
-      cerr << "DBG starting text";
-      if (NULL != locator_) {
-        cerr << " at " << locator_->getLineNumber() << endl;
-      }
-      else {
-        cerr << endl;
-      }
-      assert(!isDefiningLayers_);
-      assert(!isDefiningDescription_);
-      // assert(NULL == currentText_);
-      currentText_ = new Text;
-      isDefiningText_ = true;
-      handleTextDefinition(attributes);
-    }
-    else if (DESCRIPTION == name) {
-      assert(!isDefiningLayers_);
-      assert(!isDefiningDescription_);
-      assert(!isDefiningNote_);
-      assert(!isDefiningText_);
-      // NOTE: current assumption is that descriptions only apply to
-      // packages.
-      assert(isDefiningPackages_);
-      assert(isDefiningPackage_);
-      currentText_ = new Text;
-      isDefiningDescription_ = true;
-      handleTextDefinition(attributes);
-    }
-    else if (NOTE == name) {
-      assert(!isDefiningLayers_);
-      assert(!isDefiningDescription_);
-      assert(!isDefiningNote_);
-      isDefiningNote_ = true;
-    }
-    else if (WIRE == name) {
-      assert(!isDefiningLayers_);
-      // TODO: add asserts
-      handleWireDefinition(attributes);
-    }
-    else if (HOLE == name) {
-      assert(!isDefiningLayers_);
-      // TODO: add asserts
-      handleHoleDefinition(attributes);
-    }
-    else if (RECTANGLE == name) {
-      // TODO: add asserts
-      assert(!isDefiningLayers_);
-      handleRectangleDefinition(attributes);
-    }
-    else if (CIRCLE == name) {
-      // TODO: add asserts
-      assert(!isDefiningLayers_);
-      handleCircleDefinition(attributes);
-    }
-    else if (PACKAGES == name) {
-      assert(!isDefiningPackages_);
-      assert(!isDefiningPackage_);
-      isDefiningPackages_ = true;
-    }
-    else if (PACKAGE == name) {
-      // NOTE: singular PACKAGE here instead of plural PACKAGES
-      assert(isDefiningPackages_);
-      assert(!isDefiningPackage_);
-      isDefiningPackage_ = true;
-      currentPackage_ = new Package;
-    }
-    else {
-      ++elementCounts_[name];
-    }
-  }
+private:
 
-  void
-  endElement(const XMLCh * const elementName)
+  // Data members
+
+  DecompressingReader reader_;
+  string name_;
+  DecompressingReader::Statistics *statistics_;
+};
+
+/**
+ * Input source for a file, or stdin when the path is empty, which may
+ * be compressed.
+ */
+class DecompressingInputSource : public InputSource
+{
+public:
+
+  // Constructors/destructors
+
+  DecompressingInputSource(const string &path,
+                           DecompressingReader::Statistics *statistics)
+    : InputSource(path.empty() ? "stdin" : path.c_str()),
+      path_(path),
+      statistics_(statistics)
   {
-    string name = getStlString(elementName);
-    if (LAYERS == name) {
-      assert(isDefiningLayers_);
-      assert(!isDefiningBoard_);
-      assert(!isDefiningPlain_);
-      isDefiningLayers_ = false;
-    }
-    else if (BOARD == name) {
-      assert(!isDefiningLayers_);
-      assert(isDefiningBoard_);
-      assert(!isDefiningPlain_);
-      isDefiningBoard_ = false;
-    }
-    else if (PLAIN == name) {
-      assert(!isDefiningLayers_);
-      assert(isDefiningBoard_);
-      assert(isDefiningPlain_);
-      isDefiningPlain_ = false;
-    }
-    else if (TEXT == name) {
-      cerr << "DBG ending text" << endl;
-      assert(!isDefiningLayers_);
-      assert(currentText_);
-      // TODO: are the following correct?
-      // assert(isDefiningPlain_);
-      // isDefiningPlain_ = false;
-      assert(isDefiningText_);
-      if (isDefiningPackage_) {
-        assert(NULL != currentPackage_);
-        currentPackage_->addText(currentText_);
-      }
-      else {
-        assert(!isDefiningPackages_);
-        assert(NULL == currentPackage_);
-        board_.addText(currentText_);
-      }
-      isDefiningText_ = false;
-      // cerr << "DBG text x=" << currentText_->x
-      //      << ",y=" << currentText_->y
-      //      << ",size=" << currentText_->size
-      //      << ",layer=" << currentText_->layer
-      //      << ",ratio=" << currentText_->ratio
-      //      << ",rotation=" << currentText_->rotationDegrees
-      //      << ",value='" << currentText_->value << "'" << endl;
-      currentText_ = NULL;
-    }
-    else if (DESCRIPTION == name) {
-      assert(!isDefiningText_);
-      assert(isDefiningDescription_);
-      assert(!isDefiningNote_);
-      // NOTE: current assumption is that descriptions only apply to
-      // packages.
-      assert(isDefiningPackages_);
-      assert(isDefiningPackage_);
-      assert(NULL != currentPackage_);
-      currentPackage_->setDescription(*currentText_);
-      // TODO: memory leak here
-      delete currentText_;
-      isDefiningDescription_ = false;
-    }
-    else if (NOTE == name) {
-      assert(!isDefiningText_);
-      assert(!isDefiningDescription_);
-      assert(isDefiningNote_);
-      isDefiningNote_ = false;
-    }
-    else if (PACKAGE == name) {
-      assert(isDefiningPackages_);
-      assert(isDefiningPackage_);
-      assert(NULL != currentPackage_);
-      isDefiningPackage_ = false;
-      packages_.push(currentPackage_);
-      currentPackage_ = NULL;
-    }
-    else if (PACKAGES == name) {
-      assert(isDefiningPackages_);
-      assert(!isDefiningPackage_);
-      assert(NULL == currentPackage_);
-      isDefiningPackages_ = false;
-    }
   }
 
-  void
-  characters(const XMLCh * const chars,
-             const XMLSize_t length)
+  // Member functions
+
+  virtual BinInputStream *
+  makeStream() const
   {
-    if (isDefiningText_) {
-      currentText_->handleCharacters(chars, length);
+    if (path_.empty()) {
+      return new DecompressingInputStream(STDIN_FILENO, false, "stdin",
+                                          statistics_);
     }
-    else if (isDefiningDescription_) {
-      // TODO: reassess
-      assert(!isDefiningText_);
-      // currentPackage_->handleCharacters(chars, length);
-      currentText_->handleCharacters(chars, length);
-    }
-    else if (isDefiningNote_) {
-      // Do nothing
-    }
-    else {
-      cerr << "WARN " << length << " unexpected characters: '"
-           << chars << "'" << endl;
+    const int fd = ::open(path_.c_str(), O_RDONLY);
+    if (0 > fd) {
+      // NOTE: the parser reports the missing stream.
+      return NULL;
     }
+    return new DecompressingInputStream(fd, true, path_, statistics_);
   }
 
-  void
-  ignorableWhitespace(const XMLCh * const chars,
-                      const XMLSize_t length)
+private:
+
+  // Data members
+
+  string path_;
+  DecompressingReader::Statistics *statistics_;
+};
+
+/**
+ * Xerces memory manager counting everything the parser allocates under
+ * AllocationStatistics::PARSER_TAG, see --stats.  Each block starts
+ * with a header holding its size, since Xerces doesn't pass the size
+ * back when freeing.
+ */
+class CountingMemoryManager : public MemoryManager
+{
+public:
+
+  // Member functions
+
+  virtual MemoryManager *
+  getExceptionMemoryManager()
   {
-    // Unused
+    return this;
   }
 
-  void
-  processingInstruction(const XMLCh * const target,
-                        const XMLCh * const data)
+  virtual void *
+  allocate(XMLSize_t size)
   {
-    cerr << "DBG processing instruction" << endl;
+    char *block = static_cast<char *>(malloc(HEADER_SIZE + size));
+    if (NULL == block) {
+      throw OutOfMemoryException();
+    }
+    *reinterpret_cast<XMLSize_t *>(block) = size;
+    AllocationStatistics::add(AllocationStatistics::PARSER_TAG, size);
+    return block + HEADER_SIZE;
   }
 
-  // ErrorHandler overrides
-  void
-  warning(const SAXParseException &exc)
+  virtual void
+  deallocate(void *pointer)
   {
-    dumpExceptionDetails("WARN", exc);
+    if (NULL == pointer) {
+      return;
+    }
+    char *block = static_cast<char *>(pointer) - HEADER_SIZE;
+    AllocationStatistics::remove(AllocationStatistics::PARSER_TAG,
+                                 *reinterpret_cast<XMLSize_t *>(block));
+    free(block);
   }
 
-  void
-  error(const SAXParseException &exc)
-  {
-    dumpExceptionDetails("ERR", exc);
+private:
+
+  // Constants
+
+  /** Keeps the blocks handed out as aligned as malloc's. */
+  static const size_t HEADER_SIZE = alignof(max_align_t);
+};
+
+/**
+ * Rebuild the model from a snapshot written by --dump-model, reporting
+ * any problem.
+ */
+static bool
+loadModel(SAXHandler &handler,
+          const ModelReader &model,
+          const string &path)
+{
+  if (!handler.replay(model)) {
+    cerr << "ERR unbalanced model snapshot '" << path << "'" << endl;
+    return false;
   }
+  cerr << "Loading complete with " << handler.getNestingErrors().size()
+       << " errors" << endl;
+  return true;
+}
 
-  void
-  fatalError(const SAXParseException &exc)
-  {
-    dumpExceptionDetails("FATAL", exc);
+static bool
+loadModel(SAXHandler &handler,
+          const string &path)
+{
+  ModelReader model;
+  string error;
+  if (!model.open(path, error)) {
+    cerr << "ERR " << error << endl;
+    return false;
   }
+  return loadModel(handler, model, path);
+}
 
-  // DTDHandler interface
-  void
-  notationDecl(const XMLCh * const name,
-               const XMLCh * const publicId,
-               const XMLCh * const systemId)
-  {
-    // Unused
+/**
+ * Report how reading the input went, for --stats.
+ */
+static void
+printInputStatistics(const DecompressingReader::Statistics &statistics)
+{
+  cerr << "INFO read " << statistics.inputBytes << " bytes ("
+       << statistics.outputBytes << " after decompression) in "
+       << statistics.readCount << " reads taking " << statistics.readSeconds
+       << "s, consumer stalled " << statistics.stallSeconds
+       << "s waiting for input, reader idle " << statistics.idleSeconds
+       << "s" << endl;
+}
+
+/**
+ * Report how writing the output went, see --stats.
+ */
+static void
+printOutputStatistics(OutputWriter &writer)
+{
+  const OutputWriter::Statistics statistics = writer.getStatistics();
+  cerr << "INFO wrote " << statistics.bytes << " bytes in "
+       << statistics.writeCount << " writes using " << writer.getBackendName()
+       << ", producer stalled " << statistics.stallSeconds
+       << "s waiting for buffers" << endl;
+}
+
+/**
+ * Report how keeping under --memory-limit went, see --stats.
+ */
+static void
+printMemoryStatistics(const MemoryBudget &budget,
+                      const SpillFile &spillFile)
+{
+  cerr << "INFO spilled " << spillFile.getSize() << " bytes in "
+       << spillFile.getChunkCount() << " chunks to stay under "
+       << budget.getLimit() << " bytes, peak resident size "
+       << MemoryBudget::getPeakResidentBytes() << " bytes" << endl;
+}
+
+/**
+ * Report the memory allocated by each part of the converter, see
+ * --stats.
+ */
+static void
+printAllocationStatistics()
+{
+  for (unsigned tag = 0; tag < AllocationStatistics::TAG_COUNT; ++tag) {
+    const AllocationStatistics::Counters counters =
+      AllocationStatistics::get(static_cast<AllocationStatistics::Tag>(tag));
+    cerr << "INFO memory for "
+         << AllocationStatistics::getName(static_cast<AllocationStatistics::Tag>(tag))
+         << ": " << counters.current << " bytes in use, peak "
+         << counters.peak << " bytes, " << counters.count << " allocations"
+         << endl;
   }
+  cerr << "INFO peak resident size " << MemoryBudget::getPeakResidentBytes()
+       << " bytes" << endl;
+}
 
-  void
-  unparsedEntityDecl(const XMLCh * const name,
-                     const XMLCh * const publicId,
-                     const XMLCh * const systemId,
-                     const XMLCh * const notationName)
-  {
-    // Unused
+/**
+ * Read the whole decompressed content of fd into document.
+ */
+static bool
+readDocument(const int fd,
+             const bool isOwningFd,
+             string &document,
+             DecompressingReader::Statistics &statistics,
+             string &error)
+{
+  DecompressingReader reader(fd, isOwningFd);
+  char block[64 << 10];
+  size_t count;
+  while (0 < (count = reader.read(block, sizeof(block)))) {
+    document.append(block, count);
   }
+  statistics = reader.getStatistics();
+  error = reader.getError();
+  return error.empty();
+}
 
-  virtual void
-  setDocumentLocator(const Locator * const locator)
-  {
-    if (NULL != locator_) {
-      delete locator_;
-    }
-    locator_ = new LocatorManager(locator);
+/**
+ * Read the whole decompressed input, from a file or stdin, for hashing
+ * and parsing.
+ */
+static bool
+readInput(const po::variables_map &args,
+          string &document,
+          DecompressingReader::Statistics &statistics)
+{
+  const string path = args.count("input") ? args["input"].as<string>() : "stdin";
+  const int fd = args.count("input") ? ::open(path.c_str(), O_RDONLY) : STDIN_FILENO;
+  if (0 > fd) {
+    cerr << "ERR unable to read '" << path << "'" << endl;
+    return false;
+  }
+  string error;
+  if (!readDocument(fd, 0 != args.count("input"), document, statistics, error)) {
+    cerr << "ERR " << error << " in '" << path << "'" << endl;
+    return false;
   }
+  return true;
+}
 
-private:
+/**
+ * Parses the sections found by SectionSplitter, and the skeleton left
+ * around them, concurrently on separate handlers which only record
+ * their events.  The recordings are then replayed into the target
+ * handler in document order, so the model is built exactly as by a
+ * serial parse.
+ *
+ * NOTE: fragments have no document type declaration, so nothing is
+ * validated against the DTD.
+ */
+class ParallelParser
+{
+public:
 
-  // Types
+  // Constructors/destructors
 
-  enum Language {
-    ENGLISH,
-    GERMAN
-  };
+  explicit ParallelParser(const unsigned threadCount)
+    : threadCount_(threadCount), document_(NULL), nextTask_(0)
+  {
+  }
 
-  typedef map<string, unsigned> CountMap;
-  typedef map<string, unsigned>::iterator CountIterator;
-  typedef map<string, string> StringMap;
-  typedef map<string, string>::iterator StringIterator;
+  // Member functions
 
   /**
-   * Wrapper which allows the SAXParser to receive a copy of the
-   * Locator object.
+   * Build the model of a document in handler, returns false without
+   * touching handler if the document can't be parsed in sections.
+   * Otherwise errorCount is the number of parse errors.
    */
-  class LocatorManager
+  bool
+  parse(const string &document,
+        SAXHandler &handler,
+        size_t &errorCount)
   {
-  public:
-    LocatorManager(const Locator * const locator)
-      : locator_(locator)
-    {
+    if (!splitter_.split(document)) {
+      return false;
     }
-
-    const XMLCh *
-    getPublicId () const
-    {
-      return locator_->getPublicId();
+    document_ = &document;
+    const vector<SectionSplitter::Section> &sections = splitter_.getSections();
+    results_.assign(sections.size() + 1, Result());
+    nextTask_ = 0;
+    vector<thread> threads;
+    const size_t threadCount = min<size_t>(threadCount_, results_.size());
+    for (size_t index = 1; index < threadCount; ++index) {
+      threads.push_back(thread(&ParallelParser::work, this));
+    }
+    work();
+    for (vector<thread>::iterator iter = threads.begin();
+         iter != threads.end(); ++iter) {
+      iter->join();
+    }
+
+    // Check that each placeholder ended up where its section belongs
+    // before building anything.
+    const vector<SAXHandler::Context> &contexts = results_[0].sectionContexts;
+    if (contexts.size() != sections.size()) {
+      return false;
     }
-
-    const XMLCh *
-    getSystemId () const
-    {
-      return locator_->getSystemId();
+    for (size_t index = 0; index < sections.size(); ++index) {
+      if (!isExpectedParent(sections[index].kind, contexts[index])) {
+        return false;
+      }
     }
-
-    XMLSSize_t
-    getLineNumber () const
-    {
-      return locator_->getLineNumber();
+    for (vector<Result>::const_iterator result = results_.begin();
+         result != results_.end(); ++result) {
+      ModelReader model;
+      string error;
+      if (!model.load(result->image, error)) {
+        cerr << "ERR section " << error << endl;
+        return false;
+      }
     }
+    merge(handler, errorCount);
+    return true;
+  }
 
-    XMLSSize_t
-    getColumnNumber () const
-    {
-      return locator_->getColumnNumber();
-    }
+private:
+
+  // Types
 
-  private:
-    const Locator * const locator_;
+  struct Result
+  {
+    string image;
+    size_t errorCount;
+    vector<SAXHandler::NestingError> nestingErrors;
+    vector<SAXHandler::Context> sectionContexts;
   };
 
-  /**
-   * Extract a string from an attribute using a policy.
-   */
-  template <typename GetPolicy> static string
-  extract(const AttributeList &attributes,
-          const unsigned index)
+  // Member functions
+
+  static bool
+  isExpectedParent(const Subtree::Kind kind,
+                   const SAXHandler::Context context)
   {
-    return GetPolicy::get(attributes, index);
+    switch (kind) {
+    case Subtree::PLAIN:
+      return SAXHandler::BOARD_CONTEXT == context;
+    case Subtree::LIBRARY:
+      return (SAXHandler::LIBRARIES_CONTEXT == context) ||
+        (SAXHandler::DOCUMENT_CONTEXT == context);
+    case Subtree::ELEMENTS:
+      return (SAXHandler::BOARD_CONTEXT == context) ||
+        (SAXHandler::DOCUMENT_CONTEXT == context);
+    case Subtree::SIGNAL:
+      return SAXHandler::SIGNALS_CONTEXT == context;
+    case Subtree::PACKAGE:
+      break;
+    }
+    return false;
   }
 
   /**
-   * Policy class for extracting the name of an attribute.
+   * Thread body, parses tasks until there are none left: task 0 is the
+   * skeleton and task n section n - 1.
    */
-  class NameGetter
+  void
+  work()
   {
-  public:
-    static string
-    get(const AttributeList &attributes,
-        const unsigned index)
-    {
-      return getStlString(attributes.getName(index));
+    SAXParser parser;
+    configureParser(parser);
+    for (size_t task = nextTask_++; task < results_.size(); task = nextTask_++) {
+      const string fragment = (0 == task) ? splitter_.getSkeleton() :
+        splitter_.getFragment(*document_, task - 1);
+      Result &result = results_[task];
+      ModelWriter recorder;
+      SAXHandler handler;
+      handler.setRecorder(&recorder);
+      handler.setRecordingOnly(true);
+      parser.setDocumentHandler(&handler);
+      parser.setErrorHandler(&handler);
+      MemBufInputSource source(reinterpret_cast<const XMLByte *>(fragment.data()),
+                               fragment.size(), "section");
+      parser.parse(source);
+      parser.setDocumentHandler(NULL);
+      parser.setErrorHandler(NULL);
+      recorder.serialize(result.image);
+      result.errorCount = parser.getErrorCount();
+      result.nestingErrors = handler.getNestingErrors();
+      result.sectionContexts = handler.getSectionContexts();
     }
-  };
+  }
 
   /**
-   * Policy class for extracting the value of an attribute.
+   * Replay the skeleton with each placeholder replaced by its section,
+   * less any wrapper, then report the nesting errors in line order.
+   * The recordings have already been validated.
    */
-  class ValueGetter
+  void
+  merge(SAXHandler &handler,
+        size_t &errorCount)
   {
-  public:
-    static string
-    get(const AttributeList &attributes,
-        const unsigned index)
-    {
-      return getStlString(attributes.getValue(index));
+    const vector<SectionSplitter::Section> &sections = splitter_.getSections();
+    vector<SAXHandler::NestingError> nestingErrors(results_[0].nestingErrors);
+    errorCount = results_[0].errorCount;
+    ModelReader skeleton;
+    string error;
+    skeleton.load(results_[0].image, error);
+    handler.startDocument();
+    size_t next = 0;
+    size_t index = 0;
+    const size_t count = skeleton.getEventCount();
+    for (size_t event = 0; event < count; ++event) {
+      if ((ModelLayout::START_EVENT != skeleton.getEventType(event)) ||
+          (skeleton.getEventString(event) != SectionSplitter::PLACEHOLDER)) {
+        continue;
+      }
+      handler.replayEvents(skeleton, next, event);
+      // NOTE: placeholders are empty, so their end event follows.
+      next = event + 2;
+
+      const SectionSplitter::Section &section = sections[index];
+      const Result &result = results_[index + 1];
+      ++index;
+      ModelReader model;
+      model.load(result.image, error);
+      const size_t wrapping = (NULL == section.wrapper) ? 0 : 1;
+      if (model.getEventCount() >= 2 * wrapping) {
+        handler.replayEvents(model, wrapping, model.getEventCount() - wrapping);
+      }
+      errorCount += result.errorCount;
+      for (vector<SAXHandler::NestingError>::const_iterator iter =
+             result.nestingErrors.begin();
+           iter != result.nestingErrors.end(); ++iter) {
+        // NOTE: wrappers don't add lines, but do shift the first one.
+        nestingErrors.push_back(
+          SAXHandler::NestingError(iter->getElement(), iter->getContext(),
+                                   iter->getLineNumber() + section.line - 1,
+                                   iter->getColumnNumber()));
+      }
     }
-  };
+    handler.replayEvents(skeleton, next, count);
+    handler.endDocument();
 
-  /**
-   * Xerces SAX parsing API doesn't support an object associated with
-   * a single (name, value) attribute, so it is implemented here.
-   */
-  class Attribute : public pair<const string, const string>
+    stable_sort(nestingErrors.begin(), nestingErrors.end(), isEarlier);
+    for (vector<SAXHandler::NestingError>::const_iterator iter =
+           nestingErrors.begin();
+         iter != nestingErrors.end(); ++iter) {
+      handler.addNestingError(*iter);
+    }
+    errorCount += nestingErrors.size();
+  }
+
+  static bool
+  isEarlier(const SAXHandler::NestingError &first,
+            const SAXHandler::NestingError &second)
   {
-  public:
+    return first.getLineNumber() < second.getLineNumber();
+  }
 
-    // Constructors/destructors
+  // Data members
 
-    Attribute(const AttributeList &attributes,
-              const unsigned index)
-      : attribute_(make_pair(extract<NameGetter>(attributes, index),
-                             extract<ValueGetter>(attributes, index)))
-    {
-    }
+  unsigned threadCount_;
+  SectionSplitter splitter_;
+  const string *document_;
+  vector<Result> results_;
+  atomic<size_t> nextTask_;
+};
 
-    // Member functions
+/**
+ * Writes every package of a parsed library (or of the libraries
+ * embedded in a board) as a gEDA footprint file, <package>.fp in a
+ * subdirectory named after its library, or in the directory itself for
+ * a library without a name.
+ *
+ * The directories are all created up front, then the footprints are
+ * rendered on a pool of threads and handed to an OutputWriter.  Each
+ * thread keeps a few files open while they are written, so rendering
+ * doesn't wait for every file in turn.
+ */
+class FootprintWriter
+{
+public:
 
-    const string &
-    getName() const
-    {
-      return attribute_.first;
-    }
+  // Constants
 
-    const string &
-    getValue() const
-    {
-      return attribute_.second;
-    }
+  /** Buffer size for an OutputWriter suited to footprints. */
+  static const size_t BUFFER_SIZE = 64 << 10;
 
-  private:
+  // Constructors/destructors
 
-    // Data members
-    const pair<const string, const string> attribute_;
-  };
+  FootprintWriter(const unsigned threadCount,
+                  OutputWriter &writer)
+    : threadCount_(threadCount), writer_(writer), handler_(NULL), nextTask_(0)
+  {
+  }
+
+  // Member functions
 
   /**
-   * Mixin for Eagle board file elements which have a specified width.
+   * Write the footprints of handler below directory, returns false
+   * after reporting the problems if any file couldn't be written.
+   * Otherwise fileCount is the number of footprints written.
    */
-  class HasWidth
+  bool
+  write(const SAXHandler &handler,
+        const string &directory,
+        size_t &fileCount)
   {
-  public:
-
-    // Constructors/destructors
-
-    HasWidth()
-      : width_(0.0), hasWidth_(false)
-    {}
-
-    // Member functions
-
-    double
-    getWidth() const
-    {
-      assert(hasWidth_);
-      return width_;
+    fileCount = 0;
+    handler_ = &handler;
+    keys_ = handler.getPackageKeys();
+    paths_.assign(keys_.size(), string());
+    errors_.assign(keys_.size(), string());
+
+    set<string> libraryDirectories;
+    for (size_t index = 0; index < keys_.size(); ++index) {
+      string path = directory;
+      if (!keys_[index].first.empty()) {
+        path += "/" + getFileName(keys_[index].first);
+        libraryDirectories.insert(path);
+      }
+      paths_[index] = path + "/" + getFileName(keys_[index].second) + ".fp";
+    }
+    if (!makeDirectory(directory)) {
+      return false;
+    }
+    for (set<string>::const_iterator path = libraryDirectories.begin();
+         path != libraryDirectories.end(); ++path) {
+      if (!makeDirectory(*path)) {
+        return false;
+      }
     }
 
-    bool
-    hasWidth() const
-    {
-      return hasWidth_;
+    nextTask_ = 0;
+    vector<thread> threads;
+    const size_t threadCount = min<size_t>(threadCount_, keys_.size());
+    for (size_t index = 1; index < threadCount; ++index) {
+      threads.push_back(thread(&FootprintWriter::work, this));
+    }
+    work();
+    for (vector<thread>::iterator iter = threads.begin();
+         iter != threads.end(); ++iter) {
+      iter->join();
     }
 
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      const string &name = attribute.getName();
-      const char * const value = attribute.getValue().c_str();
-      if (WIDTH == name) {
-        assert(!hasWidth_);
-        width_ = atof(value);
-        hasWidth_ = true;
-        return true;
+    bool isWritten = true;
+    for (size_t index = 0; index < keys_.size(); ++index) {
+      if (errors_[index].empty()) {
+        ++fileCount;
+      }
+      else {
+        cerr << "ERR " << errors_[index] << endl;
+        isWritten = false;
       }
-      return false;
     }
+    return isWritten;
+  }
+
+private:
 
-  private:
+  // Member functions
 
-    // Data members
+  /**
+   * Name of a file or directory for a library or package name, which
+   * may contain path separators.
+   */
+  static string
+  getFileName(const string &name)
+  {
+    string fileName(name);
+    replace(fileName.begin(), fileName.end(), '/', '_');
+    if (("." == fileName) || (".." == fileName)) {
+      fileName.insert(0, "_");
+    }
+    return fileName;
+  }
 
-    double width_;
-    bool hasWidth_;
-  };
+  static bool
+  makeDirectory(const string &path)
+  {
+    struct stat status;
+    if (((0 != ::mkdir(path.c_str(), 0777)) && (EEXIST != errno)) ||
+        (0 != ::stat(path.c_str(), &status)) || !S_ISDIR(status.st_mode)) {
+      cerr << "ERR unable to create footprint directory '" << path << "'"
+           << endl;
+      return false;
+    }
+    return true;
+  }
 
   /**
-   * Mixin to add layer data to Eagle board file elements.
+   * Thread body, writes footprints until there are none left.
    */
-  class InLayer
+  void
+  work()
+  {
+    // (task, file) of the footprints being written, oldest first.
+    deque<pair<size_t, OutputFile *> > files;
+    for (size_t task = nextTask_++; task < keys_.size(); task = nextTask_++) {
+      if (OPEN_FILE_COUNT == files.size()) {
+        finish(files.front().first, files.front().second);
+        files.pop_front();
+      }
+      OutputFile *file = new OutputFile(writer_);
+      if (!file->open(paths_[task], errors_[task])) {
+        delete file;
+        continue;
+      }
+      {
+        ostream output(file);
+        handler_->printFootprint(output, keys_[task]);
+      }
+      file->submit();
+      files.push_back(make_pair(task, file));
+    }
+    for (; !files.empty(); files.pop_front()) {
+      finish(files.front().first, files.front().second);
+    }
+  }
+
+  void
+  finish(const size_t task,
+         OutputFile *file)
   {
-  public:
+    file->close(errors_[task]);
+    delete file;
+  }
 
-    // Constructors/destructors
+  // Constants
 
-    InLayer()
-      : layer_(0), hasLayer_(false)
-    {}
+  static const size_t OPEN_FILE_COUNT = 16;
 
-    // Member functions
+  // Data members
 
-    unsigned
-    getLayer() const
-    {
-      assert(hasLayer_);
-      return layer_;
-    }
+  unsigned threadCount_;
+  OutputWriter &writer_;
+  const SAXHandler *handler_;
+  vector<pair<string, string> > keys_;
+  vector<string> paths_;
+  vector<string> errors_;
+  atomic<size_t> nextTask_;
+};
 
-    bool
-    hasLayer() const
-    {
-      return hasLayer_;
-    }
+/**
+ * Reconverts a board file whenever it changes.
+ *
+ * The parsed model and a content hash of each <plain>, <library>,
+ * <package>, <elements> and <signal> subtree are kept from the previous
+ * conversion.  When the file changes only the subtrees whose hashes
+ * differ are parsed again (as standalone fragments) and only the output
+ * which depends on them is regenerated; anything else (e.g. a change to
+ * the layers or design rules, or a removed package) falls back to a
+ * full conversion.
+ */
+class WatchSession
+{
+public:
 
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if (LAYER == attribute.getName()) {
-        assert(!hasLayer_);
-        layer_ = atoi(attribute.getValue().c_str());
-        hasLayer_ = true;
-        return true;
-      }
-      return false;
-    }
+  // Constructors/destructors
 
-  private:
+  WatchSession(const string &inputPath,
+               const string &outputPath,
+               const bool isPreClearing,
+               const bool isSnapping,
+               const bool isIncludingTextExtents)
+    : inputPath_(inputPath), outputPath_(outputPath),
+      isPreClearing_(isPreClearing), isSnapping_(isSnapping),
+      isIncludingTextExtents_(isIncludingTextExtents), handler_(NULL),
+      remainderHash_(0), originY_(0.0)
+  {
+    configureParser(parser_);
+  }
 
-    // Data members
+  ~WatchSession()
+  {
+    delete handler_;
+  }
 
-    unsigned layer_;
-    bool hasLayer_;
-  };
+  // Member functions
 
-  // TODO: use boost::units?
   /**
-   * Mixin representing the pose (in a robotics/kinematics sense of
-   * including both position and rotation) of an element in the Eagle
-   * layout.
+   * Poll the input file for changes, never returns.
    */
-  class Pose : public InLayer
+  void
+  run()
   {
-  public:
+    bool hasStatus = false;
+    struct stat last;
+    memset(&last, 0, sizeof(last));
+    for (;;) {
+      struct stat current;
+      if ((0 == stat(inputPath_.c_str(), &current)) &&
+          ((!hasStatus) || isModified(last, current))) {
+        last = current;
+        hasStatus = true;
+        update();
+      }
+      usleep(POLL_INTERVAL_USEC);
+    }
+  }
 
-    // Constructors/destructors
+private:
 
-    Pose()
-      : x_(0.0), y_(0.0), rotationDegrees_(0.0),
-        hasX_(false), hasY_(false), hasRotation_(false)
-    {
-    }
+  // Types
 
-    // Member functions
+  typedef map<string, uint64_t> HashMap;
 
-    Millimeters
-    getX() const
-    {
-      assert(hasX_);
-      return x_;
-    }
-
-    double
-    getY() const
-    {
-      assert(hasY_);
-      return y_;
-    }
+  // Member functions
 
-    double
-    getRotationDegrees() const
-    {
-      assert(hasRotation_);
-      return rotationDegrees_;
-    }
+  static bool
+  isModified(const struct stat &last,
+             const struct stat &current)
+  {
+    return (last.st_mtim.tv_sec != current.st_mtim.tv_sec) ||
+      (last.st_mtim.tv_nsec != current.st_mtim.tv_nsec) ||
+      (last.st_size != current.st_size) ||
+      (last.st_ino != current.st_ino);
+  }
 
-    bool
-    hasX() const
+  void
+  update()
+  {
+    string document;
     {
-      return hasX_;
+      const int fd = ::open(inputPath_.c_str(), O_RDONLY);
+      if (0 > fd) {
+        cerr << "WARN unable to read '" << inputPath_ << "'" << endl;
+        return;
+      }
+      // NOTE: decompressed like any other input, so that watching a
+      // .brd.gz or .brd.zst works too.  A compressed file caught half
+      // written is reported like a truncated board.
+      DecompressingReader::Statistics statistics;
+      string error;
+      if (!readDocument(fd, true, document, statistics, error)) {
+        cerr << "WARN " << error << " in '" << inputPath_
+             << "', output not updated" << endl;
+        return;
+      }
     }
+    const chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    size_t changed = 0;
+    const bool isIncremental = convertChanges(document, changed);
+    if ((!isIncremental) && (!convertAll(document))) {
+      // Most likely caught the file in the middle of being written,
+      // keep the previous output until the next change.
+      cerr << "WARN errors parsing '" << inputPath_
+           << "', output not updated" << endl;
+      return;
+    }
+    if (!writeOutput()) {
+      return;
+    }
+    const chrono::steady_clock::duration elapsed =
+      chrono::steady_clock::now() - start;
+    cerr << "INFO " << (isIncremental ? "incremental" : "full")
+         << " conversion of '" << inputPath_ << "' (" << changed
+         << " subtrees changed) in "
+         << chrono::duration_cast<chrono::microseconds>(elapsed).count() / 1000.0
+         << " ms" << endl;
+  }
 
-    bool
-    hasY() const
-    {
-      return hasY_;
+  bool
+  convertAll(const string &document)
+  {
+    delete handler_;
+    handler_ = new SAXHandler;
+    handler_->setIncludingTextExtents(isIncludingTextExtents_);
+    hashes_.clear();
+    if (!parse(document)) {
+      delete handler_;
+      handler_ = NULL;
+      return false;
     }
-
-    bool
-    hasRotation() const
-    {
-      return hasRotation_;
+    if (isSnapping_) {
+      handler_->snapToGrid();
     }
-
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if (!InLayer::tryHandleAttribute(attribute)) {
-        const string &name = attribute.getName();
-        const char * const value = attribute.getValue().c_str();
-        if (X == name) {
-          assert(!hasX_);
-          x_ = atof(value);
-          hasX_ = true;
-          return true;
-        }
-        if (Y == name) {
-          assert(!hasY_);
-          y_ = atof(value);
-          hasY_ = true;
-          return true;
-        }
-        if (ROTATION == name) {
-          assert(!hasRotation_);
-          rotationDegrees_ = atof(value);
-          hasRotation_ = true;
-          return true;
-        }
-        return false;
-        
+    if (scanner_.scan(document.data(), document.size())) {
+      remainderHash_ = scanner_.getRemainderHash();
+      const vector<Subtree> &subtrees = scanner_.getSubtrees();
+      for (vector<Subtree>::const_iterator subtree = subtrees.begin();
+           subtree != subtrees.end(); ++subtree) {
+        hashes_[subtree->getKey(subtrees)] = subtree->getHash();
       }
-      // Attribute actually specified the layer.
-      return true;
     }
-  private:
-
-    // Data members
-
-    Millimeters x_;
-    double y_;
-    double rotationDegrees_;
-    bool hasX_;
-    bool hasY_;
-    bool hasRotation_;
-  };
+    originY_ = handler_->getOriginY();
+    elementTexts_.assign(handler_->getElementCount(), string());
+    for (size_t index = 0; index < elementTexts_.size(); ++index) {
+      renderElement(index);
+    }
+    renderVias();
+    renderLayers();
+    renderNetList();
+    return true;
+  }
 
   /**
-   * Representation of a text element of an Eagle board or
-   * package.
+   * Parse and convert only the subtrees which changed, returns false if
+   * a full conversion is required instead.
    */
-  class Text : public Pose
+  bool
+  convertChanges(const string &document,
+                 size_t &changedCount)
   {
-  public:
-
-    // Constructors/destructors
-
-    Text()
-      : language_(ENGLISH), size_(0), ratio_(0), string_(""),
-        hasSize_(false), hasRatio_(false), hasString_(false)
-    {
+    if ((NULL == handler_) ||
+        (!scanner_.scan(document.data(), document.size())) ||
+        (remainderHash_ != scanner_.getRemainderHash())) {
+      return false;
     }
-
-
-    // Member functions
-
-    Language
-    getLanguage() const
-    {
-      return language_;
+    const vector<Subtree> &subtrees = scanner_.getSubtrees();
+    HashMap hashes;
+    vector<const Subtree *> changed;
+    for (vector<Subtree>::const_iterator subtree = subtrees.begin();
+         subtree != subtrees.end(); ++subtree) {
+      const string key = subtree->getKey(subtrees);
+      hashes[key] = subtree->getHash();
+      const HashMap::const_iterator previous = hashes_.find(key);
+      if ((hashes_.end() != previous) &&
+          (previous->second == subtree->getHash())) {
+        continue;
+      }
+      if (Subtree::LIBRARY == subtree->getKind()) {
+        return false;
+      }
+      changed.push_back(&*subtree);
     }
-
-    double
-    getSize() const
-    {
-      assert(hasSize_);
-      return size_;
+    for (HashMap::const_iterator previous = hashes_.begin();
+         previous != hashes_.end(); ++previous) {
+      if (0 == hashes.count(previous->first)) {
+        // Removed subtree.
+        return false;
+      }
     }
 
-    double
-    getRatio() const
-    {
-      assert(hasRatio_);
-      return ratio_;
+    bool isPlainChanged = false;
+    bool isElementsChanged = false;
+    bool isSignalsChanged = false;
+    handler_->setReplacing(true);
+    for (vector<const Subtree *>::const_iterator iter = changed.begin();
+         iter != changed.end(); ++iter) {
+      const Subtree &subtree = **iter;
+      const string content =
+        document.substr(subtree.getBegin(), subtree.getEnd() - subtree.getBegin());
+      bool isParsed = true;
+      switch (subtree.getKind()) {
+      case Subtree::PLAIN:
+        isPlainChanged = true;
+        handler_->clearPlain();
+        isParsed = parse("<board>" + content + "</board>");
+        break;
+      case Subtree::PACKAGE:
+        {
+          // NOTE: the library start tag is reused as is so that the
+          // package is indexed under the same library name.
+          const Subtree &library = subtrees[subtree.getLibrary()];
+          isParsed = parse("<libraries>" +
+                           document.substr(library.getBegin(),
+                                           library.getContentBegin() -
+                                           library.getBegin()) +
+                           "<packages>" + content +
+                           "</packages></library></libraries>");
+        }
+        break;
+      case Subtree::ELEMENTS:
+        isElementsChanged = true;
+        handler_->clearElements();
+        isParsed = parse(content);
+        break;
+      case Subtree::SIGNAL:
+        isSignalsChanged = true;
+        isParsed = parse("<signals>" + content + "</signals>");
+        break;
+      case Subtree::LIBRARY:
+        assert(false);
+        break;
+      }
+      if (!isParsed) {
+        return false;
+      }
     }
-
-    const string &
-    getString() const
-    {
-      assert(hasString_);
-      return string_;
+    handler_->setReplacing(false);
+    hashes_.swap(hashes);
+    changedCount = changed.size();
+    if (isSnapping_) {
+      // NOTE: snapping again leaves the unchanged parts as they were.
+      handler_->snapToGrid();
+    }
+
+    const vector<size_t> changedElements = handler_->resolveElements();
+    // NOTE: the origin follows the outline, or the elements and text
+    // when there is none or text extents are included.
+    const double originY = handler_->getOriginY();
+    const bool isOriginMoved = (originY != originY_);
+    if (isElementsChanged || isOriginMoved) {
+      originY_ = originY;
+      elementTexts_.assign(handler_->getElementCount(), string());
+      for (size_t index = 0; index < elementTexts_.size(); ++index) {
+        renderElement(index);
+      }
     }
-
-    bool
-    hasSize() const
-    {
-      return hasSize_;
+    else {
+      for (vector<size_t>::const_iterator index = changedElements.begin();
+           index != changedElements.end(); ++index) {
+        renderElement(*index);
+      }
     }
-
-    bool
-    hasRatio() const
-    {
-      return hasRatio_;
+    if (isPlainChanged || isSignalsChanged || isOriginMoved) {
+      renderVias();
+      renderLayers();
     }
-
-    bool
-    hasString() const
-    {
-      return hasString_;
+    if (isSignalsChanged) {
+      renderNetList();
     }
+    return true;
+  }
 
-    void
-    handleCharacters(const XMLCh * const chars,
-                     const XMLSize_t length)
-    {
-      assert(!hasString_);
-      string_ = getStlString(chars);
-      hasString_ = true;
-      // TODO: assert(length == string_.length()); ??
-    }
+  bool
+  parse(const string &content)
+  {
+    parser_.setDocumentHandler(handler_);
+    parser_.setErrorHandler(handler_);
+    MemBufInputSource source(reinterpret_cast<const XMLByte *>(content.data()),
+                             content.size(), inputPath_.c_str());
+    const size_t nestingErrorCount = handler_->getNestingErrors().size();
+    parser_.parse(source);
+    return (0 == parser_.getErrorCount()) &&
+      (nestingErrorCount == handler_->getNestingErrors().size());
+  }
 
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if (!Pose::tryHandleAttribute(attribute)) {
-        const string &name = attribute.getName();
-        const char * const value = attribute.getValue().c_str();
-        if (SIZE == name) {
-          assert(!hasSize_);
-          size_ = atof(value);
-          hasSize_ = true;
-          return true;
-        }
-        if (RATIO == name) {
-          assert(!hasRatio_);
-          ratio_ = atof(value);
-          hasRatio_ = true;
-          return true;
-        }
-        if (LANGUAGE == name) {
-          if (EN == value) {
-            language_ = ENGLISH;
-          }
-          else if (DE == value) {
-            language_ = GERMAN;
-          }
-          else {
-            cerr << "WARN unknown language type '" << value << "'" << endl;
-          }
-          return true;
-        }
-        if ((FONT == name) || (ALIGN == name)) {
-          // TODO: handle this if possible, currently short-circuits
-          // processing of this attribute so that it won't be reported
-          // as unexpected.
-          return true;
-        }
-        return false;
-      }
-      return true;
-    }
+  void
+  renderElement(const size_t index)
+  {
+    ostringstream strm;
+    handler_->printElement(strm, index, originY_);
+    elementTexts_[index] = strm.str();
+  }
 
-  private:
+  void
+  renderVias()
+  {
+    ostringstream strm;
+    handler_->printVias(strm);
+    viasText_ = strm.str();
+  }
 
-    // Data members
+  void
+  renderLayers()
+  {
+    ostringstream strm;
+    handler_->printLayers(strm, isPreClearing_);
+    layersText_ = strm.str();
+  }
 
-    Language language_;
-    double size_;
-    double ratio_;
-    string string_;
-    bool hasSize_;
-    bool hasRatio_;
-    bool hasString_;
-  };
+  void
+  renderNetList()
+  {
+    ostringstream strm;
+    handler_->printNetList(strm);
+    netListText_ = strm.str();
+  }
 
   /**
-   * Representation of a hole element (including a via) of an Eagle
-   * board or package.
-   *
-   * NOTE: doesn't really need the rotation element, but no need to
-   * create a separate class with position but no rotation to handle
-   * only this case.
+   * Write the output from the cached conversion results, replacing the
+   * previous output atomically.  Returns false, leaving the previous
+   * output in place, if the new one couldn't be written in full.
    */
-  class Hole : public Pose
+  bool
+  writeOutput() const
   {
-  public:
-    Hole(const bool isVia)
-      : drill_(0.0), hasDrill_(false), isVia_(isVia)
-    {
-    }
-
-    double
-    getDrill() const
-    {
-      assert(hasDrill_);
-      return drill_;
-    }
-
-    bool
-    hasDrill() const
-    {
-      return hasDrill_;
+    const string temporaryPath = outputPath_ + ".tmp";
+    ofstream output(temporaryPath.c_str(), ios::out | ios::trunc);
+    printHeader(output, *handler_);
+    output << viasText_;
+    for (vector<string>::const_iterator text = elementTexts_.begin();
+         text != elementTexts_.end(); ++text) {
+      output << *text;
+    }
+    output << layersText_;
+    output << netListText_;
+    output.close();
+    if (!output.good()) {
+      // NOTE: e.g. a full disk, renaming would replace a good output
+      // with a truncated one.
+      cerr << "ERR unable to write '" << temporaryPath << "', output not "
+           << "updated" << endl;
+      unlink(temporaryPath.c_str());
+      return false;
     }
-
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if (!Pose::tryHandleAttribute(attribute)) {
-        const string &name = attribute.getName();
-        const char * const value = attribute.getValue().c_str();
-        if (DRILL == name) {
-          assert(!hasDrill_);
-          drill_ = atof(value);
-          hasDrill_ = true;
-          return true;
-        }
-        return false;
-      }
-      return true;
+    if (0 != rename(temporaryPath.c_str(), outputPath_.c_str())) {
+      cerr << "ERR unable to replace '" << outputPath_ << "'" << endl;
+      unlink(temporaryPath.c_str());
+      return false;
     }
+    return true;
+  }
 
-  private:
-    double drill_;
-    bool hasDrill_;
-    const bool isVia_;
-  };
+  // Constants
 
-  /**
-   * Mixin to add end point data to certain types of Eagle board file
-   * elements.
-   */
-  class EndPoints : public InLayer, HasWidth
-  {
-  public:
+  static const unsigned POLL_INTERVAL_USEC = 100000;
 
-    // Constructors/destructors
+  // Data members
 
-    EndPoints()
-      : x1_(0.0), y1_(0.0), x2_(0.0), y2_(0.0),
-        hasX1_(false), hasY1_(false), hasX2_(false), hasY2_(false)
-    {
-    }
+  const string inputPath_;
+  const string outputPath_;
+  const bool isPreClearing_;
+  const bool isSnapping_;
+  const bool isIncludingTextExtents_;
+  SAXParser parser_;
+  SAXHandler *handler_;
+  SubtreeScanner scanner_;
+  HashMap hashes_;
+  uint64_t remainderHash_;
+  double originY_;
+  vector<string> elementTexts_;  // Output for each element.
+  string viasText_;
+  string layersText_;
+  string netListText_;
+};
 
-    // Member functions
+/**
+ * Converter for --serve.  Each worker keeps a parser which is reused
+ * from one request to the next, and parsed boards are shared between
+ * workers through the parse cache, if there is one.  A request
+ * converts its body, or the (possibly compressed) file named by its
+ * "path" field, with these optional fields:
+ *
+ *   option pre-clear-polygons|check-nets|check-clearance|snap-to-grid|
+ *          text-extents
+ *   timeout-ms N (at most --request-timeout)
+ *   memory-limit N (megabytes, at most --request-memory)
+ *
+ * The body of the response is the gEDA pcb layout, its fields report
+ * how the conversion went, with a "log" field for each line reported
+ * by the checks or the snap.
+ */
+class ServeSession : public ConversionServer::Converter
+{
+public:
 
-    double
-    getX1() const
-    {
-      assert(hasX1_);
-      return x1_;
-    }
+  // Constructors/destructors
 
-    double
-    getY1() const
-    {
-      assert(hasY1_);
-      return y1_;
+  ServeSession(const unsigned workerCount,
+               const unsigned timeoutMilliseconds,
+               const unsigned memoryLimitMegabytes,
+               ParseCache *cache)
+    : parsers_(workerCount, NULL),
+      timeoutMilliseconds_(timeoutMilliseconds),
+      memoryLimitMegabytes_(memoryLimitMegabytes),
+      cache_(cache)
+  {
+    for (size_t index = 0; index < parsers_.size(); ++index) {
+      parsers_[index] = new SAXParser;
+      configureParser(*parsers_[index]);
     }
+  }
 
-    double
-    getX2() const
-    {
-      assert(hasX2_);
-      return x2_;
+  virtual
+  ~ServeSession()
+  {
+    for (vector<SAXParser *>::iterator iter = parsers_.begin();
+         iter != parsers_.end(); ++iter) {
+      delete *iter;
     }
+  }
 
-    double
-    getY2() const
-    {
-      assert(hasY2_);
-      return y2_;
-    }
+  // Member functions
 
-    bool
-    hasX1() const
-    {
-      return hasX1_;
+  virtual void
+  convert(const unsigned worker,
+          const ServerMessage &request,
+          ServerMessage &response)
+  {
+    RequestLimits limits(chrono::milliseconds(getLimit(request, "timeout-ms",
+                                                       timeoutMilliseconds_)),
+                         static_cast<uint64_t>(getLimit(request, "memory-limit",
+                                                        memoryLimitMegabytes_)) << 20);
+    string path;
+    string document;
+    if (request.tryGet("path", path)) {
+      const int fd = ::open(path.c_str(), O_RDONLY);
+      DecompressingReader::Statistics statistics;
+      string error;
+      if (0 > fd) {
+        response.setCommand("ERROR unable to read '" + path + "'");
+        return;
+      }
+      if (!readDocument(fd, true, document, statistics, error)) {
+        response.setCommand("ERROR " + error + " in '" + path + "'");
+        return;
+      }
     }
+    const string &input = path.empty() ? request.getBody() : document;
+    limits.charge(input.size());
 
-    bool
-    hasY1() const
-    {
-      return hasY1_;
-    }
+    SAXHandler handler;
+    handler.setLimits(&limits);
+    size_t errorCount = 0;
+    if (!load(worker, input, path.empty() ? "request" : path, handler,
+              errorCount, response)) {
+      return;
+    }
+    limits.check();
+    const double parseSeconds = limits.getElapsedSeconds();
+    ConversionOptions options;
+    options.isPreClearingPolygons = request.has("option", "pre-clear-polygons");
+    options.isCheckingNets = request.has("option", "check-nets");
+    options.isCheckingClearance = request.has("option", "check-clearance");
+    options.isSnappingToGrid = request.has("option", "snap-to-grid");
+    options.isIncludingTextExtents = request.has("option", "text-extents");
+    ostringstream log;
+    RequestOutputBuffer outputBuffer(limits);
+    ostream output(&outputBuffer);
+    output.exceptions(ios::badbit);
+    printLayout(output, handler, options, log);
+    output.flush();
+    ConversionStatistics statistics;
+    checkBoard(handler, options, log, statistics);
+    if (options.isCheckingClearance) {
+      log << "INFO " << statistics.clearanceViolationCount
+          << " clearance violations" << endl;
+    }
+
+    response.setCommand("OK");
+    response.add("parse-errors", to_string(errorCount));
+    response.add("parse-seconds", to_string(parseSeconds));
+    response.add("seconds", to_string(limits.getElapsedSeconds()));
+    response.add("peak-memory", to_string(limits.getPeakBytes()));
+    istringstream lines(log.str());
+    string line;
+    while (getline(lines, line)) {
+      response.add("log", line);
+    }
+    response.getBody() = outputBuffer.release();
+  }
 
-    bool
-    hasX2() const
-    {
-      return hasX2_;
-    }
+private:
 
-    bool
-    hasY2() const
-    {
-      return hasY2_;
-    }
+  // Member functions
 
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if ((!InLayer::tryHandleAttribute(attribute)) &&
-          (!HasWidth::tryHandleAttribute(attribute))) {
-        const string &name = attribute.getName();
-        const char * const value = attribute.getValue().c_str();
-        if (X1 == name) {
-          assert(!hasX1_);
-          x1_ = atof(value);
-          hasX1_ = true;
-          return true;
-        }
-        if (Y1 == name) {
-          assert(!hasY1_);
-          y1_ = atof(value);
-          hasY1_ = true;
-          return true;
-        }
-        if (X2 == name) {
-          assert(!hasX2_);
-          x2_ = atof(value);
-          hasX2_ = true;
-          return true;
-        }
-        if (Y2 == name) {
-          assert(!hasY2_);
-          y2_ = atof(value);
-          hasY2_ = true;
-          return true;
-        }
-        return false;
-      }
-      return true;
+  static unsigned
+  getLimit(const ServerMessage &request,
+           const string &key,
+           const unsigned limit)
+  {
+    string value;
+    if (!request.tryGet(key, value)) {
+      return limit;
     }
-
-  private:
-
-    // Data members
-
-    double x1_;
-    double x2_;
-    double y1_;
-    double y2_;
-    bool hasX1_;
-    bool hasY1_;
-    bool hasX2_;
-    bool hasY2_;
-  };
+    return min(limit, static_cast<unsigned>(strtoul(value.c_str(), NULL, 10)));
+  }
 
   /**
-   * Representation of a wire element of an Eagle board or
-   * package.
+   * Fill handler from the parse cache, or by parsing input with the
+   * parser of worker.
    */
-  class Wire : public EndPoints
+  bool
+  load(const unsigned worker,
+       const string &input,
+       const string &name,
+       SAXHandler &handler,
+       size_t &errorCount,
+       ServerMessage &response)
   {
-  public:
-
-    // Constructors/destructors
-
-    Wire()
-      : curve_(0.0), hasCurve_(false)
-    {
-    }
-
-    // Member functions
-
-    double
-    getCurve() const
-    {
-      return curve_;
-    }
-
-    bool
-    hasCurve() const
-    {
-      return hasCurve_;
-    }
-
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if (!EndPoints::tryHandleAttribute(attribute)) {
-        const string &name = attribute.getName();
-        const char * const value = attribute.getValue().c_str();
-        if (CURVE == name) {
-          assert(!hasCurve_);
-          curve_ = atof(value);
-          hasCurve_ = true;
-          return true;
+    uint64_t key = 0;
+    ModelWriter recorder;
+    if (NULL != cache_) {
+      key = ParseCache::computeKey(input, CONVERTER_VERSION);
+      ModelReader model;
+      bool isHit = false;
+      {
+        lock_guard<mutex> lock(cacheMutex_);
+        isHit = cache_->lookup(key, model);
+      }
+      response.add("cache", isHit ? "hit" : "miss");
+      if (isHit) {
+        if (!handler.replay(model)) {
+          response.setCommand("ERROR unbalanced cached model");
+          return false;
         }
-        return false;
+        errorCount = handler.getNestingErrors().size();
+        return true;
+      }
+      handler.setRecorder(&recorder);
+    }
+
+    SAXParser &parser = *parsers_[worker];
+    parser.setDocumentHandler(&handler);
+    parser.setErrorHandler(&handler);
+    MemBufInputSource source(reinterpret_cast<const XMLByte *>(input.data()),
+                             input.size(), name.c_str());
+    parser.parse(source);
+    errorCount = parser.getErrorCount() + handler.getNestingErrors().size();
+    handler.setRecorder(NULL);
+
+    // Only clean parses are cached, so that a hit never hides errors.
+    if ((NULL != cache_) && (0 == errorCount)) {
+      string error;
+      lock_guard<mutex> lock(cacheMutex_);
+      if (!cache_->store(key, recorder, error)) {
+        cerr << "WARN " << error << ", not cached" << endl;
       }
-      return true;
     }
+    return true;
+  }
 
-  private:
+  // Data members
 
-    // Data members
+  vector<SAXParser *> parsers_;  // For each worker.
+  const unsigned timeoutMilliseconds_;
+  const unsigned memoryLimitMegabytes_;
+  ParseCache *cache_;
+  mutex cacheMutex_;
+};
 
-    double curve_;
-    bool hasCurve_;
-  };
+/**
+ * Serve conversion requests for --serve, only returns if that fails.
+ */
+static void
+serve(const po::variables_map &args)
+{
+  unsigned workerCount = args["parse-threads"].as<unsigned>();
+  if (0 == workerCount) {
+    workerCount = max(1U, thread::hardware_concurrency());
+  }
+  ParseCache cache(args.count("cache-dir") ? args["cache-dir"].as<string>() : "",
+                   static_cast<uint64_t>(args["cache-size"].as<unsigned>()) << 20);
+  string error;
+  if (args.count("cache-dir") && (!cache.open(error))) {
+    cerr << "WARN " << error << ", serving without the cache" << endl;
+  }
+  ServeSession session(workerCount,
+                       1000 * args["request-timeout"].as<unsigned>(),
+                       args["request-memory"].as<unsigned>(),
+                       (args.count("cache-dir") && error.empty()) ? &cache : NULL);
+  const string path = args["serve"].as<string>();
+  ConversionServer server(path, workerCount,
+                          static_cast<size_t>(args["request-memory"].as<unsigned>()) << 20,
+                          session);
+  if (!server.open(error)) {
+    cerr << "ERR " << error << endl;
+    return;
+  }
+  cerr << "INFO serving conversions on '" << path << "' with " << workerCount
+       << " workers" << endl;
+  server.run();
+}
 
-  /**
-   * Representation of a rectangle element of an Eagle board or
-   * package.
-   */
-  class Rectangle : public EndPoints
+int
+main(const int argc, const char *argv[])
+{
+  // Argument processing
+  po::variables_map args;
   {
-  public:
+    po::options_description description("Usage (input file on stdio, output to stdout)");
+    description.add_options()
+      ("help,h", "Display usage")
+      ("input,i", po::value<string>(), "Read the Eagle board from a file instead of stdin (either may be gzip or zstd compressed)")
+      ("output,o", po::value<string>(), "Write the gEDA pcb layout to a file instead of stdout")
+      ("watch,w", "Reconvert the input file whenever it changes (requires --input and --output)")
+      ("check-nets", "Report signals whose routed copper touches another signal")
+      ("check-clearance", "Report routed copper of different signals closer than the clearance of the converted lines")
+      ("pre-clear-polygons", "Subtract the isolation around other signals from polygon pours instead of leaving it to pcb")
+      ("snap-to-grid", "Snap the coordinates of the copper and of the element placements to the Eagle grid")
+      ("text-extents", "Include the bounding boxes of board text and element names in the board extents, so that text outside the outline stays on the page")
+      ("dump-model", po::value<string>(), "Parse the input and write a binary snapshot of it to a file instead of converting it")
+      ("from-model", po::value<string>(), "Convert a snapshot written by --dump-model instead of parsing an Eagle board")
+      ("cache-dir", po::value<string>(), "Keep snapshots of parsed boards in a directory and reuse them for unchanged input")
+      ("cache-size", po::value<unsigned>()->default_value(DEFAULT_CACHE_SIZE), "Size limit of the --cache-dir directory in megabytes")
+      ("memory-limit", po::value<unsigned>(), "Keep the memory used under about this many megabytes by spilling converted copper to a temporary file (in $TMPDIR)")
+      ("stats", "Report how reading the input and writing the output went, and the memory used")
+      ("library-dir", po::value<string>(), "Write each package of the input (an Eagle .lbr library or a board) as a gEDA footprint in a directory instead of converting a layout")
+      ("serve", po::value<string>(), "Serve conversion requests on a Unix domain socket at this path instead of converting (see conversion_server.hpp for the protocol)")
+      ("request-timeout", po::value<unsigned>()->default_value(60), "Seconds a --serve request may take")
+      ("request-memory", po::value<unsigned>()->default_value(1024), "Megabytes a --serve request may use for its input, parsed board and output (approximate, temporaries aren't counted)")
+      ("parse-threads", po::value<unsigned>()->default_value(1), "Parse sections of the board, write --library-dir footprints and run --check-clearance on this many threads, or serve this many --serve requests at once (0 for one per core)");
 
-    // Constructors/destructors
+    po::store(po::command_line_parser(argc, argv).options(description).run(), args);
+    po::notify(args);
 
-    Rectangle()
-      : rotationDegrees_(0.0), hasRotation_(false)
-    {
+    if (args.count("help")){
+      cerr << description;
+      return -1;
     }
-
-    // Member functions
-
-    double
-    getRotationDegrees() const
-    {
-      assert(hasRotation_);
-      return rotationDegrees_;
+    if (args.count("watch") &&
+        ((0 == args.count("input")) || (0 == args.count("output")))) {
+      cerr << "ERR --watch requires --input and --output" << endl;
+      cerr << description;
+      return -1;
     }
-
-    bool
-    hasRotation() const
-    {
-      return hasRotation_;
+    if (args.count("from-model") &&
+        (args.count("input") || args.count("watch") ||
+         args.count("dump-model"))) {
+      cerr << "ERR --from-model can't be combined with --input, --watch or "
+           << "--dump-model" << endl;
+      cerr << description;
+      return -1;
     }
-
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if (!EndPoints::tryHandleAttribute(attribute)) {
-        const string &name = attribute.getName();
-        const char * const value = attribute.getValue().c_str();
-        if (ROTATION == name) {
-          assert(!hasRotation_);
-          rotationDegrees_ = atof(value);
-          hasRotation_ = true;
-          return true;
-        }
-        return false;
-      }
-      return true;
+    if (args.count("dump-model") && args.count("watch")) {
+      cerr << "ERR --dump-model can't be combined with --watch" << endl;
+      cerr << description;
+      return -1;
     }
-
-  private:
-
-    // Data members
-
-    double rotationDegrees_;
-    bool hasRotation_;
-  };
-
-  /**
-   * Representation of a circle element of an Eagle board or package.
-   */
-  class Circle : public Pose, HasWidth
-  {
-  public:
-
-    // Constructors/destructors
-
-    Circle()
-      : radius_(0.0), hasRadius_(false)
-    {
+    if (args.count("library-dir") &&
+        (args.count("output") || args.count("watch") ||
+         args.count("dump-model"))) {
+      cerr << "ERR --library-dir can't be combined with --output, --watch or "
+           << "--dump-model" << endl;
+      cerr << description;
+      return -1;
     }
-
-    // Member functions
-
-    double
-    getRadius() const
-    {
-      assert(hasRadius_);
-      return radius_;
+    if ((1 != args["parse-threads"].as<unsigned>()) &&
+        (!args.count("library-dir")) &&
+        (args.count("from-model") || args.count("watch"))) {
+      cerr << "ERR --parse-threads can't be combined with --from-model or "
+           << "--watch" << endl;
+      cerr << description;
+      return -1;
     }
-
-    bool
-    hasRadius() const
-    {
-      return hasRadius_;
+    if (args.count("serve") &&
+        (args.count("input") || args.count("output") || args.count("watch") ||
+         args.count("dump-model") || args.count("from-model") ||
+         args.count("library-dir") || args.count("memory-limit"))) {
+      cerr << "ERR --serve can't be combined with --input, --output, --watch, "
+           << "--dump-model, --from-model, --library-dir or --memory-limit"
+           << endl;
+      cerr << description;
+      return -1;
     }
-
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      if ((!Pose::tryHandleAttribute(attribute)) &&
-          (!HasWidth::tryHandleAttribute(attribute))) {
-        const string &name = attribute.getName();
-        const char * const value = attribute.getValue().c_str();
-        if (RADIUS == name) {
-          assert(!hasRadius_);
-          radius_ = atof(value);
-          hasRadius_ = true;
-          return true;
-        }
-        return false;
-      }
-      return true;
+    if (args.count("memory-limit") && args.count("watch")) {
+      cerr << "ERR --memory-limit can't be combined with --watch" << endl;
+      cerr << description;
+      return -1;
     }
+    if (args.count("cache-dir") &&
+        (args.count("from-model") || args.count("watch") ||
+         args.count("dump-model"))) {
+      cerr << "ERR --cache-dir can't be combined with --from-model, --watch or "
+           << "--dump-model" << endl;
+      cerr << description;
+      return -1;
+    }
+  }
 
-  private:
-
-    // Data members
-
-    double radius_;
-    bool hasRadius_;
-  };
-
-  /**
-   * Representation of an Eagle board or package.
-   */
-  class Board
-  {
-  public:
-
-    // Member functions
-
-#define ADD_OBJECT(otype, oname) \
-    void \
-    add##otype(otype *oname) \
-    { \
-      oname##Objects_.push(oname); \
-    }
-
-    ADD_OBJECT(Text, text);
-    ADD_OBJECT(Hole, hole);
-    ADD_OBJECT(Wire, wire);
-    ADD_OBJECT(Circle, circle);
-    ADD_OBJECT(Rectangle, rectangle);
-    // void
-    // addText(Text *text)
-    // {
-    //   textObjects_.push(text);
-    // }
-
-    // void
-    // addHole(Hole *hole)
-    // {
-    //   holeObjects_.push(hole);
-    // }
-
-    // void
-    // addWire(Wire *wire)
-    // {
-    //   wireObjects_.push(wire);
-    // }
-
-    // void
-    // addCircle(Circle *circle)
-    // {
-    //   circleObjects_.push(circle);
-    // }
-
-#undef ADD_OBJECT
-
-  private:
-
-    // Data members
-
-    queue<Text *> textObjects_;
-    queue<Hole *> holeObjects_;
-    queue<Wire *> wireObjects_;
-    queue<Circle *> circleObjects_;
-    queue<Rectangle *> rectangleObjects_;
-  };
-
-  class Package : public Board
-  {
-  public:
-
-    // Constructors/destructors
+  bool doTerminate = false;
+  int result = 0;
+  SAXParser *parser = NULL;
 
-    Package()
-      : name_(""), description_(""),
-        hasName_(false), hasDescription_(false)
-    {
-    }
+  // NOTE: counting has to start before anything counted is allocated,
+  // and the parser's memory manager has to outlive Terminate().  The
+  // limits of --serve requests rely on counting too.
+  CountingMemoryManager memoryManager;
+  const bool isCounting = args.count("stats") || args.count("serve");
+  if (isCounting) {
+    AllocationStatistics::enable();
+  }
 
-    // Member functions
+  try {
+    XMLPlatformUtils::Initialize(XMLUni::fgXercescDefaultLocale, NULL, NULL,
+                                 isCounting ? &memoryManager : NULL);
+    doTerminate = true;
 
-    string
-    getName() const
-    {
-      assert(hasName_);
-      return name_;
+    if (args.count("watch")) {
+      WatchSession session(args["input"].as<string>(),
+                           args["output"].as<string>(),
+                           0 != args.count("pre-clear-polygons"),
+                           0 != args.count("snap-to-grid"),
+                           0 != args.count("text-extents"));
+      session.run();
     }
 
-    bool
-    hasName() const
-    {
-      return hasName_;
-    }
-
-    // void
-    // handleCharacters(const XMLCh * const chars,
-    //                  const XMLSize_t length)
-    // {
-    //   cerr << "DBG handling characters in package" << endl;
-    //   // assert(!hasDescription_);
-    //   description_ = getStlString(chars);
-    //   hasDescription_ = true;
-    //   // TODO: assert(length == description_.length()); ??
-    // }
-
-    void
-    setDescription(const Text &description)
-    {
-      assert(description.hasString());
-      if (ENGLISH == description.getLanguage()) {
-        description_ = description.getString();
+    SAXHandler handler;
+    bool isConverting = true;
+    bool isParsing = true;
+    if (args.count("from-model")) {
+      isParsing = false;
+      if (!loadModel(handler, args["from-model"].as<string>())) {
+        isConverting = false;
+        result = -1;
       }
     }
 
-    bool
-    tryHandleAttribute(const Attribute &attribute)
-    {
-      // TODO: error checking on conversions
-      const string &name = attribute.getName();
-      const char * const value = attribute.getValue().c_str();
-      if (NAME == name) {
-        assert(!hasName_);
-        name_ = name;
-        hasName_ = true;
-        return true;
+    if (args.count("serve")) {
+      // Only returns when unable to serve.
+      serve(args);
+      isParsing = false;
+      isConverting = false;
+      result = -1;
+    }
+
+    // With --cache-dir the input is read up front to look it up by
+    // content, and parsed from memory on a miss.
+    ParseCache cache(args.count("cache-dir") ? args["cache-dir"].as<string>() : "",
+                     static_cast<uint64_t>(args["cache-size"].as<unsigned>()) << 20);
+    bool isCaching = false;
+    uint64_t cacheKey = 0;
+    string document;
+    DecompressingReader::Statistics inputStatistics;
+    memset(&inputStatistics, 0, sizeof(inputStatistics));
+    if (isParsing && args.count("cache-dir")) {
+      string error;
+      if (!cache.open(error)) {
+        cerr << "WARN " << error << ", parsing without the cache" << endl;
       }
-      else if (DESCRIPTION == name) {
-        // TODO: ignore?
+      else if (!readInput(args, document, inputStatistics)) {
+        isParsing = false;
+        isConverting = false;
+        result = -1;
+      }
+      else {
+        isCaching = true;
+        cacheKey = ParseCache::computeKey(document, CONVERTER_VERSION);
+        ModelReader model;
+        if (cache.lookup(cacheKey, model)) {
+          isParsing = false;
+          if (!loadModel(handler, model, cache.getEntryPath(cacheKey))) {
+            isConverting = false;
+            result = -1;
+          }
+        }
       }
-      return false;
     }
 
-  private:
-
-    // Data members
-
-    string name_;
-    string description_;
-    bool hasName_;
-    bool hasDescription_;
-  };
-
-  // Member functions
-
-  void
-  dumpExceptionDetails(const char *errorType,
-                       const SAXParseException &exc)
-  {
-    // cerr << errorType << " in file " << StrX(exc.getSystemId()) << ", line "
-    //      << exc.getLineNumber() << ", char " << exc.getColumnNumber()
-    //      << ": " << StrX(exc.getMessage()) << endl;
-    cerr << errorType << " in file " << exc.getSystemId() << ", line "
-         << exc.getLineNumber() << ", char " << exc.getColumnNumber()
-         << ": " << exc.getMessage() << endl;
-  }
-
-  // TODO: is it necessary to have a list of all layer definitions, or
-  // will a fixed mapping from Eagle layers to pcb layers suffice?
-  //
-  // void
-  // handleLayerDefinition(AttributeList &attributes)
-  // {
-  //   bool isActive = false;
-  //   const unsigned count = attributes.getLength();
-  //   for (unsigned index = 0; index < count; ++index) {
-  //     Attribute attribute(attributes, index);
-  //     // TODO: assert that CDATA or ENUMERATION are the only types?
-      
-  //     if ((ACTIVE == attribute.getName()) && (YES == attribute.getValue())) {
-  //       isActive = true;
-  //     }
-  //     else if (NUMBER == attribute.getName()) {
-  //       layerNumber = attribute.getValue();
-  //     }
-  //     else if (NAME == attribute.getName()) {
-  //       layerName = attribute.getValue();
-  //     }
-  //   }
-  //   if (isActive) {
-  //     layerNames_[layerNumber] = attribute.getName();
-  //   }
-  // }
-
-  void
-  handleTextDefinition(AttributeList &attributes)
-  {
-    assert(NULL != currentText_);
-    const unsigned count = attributes.getLength();
-    for (unsigned index = 0; index < count; ++index) {
-      Attribute attribute(attributes, index);
-      if (currentText_->tryHandleAttribute(attribute)) {
-        continue;
-      }
-      else if ((FONT == attribute.getName()) ||
-               (ALIGN == attribute.getName())) {
-        // TODO: handle this if possible
-        continue;
+    // Parsing in sections needs the whole input in memory, as does
+    // --cache-dir.
+    unsigned threadCount = args["parse-threads"].as<unsigned>();
+    if (0 == threadCount) {
+      threadCount = max(1U, thread::hardware_concurrency());
+    }
+    bool isInMemory = isCaching;
+    if (isParsing && (1 < threadCount) && (!isInMemory)) {
+      if (readInput(args, document, inputStatistics)) {
+        isInMemory = true;
       }
       else {
-        cerr << "WARN unexpected attribute '" << attribute.getName()
-             << "' in text definition" << endl;
+        isParsing = false;
+        isConverting = false;
+        result = -1;
       }
     }
-    // NOTE: wait until the end of the text definition to save the
-    // text value since the characters are not defined along with the
-    // other attributes.
-  }
 
-  void
-  handleWireDefinition(AttributeList &attributes)
-  {
-    Wire *wire = new Wire;
-    const unsigned count = attributes.getLength();
-    for (unsigned index = 0; index < count; ++index) {
-      Attribute attribute(attributes, index);
-      if (!wire->tryHandleAttribute(attribute)) {
-        if (CAP == attribute.getName()) {
-          // Handle 'cap' attribute, the only instances observed have the
-          // value 'flat' and 'round'
-          // cerr << "WARN ignoring 'cap' value '" << value << "' in wire "
-          //      << "definition" << endl;
+    if (isParsing) {
+      ModelWriter recorder;
+      if (args.count("dump-model") || isCaching) {
+        handler.setRecorder(&recorder);
+      }
+      size_t errorCount = 0;
+      bool isParsed = false;
+      if (1 < threadCount) {
+        ParallelParser parallelParser(threadCount);
+        isParsed = parallelParser.parse(document, handler, errorCount);
+        if (!isParsed) {
+          cerr << "WARN unable to split the board into sections, "
+               << "parsing it serially" << endl;
         }
-        else if (STYLE == attribute.getName()) {
-          // NOTE: Possibly specific to rendering of wires; the only
-          // instance observed has the value 'shortdash'
+      }
+      if (!isParsed) {
+        parser = new SAXParser;
+        configureParser(*parser);
+        parser->setDocumentHandler(&handler);
+        parser->setErrorHandler(&handler);
+        if (isInMemory) {
+          MemBufInputSource source(reinterpret_cast<const XMLByte *>(document.data()),
+                                   document.size(),
+                                   args.count("input") ?
+                                   args["input"].as<string>().c_str() : "stdin");
+          parser->parse(source);
         }
         else {
-          cerr << "WARN unexpected attribute '" << attribute.getName()
-               << "' in wire definition" << endl;
+          parser->parse(DecompressingInputSource(args.count("input") ?
+                                                 args["input"].as<string>() : "",
+                                                 args.count("stats") ?
+                                                 &inputStatistics : NULL));
         }
+        errorCount = parser->getErrorCount() + handler.getNestingErrors().size();
       }
-    }
-    if (isDefiningPackage_) {
-      assert(isDefiningPackages_);
-      assert(NULL != currentPackage_);
-      currentPackage_->addWire(wire);
-    }
-    else {
-      assert(!isDefiningPackages_);
-      assert(NULL == currentPackage_);
-      board_.addWire(wire);
-    }
-  }
+      cerr << "Parsing complete with " << errorCount << " errors" << endl;
 
-  void
-  handleHoleDefinition(AttributeList &attributes)
-  {
-    Hole *hole = new Hole(false);  // Not a Via
-    const unsigned count = attributes.getLength();
-    for (unsigned index = 0; index < count; ++index) {
-      Attribute attribute(attributes, index);
-      if (!hole->tryHandleAttribute(attribute)) {
-        cerr << "WARN unexpected attribute '" << attribute.getName()
-             << "' in hole definition" << endl;
+      handler.setRecorder(NULL);
+
+      // Only clean parses are cached, so that a hit never hides errors.
+      if (isCaching && (0 == errorCount)) {
+        string error;
+        if (!cache.store(cacheKey, recorder, error)) {
+          cerr << "WARN " << error << ", not cached" << endl;
+        }
       }
-    }
-    if (isDefiningPackage_) {
-      assert(NULL != currentPackage_);
-      currentPackage_->addHole(hole);
-    }
-    else {
-      assert(!isDefiningPackages_);
-      assert(NULL == currentPackage_);
-      board_.addHole(hole);
-    }
-  }
 
-  void
-  handleRectangleDefinition(AttributeList &attributes)
-  {
-    // NOTE: attributes of a rectangle are the same as a wire, but it
-    // needs to go on a different list.
-    Rectangle *rectangle = new Rectangle;
-    const unsigned count = attributes.getLength();
-    for (unsigned index = 0; index < count; ++index) {
-      Attribute attribute(attributes, index);
-      if (!rectangle->tryHandleAttribute(attribute)) {
-        cerr << "WARN unexpected attribute '" << attribute.getName()
-             << "' in rectangle definition" << endl;
+      if (args.count("dump-model")) {
+        isConverting = false;
+        const string path = args["dump-model"].as<string>();
+        string error;
+        if (recorder.write(path, error)) {
+          cerr << "INFO wrote " << recorder.getEventCount()
+               << " events to model snapshot '" << path << "'" << endl;
+        }
+        else {
+          cerr << "ERR " << error << endl;
+          result = -1;
+        }
       }
     }
-    if (isDefiningPackage_) {
-      assert(NULL != currentPackage_);
-      currentPackage_->addRectangle(rectangle);
+
+    if (args.count("stats") && (0 != inputStatistics.readCount)) {
+      printInputStatistics(inputStatistics);
     }
-    else {
-      assert(!isDefiningPackages_);
-      assert(NULL == currentPackage_);
-      board_.addRectangle(rectangle);
+
+    if (isCaching) {
+      cache.saveStatistics();
+      const ParseCache::Statistics &statistics = cache.getStatistics();
+      cerr << "INFO parse cache " << (isParsing ? "miss" : "hit") << ", "
+           << statistics.hits << " hits, " << statistics.misses << " misses, "
+           << statistics.stores << " stores, " << statistics.evictions
+           << " evictions, " << statistics.entryCount << " entries using "
+           << statistics.byteCount << " bytes" << endl;
     }
-  }
 
-  void
-  handleCircleDefinition(AttributeList &attributes)
-  {
-    Circle *circle = new Circle;
-    const unsigned count = attributes.getLength();
-    for (unsigned index = 0; index < count; ++index) {
-      Attribute attribute(attributes, index);
-      if (!circle->tryHandleAttribute(attribute)) {
-        cerr << "WARN unexpected attribute '" << attribute.getName()
-             << "' in circle definition" << endl;
+    if (isConverting && args.count("library-dir")) {
+      isConverting = false;
+      const string directory = args["library-dir"].as<string>();
+      OutputWriter outputWriter(FootprintWriter::BUFFER_SIZE,
+                                OutputWriter::DEFAULT_BUFFER_COUNT * threadCount);
+      FootprintWriter writer(threadCount, outputWriter);
+      size_t fileCount = 0;
+      if (writer.write(handler, directory, fileCount)) {
+        cerr << "INFO wrote " << fileCount << " footprints to '" << directory
+             << "'" << endl;
       }
+      else {
+        result = -1;
+      }
+      if (args.count("stats")) {
+        printOutputStatistics(outputWriter);
+      }
+      handler.finalize();
+    }
+
+    if (isConverting) {
+      // NOTE: only the converted copper is spilled, the parsed board has
+      // to fit in the limit.
+      MemoryBudget memoryBudget(args.count("memory-limit") ?
+                                static_cast<uint64_t>(args["memory-limit"].as<unsigned>()) << 20 :
+                                0);
+      SpillFile spillFile(SpillFile::getDefaultDirectory());
+      if (args.count("memory-limit")) {
+        if (memoryBudget.isNearLimit()) {
+          cerr << "WARN the parsed board already uses "
+               << (MemoryBudget::getResidentBytes() >> 20)
+               << " MB, near the --memory-limit" << endl;
+        }
+        handler.setMemoryBudget(&memoryBudget, &spillFile);
+      }
+      OutputWriter outputWriter;
+      OutputFile outputFile(outputWriter);
+      string error;
+      if (args.count("output")) {
+        if (!outputFile.open(args["output"].as<string>(), error)) {
+          cerr << "ERR " << error << endl;
+          result = -1;
+        }
+      }
+      else {
+        cout.flush();
+        outputFile.attach(STDOUT_FILENO, "stdout");
+      }
+      ConversionOptions options;
+      options.isPreClearingPolygons = 0 != args.count("pre-clear-polygons");
+      options.isCheckingNets = 0 != args.count("check-nets");
+      options.isCheckingClearance = 0 != args.count("check-clearance");
+      options.isSnappingToGrid = 0 != args.count("snap-to-grid");
+      options.isIncludingTextExtents = 0 != args.count("text-extents");
+      options.threadCount = threadCount;
+      if (outputFile.isOpen()) {
+        ostream output(&outputFile);
+        printLayout(output, handler, options, cerr);
+        if (!outputFile.close(error)) {
+          cerr << "ERR " << error << endl;
+          result = -1;
+        }
+        if (args.count("stats")) {
+          printOutputStatistics(outputWriter);
+          if (args.count("memory-limit")) {
+            printMemoryStatistics(memoryBudget, spillFile);
+          }
+        }
+      }
+      handler.setMemoryBudget(NULL, NULL);
+      ConversionStatistics statistics;
+      checkBoard(handler, options, cerr, statistics);
+      if (options.isCheckingClearance) {
+        cerr << "INFO " << statistics.clearanceViolationCount
+             << " clearance violations" << endl;
+      }
+      handler.finalize();
     }
-  }
-
-  // Constants
-
-  // attribute types
-  static const string CDATA;
-  static const string ENUMERATION;
-  // Eagle element and attribute names
-  static const string LAYERS;
-  static const string LAYER;
-  static const string NUMBER;
-  static const string NAME;
-  static const string ACTIVE;
-  static const string YES;
-  static const string NO;
-  static const string BOARD;
-  static const string PLAIN;
-  static const string TEXT;
-  static const string WIRE;
-  static const string HOLE;
-  static const string RECTANGLE;
-  static const string CIRCLE;
-  static const string X;
-  static const string Y;
-  static const string X1;
-  static const string Y1;
-  static const string X2;
-  static const string Y2;
-  static const string SIZE;
-  static const string RATIO;
-  static const string ROTATION;
-  static const string FONT;
-  static const string ALIGN;
-  static const string DESCRIPTION;
-  static const string LANGUAGE;
-  static const string EN;
-  static const string DE;
-  static const string NOTE;
-  static const string WIDTH;
-  static const string CURVE;
-  static const string DRILL;
-  static const string CAP;
-  static const string STYLE;
-  static const string RADIUS;
-  static const string LIBRARIES;
-  static const string LIBRARY;
-  static const string PACKAGES;
-  static const string PACKAGE;
-  static const string SMD;
-  static const string PAD;
 
-  // Data members
-
-  LocatorManager *locator_;
-
-  CountMap elementCounts_;
-  // CountMap layerCounts_;
-  StringMap layerNames_;
-
-  Board board_;
-  queue<Package *> packages_;
-
-  // TODO: convert flags into a state machine
-  bool isDefiningLayers_;
-  bool isDefiningBoard_;
-  bool isDefiningPlain_;
-  bool isDefiningText_;
-  bool isDefiningDescription_;
-  bool isDefiningNote_;
-  bool isDefiningLibraries_;
-  bool isDefiningLibrary_;
-  bool isDefiningPackages_;
-  bool isDefiningPackage_;
-
-  // Current variables used when definitions cross multiple elements.
-  Text *currentText_;
-  Package *currentPackage_;
-};
-
-const string SAXHandler::CDATA = "CDATA";
-const string SAXHandler::ENUMERATION = "ENUMERATION";
-const string SAXHandler::LAYERS = "layers";
-const string SAXHandler::LAYER = "layer";
-const string SAXHandler::NUMBER = "number";
-const string SAXHandler::NAME = "name";
-const string SAXHandler::ACTIVE = "active";
-const string SAXHandler::YES = "yes";
-const string SAXHandler::NO = "no";
-const string SAXHandler::BOARD = "board";
-const string SAXHandler::PLAIN = "plain";
-const string SAXHandler::TEXT = "text";
-const string SAXHandler::WIRE = "wire";
-const string SAXHandler::HOLE = "hole";
-const string SAXHandler::RECTANGLE = "rectangle";
-const string SAXHandler::CIRCLE = "circle";
-const string SAXHandler::X = "x";
-const string SAXHandler::Y = "y";
-const string SAXHandler::X1 = "x1";
-const string SAXHandler::Y1 = "y1";
-const string SAXHandler::X2 = "x2";
-const string SAXHandler::Y2 = "y2";
-const string SAXHandler::SIZE = "size";
-const string SAXHandler::RATIO = "ratio";
-const string SAXHandler::ROTATION = "rot";
-const string SAXHandler::FONT = "font";
-const string SAXHandler::ALIGN = "align";
-const string SAXHandler::DESCRIPTION = "description";
-const string SAXHandler::LANGUAGE = "language";
-const string SAXHandler::EN = "en";  // English
-const string SAXHandler::DE = "de";  // German
-const string SAXHandler::NOTE = "note";
-const string SAXHandler::WIDTH = "width";
-const string SAXHandler::CURVE = "curve";
-const string SAXHandler::DRILL = "drill";
-const string SAXHandler::CAP = "cap";
-const string SAXHandler::STYLE = "style";
-const string SAXHandler::RADIUS = "radius";
-const string SAXHandler::LIBRARIES = "libraries";
-const string SAXHandler::LIBRARY = "library";
-const string SAXHandler::PACKAGES = "packages";
-const string SAXHandler::PACKAGE = "package";
-const string SAXHandler::SMD = "smd";
-const string SAXHandler::PAD = "pad";
-};
-
-// Constant values for gEDA pcb output file, all comments are taken
-// directly from the pcb manual.
-
-// File format version. This version number represents the date when
-// the pcb file format was last changed.  Any version of pcb build
-// from sources equal to or newer than this number should be able to
-// read the file. If this line is not present in the input file then
-// file format compatibility is not checked.
-static const char *FILE_VERSION = "FileVersion[20070407]";
-// Relative size of thermal fingers. A value of 1.0 makes the finger
-// width twice the clearance gap width (measured across the gap, not
-// diameter). The normal value is 0.5, which results in a finger width
-// the same as the clearance gap width.
-static const char *THERMAL_GAP = "Thermal[0.500000]";
-// NOTE: these symbolic values were deduced from an extant file using
-// the flags documentation.
-//
-// nameonpcb - Display names of elements, instead of refdes. ??
-//
-// uniquename - Force unique names on board.
-//
-// clearnew - New lines/arc clear polygons.
-//
-// snappin - Crosshair snaps to pins and pads.
-static const char *LAYOUT_FLAGS = "Flags(\"nameonpcb,uniquename,clearnew,snappin\")";
-// Encodes the layer grouping information. Each group is separated by
-// a colon, each member of each group is separated by a comma. Group
-// members are either numbers from 1..N for each layer, and the
-// letters c or s representing the component side and solder side of
-// the board. Including c or s marks that group as being the top or
-// bottom side of the board.
-//
-// Default here has group 1 on the component side and group 6 on the
-// solder side
-static const char *LAYOUT_GROUPS = "Groups(\"1,c:2:3:4:5:6,s:7:8\")";
-
-using namespace jrl;
-
-int
-main(const int argc, const char *argv[])
-{
-  // Argument processing
-  po::variables_map args;
-  {
-    po::options_description description("Usage (input file on stdio, output to stdout)");
-    description.add_options()
-      ("help,h", "Display usage");
-
-    po::store(po::command_line_parser(argc, argv).options(description).run(), args);
-    po::notify(args);
-
-    if (args.count("help")){
-      cerr << description;
-      return -1;
+    if (args.count("stats")) {
+      printAllocationStatistics();
     }
   }
-
-  bool doTerminate = false;
-  int result = 0;
-  SAXParser *parser = NULL;
-
-  try {
-    XMLPlatformUtils::Initialize();
-    doTerminate = true;
-
-    parser = new SAXParser;
-    // NOTE: SAXParser configuration stolen from SAXPrint.cpp sample code.
-    parser->setValidationScheme(SAXParser::Val_Auto);
-    parser->setDoNamespaces(false);
-    parser->setDoSchema(false);
-    parser->setHandleMultipleImports(true);
-    parser->setValidationSchemaFullChecking(false);
-
-    SAXHandler handler;
-    parser->setDocumentHandler(&handler);
-    parser->setErrorHandler(&handler);
-    parser->parse(StdInInputSource());
-    cerr << "Parsing complete with " << parser->getErrorCount() << " errors" << endl;
-
-    cout << "# Output generated from Eagle .brd file automatically by "
-         << "eagle2gedapcb." << endl << endl;
-    cout << FILE_VERSION << endl;
-    // TODO: PCB element
-    //
-    // name should probably be set by command line argument.
-    //
-    // dimensions should be command line argument or calculation based
-    // on ensuring that all components fit.
-
-    // NOTE: not including the following optional layout file elements:
-    // Grid (TODO: this can be determined from Eagle file)
-    // Cursor
-    // Styles
-    // Symbols
-    // Netlists
-    cout << LAYOUT_FLAGS << endl;
-    cout << LAYOUT_GROUPS << endl;
-    // TODO: set the PCB::grid::unit attribute based on the grid
-    // setting from the Eagle file
-    //
-    // Eagle example:
-    // <grid distance="25" unitdist="mil" unit="mil" style="dots"
-    //       multiple="8" display="no" altdistance="6.25" altunitdist="mil"
-    //       altunit="mil"/>
-    //
-    // pcb example
-    // Attribute("PCB::grid::unit" "mil")
-    handler.finalize();
-  }
   catch (const OutOfMemoryException &) {
     cerr << "FATAL out of memory exception at top level" << endl;
     result = -2;
@@ -0,0 +1,655 @@
+/*
+ * Conversion of Eagle .brd files held in memory to gEDA pcb layouts,
+ * the library behind eagle2gedapcb.
+ *
+ * Copyright 2014 Brian Davis, all rights reserved.
+ */
+
+
+// Standard C library includes
+#include <cstring>
+
+// STL includes
+#include <memory>
+#include <iomanip>
+#include <mutex>
+#include <streambuf>
+
+// Local includes
+#include "eagle_handler.hpp"
+#include "eagle_converter.hpp"
+#include "eagle_converter.h"
+
+namespace jrl
+{
+
+const string SAXHandler::CDATA = "CDATA";
+const string SAXHandler::ENUMERATION = "ENUMERATION";
+const string SAXHandler::LAYERS = "layers";
+const string SAXHandler::LAYER = "layer";
+const string SAXHandler::NUMBER = "number";
+const string SAXHandler::NAME = "name";
+const string SAXHandler::ACTIVE = "active";
+const string SAXHandler::YES = "yes";
+const string SAXHandler::NO = "no";
+const string SAXHandler::BOARD = "board";
+const string SAXHandler::PLAIN = "plain";
+const string SAXHandler::TEXT = "text";
+const string SAXHandler::WIRE = "wire";
+const string SAXHandler::HOLE = "hole";
+const string SAXHandler::RECTANGLE = "rectangle";
+const string SAXHandler::CIRCLE = "circle";
+const string SAXHandler::X = "x";
+const string SAXHandler::Y = "y";
+const string SAXHandler::X1 = "x1";
+const string SAXHandler::Y1 = "y1";
+const string SAXHandler::X2 = "x2";
+const string SAXHandler::Y2 = "y2";
+const string SAXHandler::SIZE = "size";
+const string SAXHandler::RATIO = "ratio";
+const string SAXHandler::ROTATION = "rot";
+const string SAXHandler::FONT = "font";
+const string SAXHandler::ALIGN = "align";
+const string SAXHandler::DESCRIPTION = "description";
+const string SAXHandler::LANGUAGE = "language";
+const string SAXHandler::EN = "en";  // English
+const string SAXHandler::DE = "de";  // German
+const string SAXHandler::NOTE = "note";
+const string SAXHandler::WIDTH = "width";
+const string SAXHandler::CURVE = "curve";
+const string SAXHandler::DRILL = "drill";
+const string SAXHandler::CAP = "cap";
+const string SAXHandler::STYLE = "style";
+const string SAXHandler::RADIUS = "radius";
+const string SAXHandler::LIBRARIES = "libraries";
+const string SAXHandler::LIBRARY = "library";
+const string SAXHandler::PACKAGES = "packages";
+const string SAXHandler::PACKAGE = "package";
+const string SAXHandler::SMD = "smd";
+const string SAXHandler::PAD = "pad";
+const string SAXHandler::ELEMENTS = "elements";
+const string SAXHandler::ELEMENT = "element";
+const string SAXHandler::VALUE = "value";
+const string SAXHandler::LOCKED = "locked";
+const string SAXHandler::SMASHED = "smashed";
+const string SAXHandler::SIGNALS = "signals";
+const string SAXHandler::SIGNAL = "signal";
+const string SAXHandler::CONTACTREF = "contactref";
+const string SAXHandler::VIA = "via";
+const string SAXHandler::CLASS = "class";
+const string SAXHandler::AIRWIRESHIDDEN = "airwireshidden";
+const string SAXHandler::ROUTE = "route";
+const string SAXHandler::ROUTETAG = "routetag";
+const string SAXHandler::EXTENT = "extent";
+const string SAXHandler::DIAMETER = "diameter";
+const string SAXHandler::SHAPE = "shape";
+const string SAXHandler::ALWAYSSTOP = "alwaysstop";
+const string SAXHandler::POLYGON = "polygon";
+const string SAXHandler::VERTEX = "vertex";
+const string SAXHandler::ISOLATE = "isolate";
+const string SAXHandler::POUR = "pour";
+const string SAXHandler::SOLID = "solid";
+const string SAXHandler::HATCH = "hatch";
+const string SAXHandler::CUTOUT = "cutout";
+const string SAXHandler::SPACING = "spacing";
+const string SAXHandler::RANK = "rank";
+const string SAXHandler::ORPHANS = "orphans";
+const string SAXHandler::THERMALS = "thermals";
+const string SAXHandler::GRID = "grid";
+const string SAXHandler::DISTANCE = "distance";
+const string SAXHandler::UNITDIST = "unitdist";
+const string SAXHandler::UNIT = "unit";
+const string SAXHandler::DISPLAY = "display";
+const string SAXHandler::MULTIPLE = "multiple";
+const string SAXHandler::ALTDISTANCE = "altdistance";
+const string SAXHandler::ALTUNITDIST = "altunitdist";
+const string SAXHandler::ALTUNIT = "altunit";
+const string SAXHandler::DESIGNRULES = "designrules";
+const string SAXHandler::PARAM = "param";
+const string SAXHandler::ATTRIBUTE = "attribute";
+const string SAXHandler::CONSTANT = "constant";
+const string SAXHandler::OFF = "off";
+const string SAXHandler::NAME_ATTRIBUTE = "NAME";
+const string SAXHandler::NAME_PLACEHOLDER = ">NAME";
+const string SAXHandler::DX = "dx";
+const string SAXHandler::DY = "dy";
+const string SAXHandler::ROUNDNESS = "roundness";
+const string SAXHandler::STOP = "stop";
+const string SAXHandler::CREAM = "cream";
+const string SAXHandler::FIRST = "first";
+const string SAXHandler::SQUARE = "square";
+const string SAXHandler::ROUND = "round";
+const string SAXHandler::OCTAGON = "octagon";
+const string SAXHandler::LONG = "long";
+const string SAXHandler::OFFSET = "offset";
+constexpr double SAXHandler::DEFAULT_CLEARANCE;
+constexpr double SAXHandler::STOP_MARGIN;
+constexpr double SAXHandler::RESTRING_RATIO;
+constexpr double SAXHandler::MIN_RESTRING;
+constexpr double SAXHandler::MAX_RESTRING;
+constexpr double SAXHandler::DEFAULT_TEXT_RATIO;
+constexpr double SAXHandler::ARC_STEP_DEGREES;
+constexpr double SAXHandler::CLEARANCE_GRID_CELL;
+// NOTE: built from the element name constants above, so must follow them.
+const SAXHandler::TransitionTable SAXHandler::TRANSITIONS;
+// Constant values for gEDA pcb output file, all comments are taken
+// directly from the pcb manual.
+
+// File format version. This version number represents the date when
+// the pcb file format was last changed.  Any version of pcb build
+// from sources equal to or newer than this number should be able to
+// read the file. If this line is not present in the input file then
+// file format compatibility is not checked.
+static const char *FILE_VERSION = "FileVersion[20070407]";
+// Relative size of thermal fingers. A value of 1.0 makes the finger
+// width twice the clearance gap width (measured across the gap, not
+// diameter). The normal value is 0.5, which results in a finger width
+// the same as the clearance gap width.
+static const char *THERMAL_GAP = "Thermal[0.500000]";
+// NOTE: these symbolic values were deduced from an extant file using
+// the flags documentation.
+//
+// nameonpcb - Display names of elements, instead of refdes. ??
+//
+// uniquename - Force unique names on board.
+//
+// clearnew - New lines/arc clear polygons.
+//
+// snappin - Crosshair snaps to pins and pads.
+static const char *LAYOUT_FLAGS = "Flags(\"nameonpcb,uniquename,clearnew,snappin\")";
+// Encodes the layer grouping information. Each group is separated by
+// a colon, each member of each group is separated by a comma. Group
+// members are either numbers from 1..N for each layer, and the
+// letters c or s representing the component side and solder side of
+// the board. Including c or s marks that group as being the top or
+// bottom side of the board.
+//
+// Default here has group 1 on the component side and group 6 on the
+// solder side
+static const char *LAYOUT_GROUPS = "Groups(\"1,c:2:3:4:5:6,s:7:8\")";
+
+/**
+ * Apply the parser configuration shared by all conversions.
+ */
+void
+configureParser(SAXParser &parser)
+{
+  // NOTE: SAXParser configuration stolen from SAXPrint.cpp sample code.
+  parser.setValidationScheme(SAXParser::Val_Auto);
+  parser.setDoNamespaces(false);
+  parser.setDoSchema(false);
+  parser.setHandleMultipleImports(true);
+  parser.setValidationSchemaFullChecking(false);
+}
+
+/**
+ * Output the layout file elements which precede the board contents.
+ */
+void
+printHeader(ostream &strm,
+            const SAXHandler &handler)
+{
+  strm << "# Output generated from Eagle .brd file automatically by "
+       << "eagle2gedapcb." << endl << endl;
+  strm << FILE_VERSION << endl;
+  // TODO: PCB element
+  //
+  // name should probably be set by command line argument.
+  //
+  // dimensions should be command line argument or calculation based
+  // on ensuring that all components fit.
+
+  const double gridDistance = handler.getGridDistance();
+  if (0.0 < gridDistance) {
+    // NOTE: the step is in centimils, and fractional for metric grids.
+    ostringstream step;
+    step << fixed << setprecision(6) << (gridDistance / 25.4e-5);
+    strm << "Grid[" << step.str() << " 0.000000 0.000000 "
+         << (handler.isGridDisplayed() ? 1 : 0) << "]" << endl;
+  }
+  strm << THERMAL_GAP << endl;
+  // NOTE: not including the following optional layout file elements:
+  // Cursor
+  // Styles
+  // Symbols
+  strm << LAYOUT_FLAGS << endl;
+  strm << LAYOUT_GROUPS << endl;
+  const char * const gridUnit = handler.getGridUnitName();
+  if (NULL != gridUnit) {
+    strm << "Attribute(\"PCB::grid::unit\" \"" << gridUnit << "\")" << endl;
+  }
+}
+
+void
+printLayout(ostream &strm,
+            SAXHandler &handler,
+            const ConversionOptions &options,
+            ostream &log)
+{
+  if (options.isSnappingToGrid && (!handler.snapToGrid())) {
+    log << "WARN no grid to snap to" << endl;
+  }
+  handler.setIncludingTextExtents(options.isIncludingTextExtents);
+  printHeader(strm, handler);
+  handler.printVias(strm);
+  handler.printElements(strm);
+  handler.printLayers(strm, options.isPreClearingPolygons);
+  handler.printNetList(strm);
+}
+
+void
+checkBoard(const SAXHandler &handler,
+           const ConversionOptions &options,
+           ostream &log,
+           ConversionStatistics &statistics)
+{
+  if (options.isCheckingNets) {
+    statistics.shortCount = handler.checkCopperConnectivity(log);
+  }
+  if (options.isCheckingClearance) {
+    statistics.clearanceViolationCount =
+      handler.checkClearances(max(1U, options.threadCount), log);
+  }
+}
+
+namespace
+{
+
+/**
+ * Splits what a conversion logs into diagnostics, one per line, by the
+ * severity prefix the converter writes.
+ */
+class DiagnosticBuffer : public streambuf
+{
+public:
+
+  // Constructors/destructors
+
+  explicit DiagnosticBuffer(vector<Diagnostic> &diagnostics)
+    : diagnostics_(diagnostics)
+  {
+  }
+
+  // Member functions
+
+  /** Add what remains of an unterminated last line. */
+  void
+  finish()
+  {
+    if (!line_.empty()) {
+      addLine();
+    }
+  }
+
+protected:
+
+  // Member functions
+
+  virtual int_type
+  overflow(const int_type c)
+  {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+      return traits_type::not_eof(c);
+    }
+    if ('\n' == traits_type::to_char_type(c)) {
+      addLine();
+    }
+    else {
+      line_.push_back(traits_type::to_char_type(c));
+    }
+    return c;
+  }
+
+  virtual streamsize
+  xsputn(const char *data,
+         const streamsize size)
+  {
+    for (streamsize index = 0; index < size; ++index) {
+      overflow(traits_type::to_int_type(data[index]));
+    }
+    return size;
+  }
+
+private:
+
+  // Member functions
+
+  void
+  addLine()
+  {
+    static const struct
+    {
+      const char *prefix;
+      Diagnostic::Severity severity;
+    } PREFIXES[] = {
+      { "DBG ", Diagnostic::DEBUG_SEVERITY },
+      { "INFO ", Diagnostic::INFO_SEVERITY },
+      { "WARN ", Diagnostic::WARNING_SEVERITY },
+      { "ERR ", Diagnostic::ERROR_SEVERITY },
+      { "FATAL ", Diagnostic::ERROR_SEVERITY }
+    };
+    Diagnostic diagnostic;
+    diagnostic.severity = Diagnostic::INFO_SEVERITY;
+    size_t skip = 0;
+    for (size_t index = 0; index < sizeof(PREFIXES) / sizeof(PREFIXES[0]);
+         ++index) {
+      const size_t length = strlen(PREFIXES[index].prefix);
+      if (0 == line_.compare(0, length, PREFIXES[index].prefix)) {
+        diagnostic.severity = PREFIXES[index].severity;
+        skip = length;
+        break;
+      }
+    }
+    diagnostic.message = line_.substr(skip);
+    diagnostics_.push_back(diagnostic);
+    line_.clear();
+  }
+
+  // Data members
+
+  vector<Diagnostic> &diagnostics_;
+  string line_;
+};
+
+/**
+ * Buffers output for a write function, counting the bytes it takes.
+ * Once the function takes less than it is given every later write
+ * fails.
+ */
+class SinkBuffer : public streambuf
+{
+public:
+
+  // Types
+
+  typedef size_t (*WriteFunction)(void *context,
+                                  const char *data,
+                                  size_t size);
+
+  // Constructors/destructors
+
+  SinkBuffer(const WriteFunction write,
+             void * const context)
+    : write_(write), context_(context), buffer_(BUFFER_SIZE), count_(0),
+      isFailed_(false)
+  {
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+  }
+
+  // Member functions
+
+  size_t
+  getCount() const
+  {
+    return count_;
+  }
+
+protected:
+
+  // Member functions
+
+  virtual int_type
+  overflow(const int_type c)
+  {
+    if (!flush()) {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  virtual int
+  sync()
+  {
+    return flush() ? 0 : -1;
+  }
+
+private:
+
+  // Constants
+
+  static const size_t BUFFER_SIZE = 64 << 10;
+
+  // Member functions
+
+  bool
+  flush()
+  {
+    const size_t size = pptr() - pbase();
+    if ((!isFailed_) && (0 < size)) {
+      const size_t written = write_(context_, pbase(), size);
+      count_ += min(written, size);
+      isFailed_ = (written < size);
+    }
+    setp(&buffer_[0], &buffer_[0] + buffer_.size());
+    return !isFailed_;
+  }
+
+  // Data members
+
+  WriteFunction write_;
+  void *context_;
+  vector<char> buffer_;
+  size_t count_;
+  bool isFailed_;
+};
+
+size_t
+writeToStream(void *context,
+              const char *data,
+              const size_t size)
+{
+  ostream &strm = *static_cast<ostream *>(context);
+  strm.write(data, size);
+  return strm ? size : 0;
+}
+
+void
+initializeXercesOnce()
+{
+  XMLPlatformUtils::Initialize();
+}
+
+/**
+ * Initialize Xerces the first time any conversion needs it.  It is
+ * left initialized until the process exits: Xerces counts nested
+ * initializations but doesn't make them thread safe, and initializing
+ * it for every conversion would be slow.
+ */
+void
+initializeXerces()
+{
+  static once_flag isInitialized;
+  call_once(isInitialized, &initializeXercesOnce);
+}
+
+}
+
+bool
+convertBoard(const char *data,
+             const size_t size,
+             const ConversionOptions &options,
+             ostream &output,
+             ConversionReport &report)
+{
+  typedef chrono::steady_clock Clock;
+
+  initializeXerces();
+  report = ConversionReport();
+  ConversionStatistics &statistics = report.statistics;
+  statistics.inputBytes = size;
+  DiagnosticBuffer diagnostics(report.diagnostics);
+  ostream log(&diagnostics);
+  SinkBuffer sink(&writeToStream, &output);
+  ostream strm(&sink);
+  bool isConverted = false;
+  {
+    SAXHandler::LogScope logScope(log);
+    try {
+      const Clock::time_point start = Clock::now();
+      SAXParser parser;
+      configureParser(parser);
+      SAXHandler handler;
+      parser.setDocumentHandler(&handler);
+      parser.setErrorHandler(&handler);
+      const string name = options.name.empty() ? "board" : options.name;
+      MemBufInputSource source(reinterpret_cast<const XMLByte *>(data), size,
+                               name.c_str());
+      parser.parse(source);
+      parser.setDocumentHandler(NULL);
+      parser.setErrorHandler(NULL);
+      statistics.errorCount =
+        parser.getErrorCount() + handler.getNestingErrors().size();
+      statistics.elementCount = handler.getElementCount();
+      const Clock::time_point parsed = Clock::now();
+      statistics.parseSeconds =
+        chrono::duration<double>(parsed - start).count();
+      printLayout(strm, handler, options, log);
+      strm.flush();
+      statistics.convertSeconds =
+        chrono::duration<double>(Clock::now() - parsed).count();
+      isConverted = strm.good();
+      if (!isConverted) {
+        log << "ERR unable to write the output" << endl;
+      }
+
+      checkBoard(handler, options, log, statistics);
+    }
+    catch (const OutOfMemoryException &) {
+      log << "ERR out of memory" << endl;
+      isConverted = false;
+    }
+    catch (const XMLException &exc) {
+      log << "ERR exception during conversion: "
+          << getStlString(exc.getMessage()) << endl;
+      isConverted = false;
+    }
+    catch (const exception &exc) {
+      // NOTE: e.g. bad_alloc, which must not cost the caller the
+      // diagnostics collected so far.
+      log << "ERR exception during conversion: " << exc.what() << endl;
+      isConverted = false;
+    }
+  }
+  diagnostics.finish();
+  statistics.outputBytes = sink.getCount();
+  return isConverted;
+}
+
+}
+
+using namespace jrl;
+
+/**
+ * What the C interface hands out as an eagle2gedapcb_report.
+ */
+struct eagle2gedapcb_report
+{
+  ConversionReport report;
+};
+
+extern "C" void
+eagle2gedapcb_options_init(eagle2gedapcb_options *options)
+{
+  memset(options, 0, sizeof(*options));
+  options->thread_count = 1;
+}
+
+extern "C" int
+eagle2gedapcb_convert(const char *data,
+                      size_t size,
+                      const eagle2gedapcb_options *options,
+                      eagle2gedapcb_write write,
+                      void *context,
+                      eagle2gedapcb_report **report)
+{
+  // NOTE: no exception may cross into C.
+  try {
+    ConversionOptions conversionOptions;
+    if (NULL != options) {
+      conversionOptions.isPreClearingPolygons = 0 != options->pre_clear_polygons;
+      conversionOptions.isCheckingNets = 0 != options->check_nets;
+      conversionOptions.isCheckingClearance = 0 != options->check_clearance;
+      conversionOptions.isSnappingToGrid = 0 != options->snap_to_grid;
+      conversionOptions.isIncludingTextExtents =
+        0 != options->include_text_extents;
+      conversionOptions.threadCount = options->thread_count;
+      if (NULL != options->name) {
+        conversionOptions.name = options->name;
+      }
+    }
+    unique_ptr<eagle2gedapcb_report> result(new eagle2gedapcb_report);
+    SinkBuffer sink(write, context);
+    ostream output(&sink);
+    bool isConverted =
+      convertBoard(data, size, conversionOptions, output, result->report);
+    output.flush();
+    isConverted = isConverted && output.good();
+    // NOTE: convertBoard() counted the bytes buffered here, not those
+    // write took.
+    result->report.statistics.outputBytes = sink.getCount();
+    if (NULL != report) {
+      *report = result.release();
+    }
+    return isConverted ? 1 : 0;
+  }
+  catch (const exception &) {
+    if (NULL != report) {
+      *report = NULL;
+    }
+    return 0;
+  }
+}
+
+extern "C" size_t
+eagle2gedapcb_report_diagnostic_count(const eagle2gedapcb_report *report)
+{
+  return report->report.diagnostics.size();
+}
+
+extern "C" enum eagle2gedapcb_severity
+eagle2gedapcb_report_diagnostic_severity(const eagle2gedapcb_report *report,
+                                         size_t index)
+{
+  switch (report->report.diagnostics[index].severity) {
+  case Diagnostic::DEBUG_SEVERITY:
+    return EAGLE2GEDAPCB_DEBUG;
+  case Diagnostic::INFO_SEVERITY:
+    return EAGLE2GEDAPCB_INFO;
+  case Diagnostic::WARNING_SEVERITY:
+    return EAGLE2GEDAPCB_WARNING;
+  default:
+    return EAGLE2GEDAPCB_ERROR;
+  }
+}
+
+extern "C" const char *
+eagle2gedapcb_report_diagnostic_message(const eagle2gedapcb_report *report,
+                                        size_t index)
+{
+  return report->report.diagnostics[index].message.c_str();
+}
+
+extern "C" void
+eagle2gedapcb_report_statistics(const eagle2gedapcb_report *report,
+                                eagle2gedapcb_statistics *statistics)
+{
+  const ConversionStatistics &source = report->report.statistics;
+  statistics->input_bytes = source.inputBytes;
+  statistics->output_bytes = source.outputBytes;
+  statistics->error_count = source.errorCount;
+  statistics->element_count = source.elementCount;
+  statistics->short_count = source.shortCount;
+  statistics->clearance_violation_count = source.clearanceViolationCount;
+  statistics->parse_seconds = source.parseSeconds;
+  statistics->convert_seconds = source.convertSeconds;
+}
+
+extern "C" void
+eagle2gedapcb_report_free(eagle2gedapcb_report *report)
+{
+  delete report;
+}
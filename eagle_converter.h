@@ -0,0 +1,101 @@
+/*
+ * C interface to the conversion of Eagle .brd files held in memory to
+ * gEDA pcb layouts, see eagle_converter.hpp.
+ *
+ * Copyright 2014 by Brian Davis.
+ */
+
+#ifndef eagle_converter_H
+#define eagle_converter_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum eagle2gedapcb_severity {
+  EAGLE2GEDAPCB_DEBUG,
+  EAGLE2GEDAPCB_INFO,
+  EAGLE2GEDAPCB_WARNING,
+  EAGLE2GEDAPCB_ERROR
+};
+
+typedef struct eagle2gedapcb_options
+{
+  int pre_clear_polygons;
+  int check_nets;
+  int check_clearance;
+  int snap_to_grid;
+  int include_text_extents;
+  unsigned thread_count;
+  /* Name of the input in diagnostics, may be NULL. */
+  const char *name;
+} eagle2gedapcb_options;
+
+typedef struct eagle2gedapcb_statistics
+{
+  size_t input_bytes;
+  size_t output_bytes;
+  size_t error_count;
+  size_t element_count;
+  size_t short_count;
+  size_t clearance_violation_count;
+  double parse_seconds;
+  double convert_seconds;
+} eagle2gedapcb_statistics;
+
+/* Diagnostics and statistics of a conversion. */
+typedef struct eagle2gedapcb_report eagle2gedapcb_report;
+
+/*
+ * Receives the layout as it is printed.  Returns the number of bytes
+ * taken; fewer than size fails the conversion.
+ */
+typedef size_t (*eagle2gedapcb_write)(void *context,
+                                      const char *data,
+                                      size_t size);
+
+/* Set options to the defaults. */
+void
+eagle2gedapcb_options_init(eagle2gedapcb_options *options);
+
+/*
+ * Convert the board in size bytes at data, passing the layout to
+ * write.  options may be NULL for the defaults.  If report isn't NULL
+ * it is set to a report, to be freed with eagle2gedapcb_report_free(),
+ * even when the conversion fails.  Returns nonzero if the board was
+ * converted.
+ */
+int
+eagle2gedapcb_convert(const char *data,
+                      size_t size,
+                      const eagle2gedapcb_options *options,
+                      eagle2gedapcb_write write,
+                      void *context,
+                      eagle2gedapcb_report **report);
+
+size_t
+eagle2gedapcb_report_diagnostic_count(const eagle2gedapcb_report *report);
+
+enum eagle2gedapcb_severity
+eagle2gedapcb_report_diagnostic_severity(const eagle2gedapcb_report *report,
+                                         size_t index);
+
+/* Valid until the report is freed. */
+const char *
+eagle2gedapcb_report_diagnostic_message(const eagle2gedapcb_report *report,
+                                        size_t index);
+
+void
+eagle2gedapcb_report_statistics(const eagle2gedapcb_report *report,
+                                eagle2gedapcb_statistics *statistics);
+
+void
+eagle2gedapcb_report_free(eagle2gedapcb_report *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
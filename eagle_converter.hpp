@@ -0,0 +1,119 @@
+// Conversion of Eagle .brd files held in memory to gEDA pcb layouts.
+// Copyright 2014 by Brian Davis.
+
+#ifndef eagle_converter_HEADER
+#define eagle_converter_HEADER
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace jrl
+{
+
+/**
+ * What a conversion does besides printing the layout.
+ */
+struct ConversionOptions
+{
+  // Constructors/destructors
+
+  ConversionOptions()
+    : isPreClearingPolygons(false),
+      isCheckingNets(false),
+      isCheckingClearance(false),
+      isSnappingToGrid(false),
+      isIncludingTextExtents(false),
+      threadCount(1)
+  {
+  }
+
+  // Data members
+
+  /** Cut copper clearances out of polygons, see --pre-clear-polygons. */
+  bool isPreClearingPolygons;
+  /** Report shorts and opens, see --check-nets. */
+  bool isCheckingNets;
+  /** Report copper clearance violations, see --check-clearance. */
+  bool isCheckingClearance;
+  /** Snap board coordinates to the Eagle grid, see --snap-to-grid. */
+  bool isSnappingToGrid;
+  /** Place the board to fit its text, see --text-extents. */
+  bool isIncludingTextExtents;
+  /** Threads used by the clearance check. */
+  unsigned threadCount;
+  /** Name of the input in diagnostics. */
+  std::string name;
+};
+
+/**
+ * One line the converter logged, e.g. a parse error or a short.
+ */
+struct Diagnostic
+{
+  // Types
+
+  enum Severity {
+    DEBUG_SEVERITY,
+    INFO_SEVERITY,
+    WARNING_SEVERITY,
+    ERROR_SEVERITY
+  };
+
+  // Data members
+
+  Severity severity;
+  std::string message;
+};
+
+struct ConversionStatistics
+{
+  // Constructors/destructors
+
+  ConversionStatistics()
+    : inputBytes(0), outputBytes(0), errorCount(0), elementCount(0),
+      shortCount(0), clearanceViolationCount(0), parseSeconds(0),
+      convertSeconds(0)
+  {
+  }
+
+  // Data members
+
+  std::size_t inputBytes;
+  std::size_t outputBytes;
+  /** Parse errors, including misplaced elements. */
+  std::size_t errorCount;
+  std::size_t elementCount;
+  std::size_t shortCount;
+  std::size_t clearanceViolationCount;
+  double parseSeconds;
+  double convertSeconds;
+};
+
+struct ConversionReport
+{
+  std::vector<Diagnostic> diagnostics;
+  ConversionStatistics statistics;
+};
+
+/**
+ * Convert the Eagle board in size bytes at data, writing the layout to
+ * output.  Everything logged goes to report rather than to cerr, and a
+ * conversion shares no state with others, so any number can run at
+ * once on different threads.
+ *
+ * Returns false, with the reason in an error diagnostic, if the board
+ * couldn't be parsed at all or output failed; a board parsed with
+ * errors is still converted as far as it goes.
+ */
+bool
+convertBoard(const char *data,
+             std::size_t size,
+             const ConversionOptions &options,
+             std::ostream &output,
+             ConversionReport &report);
+
+}
+
+#endif
@@ -0,0 +1,6008 @@
+// SAX handler building the board model from an Eagle .brd file, and
+// the output it prints, shared by the command line and the library.
+// Copyright 2014 by Brian Davis.
+
+#ifndef eagle_handler_HEADER
+#define eagle_handler_HEADER
+
+// Standard C library includes
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+
+// System includes
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// STL includes
+#include <queue>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <utility>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <functional>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Boost includes
+#include <boost/units/io.hpp>
+#include <boost/units/systems/si.hpp>
+#include <boost/units/base_units/us/mil.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/utility/string_ref.hpp>
+
+// Xerces includes
+#include <xercesc/sax/HandlerBase.hpp>
+#include <xercesc/util/XMLUniDefs.hpp>
+#include <xercesc/sax/AttributeList.hpp>
+#include <xercesc/util/PlatformUtils.hpp>
+#include <xercesc/util/TransService.hpp>
+#include <xercesc/parsers/SAXParser.hpp>
+#include <xercesc/util/OutOfMemoryException.hpp>
+#include <xercesc/sax/InputSource.hpp>
+#include <xercesc/util/BinInputStream.hpp>
+#include <xercesc/framework/MemBufInputSource.hpp>
+#include <xercesc/sax/Locator.hpp>
+#include <xercesc/framework/MemoryManager.hpp>
+
+// Local includes
+#include "boost_unit_extras.hpp"
+#include "eagle_transform.hpp"
+#include "eagle_subtrees.hpp"
+#include "union_find.hpp"
+#include "interner.hpp"
+#include "spatial_grid.hpp"
+#include "polygon_clip.hpp"
+#include "model_snapshot.hpp"
+#include "parse_cache.hpp"
+#include "compressed_input.hpp"
+#include "document_sections.hpp"
+#include "output_writer.hpp"
+#include "spill_file.hpp"
+#include "allocation_stats.hpp"
+#include "conversion_server.hpp"
+#include "eagle_converter.hpp"
+#include "grid_snap.hpp"
+#include "text_metrics.hpp"
+#include "gedapcb.hpp"
+
+using namespace std;
+using namespace xercesc;
+XERCES_CPP_NAMESPACE_USE
+
+namespace jrl
+{
+
+static const double INCHES_PER_MM = 0.0393701;
+
+inline string
+getStlString(const XMLCh * const xmlString)
+{
+  char * transcoded = XMLString::transcode(xmlString);
+  string result(transcoded);
+  XMLString::release(&transcoded);
+  return result;
+}
+
+/**
+ * Append length UTF-16 code units from a Xerces string to target as
+ * UTF-8, without any intermediate allocation.  Eagle files are UTF-8,
+ * so this round trips names and text exactly.
+ */
+inline void
+appendUtf8(const XMLCh * const xmlString,
+           const XMLSize_t length,
+           string &target)
+{
+  for (XMLSize_t index = 0; index < length; ++index) {
+    uint32_t code = xmlString[index];
+    if ((0xD800 <= code) && (code < 0xDC00) && (index + 1 < length) &&
+        (0xDC00 <= xmlString[index + 1]) && (xmlString[index + 1] < 0xE000)) {
+      // Surrogate pair.
+      code = 0x10000 + ((code - 0xD800) << 10) +
+        (xmlString[index + 1] - 0xDC00);
+      ++index;
+    }
+    if (code < 0x80) {
+      target.push_back(static_cast<char>(code));
+    }
+    else if (code < 0x800) {
+      target.push_back(static_cast<char>(0xC0 | (code >> 6)));
+      target.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    else if (code < 0x10000) {
+      target.push_back(static_cast<char>(0xE0 | (code >> 12)));
+      target.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      target.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+    else {
+      target.push_back(static_cast<char>(0xF0 | (code >> 18)));
+      target.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+      target.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+      target.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+  }
+}
+
+inline void
+appendUtf8(const XMLCh * const xmlString,
+           string &target)
+{
+  appendUtf8(xmlString, XMLString::stringLen(xmlString), target);
+}
+
+inline ostream &
+operator<<(ostream &target, const XMLCh * const &outgoing)
+{
+  char * transcoded = XMLString::transcode(outgoing);
+  target << transcoded;
+  XMLString::release(&transcoded);
+  return target;
+}
+
+class SAXHandler : public HandlerBase
+{
+public:
+
+  // Types
+
+  /**
+   * Parsing context, i.e. the innermost enclosing element which
+   * matters to the conversion.
+   */
+  enum Context {
+    DOCUMENT_CONTEXT,
+    LAYERS_CONTEXT,
+    BOARD_CONTEXT,
+    PLAIN_CONTEXT,
+    TEXT_CONTEXT,
+    LIBRARIES_CONTEXT,
+    LIBRARY_CONTEXT,
+    PACKAGES_CONTEXT,
+    PACKAGE_CONTEXT,
+    ELEMENTS_CONTEXT,
+    SIGNALS_CONTEXT,
+    SIGNAL_CONTEXT,
+    POLYGON_CONTEXT,
+    DESIGNRULES_CONTEXT,
+    ELEMENT_CONTEXT,
+    // Content which is skipped, including the children of elements
+    // which are handled entirely by their attributes.
+    IGNORED_CONTEXT,
+    CONTEXT_COUNT,
+    INVALID_CONTEXT = CONTEXT_COUNT
+  };
+
+  /**
+   * Element found in a context where it isn't expected, its content is
+   * skipped.
+   */
+  class NestingError
+  {
+  public:
+
+    // Constructors/destructors
+
+    NestingError(const string &element,
+                 const Context context,
+                 const XMLSSize_t lineNumber,
+                 const XMLSSize_t columnNumber)
+      : element_(element), context_(context),
+        lineNumber_(lineNumber), columnNumber_(columnNumber)
+    {
+    }
+
+    // Member functions
+
+    const string &
+    getElement() const
+    {
+      return element_;
+    }
+
+    Context
+    getContext() const
+    {
+      return context_;
+    }
+
+    XMLSSize_t
+    getLineNumber() const
+    {
+      return lineNumber_;
+    }
+
+    XMLSSize_t
+    getColumnNumber() const
+    {
+      return columnNumber_;
+    }
+
+  private:
+
+    // Data members
+
+    string element_;
+    Context context_;
+    XMLSSize_t lineNumber_;
+    XMLSSize_t columnNumber_;
+  };
+
+  /**
+   * Sends the diagnostics of the calling thread to log while it
+   * exists, see getLog().
+   */
+  class LogScope
+  {
+  public:
+
+    // Constructors/destructors
+
+    explicit LogScope(ostream &log)
+      : previous_(getLogSlot())
+    {
+      getLogSlot() = &log;
+    }
+
+    ~LogScope()
+    {
+      getLogSlot() = previous_;
+    }
+
+    LogScope(const LogScope &) = delete;
+
+    LogScope &
+    operator=(const LogScope &) = delete;
+
+  private:
+
+    // Data members
+
+    ostream *previous_;
+  };
+
+  // Constructors/destructors
+
+  SAXHandler()
+    : locator_(NULL), recorder_(NULL), isRecordingOnly_(false),
+      memoryBudget_(NULL), spillFile_(NULL), limits_(NULL),
+      isReplacing_(false), isIncludingTextExtents_(false),
+      currentText_(NULL), currentPackage_(NULL), currentSignal_(NULL),
+      currentPolygon_(NULL), currentElement_(NULL)
+  {
+  }
+
+  virtual
+  ~SAXHandler(void)
+  {
+    delete locator_;
+    for (PackageIndex::iterator entry = packageIndex_.begin();
+         entry != packageIndex_.end(); ++entry) {
+      delete entry->second;
+    }
+    clearElements();
+    for (vector<Signal *>::iterator iter = signals_.begin();
+         iter != signals_.end(); ++iter) {
+      delete *iter;
+    }
+  }
+
+  // Member functions
+
+  /**
+   * Stream for diagnostics (lines starting with DBG, INFO, WARN or ERR)
+   * on the calling thread: cerr, unless redirected by a LogScope so that
+   * conversions on different threads each collect their own.
+   */
+  static ostream &
+  getLog()
+  {
+    ostream * const log = getLogSlot();
+    return (NULL == log) ? cerr : *log;
+  }
+
+  void
+  finalize()
+  {
+    for (CountIterator entry = elementCounts_.begin();
+         entry != elementCounts_.end(); ++entry) {
+      getLog() << "DBG element " << entry->first << " -> " << entry->second << endl;
+    }
+    // for (CountIterator entry = layerCounts_.begin();
+    //      entry != layerCounts_.end(); ++entry) {
+    //   string mapping = layerNames_[entry->first];
+    //   cerr << "DBG layer " << mapping << " (" << entry->first << ") -> "
+    //        << entry->second << endl;
+    // }
+  }
+
+  /**
+   * Output a gEDA Element for every placed element, applying the
+   * placement transform to the geometry of its package.
+   */
+  void
+  printElements(ostream &strm) const
+  {
+    const double originY = getOriginY();
+    for (size_t index = 0; index < elements_.size(); ++index) {
+      printElement(strm, index, originY);
+    }
+  }
+
+  /**
+   * Output the gEDA Via for each via of the signals, sized by the
+   * design rules.  Vias are printed straight from their columns, with
+   * no object kept per via.
+   */
+  void
+  printVias(ostream &strm) const
+  {
+    static const string SHAPE_FLAGS[] = { "", "square", "octagon" };
+    const string noName;
+    const double originY = getOriginY();
+    const Millimeters clearance(2.0 * DEFAULT_CLEARANCE);
+    for (vector<Signal *>::const_iterator signal = signals_.begin();
+         signal != signals_.end(); ++signal) {
+      const ViaColumns &vias = (*signal)->getVias();
+      for (size_t via = 0; via < vias.size(); ++via) {
+        const double drill = vias.getDrill(via);
+        const double diameter =
+          designRules_.getViaDiameter(drill, vias.getDiameter(via));
+        const double mask =
+          designRules_.getViaMask(drill, diameter, vias.isAlwaysStopped(via));
+        // NOTE: Eagle Y axis points up, gEDA pcb Y axis points down.
+        // Lines end without a flush, which would dominate on boards
+        // with many vias.
+        strm << geda_pcb::Via(Millimeters(vias.getX(via)),
+                              Millimeters(originY - vias.getY(via)),
+                              Millimeters(diameter),
+                              clearance,
+                              Millimeters(mask),
+                              Millimeters(drill),
+                              noName,
+                              SHAPE_FLAGS[vias.getShape(via)])
+             << '\n';
+      }
+    }
+  }
+
+  /**
+   * Output the gEDA Element for a single placed element, see
+   * printElements().
+   */
+  void
+  printElement(ostream &strm,
+               const size_t index,
+               const double originY) const
+  {
+    const Element &element = *elements_[index];
+    const Package *package = element.getPackage();
+    if (NULL == package) {
+      // Already reported when the element was parsed.
+      return;
+    }
+    const PackageGeometry &geometry = package->getGeometry();
+    vector<double> xs(geometry.getXs());
+    vector<double> ys(geometry.getYs());
+    const bool isMirrored =
+      element.hasRotation() && element.getRotation().isMirrored();
+    if (element.hasRotation() && !xs.empty()) {
+      element.getRotation().apply(&xs[0], &ys[0], xs.size());
+    }
+
+    // NOTE: Eagle Y axis points up, gEDA pcb Y axis points down, and
+    // the name is placed relative to the mark.
+    const double x = element.getX().value();
+    const double y = element.getY();
+    TextPlacement name;
+    if (!tryPlaceName(element, name)) {
+      name.x = x;
+      name.y = y;
+      name.direction = 0;
+      name.scale = 100;
+    }
+    geda_pcb::Element placed(isMirrored ? "onsolder" : "",
+                             package->getName(),
+                             element.getName(),
+                             element.getValue(),
+                             Millimeters(x),
+                             Millimeters(originY - y),
+                             Millimeters(name.x - x),
+                             Millimeters(y - name.y),
+                             name.direction, name.scale, "");
+    addGeometry(placed, geometry, xs, ys,
+                element.hasRotation() ? element.getRotation() : Rotation());
+    strm << placed << endl;
+  }
+
+  size_t
+  getElementCount() const
+  {
+    return elements_.size();
+  }
+
+  /**
+   * (library, package) names of every parsed package, in name order.
+   */
+  vector<pair<string, string> >
+  getPackageKeys() const
+  {
+    vector<pair<string, string> > keys;
+    keys.reserve(packageIndex_.size());
+    for (PackageIndex::const_iterator entry = packageIndex_.begin();
+         entry != packageIndex_.end(); ++entry) {
+      keys.push_back(entry->first);
+    }
+    sort(keys.begin(), keys.end());
+    return keys;
+  }
+
+  /**
+   * Output a package as a standalone gEDA footprint, an Element at the
+   * origin.  Only reads the finalized model, so footprints may be
+   * printed concurrently.
+   */
+  void
+  printFootprint(ostream &strm,
+                 const pair<string, string> &key) const
+  {
+    const PackageIndex::const_iterator entry = packageIndex_.find(key);
+    assert(packageIndex_.end() != entry);
+    const PackageGeometry &geometry = entry->second->getGeometry();
+    geda_pcb::Element footprint("", entry->second->getName(), "", "",
+                                0, 0, 0, 0, 0, 100, "");
+    addGeometry(footprint, geometry, geometry.getXs(), geometry.getYs(),
+                Rotation());
+    strm << footprint << endl;
+  }
+
+  /**
+   * Output the gEDA NetList built from the contacts of each signal.
+   *
+   * Pads are interned by their "element-pad" connection name and
+   * grouped with a union-find, so signals which share a pad end up in a
+   * single net (named after the first of them).
+   */
+  void
+  printNetList(ostream &strm) const
+  {
+    Interner pads;
+    UnionFind nets;
+    vector<size_t> padSignals;  // First signal which refers to each pad.
+    for (size_t index = 0; index < signals_.size(); ++index) {
+      const vector<Signal::Contact> &contacts = signals_[index]->getContacts();
+      uint32_t first = 0;
+      for (vector<Signal::Contact>::const_iterator contact = contacts.begin();
+           contact != contacts.end(); ++contact) {
+        const uint32_t pad = pads.intern(contact->first + "-" + contact->second);
+        if (padSignals.size() == pad) {
+          padSignals.push_back(index);
+          nets.resize(pads.size());
+        }
+        else if (padSignals[pad] != index) {
+          getLog() << "WARN pad '" << pads.get(pad) << "' is in signals '"
+               << signals_[padSignals[pad]]->getName() << "' and '"
+               << signals_[index]->getName() << "'" << endl;
+        }
+        if (contacts.begin() == contact) {
+          first = pad;
+        }
+        else {
+          nets.unite(first, pad);
+        }
+      }
+    }
+
+    geda_pcb::NetList netList;
+    vector<geda_pcb::Net *> rootNets(pads.size(), NULL);
+    for (uint32_t pad = 0; pad < pads.size(); ++pad) {
+      geda_pcb::Net *&net = rootNets[nets.find(pad)];
+      if (NULL == net) {
+        net = new geda_pcb::Net(signals_[padSignals[pad]]->getName(),
+                                "(unknown)");
+        netList.addNet(net);
+      }
+      net->addConnection(pads.get(pad));
+    }
+    strm << netList;
+  }
+
+  /**
+   * Output a gEDA Layer for each copper layer in use, holding the
+   * routed wires of the signals, the text and the polygon pours, and
+   * the silk layers holding the text of the silk screen.
+   *
+   * Pours are normally left for pcb to clear around other signals
+   * ("clearpoly"); when pre-clearing, the isolation around the wires,
+   * vias and pads of other signals is subtracted here instead and the pours
+   * are output as the resulting (possibly several) polygons.  Cutout
+   * polygons are always subtracted from the pours on their layer.
+   */
+  void
+  printLayers(ostream &strm,
+              const bool isPreClearing) const
+  {
+    const double originY = getOriginY();
+    CopperLayers layers(memoryBudget_, spillFile_);
+    addLines(board_.getWires(), originY, layers);
+    for (vector<Signal *>::const_iterator signal = signals_.begin();
+         signal != signals_.end(); ++signal) {
+      pollLimits();
+      addLines((*signal)->getWires(), originY, layers);
+    }
+    addTexts(originY, layers);
+    addPolygons(originY, isPreClearing, layers);
+    layers.print(strm);
+  }
+
+  /**
+   * Check that the routed copper of different signals does not touch,
+   * reporting each short with its location to strm.  Returns the number of
+   * pairs of shorted signals.
+   *
+   * NOTE: only wire endpoints, vias and the centers of the pads which
+   * signals connect are considered, e.g. a wire which ends on the edge
+   * of a pad of another signal isn't found.
+   */
+  size_t
+  checkCopperConnectivity(ostream &strm) const
+  {
+    CopperNodes nodes;
+    UnionFind copper;
+    vector<uint32_t> owners;  // Signal of each copper node.
+    for (uint32_t index = 0; index < signals_.size(); ++index) {
+      const ViaColumns &vias = signals_[index]->getVias();
+      for (size_t via = 0; via < vias.size(); ++via) {
+        getCopperNode(CopperPoint(VIA_LAYERS, vias.getX(via), vias.getY(via)),
+                      index, nodes, copper, owners);
+      }
+    }
+    // NOTE: pins are on all layers like vias, so wire ends find them
+    // the same way.
+    vector<CopperSegment> pads;
+    addPadCopper(pads);
+    for (vector<CopperSegment>::const_iterator pad = pads.begin();
+         pad != pads.end(); ++pad) {
+      if (0 <= pad->getSignal()) {
+        const ClipPoint center = pad->getCenter();
+        getCopperNode(CopperPoint(pad->getLayer(), center.x, center.y),
+                      static_cast<uint32_t>(pad->getSignal()), nodes, copper,
+                      owners);
+      }
+    }
+    for (uint32_t index = 0; index < signals_.size(); ++index) {
+      const vector<Wire *> &wires = signals_[index]->getWires();
+      for (vector<Wire *>::const_iterator iter = wires.begin();
+           iter != wires.end(); ++iter) {
+        const Wire &wire = **iter;
+        if ((!wire.hasLayer()) || (!isCopperLayer(wire.getLayer()))) {
+          // e.g. airwires on the unrouted layer
+          continue;
+        }
+        const CopperPoint ends[2] = {
+          CopperPoint(wire.getLayer(), wire.getX1(), wire.getY1()),
+          CopperPoint(wire.getLayer(), wire.getX2(), wire.getY2())
+        };
+        uint32_t endNodes[2];
+        for (unsigned end = 0; end < 2; ++end) {
+          endNodes[end] = getCopperNode(ends[end], index, nodes, copper, owners);
+          const CopperNodes::const_iterator via =
+            nodes.find(CopperPoint(VIA_LAYERS, ends[end]));
+          if (nodes.end() != via) {
+            copper.unite(endNodes[end], via->second);
+          }
+        }
+        copper.unite(endNodes[0], endNodes[1]);
+      }
+    }
+
+    vector<int64_t> rootOwners(owners.size(), -1);
+    set<pair<uint32_t, uint32_t> > shorts;
+    for (CopperNodes::const_iterator node = nodes.begin();
+         node != nodes.end(); ++node) {
+      int64_t &rootOwner = rootOwners[copper.find(node->second)];
+      const uint32_t owner = owners[node->second];
+      if (0 > rootOwner) {
+        rootOwner = owner;
+      }
+      else if (owner != rootOwner) {
+        const pair<uint32_t, uint32_t> signals(min<uint32_t>(owner, rootOwner),
+                                               max<uint32_t>(owner, rootOwner));
+        if (shorts.insert(signals).second) {
+          const CopperPoint &point = node->first;
+          strm << "WARN short between signals '"
+               << signals_[signals.first]->getName() << "' and '"
+               << signals_[signals.second]->getName() << "' near ("
+               << point.getX() << ", " << point.getY() << ") mm" << endl;
+        }
+      }
+    }
+    return shorts.size();
+  }
+
+  /**
+   * Check that the routed copper of different signals keeps the
+   * clearance given to the converted lines, reporting each pair of wire
+   * segments, vias or pads which comes closer with its location to strm.
+   * Returns the number of violations.
+   *
+   * The copper, pads included, is binned into a uniform grid with each
+   * piece grown by half the clearance, so pieces which are too close
+   * share a cell and only pieces within a cell are compared.  The cells
+   * are checked on threadCount threads.
+   */
+  size_t
+  checkClearances(const unsigned threadCount,
+                  ostream &strm) const
+  {
+    vector<CopperSegment> segments;
+    SpatialGrid grid(CLEARANCE_GRID_CELL);
+    const double margin = DEFAULT_CLEARANCE / 2.0;
+    indexCopper(segments, grid, margin);
+    vector<BoundingBox> bounds(segments.size());
+    for (size_t index = 0; index < segments.size(); ++index) {
+      bounds[index] = segments[index].getBounds().expand(margin);
+    }
+    vector<SpatialGrid::Cell> cells;
+    grid.getCells(cells);
+
+    atomic<size_t> nextCell(0);
+    vector<vector<ClearanceViolation> > found(max(1U, threadCount));
+    vector<thread> threads;
+    for (size_t index = 1; index < found.size(); ++index) {
+      threads.push_back(thread(&SAXHandler::checkCellClearances, this,
+                               cref(segments), cref(bounds), cref(grid),
+                               cref(cells), ref(nextCell), ref(found[index])));
+    }
+    checkCellClearances(segments, bounds, grid, cells, nextCell, found[0]);
+    for (vector<thread>::iterator iter = threads.begin();
+         iter != threads.end(); ++iter) {
+      iter->join();
+    }
+
+    vector<ClearanceViolation> violations;
+    for (size_t index = 0; index < found.size(); ++index) {
+      violations.insert(violations.end(), found[index].begin(),
+                        found[index].end());
+    }
+    sort(violations.begin(), violations.end());
+    // NOTE: consecutive segments of a wire report their common end once
+    // each, and their violations needn't be adjacent in the order, so
+    // each location is only reported once per pair of signals.
+    set<pair<pair<double, double>, pair<int64_t, int64_t> > > reported;
+    size_t violationCount = 0;
+    for (size_t index = 0; index < violations.size(); ++index) {
+      const ClearanceViolation &violation = violations[index];
+      const CopperSegment &first = segments[violation.first];
+      const CopperSegment &second = segments[violation.second];
+      const pair<int64_t, int64_t> signals(min(first.getSignal(),
+                                               second.getSignal()),
+                                           max(first.getSignal(),
+                                               second.getSignal()));
+      if (!reported.insert(make_pair(make_pair(violation.location.x,
+                                               violation.location.y),
+                                     signals)).second) {
+        continue;
+      }
+      ++violationCount;
+      strm << "WARN clearance violation between "
+           << describeCopper(first) << " and " << describeCopper(second);
+      if (VIA_LAYERS != first.getLayer()) {
+        strm << " on layer " << first.getLayer();
+      }
+      else if (VIA_LAYERS != second.getLayer()) {
+        strm << " on layer " << second.getLayer();
+      }
+      strm << " at (" << violation.location.x << ", "
+           << violation.location.y << ") mm, ";
+      if (0.0 < violation.gap) {
+        strm << "gap " << violation.gap << " mm of " << DEFAULT_CLEARANCE
+             << " mm" << endl;
+      }
+      else {
+        strm << "copper overlaps" << endl;
+      }
+    }
+    return violationCount;
+  }
+
+  /**
+   * Distance between the points of the Eagle grid in mm, 0 if the file
+   * has no grid.
+   */
+  double
+  getGridDistance() const
+  {
+    return grid_.hasDistance() ? grid_.getDistance() : 0.0;
+  }
+
+  /**
+   * gEDA pcb name ("mm" or "mil") of the unit the Eagle grid shows
+   * distances in, NULL if the file has no grid.
+   */
+  const char *
+  getGridUnitName() const
+  {
+    return grid_.hasUnit() ? grid_.getUnitName() : NULL;
+  }
+
+  bool
+  isGridDisplayed() const
+  {
+    return grid_.isDisplayed();
+  }
+
+  /**
+   * Snap the board coordinates of the copper and of the element
+   * placements to the Eagle grid, returning false (with nothing
+   * snapped) if the file has no grid.  Package geometry, relative to
+   * the placements, is left as drawn.  Snapping twice changes nothing,
+   * so it may follow every update of the model.
+   */
+  bool
+  snapToGrid()
+  {
+    if (!grid_.hasDistance()) {
+      return false;
+    }
+    const GridSnap snap(grid_.getDistance());
+    snapAll(board_.getWires(), snap);
+    snapAll(board_.getHoles(), snap);
+    snapAll(board_.getTexts(), snap);
+    snapPolygons(board_.getPolygons(), snap);
+    for (vector<Signal *>::const_iterator signal = signals_.begin();
+         signal != signals_.end(); ++signal) {
+      snapAll((*signal)->getWires(), snap);
+      (*signal)->getVias().snap(snap);
+      snapPolygons((*signal)->getPolygons(), snap);
+    }
+    snapAll(elements_, snap);
+    return true;
+  }
+
+  /**
+   * Y coordinate of the top edge of the board, used to flip the Y axis
+   * for gEDA pcb.
+   */
+  double
+  getOriginY() const
+  {
+    bool hasOrigin = false;
+    double originY = 0.0;
+    const vector<Wire *> &wires = board_.getWires();
+    for (vector<Wire *>::const_iterator iter = wires.begin();
+         iter != wires.end(); ++iter) {
+      const Wire &wire = **iter;
+      if (wire.hasLayer() && (DIMENSION_LAYER == wire.getLayer())) {
+        originY = hasOrigin ? max(originY, max(wire.getY1(), wire.getY2())) :
+          max(wire.getY1(), wire.getY2());
+        hasOrigin = true;
+      }
+    }
+    if (!hasOrigin) {
+      // No board outline, fall back to the extent of the placements.
+      for (vector<Element *>::const_iterator iter = elements_.begin();
+           iter != elements_.end(); ++iter) {
+        originY = hasOrigin ? max(originY, (*iter)->getY()) : (*iter)->getY();
+        hasOrigin = true;
+      }
+    }
+    if (!isIncludingTextExtents_) {
+      return originY;
+    }
+    // NOTE: only the top edge moves, text below the board is still on
+    // the page.
+    const vector<Text *> &texts = board_.getTexts();
+    for (vector<Text *>::const_iterator iter = texts.begin();
+         iter != texts.end(); ++iter) {
+      TextPlacement placement;
+      if (tryPlaceText(**iter, placement)) {
+        originY = hasOrigin ? max(originY, placement.bounds.getMaxY()) :
+          placement.bounds.getMaxY();
+        hasOrigin = true;
+      }
+    }
+    for (vector<Element *>::const_iterator iter = elements_.begin();
+         iter != elements_.end(); ++iter) {
+      TextPlacement placement;
+      if (tryPlaceName(**iter, placement)) {
+        originY = hasOrigin ? max(originY, placement.bounds.getMaxY()) :
+          placement.bounds.getMaxY();
+        hasOrigin = true;
+      }
+    }
+    return originY;
+  }
+
+  /**
+   * When enabled, the bounding boxes of board text and of the element
+   * names count towards the extent of the board (see getOriginY()), so
+   * that text beyond the outline isn't cut off.
+   */
+  void
+  setIncludingTextExtents(const bool isIncludingTextExtents)
+  {
+    isIncludingTextExtents_ = isIncludingTextExtents;
+  }
+
+  /**
+   * Record the parse events which matter to the conversion, so that
+   * the model can be rebuilt with replay() without parsing again; may
+   * be NULL.
+   */
+  void
+  setRecorder(ModelWriter * const recorder)
+  {
+    recorder_ = recorder;
+  }
+
+  /**
+   * When set, limits are polled for every element parsed or replayed
+   * and as the copper is converted, so that a request which exceeds
+   * them is abandoned by the exception they throw.
+   */
+  void
+  setLimits(RequestLimits * const limits)
+  {
+    limits_ = limits;
+  }
+
+  /**
+   * When set, the converted copper lines are moved to spillFile as the
+   * process nears the limit of budget, see CopperLayers; either may be
+   * NULL.
+   */
+  void
+  setMemoryBudget(const MemoryBudget * const budget,
+                  SpillFile * const spillFile)
+  {
+    memoryBudget_ = budget;
+    spillFile_ = spillFile;
+  }
+
+  /**
+   * When enabled, parse events are only recorded and no model is
+   * built, nesting errors are collected without being reported, and
+   * the parent contexts of SectionSplitter placeholders are kept, see
+   * ParallelParser.
+   */
+  void
+  setRecordingOnly(const bool isRecordingOnly)
+  {
+    assert((!isRecordingOnly) || (NULL != recorder_));
+    isRecordingOnly_ = isRecordingOnly;
+  }
+
+  const vector<Context> &
+  getSectionContexts() const
+  {
+    return sectionContexts_;
+  }
+
+  /**
+   * Build the model from a snapshot written by a recorder instead of
+   * parsing.  Attributes and text are used in place in the snapshot.
+   * Returns false if the snapshot isn't a balanced document.
+   */
+  bool
+  replay(const ModelReader &model)
+  {
+    startDocument();
+    if (!replayEvents(model, 0, model.getEventCount())) {
+      return false;
+    }
+    endDocument();
+    return contexts_.empty();
+  }
+
+  /**
+   * Feed the events [first, last) of a snapshot, for building the model
+   * from several of them between startDocument() and endDocument().
+   * Returns false if an element ends which didn't start.
+   */
+  bool
+  replayEvents(const ModelReader &model,
+               const size_t first,
+               const size_t last)
+  {
+    for (size_t event = first; event < last; ++event) {
+      switch (model.getEventType(event)) {
+      case ModelLayout::START_EVENT:
+        {
+          attributes_.clear();
+          const size_t first = model.getFirstAttribute(event);
+          const size_t end = first + model.getAttributeCount(event);
+          for (size_t attribute = first; attribute < end; ++attribute) {
+            attributes_.add(model.getAttributeName(attribute),
+                            model.getAttributeValue(attribute));
+          }
+          const boost::string_ref name = model.getEventString(event);
+          elementName_.assign(name.data(), name.size());
+          handleStart(elementName_, attributes_);
+        }
+        break;
+      case ModelLayout::END_EVENT:
+        if (contexts_.empty()) {
+          return false;
+        }
+        handleEnd();
+        break;
+      case ModelLayout::CHARACTERS_EVENT:
+        handleCharacters(model.getEventString(event));
+        break;
+      }
+    }
+    return true;
+  }
+
+  const vector<NestingError> &
+  getNestingErrors() const
+  {
+    return nestingErrors_;
+  }
+
+  /**
+   * Report a nesting error found while parsing elsewhere.
+   */
+  void
+  addNestingError(const NestingError &error)
+  {
+    nestingErrors_.push_back(error);
+    getLog() << "ERR unexpected element '" << error.getElement() << "' in "
+         << getContextName(error.getContext()) << " at line "
+         << error.getLineNumber() << ", char " << error.getColumnNumber()
+         << ", skipping its content" << endl;
+  }
+
+  static const char *
+  getContextName(const Context context)
+  {
+    static const char * const NAMES[CONTEXT_COUNT] = {
+      "document", "layers", "board", "plain", "text", "libraries",
+      "library", "packages", "package", "elements",
+      "signals", "signal", "polygon", "design rules", "element",
+      "ignored content"
+    };
+    assert(context < CONTEXT_COUNT);
+    return NAMES[context];
+  }
+
+  // Incremental reconversion support, see WatchSession.
+
+  /**
+   * When enabled, packages and signals which are parsed again replace
+   * the existing package or signal of the same name instead of being
+   * reported as duplicates.
+   */
+  void
+  setReplacing(const bool isReplacing)
+  {
+    isReplacing_ = isReplacing;
+  }
+
+  /**
+   * Discard the contents of <plain> prior to parsing it again.
+   */
+  void
+  clearPlain()
+  {
+    board_.clear();
+  }
+
+  /**
+   * Discard the contents of <elements> prior to parsing it again.
+   */
+  void
+  clearElements()
+  {
+    for (vector<Element *>::iterator iter = elements_.begin();
+         iter != elements_.end(); ++iter) {
+      delete *iter;
+    }
+    elements_.clear();
+  }
+
+  /**
+   * Resolve all elements against the package index again, returns the
+   * indices of the elements whose package was replaced or added.
+   */
+  vector<size_t>
+  resolveElements()
+  {
+    vector<size_t> changed;
+    for (size_t index = 0; index < elements_.size(); ++index) {
+      Element &element = *elements_[index];
+      const PackageKey key(element.getLibraryName(), element.getPackageName());
+      const PackageIndex::const_iterator entry = packageIndex_.find(key);
+      const Package *package =
+        (packageIndex_.end() == entry) ? NULL : entry->second;
+      if ((package != element.getPackage()) ||
+          (0 != replacedPackages_.count(key))) {
+        element.setPackage(package);
+        changed.push_back(index);
+      }
+    }
+    replacedPackages_.clear();
+    return changed;
+  }
+
+  // DocumentHandler overrides
+
+  void
+  startDocument()
+  {
+    if (!isRecordingOnly_) {
+      getLog() << "DBG start of document" << endl;
+    }
+    contexts_.clear();
+  }
+
+  void
+  endDocument()
+  {
+    if (!isRecordingOnly_) {
+      getLog() << "DBG end of document" << endl;
+    }
+  }
+
+  void
+  startElement(const XMLCh * const elementName,
+               AttributeList &attributeList)
+  {
+    // NOTE: both element name and attributes are transcoded into
+    // scratch buffers which are reused for every element.
+    elementName_.clear();
+    appendUtf8(elementName, elementName_);
+    scratchCounter_.update(elementName_.capacity() + characters_.capacity());
+    handleStart(elementName_, attributes_.load(attributeList));
+  }
+
+  void
+  endElement(const XMLCh * const elementName)
+  {
+    // NOTE: the parser guarantees that elements are balanced, so the
+    // name isn't needed to know which element ends.
+    handleEnd();
+  }
+
+  void
+  characters(const XMLCh * const chars,
+             const XMLSize_t length)
+  {
+    characters_.clear();
+    appendUtf8(chars, length, characters_);
+    scratchCounter_.update(elementName_.capacity() + characters_.capacity());
+    handleCharacters(characters_);
+  }
+
+  void
+  ignorableWhitespace(const XMLCh * const chars,
+                      const XMLSize_t length)
+  {
+    // Unused
+  }
+
+  void
+  processingInstruction(const XMLCh * const target,
+                        const XMLCh * const data)
+  {
+    getLog() << "DBG processing instruction" << endl;
+  }
+
+  // ErrorHandler overrides
+  void
+  warning(const SAXParseException &exc)
+  {
+    dumpExceptionDetails("WARN", exc);
+  }
+
+  void
+  error(const SAXParseException &exc)
+  {
+    dumpExceptionDetails("ERR", exc);
+  }
+
+  void
+  fatalError(const SAXParseException &exc)
+  {
+    dumpExceptionDetails("FATAL", exc);
+  }
+
+  // DTDHandler interface
+  void
+  notationDecl(const XMLCh * const name,
+               const XMLCh * const publicId,
+               const XMLCh * const systemId)
+  {
+    // Unused
+  }
+
+  void
+  unparsedEntityDecl(const XMLCh * const name,
+                     const XMLCh * const publicId,
+                     const XMLCh * const systemId,
+                     const XMLCh * const notationName)
+  {
+    // Unused
+  }
+
+  virtual void
+  setDocumentLocator(const Locator * const locator)
+  {
+    if (NULL != locator_) {
+      delete locator_;
+    }
+    locator_ = new LocatorManager(locator);
+  }
+
+private:
+
+  // Types
+
+  enum Language {
+    ENGLISH,
+    GERMAN
+  };
+
+  typedef map<string, unsigned> CountMap;
+  typedef map<string, unsigned>::iterator CountIterator;
+  typedef map<string, string> StringMap;
+  typedef map<string, string>::iterator StringIterator;
+  // (library name, package name)
+  typedef pair<string, string> PackageKey;
+
+  /**
+   * Element types distinguished by the parsing state machine, all
+   * others are OTHER_ELEMENT.
+   */
+  enum ElementType {
+    LAYERS_ELEMENT,
+    LAYER_ELEMENT,
+    BOARD_ELEMENT,
+    PLAIN_ELEMENT,
+    TEXT_ELEMENT,
+    DESCRIPTION_ELEMENT,
+    NOTE_ELEMENT,
+    WIRE_ELEMENT,
+    HOLE_ELEMENT,
+    RECTANGLE_ELEMENT,
+    CIRCLE_ELEMENT,
+    LIBRARIES_ELEMENT,
+    LIBRARY_ELEMENT,
+    PACKAGES_ELEMENT,
+    PACKAGE_ELEMENT,
+    ELEMENTS_ELEMENT,
+    ELEMENT_ELEMENT,
+    SIGNALS_ELEMENT,
+    SIGNAL_ELEMENT,
+    CONTACTREF_ELEMENT,
+    VIA_ELEMENT,
+    POLYGON_ELEMENT,
+    VERTEX_ELEMENT,
+    GRID_ELEMENT,
+    SMD_ELEMENT,
+    PAD_ELEMENT,
+    DESIGNRULES_ELEMENT,
+    PARAM_ELEMENT,
+    ATTRIBUTE_ELEMENT,
+    SECTION_ELEMENT,
+    OTHER_ELEMENT,
+    ELEMENT_TYPE_COUNT
+  };
+
+  class AttributeBuffer;
+
+  typedef void (SAXHandler::*StartAction)(const AttributeBuffer &);
+  typedef void (SAXHandler::*EndAction)();
+
+  /**
+   * Context entered by an element of a type along with the member
+   * functions called at its start and end (either may be NULL).
+   */
+  struct Transition
+  {
+    Context context;
+    ElementType type;
+    StartAction start;
+    EndAction end;
+  };
+
+  /**
+   * Transitions of the parsing state machine, indexed by (current
+   * context, element type).  Elements which aren't listed for a context
+   * are nesting errors, except for OTHER_ELEMENT (i.e. elements which
+   * don't matter to the conversion) which leaves the context as it is.
+   */
+  class TransitionTable
+  {
+  public:
+
+    // Constructors/destructors
+
+    TransitionTable()
+    {
+      for (unsigned context = 0; context < CONTEXT_COUNT; ++context) {
+        for (unsigned type = 0; type < ELEMENT_TYPE_COUNT; ++type) {
+          set(static_cast<Context>(context), static_cast<ElementType>(type),
+              (IGNORED_CONTEXT == context) ? IGNORED_CONTEXT : INVALID_CONTEXT);
+        }
+        set(static_cast<Context>(context), OTHER_ELEMENT,
+            static_cast<Context>(context));
+        // NOTE: placeholders are recorded, unlike other elements.
+        set(static_cast<Context>(context), SECTION_ELEMENT,
+            static_cast<Context>(context));
+        // NOTE: parameters outside the design rules are autorouter
+        // settings, of no use.
+        set(static_cast<Context>(context), PARAM_ELEMENT, IGNORED_CONTEXT);
+        // NOTE: only the attributes of elements place anything.
+        set(static_cast<Context>(context), ATTRIBUTE_ELEMENT, IGNORED_CONTEXT);
+      }
+
+      addElementType(LAYERS, LAYERS_ELEMENT);
+      addElementType(LAYER, LAYER_ELEMENT);
+      addElementType(BOARD, BOARD_ELEMENT);
+      addElementType(PLAIN, PLAIN_ELEMENT);
+      addElementType(TEXT, TEXT_ELEMENT);
+      addElementType(DESCRIPTION, DESCRIPTION_ELEMENT);
+      addElementType(NOTE, NOTE_ELEMENT);
+      addElementType(WIRE, WIRE_ELEMENT);
+      addElementType(HOLE, HOLE_ELEMENT);
+      addElementType(RECTANGLE, RECTANGLE_ELEMENT);
+      addElementType(CIRCLE, CIRCLE_ELEMENT);
+      addElementType(LIBRARIES, LIBRARIES_ELEMENT);
+      addElementType(LIBRARY, LIBRARY_ELEMENT);
+      addElementType(PACKAGES, PACKAGES_ELEMENT);
+      addElementType(PACKAGE, PACKAGE_ELEMENT);
+      addElementType(ELEMENTS, ELEMENTS_ELEMENT);
+      addElementType(ELEMENT, ELEMENT_ELEMENT);
+      addElementType(SIGNALS, SIGNALS_ELEMENT);
+      addElementType(SIGNAL, SIGNAL_ELEMENT);
+      addElementType(CONTACTREF, CONTACTREF_ELEMENT);
+      addElementType(VIA, VIA_ELEMENT);
+      addElementType(POLYGON, POLYGON_ELEMENT);
+      addElementType(VERTEX, VERTEX_ELEMENT);
+      addElementType(GRID, GRID_ELEMENT);
+      addElementType(SMD, SMD_ELEMENT);
+      addElementType(PAD, PAD_ELEMENT);
+      addElementType(DESIGNRULES, DESIGNRULES_ELEMENT);
+      addElementType(PARAM, PARAM_ELEMENT);
+      addElementType(ATTRIBUTE, ATTRIBUTE_ELEMENT);
+      addElementType(SectionSplitter::PLACEHOLDER, SECTION_ELEMENT);
+
+      set(DOCUMENT_CONTEXT, LAYERS_ELEMENT, LAYERS_CONTEXT);
+      set(LAYERS_CONTEXT, LAYER_ELEMENT, IGNORED_CONTEXT);
+      set(DOCUMENT_CONTEXT, NOTE_ELEMENT, IGNORED_CONTEXT);
+      set(DOCUMENT_CONTEXT, GRID_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handleGridDefinition);
+      set(DOCUMENT_CONTEXT, BOARD_ELEMENT, BOARD_CONTEXT);
+      set(BOARD_CONTEXT, PLAIN_ELEMENT, PLAIN_CONTEXT);
+      set(BOARD_CONTEXT, DESIGNRULES_ELEMENT, DESIGNRULES_CONTEXT);
+      set(DESIGNRULES_CONTEXT, DESCRIPTION_ELEMENT, IGNORED_CONTEXT);
+      set(DESIGNRULES_CONTEXT, PARAM_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handleParamDefinition);
+      // NOTE: libraries, elements and signals are also accepted at
+      // document level for the fragments parsed by WatchSession.
+      const Context parents[] = { DOCUMENT_CONTEXT, BOARD_CONTEXT };
+      for (unsigned index = 0; index < 2; ++index) {
+        set(parents[index], LIBRARIES_ELEMENT, LIBRARIES_CONTEXT);
+        set(parents[index], ELEMENTS_ELEMENT, ELEMENTS_CONTEXT);
+        set(parents[index], SIGNALS_ELEMENT, SIGNALS_CONTEXT);
+        set(parents[index], DESCRIPTION_ELEMENT, IGNORED_CONTEXT);
+      }
+      // NOTE: a library file (.lbr) holds a single library at document
+      // level.
+      const Context libraryParents[] = { DOCUMENT_CONTEXT, LIBRARIES_CONTEXT };
+      for (unsigned index = 0; index < 2; ++index) {
+        set(libraryParents[index], LIBRARY_ELEMENT, LIBRARY_CONTEXT,
+            &SAXHandler::handleLibraryDefinition, &SAXHandler::finishLibrary);
+      }
+      // NOTE: symbols and device sets of library files are of no use.
+      set(LIBRARY_CONTEXT, OTHER_ELEMENT, IGNORED_CONTEXT);
+      set(LIBRARY_CONTEXT, DESCRIPTION_ELEMENT, IGNORED_CONTEXT);
+      set(LIBRARY_CONTEXT, PACKAGES_ELEMENT, PACKAGES_CONTEXT);
+      set(PACKAGES_CONTEXT, PACKAGE_ELEMENT, PACKAGE_CONTEXT,
+          &SAXHandler::startPackage, &SAXHandler::finishPackage);
+      // NOTE: descriptions are never output, so aren't even copied.
+      set(PACKAGE_CONTEXT, DESCRIPTION_ELEMENT, IGNORED_CONTEXT);
+      set(PACKAGE_CONTEXT, SMD_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handleSmdDefinition);
+      set(PACKAGE_CONTEXT, PAD_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handlePadDefinition);
+      set(ELEMENTS_CONTEXT, ELEMENT_ELEMENT, ELEMENT_CONTEXT,
+          &SAXHandler::handleElementDefinition, &SAXHandler::finishElement);
+      set(ELEMENT_CONTEXT, ATTRIBUTE_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handleElementAttributeDefinition);
+      // NOTE: variants of elements are of no use.
+      set(ELEMENT_CONTEXT, OTHER_ELEMENT, IGNORED_CONTEXT);
+      set(SIGNALS_CONTEXT, SIGNAL_ELEMENT, SIGNAL_CONTEXT,
+          &SAXHandler::startSignal, &SAXHandler::finishSignal);
+      set(SIGNAL_CONTEXT, CONTACTREF_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handleContactRefDefinition);
+      set(SIGNAL_CONTEXT, VIA_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handleViaDefinition);
+
+      // Drawing primitives.
+      const Context drawings[] = {
+        PLAIN_CONTEXT, PACKAGE_CONTEXT, SIGNAL_CONTEXT
+      };
+      for (unsigned index = 0; index < 3; ++index) {
+        set(drawings[index], WIRE_ELEMENT, IGNORED_CONTEXT,
+            &SAXHandler::handleWireDefinition);
+        set(drawings[index], POLYGON_ELEMENT, POLYGON_CONTEXT,
+            &SAXHandler::startPolygon, &SAXHandler::finishPolygon);
+        if (SIGNAL_CONTEXT == drawings[index]) {
+          continue;
+        }
+        set(drawings[index], TEXT_ELEMENT, TEXT_CONTEXT,
+            &SAXHandler::startText, &SAXHandler::finishText);
+        set(drawings[index], HOLE_ELEMENT, IGNORED_CONTEXT,
+            &SAXHandler::handleHoleDefinition);
+        set(drawings[index], RECTANGLE_ELEMENT, IGNORED_CONTEXT,
+            &SAXHandler::handleRectangleDefinition);
+        set(drawings[index], CIRCLE_ELEMENT, IGNORED_CONTEXT,
+            &SAXHandler::handleCircleDefinition);
+      }
+      set(POLYGON_CONTEXT, VERTEX_ELEMENT, IGNORED_CONTEXT,
+          &SAXHandler::handleVertexDefinition);
+    }
+
+    // Member functions
+
+    ElementType
+    getElementType(const string &name) const
+    {
+      const unordered_map<string, ElementType>::const_iterator entry =
+        elementTypes_.find(name);
+      return (elementTypes_.end() == entry) ? OTHER_ELEMENT : entry->second;
+    }
+
+    const Transition &
+    get(const Context context,
+        const ElementType type) const
+    {
+      assert(context < CONTEXT_COUNT);
+      return transitions_[context][type];
+    }
+
+  private:
+
+    // Member functions
+
+    void
+    addElementType(const string &name,
+                   const ElementType type)
+    {
+      elementTypes_[name] = type;
+    }
+
+    void
+    set(const Context from,
+        const ElementType type,
+        const Context to,
+        const StartAction start = NULL,
+        const EndAction end = NULL)
+    {
+      const Transition transition = { to, type, start, end };
+      transitions_[from][type] = transition;
+    }
+
+    // Data members
+
+    unordered_map<string, ElementType> elementTypes_;
+    Transition transitions_[CONTEXT_COUNT][ELEMENT_TYPE_COUNT];
+  };
+
+  /**
+   * Wrapper which allows the SAXParser to receive a copy of the
+   * Locator object.
+   */
+  class LocatorManager
+  {
+  public:
+    LocatorManager(const Locator * const locator)
+      : locator_(locator)
+    {
+    }
+
+    const XMLCh *
+    getPublicId () const
+    {
+      return locator_->getPublicId();
+    }
+
+    const XMLCh *
+    getSystemId () const
+    {
+      return locator_->getSystemId();
+    }
+
+    XMLSSize_t
+    getLineNumber () const
+    {
+      return locator_->getLineNumber();
+    }
+
+    XMLSSize_t
+    getColumnNumber () const
+    {
+      return locator_->getColumnNumber();
+    }
+
+  private:
+    const Locator * const locator_;
+  };
+
+  /**
+   * Names and values of the attributes of the element being started.
+   * Attributes from the parser are transcoded once into a scratch
+   * buffer owned by the handler, those replayed from a model snapshot
+   * refer to the snapshot directly.  The buffers keep their capacity
+   * from one element to the next, so steady state parsing doesn't
+   * allocate per attribute.  Each name and value is NUL terminated so
+   * that values can be passed directly to atof/atoi.
+   */
+  class AttributeBuffer
+  {
+  public:
+
+    // Member functions
+
+    const AttributeBuffer &
+    load(const AttributeList &attributes)
+    {
+      clear();
+      const XMLSize_t count = attributes.getLength();
+      for (XMLSize_t index = 0; index < count; ++index) {
+        offsets_.push_back(chars_.size());
+        appendUtf8(attributes.getName(index), chars_);
+        chars_.push_back('\0');
+        offsets_.push_back(chars_.size());
+        appendUtf8(attributes.getValue(index), chars_);
+        chars_.push_back('\0');
+      }
+      offsets_.push_back(chars_.size());
+      // NOTE: views are only taken once chars_ has stopped growing.
+      for (size_t index = 0; index + 1 < offsets_.size(); ++index) {
+        views_.push_back(boost::string_ref(&chars_[offsets_[index]],
+                                           offsets_[index + 1] -
+                                           offsets_[index] - 1));
+      }
+      updateCounter();
+      return *this;
+    }
+
+    void
+    clear()
+    {
+      chars_.clear();
+      offsets_.clear();
+      views_.clear();
+    }
+
+    /**
+     * Add an attribute whose name and value are NUL terminated strings
+     * which outlive the element.
+     */
+    void
+    add(const boost::string_ref &name,
+        const boost::string_ref &value)
+    {
+      views_.push_back(name);
+      views_.push_back(value);
+      updateCounter();
+    }
+
+    unsigned
+    getLength() const
+    {
+      return views_.size() / 2;
+    }
+
+    const boost::string_ref &
+    getName(const unsigned index) const
+    {
+      return views_[2 * index];
+    }
+
+    const boost::string_ref &
+    getValue(const unsigned index) const
+    {
+      return views_[(2 * index) + 1];
+    }
+
+  private:
+
+    // Member functions
+
+    void
+    updateCounter()
+    {
+      counter_.update(chars_.capacity() +
+                      (offsets_.capacity() * sizeof(size_t)) +
+                      (views_.capacity() * sizeof(boost::string_ref)));
+    }
+
+    // Data members
+
+    string chars_;
+    vector<size_t> offsets_;
+    // NOTE: name and value for each attribute, in order.
+    vector<boost::string_ref> views_;
+    CapacityCounter<AllocationStatistics::ATTRIBUTE_TAG> counter_;
+  };
+
+  /**
+   * Xerces SAX parsing API doesn't support an object associated with
+   * a single (name, value) attribute, so it is implemented here as a
+   * non-owning view into the AttributeBuffer; it is only valid until
+   * the next element is started.
+   */
+  class Attribute
+  {
+  public:
+
+    // Constructors/destructors
+
+    Attribute(const AttributeBuffer &attributes,
+              const unsigned index)
+      : name_(attributes.getName(index)), value_(attributes.getValue(index))
+    {
+    }
+
+    // Member functions
+
+    boost::string_ref
+    getName() const
+    {
+      return name_;
+    }
+
+    boost::string_ref
+    getValue() const
+    {
+      return value_;
+    }
+
+    /**
+     * NUL terminated value, for numeric conversions.
+     */
+    const char *
+    getValueCString() const
+    {
+      return value_.data();
+    }
+
+    /**
+     * Copy of the value for records which keep it, intended to be
+     * move assigned into place.
+     */
+    string
+    copyValue() const
+    {
+      return string(value_.data(), value_.size());
+    }
+
+  private:
+
+    // Data members
+    boost::string_ref name_;
+    boost::string_ref value_;
+  };
+
+  /**
+   * Mixin for Eagle board file elements which have a specified width.
+   */
+  class HasWidth
+  {
+  public:
+
+    // Constructors/destructors
+
+    HasWidth()
+      : width_(0.0), hasWidth_(false)
+    {}
+
+    // Member functions
+
+    double
+    getWidth() const
+    {
+      assert(hasWidth_);
+      return width_;
+    }
+
+    bool
+    hasWidth() const
+    {
+      return hasWidth_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      const boost::string_ref name = attribute.getName();
+      const char * const value = attribute.getValueCString();
+      if (WIDTH == name) {
+        assert(!hasWidth_);
+        width_ = atof(value);
+        hasWidth_ = true;
+        return true;
+      }
+      return false;
+    }
+
+  private:
+
+    // Data members
+
+    double width_;
+    bool hasWidth_;
+  };
+
+  /**
+   * Mixin to add layer data to Eagle board file elements.
+   */
+  class InLayer : public AllocationCounted<AllocationStatistics::MODEL_TAG>
+  {
+  public:
+
+    // Constructors/destructors
+
+    InLayer()
+      : layer_(0), hasLayer_(false)
+    {}
+
+    // Member functions
+
+    unsigned
+    getLayer() const
+    {
+      assert(hasLayer_);
+      return layer_;
+    }
+
+    bool
+    hasLayer() const
+    {
+      return hasLayer_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (LAYER == attribute.getName()) {
+        assert(!hasLayer_);
+        layer_ = atoi(attribute.getValueCString());
+        hasLayer_ = true;
+        return true;
+      }
+      return false;
+    }
+
+  private:
+
+    // Data members
+
+    unsigned layer_;
+    bool hasLayer_;
+  };
+
+  // TODO: use boost::units?
+  /**
+   * Mixin representing the pose (in a robotics/kinematics sense of
+   * including both position and rotation) of an element in the Eagle
+   * layout.
+   */
+  class Pose : public InLayer
+  {
+  public:
+
+    // Constructors/destructors
+
+    Pose()
+      : x_(0.0), y_(0.0), rotation_(),
+        hasX_(false), hasY_(false), hasRotation_(false)
+    {
+    }
+
+    // Member functions
+
+    Millimeters
+    getX() const
+    {
+      assert(hasX_);
+      return x_;
+    }
+
+    double
+    getY() const
+    {
+      assert(hasY_);
+      return y_;
+    }
+
+    const Rotation &
+    getRotation() const
+    {
+      assert(hasRotation_);
+      return rotation_;
+    }
+
+    bool
+    hasX() const
+    {
+      return hasX_;
+    }
+
+    bool
+    hasY() const
+    {
+      return hasY_;
+    }
+
+    bool
+    hasRotation() const
+    {
+      return hasRotation_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (!InLayer::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (X == name) {
+          assert(!hasX_);
+          x_ = atof(value);
+          hasX_ = true;
+          return true;
+        }
+        if (Y == name) {
+          assert(!hasY_);
+          y_ = atof(value);
+          hasY_ = true;
+          return true;
+        }
+        if (ROTATION == name) {
+          assert(!hasRotation_);
+          if (!rotation_.tryParse(value)) {
+            getLog() << "WARN malformed rotation '" << value << "'" << endl;
+          }
+          hasRotation_ = true;
+          return true;
+        }
+        return false;
+        
+      }
+      // Attribute actually specified the layer.
+      return true;
+    }
+
+    // Coordinates as a column for batched updates, see snapAll().
+    static const size_t COORDINATE_COUNT = 2;
+
+    void
+    getCoordinates(double * const coordinates) const
+    {
+      coordinates[0] = x_.value();
+      coordinates[1] = y_;
+    }
+
+    void
+    setCoordinates(const double * const coordinates)
+    {
+      x_ = Millimeters(coordinates[0]);
+      y_ = coordinates[1];
+    }
+
+  private:
+
+    // Data members
+
+    Millimeters x_;
+    double y_;
+    Rotation rotation_;
+    bool hasX_;
+    bool hasY_;
+    bool hasRotation_;
+  };
+
+  /**
+   * Representation of a text element of an Eagle board or
+   * package.
+   */
+  class Text : public Pose
+  {
+  public:
+
+    // Constructors/destructors
+
+    Text()
+      : language_(ENGLISH), size_(0), ratio_(0), string_(""),
+        metricsIndex_(0), hasSize_(false), hasRatio_(false),
+        hasString_(false), hasMetrics_(false)
+    {
+    }
+
+
+    // Member functions
+
+    Language
+    getLanguage() const
+    {
+      return language_;
+    }
+
+    double
+    getSize() const
+    {
+      assert(hasSize_);
+      return size_;
+    }
+
+    double
+    getRatio() const
+    {
+      assert(hasRatio_);
+      return ratio_;
+    }
+
+    const string &
+    getString() const
+    {
+      assert(hasString_);
+      return string_;
+    }
+
+    bool
+    hasSize() const
+    {
+      return hasSize_;
+    }
+
+    bool
+    hasRatio() const
+    {
+      return hasRatio_;
+    }
+
+    bool
+    hasString() const
+    {
+      return hasString_;
+    }
+
+    /** Index of the gEDA size of the text, see TextMetricsTable. */
+    size_t
+    getMetricsIndex() const
+    {
+      assert(hasMetrics_);
+      return metricsIndex_;
+    }
+
+    bool
+    hasMetrics() const
+    {
+      return hasMetrics_;
+    }
+
+    void
+    setMetricsIndex(const size_t metricsIndex)
+    {
+      metricsIndex_ = metricsIndex;
+      hasMetrics_ = true;
+    }
+
+    /**
+     * Add a chunk of characters, SAX may split the content of an
+     * element into any number of chunks.
+     */
+    void
+    handleCharacters(const boost::string_ref &chars)
+    {
+      // NOTE: appending grows the string geometrically, so long text
+      // delivered in many chunks stays linear.
+      string_.append(chars.data(), chars.size());
+      hasString_ = true;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (!Pose::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (SIZE == name) {
+          assert(!hasSize_);
+          size_ = atof(value);
+          hasSize_ = true;
+          return true;
+        }
+        if (RATIO == name) {
+          assert(!hasRatio_);
+          ratio_ = atof(value);
+          hasRatio_ = true;
+          return true;
+        }
+        if (LANGUAGE == name) {
+          if (EN == value) {
+            language_ = ENGLISH;
+          }
+          else if (DE == value) {
+            language_ = GERMAN;
+          }
+          else {
+            getLog() << "WARN unknown language type '" << value << "'" << endl;
+          }
+          return true;
+        }
+        if ((FONT == name) || (ALIGN == name)) {
+          // TODO: handle this if possible, currently short-circuits
+          // processing of this attribute so that it won't be reported
+          // as unexpected.
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    Language language_;
+    double size_;
+    double ratio_;
+    string string_;
+    size_t metricsIndex_;
+    bool hasSize_;
+    bool hasRatio_;
+    bool hasString_;
+    bool hasMetrics_;
+  };
+
+  /**
+   * Vias of a signal, stored as columns rather than as objects since
+   * dense boards have a great many of them and they are only ever
+   * visited all at once.
+   */
+  class ViaColumns
+  {
+  public:
+
+    // Types
+
+    enum Shape {
+      ROUND_SHAPE,
+      SQUARE_SHAPE,
+      OCTAGON_SHAPE
+    };
+
+    typedef vector<double,
+                   CountingAllocator<double, AllocationStatistics::MODEL_TAG> >
+      Column;
+    typedef vector<uint8_t,
+                   CountingAllocator<uint8_t, AllocationStatistics::MODEL_TAG> >
+      FlagColumn;
+
+    // Member functions
+
+    void
+    add(const double x,
+        const double y,
+        const double drill,
+        const double diameter,
+        const Shape shape,
+        const bool isAlwaysStopped)
+    {
+      xs_.push_back(x);
+      ys_.push_back(y);
+      drills_.push_back(drill);
+      diameters_.push_back(diameter);
+      shapes_.push_back(static_cast<uint8_t>(shape));
+      alwaysStops_.push_back(isAlwaysStopped ? 1 : 0);
+    }
+
+    size_t
+    size() const
+    {
+      return xs_.size();
+    }
+
+    double
+    getX(const size_t index) const
+    {
+      return xs_[index];
+    }
+
+    double
+    getY(const size_t index) const
+    {
+      return ys_[index];
+    }
+
+    double
+    getDrill(const size_t index) const
+    {
+      return drills_[index];
+    }
+
+    /** Outer diameter as drawn, 0 for the design rules to decide. */
+    double
+    getDiameter(const size_t index) const
+    {
+      return diameters_[index];
+    }
+
+    Shape
+    getShape(const size_t index) const
+    {
+      return static_cast<Shape>(shapes_[index]);
+    }
+
+    bool
+    isAlwaysStopped(const size_t index) const
+    {
+      return 0 != alwaysStops_[index];
+    }
+
+    void
+    snap(const GridSnap &snap)
+    {
+      snap.apply(xs_.data(), xs_.size());
+      snap.apply(ys_.data(), ys_.size());
+    }
+
+  private:
+
+    // Data members
+
+    Column xs_;
+    Column ys_;
+    Column drills_;
+    Column diameters_;
+    FlagColumn shapes_;
+    FlagColumn alwaysStops_;
+  };
+
+  /**
+   * Representation of a hole element (including a via) of an Eagle
+   * board or package.
+   *
+   * NOTE: doesn't really need the rotation element, but no need to
+   * create a separate class with position but no rotation to handle
+   * only this case.
+   */
+  class Hole : public Pose
+  {
+  public:
+    Hole(const bool isVia)
+      : drill_(0.0), diameter_(0.0), shape_(ViaColumns::ROUND_SHAPE),
+        hasDrill_(false), isAlwaysStopped_(false), isVia_(isVia)
+    {
+    }
+
+    double
+    getDrill() const
+    {
+      assert(hasDrill_);
+      return drill_;
+    }
+
+    bool
+    hasDrill() const
+    {
+      return hasDrill_;
+    }
+
+    bool
+    isVia() const
+    {
+      return isVia_;
+    }
+
+    /** Outer diameter of a via, 0 for the design rules to decide. */
+    double
+    getDiameter() const
+    {
+      assert(isVia_);
+      return diameter_;
+    }
+
+    ViaColumns::Shape
+    getShape() const
+    {
+      assert(isVia_);
+      return shape_;
+    }
+
+    /** Whether a via gets a solder mask opening whatever its drill. */
+    bool
+    isAlwaysStopped() const
+    {
+      assert(isVia_);
+      return isAlwaysStopped_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (!Pose::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (DRILL == name) {
+          assert(!hasDrill_);
+          drill_ = atof(value);
+          hasDrill_ = true;
+          return true;
+        }
+        if (isVia_) {
+          return tryHandleViaAttribute(attribute);
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Member functions
+
+    bool
+    tryHandleViaAttribute(const Attribute &attribute)
+    {
+      const boost::string_ref name = attribute.getName();
+      const boost::string_ref value = attribute.getValue();
+      if (DIAMETER == name) {
+        diameter_ = atof(attribute.getValueCString());
+        return true;
+      }
+      if (SHAPE == name) {
+        if (SQUARE == value) {
+          shape_ = ViaColumns::SQUARE_SHAPE;
+        }
+        else if (OCTAGON == value) {
+          shape_ = ViaColumns::OCTAGON_SHAPE;
+        }
+        else if (ROUND == value) {
+          shape_ = ViaColumns::ROUND_SHAPE;
+        }
+        else {
+          getLog() << "WARN unknown via shape '" << value << "'" << endl;
+        }
+        return true;
+      }
+      if (ALWAYSSTOP == name) {
+        isAlwaysStopped_ = (YES == value);
+        return true;
+      }
+      if (EXTENT == name) {
+        // NOTE: pcb vias go through all layers, so blind and buried
+        // vias are converted as through vias.
+        return true;
+      }
+      return false;
+    }
+
+    // Data members
+
+    double drill_;
+    double diameter_;  // 0 for automatic
+    ViaColumns::Shape shape_;
+    bool hasDrill_;
+    bool isAlwaysStopped_;
+    const bool isVia_;
+  };
+
+  /**
+   * Copper shape of a pad normalized to its center, shared by all the
+   * pads of a package which differ only in position.  The pad is the
+   * line between center - offset and center + offset, stroked with
+   * thickness as pcb draws pads and pins.
+   */
+  struct PadShape
+  {
+    double offsetX;
+    double offsetY;
+    double thickness;
+    double mask;  // Width of the solder mask opening, 0 for none
+    double drill;  // 0 for SMD pads
+    bool isSquare;
+    bool isOctagon;
+    bool isBottom;
+    bool isPasted;
+
+    bool
+    operator<(const PadShape &other) const
+    {
+      return tie(offsetX, offsetY, thickness, mask, drill, isSquare,
+                 isOctagon, isBottom, isPasted) <
+        tie(other.offsetX, other.offsetY, other.thickness, other.mask,
+            other.drill, other.isSquare, other.isOctagon, other.isBottom,
+            other.isPasted);
+    }
+  };
+
+  /**
+   * Representation of a surface mount pad of an Eagle package.
+   */
+  class Smd : public Pose
+  {
+  public:
+
+    // Constructors/destructors
+
+    Smd()
+      : dx_(0.0), dy_(0.0), roundness_(0.0), isStopped_(true),
+        isCreamed_(true), hasName_(false), hasDx_(false), hasDy_(false)
+    {
+    }
+
+    // Member functions
+
+    const string &
+    getName() const
+    {
+      assert(hasName_);
+      return name_;
+    }
+
+    bool
+    isComplete() const
+    {
+      return hasName_ && hasX() && hasY() && hasDx_ && hasDy_ && hasLayer();
+    }
+
+    /**
+     * Shape of the pad: a line along its longer side, square ended
+     * unless fully rounded.
+     *
+     * NOTE: pcb has no partly rounded pads, so they are left square,
+     * which errs on the side of more copper.
+     */
+    void
+    getShape(PadShape &shape) const
+    {
+      const double length = max(dx_, dy_);
+      const double width = min(dx_, dy_);
+      shape.offsetX = (dx_ >= dy_) ? (length - width) / 2.0 : 0.0;
+      shape.offsetY = (dx_ >= dy_) ? 0.0 : (length - width) / 2.0;
+      if (hasRotation()) {
+        getRotation().apply(shape.offsetX, shape.offsetY);
+      }
+      shape.thickness = width;
+      shape.mask = isStopped_ ? width + (2.0 * STOP_MARGIN) : 0.0;
+      shape.drill = 0.0;
+      shape.isSquare = (roundness_ < 100.0);
+      shape.isOctagon = false;
+      shape.isBottom = (BOTTOM_LAYER == getLayer());
+      shape.isPasted = isCreamed_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (!Pose::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (NAME == name) {
+          name_ = attribute.copyValue();
+          hasName_ = true;
+          return true;
+        }
+        if (DX == name) {
+          dx_ = atof(value);
+          hasDx_ = true;
+          return true;
+        }
+        if (DY == name) {
+          dy_ = atof(value);
+          hasDy_ = true;
+          return true;
+        }
+        if (ROUNDNESS == name) {
+          roundness_ = atof(value);
+          return true;
+        }
+        if (STOP == name) {
+          isStopped_ = (NO != attribute.getValue());
+          return true;
+        }
+        if (CREAM == name) {
+          isCreamed_ = (NO != attribute.getValue());
+          return true;
+        }
+        if (THERMALS == name) {
+          // NOTE: pcb decides thermals per polygon.
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    string name_;
+    double dx_;
+    double dy_;
+    double roundness_;  // Percent
+    bool isStopped_;
+    bool isCreamed_;
+    bool hasName_;
+    bool hasDx_;
+    bool hasDy_;
+  };
+
+  /**
+   * Representation of a through hole pad of an Eagle package.
+   */
+  class Pad : public Pose
+  {
+  public:
+
+    // Types
+
+    enum Shape {
+      ROUND_SHAPE,
+      SQUARE_SHAPE,
+      OCTAGON_SHAPE,
+      LONG_SHAPE,
+      OFFSET_SHAPE
+    };
+
+    // Constructors/destructors
+
+    Pad()
+      : drill_(0.0), diameter_(0.0), shape_(ROUND_SHAPE), isStopped_(true),
+        hasName_(false), hasDrill_(false)
+    {
+    }
+
+    // Member functions
+
+    const string &
+    getName() const
+    {
+      assert(hasName_);
+      return name_;
+    }
+
+    bool
+    isComplete() const
+    {
+      return hasName_ && hasX() && hasY() && hasDrill_;
+    }
+
+    /**
+     * Shape of the pin.  Without a diameter the annular ring is
+     * Eagle's default of a quarter of the drill, within 10 to 20 mil.
+     *
+     * NOTE: pcb pins are round, square or octagonal only, so long and
+     * offset pads become round pins of their width.
+     */
+    void
+    getShape(PadShape &shape) const
+    {
+      const double diameter = (0.0 < diameter_) ? diameter_ :
+        drill_ + (2.0 * min(max(drill_ * RESTRING_RATIO, MIN_RESTRING),
+                            MAX_RESTRING));
+      shape.offsetX = 0.0;
+      shape.offsetY = 0.0;
+      shape.thickness = diameter;
+      shape.mask = isStopped_ ? diameter + (2.0 * STOP_MARGIN) : 0.0;
+      shape.drill = drill_;
+      shape.isSquare = (SQUARE_SHAPE == shape_);
+      shape.isOctagon = (OCTAGON_SHAPE == shape_);
+      shape.isBottom = false;
+      shape.isPasted = false;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (!Pose::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        const boost::string_ref value = attribute.getValue();
+        if (NAME == name) {
+          name_ = attribute.copyValue();
+          hasName_ = true;
+          return true;
+        }
+        if (DRILL == name) {
+          drill_ = atof(attribute.getValueCString());
+          hasDrill_ = true;
+          return true;
+        }
+        if (DIAMETER == name) {
+          diameter_ = atof(attribute.getValueCString());
+          return true;
+        }
+        if (SHAPE == name) {
+          if (ROUND == value) {
+            shape_ = ROUND_SHAPE;
+          }
+          else if (SQUARE == value) {
+            shape_ = SQUARE_SHAPE;
+          }
+          else if (OCTAGON == value) {
+            shape_ = OCTAGON_SHAPE;
+          }
+          else if (LONG == value) {
+            shape_ = LONG_SHAPE;
+          }
+          else if (OFFSET == value) {
+            shape_ = OFFSET_SHAPE;
+          }
+          else {
+            getLog() << "WARN unknown pad shape '" << value << "'" << endl;
+          }
+          return true;
+        }
+        if (STOP == name) {
+          isStopped_ = (NO != value);
+          return true;
+        }
+        if ((THERMALS == name) || (FIRST == name)) {
+          // NOTE: pcb decides thermals per polygon, and has no special
+          // first pad shape.
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    string name_;
+    double drill_;
+    double diameter_;  // 0 for automatic
+    Shape shape_;
+    bool isStopped_;
+    bool hasName_;
+    bool hasDrill_;
+  };
+
+  /**
+   * Mixin to add end point data to certain types of Eagle board file
+   * elements.
+   */
+  class EndPoints : public InLayer, public HasWidth
+  {
+  public:
+
+    // Constructors/destructors
+
+    EndPoints()
+      : x1_(0.0), y1_(0.0), x2_(0.0), y2_(0.0),
+        hasX1_(false), hasY1_(false), hasX2_(false), hasY2_(false)
+    {
+    }
+
+    // Member functions
+
+    double
+    getX1() const
+    {
+      assert(hasX1_);
+      return x1_;
+    }
+
+    double
+    getY1() const
+    {
+      assert(hasY1_);
+      return y1_;
+    }
+
+    double
+    getX2() const
+    {
+      assert(hasX2_);
+      return x2_;
+    }
+
+    double
+    getY2() const
+    {
+      assert(hasY2_);
+      return y2_;
+    }
+
+    bool
+    hasX1() const
+    {
+      return hasX1_;
+    }
+
+    bool
+    hasY1() const
+    {
+      return hasY1_;
+    }
+
+    bool
+    hasX2() const
+    {
+      return hasX2_;
+    }
+
+    bool
+    hasY2() const
+    {
+      return hasY2_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if ((!InLayer::tryHandleAttribute(attribute)) &&
+          (!HasWidth::tryHandleAttribute(attribute))) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (X1 == name) {
+          assert(!hasX1_);
+          x1_ = atof(value);
+          hasX1_ = true;
+          return true;
+        }
+        if (Y1 == name) {
+          assert(!hasY1_);
+          y1_ = atof(value);
+          hasY1_ = true;
+          return true;
+        }
+        if (X2 == name) {
+          assert(!hasX2_);
+          x2_ = atof(value);
+          hasX2_ = true;
+          return true;
+        }
+        if (Y2 == name) {
+          assert(!hasY2_);
+          y2_ = atof(value);
+          hasY2_ = true;
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+    // Coordinates as a column for batched updates, see snapAll().
+    static const size_t COORDINATE_COUNT = 4;
+
+    void
+    getCoordinates(double * const coordinates) const
+    {
+      coordinates[0] = x1_;
+      coordinates[1] = y1_;
+      coordinates[2] = x2_;
+      coordinates[3] = y2_;
+    }
+
+    void
+    setCoordinates(const double * const coordinates)
+    {
+      x1_ = coordinates[0];
+      y1_ = coordinates[1];
+      x2_ = coordinates[2];
+      y2_ = coordinates[3];
+    }
+
+  private:
+
+    // Data members
+
+    double x1_;
+    double x2_;
+    double y1_;
+    double y2_;
+    bool hasX1_;
+    bool hasY1_;
+    bool hasX2_;
+    bool hasY2_;
+  };
+
+  /**
+   * Representation of a wire element of an Eagle board or
+   * package.
+   */
+  class Wire : public EndPoints
+  {
+  public:
+
+    // Constructors/destructors
+
+    Wire()
+      : curve_(0.0), hasCurve_(false)
+    {
+    }
+
+    // Member functions
+
+    double
+    getCurve() const
+    {
+      return curve_;
+    }
+
+    bool
+    hasCurve() const
+    {
+      return hasCurve_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (!EndPoints::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (CURVE == name) {
+          assert(!hasCurve_);
+          curve_ = atof(value);
+          hasCurve_ = true;
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    double curve_;
+    bool hasCurve_;
+  };
+
+  /**
+   * Representation of a rectangle element of an Eagle board or
+   * package.
+   */
+  class Rectangle : public EndPoints
+  {
+  public:
+
+    // Constructors/destructors
+
+    Rectangle()
+      : rotation_(), hasRotation_(false)
+    {
+    }
+
+    // Member functions
+
+    const Rotation &
+    getRotation() const
+    {
+      assert(hasRotation_);
+      return rotation_;
+    }
+
+    bool
+    hasRotation() const
+    {
+      return hasRotation_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if (!EndPoints::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (ROTATION == name) {
+          assert(!hasRotation_);
+          if (!rotation_.tryParse(value)) {
+            getLog() << "WARN malformed rotation '" << value << "'" << endl;
+          }
+          hasRotation_ = true;
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    Rotation rotation_;
+    bool hasRotation_;
+  };
+
+  /**
+   * Representation of a circle element of an Eagle board or package.
+   */
+  class Circle : public Pose, public HasWidth
+  {
+  public:
+
+    // Constructors/destructors
+
+    Circle()
+      : radius_(0.0), hasRadius_(false)
+    {
+    }
+
+    // Member functions
+
+    double
+    getRadius() const
+    {
+      assert(hasRadius_);
+      return radius_;
+    }
+
+    bool
+    hasRadius() const
+    {
+      return hasRadius_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if ((!Pose::tryHandleAttribute(attribute)) &&
+          (!HasWidth::tryHandleAttribute(attribute))) {
+        const boost::string_ref name = attribute.getName();
+        const char * const value = attribute.getValueCString();
+        if (RADIUS == name) {
+          assert(!hasRadius_);
+          radius_ = atof(value);
+          hasRadius_ = true;
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    double radius_;
+    bool hasRadius_;
+  };
+
+  /**
+   * Representation of a polygon of an Eagle board, signal or package;
+   * on a copper layer this is a pour.
+   *
+   * NOTE: Eagle strokes the outline with the polygon width, so the
+   * copper actually extends half of the width beyond the vertices.
+   */
+  class Polygon : public InLayer, public HasWidth
+  {
+  public:
+
+    // Types
+
+    enum Pour {
+      SOLID_POUR,
+      HATCH_POUR,
+      CUTOUT_POUR
+    };
+
+    // Constructors/destructors
+
+    Polygon()
+      : isolate_(0.0), pour_(SOLID_POUR)
+    {
+    }
+
+    // Member functions
+
+    /**
+     * Clearance to the copper of other signals, 0 when not specified.
+     */
+    double
+    getIsolate() const
+    {
+      return isolate_;
+    }
+
+    Pour
+    getPour() const
+    {
+      return pour_;
+    }
+
+    void
+    addVertex(const double x,
+              const double y,
+              const double curve)
+    {
+      xs_.push_back(x);
+      ys_.push_back(y);
+      curves_.push_back(curve);
+    }
+
+    /**
+     * Snap the vertices to a grid, a column at a time.
+     */
+    void
+    snap(const GridSnap &snap)
+    {
+      snap.apply(xs_.data(), xs_.size());
+      snap.apply(ys_.data(), ys_.size());
+    }
+
+    /**
+     * Outline of the polygon, with each curved edge approximated by
+     * chords.
+     */
+    void
+    getContour(Contour &contour) const
+    {
+      contour.clear();
+      for (size_t index = 0; index < xs_.size(); ++index) {
+        const size_t next = (index + 1) % xs_.size();
+        contour.push_back(ClipPoint(xs_[index], ys_[index]));
+        if (0.0 != curves_[index]) {
+          appendArc(xs_[index], ys_[index], xs_[next], ys_[next],
+                    curves_[index], contour);
+        }
+      }
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      if ((!InLayer::tryHandleAttribute(attribute)) &&
+          (!HasWidth::tryHandleAttribute(attribute))) {
+        const boost::string_ref name = attribute.getName();
+        const boost::string_ref value = attribute.getValue();
+        if (ISOLATE == name) {
+          isolate_ = atof(attribute.getValueCString());
+          return true;
+        }
+        if (POUR == name) {
+          if (SOLID == value) {
+            pour_ = SOLID_POUR;
+          }
+          else if (HATCH == value) {
+            pour_ = HATCH_POUR;
+          }
+          else if (CUTOUT == value) {
+            pour_ = CUTOUT_POUR;
+          }
+          else {
+            getLog() << "WARN unknown pour type '" << value << "'" << endl;
+          }
+          return true;
+        }
+        if ((SPACING == name) || (RANK == name) || (ORPHANS == name) ||
+            (THERMALS == name)) {
+          // NOTE: pour settings which gEDA pcb decides for itself.
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    double isolate_;
+    Pour pour_;
+    // NOTE: curve of the edge from each vertex to the next.
+    vector<double> xs_;
+    vector<double> ys_;
+    vector<double> curves_;
+  };
+
+  /**
+   * Drawing grid of the Eagle file: the distance between grid points
+   * and the unit distances are shown in.  The alternate grid (used
+   * while Alt is held) is of no use to the conversion.
+   */
+  class Grid
+  {
+  public:
+
+    // Constructors/destructors
+
+    Grid()
+      : distance_(0.0), unitDistance_(1.0), isMetric_(false),
+        isDisplayed_(false), hasDistance_(false), hasUnit_(false)
+    {
+    }
+
+    // Member functions
+
+    /** Distance between grid points, in mm. */
+    double
+    getDistance() const
+    {
+      assert(hasDistance_);
+      return distance_ * unitDistance_;
+    }
+
+    bool
+    hasDistance() const
+    {
+      return hasDistance_;
+    }
+
+    /** gEDA pcb name of the display unit, "mm" or "mil". */
+    const char *
+    getUnitName() const
+    {
+      assert(hasUnit_);
+      return isMetric_ ? "mm" : "mil";
+    }
+
+    bool
+    hasUnit() const
+    {
+      return hasUnit_;
+    }
+
+    bool
+    isDisplayed() const
+    {
+      return isDisplayed_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      const boost::string_ref name = attribute.getName();
+      const char * const value = attribute.getValueCString();
+      if (DISTANCE == name) {
+        distance_ = atof(value);
+        hasDistance_ = (0.0 < distance_);
+        return true;
+      }
+      if (UNITDIST == name) {
+        if (!GridSnap::tryGetUnitLength(value, unitDistance_)) {
+          getLog() << "WARN unknown grid unit '" << value << "'" << endl;
+          hasDistance_ = false;
+        }
+        return true;
+      }
+      if (UNIT == name) {
+        double length = 0.0;
+        hasUnit_ = GridSnap::tryGetUnitLength(value, length);
+        isMetric_ = ("mm" == attribute.getValue()) ||
+          ("mic" == attribute.getValue());
+        if (!hasUnit_) {
+          getLog() << "WARN unknown grid unit '" << value << "'" << endl;
+        }
+        return true;
+      }
+      if (DISPLAY == name) {
+        isDisplayed_ = (YES == attribute.getValue());
+        return true;
+      }
+      if ((STYLE == name) || (MULTIPLE == name) || (ALTDISTANCE == name) ||
+          (ALTUNITDIST == name) || (ALTUNIT == name)) {
+        // NOTE: display settings with no equivalent in the output.
+        return true;
+      }
+      return false;
+    }
+
+  private:
+
+    // Data members
+
+    double distance_;  // In units of unitDistance_
+    double unitDistance_;  // In mm
+    bool isMetric_;
+    bool isDisplayed_;
+    bool hasDistance_;
+    bool hasUnit_;
+  };
+
+  /**
+   * The design rule parameters of an Eagle board which size what it
+   * leaves to them, Eagle's defaults until the board says otherwise.
+   */
+  class DesignRules
+  {
+  public:
+
+    // Constructors/destructors
+
+    DesignRules()
+      : viaRestringRatio_(0.25), minViaRestring_(0.2032),
+        maxViaRestring_(0.508), stopFrameRatio_(1.0),
+        minStopFrame_(0.1016), maxStopFrame_(0.1016), viaStopLimit_(0.0)
+    {
+    }
+
+    // Member functions
+
+    /**
+     * Outer diameter of a via, at least the drawn diameter (0 for none)
+     * and at least the drill plus the restring on both sides.
+     */
+    double
+    getViaDiameter(const double drill,
+                   const double diameter) const
+    {
+      const double restring = min(max(drill * viaRestringRatio_,
+                                      minViaRestring_), maxViaRestring_);
+      return max(diameter, drill + (2.0 * restring));
+    }
+
+    /**
+     * Diameter of the solder mask opening of a via, 0 if it is tented
+     * because its drill is within the stop limit.
+     */
+    double
+    getViaMask(const double drill,
+               const double diameter,
+               const bool isAlwaysStopped) const
+    {
+      if ((!isAlwaysStopped) && (drill <= viaStopLimit_)) {
+        return 0.0;
+      }
+      const double frame = min(max(diameter * stopFrameRatio_,
+                                   minStopFrame_), maxStopFrame_);
+      return diameter + (2.0 * frame);
+    }
+
+    /**
+     * Take a <param> of the design rules, ignoring those which don't
+     * matter to the conversion.  Returns false if the value of one
+     * which does is malformed.
+     */
+    bool
+    trySetParameter(const boost::string_ref name,
+                    const char * const value)
+    {
+      if ("rvViaOuter" == name) {
+        return tryParseNumber(value, viaRestringRatio_);
+      }
+      if ("rlMinViaOuter" == name) {
+        return tryParseLength(value, minViaRestring_);
+      }
+      if ("rlMaxViaOuter" == name) {
+        return tryParseLength(value, maxViaRestring_);
+      }
+      if ("mvStopFrame" == name) {
+        return tryParseNumber(value, stopFrameRatio_);
+      }
+      if ("mlMinStopFrame" == name) {
+        return tryParseLength(value, minStopFrame_);
+      }
+      if ("mlMaxStopFrame" == name) {
+        return tryParseLength(value, maxStopFrame_);
+      }
+      if ("mlViaStopLimit" == name) {
+        return tryParseLength(value, viaStopLimit_);
+      }
+      return true;
+    }
+
+  private:
+
+    // Member functions
+
+    static bool
+    tryParseNumber(const char * const value,
+                   double &number)
+    {
+      char *end = NULL;
+      const double parsed = strtod(value, &end);
+      if ((end == value) || ('\0' != *end)) {
+        return false;
+      }
+      number = parsed;
+      return true;
+    }
+
+    /**
+     * Parse a length such as "10mil" or "0.2mm" into mm, a bare number
+     * being in mm.
+     */
+    static bool
+    tryParseLength(const char * const value,
+                   double &millimeters)
+    {
+      char *end = NULL;
+      const double parsed = strtod(value, &end);
+      double unit = 1.0;
+      if ((end == value) ||
+          (('\0' != *end) && (!GridSnap::tryGetUnitLength(end, unit)))) {
+        return false;
+      }
+      millimeters = parsed * unit;
+      return true;
+    }
+
+    // Data members
+
+    // Lengths in mm
+    double viaRestringRatio_;
+    double minViaRestring_;
+    double maxViaRestring_;
+    double stopFrameRatio_;
+    double minStopFrame_;
+    double maxStopFrame_;
+    double viaStopLimit_;  // Vias drilled up to this are tented
+  };
+
+  /**
+   * Representation of an Eagle board or package.
+   */
+  class Board : public AllocationCounted<AllocationStatistics::MODEL_TAG>
+  {
+  public:
+
+    // Constructors/destructors
+
+    Board()
+    {
+    }
+
+    ~Board()
+    {
+      clear();
+    }
+
+    // Member functions
+
+#define ADD_OBJECT(otype, oname) \
+    void \
+    add##otype(otype *oname) \
+    { \
+      oname##Objects_.push_back(oname); \
+    } \
+    \
+    const vector<otype *> & \
+    get##otype##s() const \
+    { \
+      return oname##Objects_; \
+    }
+
+    ADD_OBJECT(Text, text);
+    ADD_OBJECT(Hole, hole);
+    ADD_OBJECT(Wire, wire);
+    ADD_OBJECT(Circle, circle);
+    ADD_OBJECT(Rectangle, rectangle);
+    ADD_OBJECT(Polygon, polygon);
+    ADD_OBJECT(Smd, smd);
+    ADD_OBJECT(Pad, pad);
+    // void
+    // addText(Text *text)
+    // {
+    //   textObjects_.push(text);
+    // }
+
+    // void
+    // addHole(Hole *hole)
+    // {
+    //   holeObjects_.push(hole);
+    // }
+
+    // void
+    // addWire(Wire *wire)
+    // {
+    //   wireObjects_.push(wire);
+    // }
+
+    // void
+    // addCircle(Circle *circle)
+    // {
+    //   circleObjects_.push(circle);
+    // }
+
+#undef ADD_OBJECT
+
+    void
+    clear()
+    {
+      deleteAll(textObjects_);
+      deleteAll(holeObjects_);
+      deleteAll(wireObjects_);
+      deleteAll(circleObjects_);
+      deleteAll(rectangleObjects_);
+      deleteAll(polygonObjects_);
+      deleteAll(smdObjects_);
+      deleteAll(padObjects_);
+    }
+
+  private:
+
+    // Member functions
+
+    template <typename T> static void
+    deleteAll(vector<T *> &objects)
+    {
+      for (typename vector<T *>::iterator iter = objects.begin();
+           iter != objects.end(); ++iter) {
+        delete *iter;
+      }
+      objects.clear();
+    }
+
+
+    // Data members
+
+    // NOTE: vectors rather than queues since package contents are
+    // iterated once per placement of the package.
+    vector<Text *> textObjects_;
+    vector<Hole *> holeObjects_;
+    vector<Wire *> wireObjects_;
+    vector<Circle *> circleObjects_;
+    vector<Rectangle *> rectangleObjects_;
+    vector<Polygon *> polygonObjects_;
+    vector<Smd *> smdObjects_;
+    vector<Pad *> padObjects_;
+  };
+
+  /**
+   * Silk screen and pad geometry of a package, extracted once into
+   * coordinate columns so that each placement of the package is a copy
+   * plus a single batched transform.
+   *
+   * Line endpoints are stored as consecutive pairs, followed by the
+   * centers of the circles and then of the pads.  Each distinct pad
+   * shape is stored once, so that a placement transforms one offset per
+   * shape rather than one per pad.
+   */
+  class PackageGeometry
+  {
+  public:
+
+    // Member functions
+
+    void
+    addLine(const Wire &wire)
+    {
+      xs_.push_back(wire.getX1());
+      ys_.push_back(wire.getY1());
+      xs_.push_back(wire.getX2());
+      ys_.push_back(wire.getY2());
+      lineWidths_.push_back(wire.getWidth());
+    }
+
+    void
+    addCircle(const Circle &circle)
+    {
+      circleXs_.push_back(circle.getX().value());
+      circleYs_.push_back(circle.getY());
+      circleRadii_.push_back(circle.getRadius());
+      circleWidths_.push_back(circle.getWidth());
+    }
+
+    void
+    addPad(const double x,
+           const double y,
+           const PadShape &shape,
+           const string &name)
+    {
+      const uint32_t index = static_cast<uint32_t>(padShapes_.size());
+      const pair<map<PadShape, uint32_t>::iterator, bool> entry =
+        shapeIndex_.insert(make_pair(shape, index));
+      if (entry.second) {
+        padShapes_.push_back(shape);
+      }
+      padXs_.push_back(x);
+      padYs_.push_back(y);
+      padShapeIndices_.push_back(entry.first->second);
+      padNames_.push_back(name);
+    }
+
+    void
+    finalize()
+    {
+      xs_.insert(xs_.end(), circleXs_.begin(), circleXs_.end());
+      ys_.insert(ys_.end(), circleYs_.begin(), circleYs_.end());
+      xs_.insert(xs_.end(), padXs_.begin(), padXs_.end());
+      ys_.insert(ys_.end(), padYs_.begin(), padYs_.end());
+      circleXs_.clear();
+      circleYs_.clear();
+      padXs_.clear();
+      padYs_.clear();
+      shapeIndex_.clear();
+    }
+
+    const vector<double> &
+    getXs() const
+    {
+      return xs_;
+    }
+
+    const vector<double> &
+    getYs() const
+    {
+      return ys_;
+    }
+
+    const vector<double> &
+    getLineWidths() const
+    {
+      return lineWidths_;
+    }
+
+    const vector<double> &
+    getCircleRadii() const
+    {
+      return circleRadii_;
+    }
+
+    const vector<double> &
+    getCircleWidths() const
+    {
+      return circleWidths_;
+    }
+
+    /** Index of the first pad center in the coordinate columns. */
+    size_t
+    getFirstPad() const
+    {
+      return (2 * lineWidths_.size()) + circleRadii_.size();
+    }
+
+    const vector<PadShape> &
+    getPadShapes() const
+    {
+      return padShapes_;
+    }
+
+    const vector<uint32_t> &
+    getPadShapeIndices() const
+    {
+      return padShapeIndices_;
+    }
+
+    const vector<string> &
+    getPadNames() const
+    {
+      return padNames_;
+    }
+
+  private:
+
+    // Data members
+
+    vector<double> xs_;
+    vector<double> ys_;
+    vector<double> lineWidths_;
+    vector<double> circleXs_;
+    vector<double> circleYs_;
+    vector<double> circleRadii_;
+    vector<double> circleWidths_;
+    vector<double> padXs_;
+    vector<double> padYs_;
+    vector<PadShape> padShapes_;
+    map<PadShape, uint32_t> shapeIndex_;  // Only while adding pads
+    vector<uint32_t> padShapeIndices_;
+    vector<string> padNames_;
+  };
+
+  class Package : public Board
+  {
+  public:
+
+    // Constructors/destructors
+
+    Package()
+      : name_(""), nameText_(NULL), hasName_(false)
+    {
+    }
+
+    // Member functions
+
+    const string &
+    getName() const
+    {
+      assert(hasName_);
+      return name_;
+    }
+
+    bool
+    hasName() const
+    {
+      return hasName_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      // TODO: error checking on conversions
+      const boost::string_ref name = attribute.getName();
+      if (NAME == name) {
+        assert(!hasName_);
+        name_ = attribute.copyValue();
+        hasName_ = true;
+        return true;
+      }
+      else if (DESCRIPTION == name) {
+        // TODO: ignore?
+      }
+      return false;
+    }
+
+    /**
+     * Text showing the name of the element (">NAME"), in package
+     * coordinates, or NULL if there is none.
+     */
+    const Text *
+    getNameText() const
+    {
+      return nameText_;
+    }
+
+    /**
+     * Extract the silk screen and pad geometry used for placement,
+     * called once the package definition is complete.
+     */
+    void
+    buildGeometry()
+    {
+      const vector<Wire *> &wires = getWires();
+      for (vector<Wire *>::const_iterator iter = wires.begin();
+           iter != wires.end(); ++iter) {
+        if (isSilkLayer(**iter)) {
+          geometry_.addLine(**iter);
+        }
+      }
+      const vector<Circle *> &circles = getCircles();
+      for (vector<Circle *>::const_iterator iter = circles.begin();
+           iter != circles.end(); ++iter) {
+        if (isSilkLayer(**iter)) {
+          geometry_.addCircle(**iter);
+        }
+      }
+      PadShape shape;
+      const vector<Smd *> &smds = getSmds();
+      for (vector<Smd *>::const_iterator iter = smds.begin();
+           iter != smds.end(); ++iter) {
+        (*iter)->getShape(shape);
+        geometry_.addPad((*iter)->getX().value(), (*iter)->getY(), shape,
+                         (*iter)->getName());
+      }
+      const vector<Pad *> &pads = getPads();
+      for (vector<Pad *>::const_iterator iter = pads.begin();
+           iter != pads.end(); ++iter) {
+        (*iter)->getShape(shape);
+        geometry_.addPad((*iter)->getX().value(), (*iter)->getY(), shape,
+                         (*iter)->getName());
+      }
+      geometry_.finalize();
+      const vector<Text *> &texts = getTexts();
+      for (vector<Text *>::const_iterator iter = texts.begin();
+           iter != texts.end(); ++iter) {
+        const Text &text = **iter;
+        if (text.hasX() && text.hasY() && text.hasMetrics() &&
+            text.hasString() && (NAME_PLACEHOLDER == text.getString())) {
+          nameText_ = &text;
+          break;
+        }
+      }
+    }
+
+    const PackageGeometry &
+    getGeometry() const
+    {
+      return geometry_;
+    }
+
+  private:
+
+    // Member functions
+
+    static bool
+    isSilkLayer(const InLayer &object)
+    {
+      // NOTE: packages are defined as seen from the top, the bottom
+      // silk layer only comes into play when the element is mirrored.
+      return object.hasLayer() && (TPLACE_LAYER == object.getLayer());
+    }
+
+    // Data members
+
+    string name_;
+    const Text *nameText_;
+    bool hasName_;
+    PackageGeometry geometry_;
+  };
+
+  /**
+   * Representation of an element (i.e. a placed instance of a library
+   * package) of an Eagle board.
+   */
+  class Element : public Pose
+  {
+  public:
+
+    // Constructors/destructors
+
+    Element()
+      : package_(NULL), hasName_(false), hasLibrary_(false),
+        hasPackage_(false), hasValue_(false), hasNameText_(false)
+    {
+    }
+
+    // Member functions
+
+    const string &
+    getName() const
+    {
+      assert(hasName_);
+      return name_;
+    }
+
+    const string &
+    getLibraryName() const
+    {
+      assert(hasLibrary_);
+      return libraryName_;
+    }
+
+    const string &
+    getPackageName() const
+    {
+      assert(hasPackage_);
+      return packageName_;
+    }
+
+    const string &
+    getValue() const
+    {
+      return value_;
+    }
+
+    bool
+    isComplete() const
+    {
+      return hasName_ && hasLibrary_ && hasPackage_ && hasX() && hasY();
+    }
+
+    const Package *
+    getPackage() const
+    {
+      return package_;
+    }
+
+    void
+    setPackage(const Package *package)
+    {
+      package_ = package;
+    }
+
+    /**
+     * Placement of the name of a smashed element, in board coordinates.
+     */
+    const Text &
+    getNameText() const
+    {
+      assert(hasNameText_);
+      return nameText_;
+    }
+
+    bool
+    hasNameText() const
+    {
+      return hasNameText_;
+    }
+
+    void
+    setNameText(const Text &nameText)
+    {
+      nameText_ = nameText;
+      hasNameText_ = true;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      if (!Pose::tryHandleAttribute(attribute)) {
+        const boost::string_ref name = attribute.getName();
+        if (NAME == name) {
+          assert(!hasName_);
+          name_ = attribute.copyValue();
+          hasName_ = true;
+          return true;
+        }
+        if (LIBRARY == name) {
+          assert(!hasLibrary_);
+          libraryName_ = attribute.copyValue();
+          hasLibrary_ = true;
+          return true;
+        }
+        if (PACKAGE == name) {
+          assert(!hasPackage_);
+          packageName_ = attribute.copyValue();
+          hasPackage_ = true;
+          return true;
+        }
+        if (VALUE == name) {
+          assert(!hasValue_);
+          value_ = attribute.copyValue();
+          hasValue_ = true;
+          return true;
+        }
+        if ((LOCKED == name) || (SMASHED == name)) {
+          // NOTE: editing state only, no equivalent in the output.
+          return true;
+        }
+        return false;
+      }
+      return true;
+    }
+
+  private:
+
+    // Data members
+
+    string name_;
+    string libraryName_;
+    string packageName_;
+    string value_;
+    const Package *package_;  // Resolved when the element is parsed.
+    Text nameText_;
+    bool hasName_;
+    bool hasLibrary_;
+    bool hasPackage_;
+    bool hasValue_;
+    bool hasNameText_;
+  };
+
+  /**
+   * Representation of a signal (i.e. a net along with its copper) of an
+   * Eagle board.
+   */
+  class Signal : public AllocationCounted<AllocationStatistics::MODEL_TAG>
+  {
+  public:
+
+    // Types
+
+    // (element name, pad name)
+    typedef pair<string, string> Contact;
+
+    // Constructors/destructors
+
+    Signal()
+      : hasName_(false)
+    {
+    }
+
+    ~Signal()
+    {
+      for (vector<Wire *>::iterator iter = wires_.begin();
+           iter != wires_.end(); ++iter) {
+        delete *iter;
+      }
+      for (vector<Polygon *>::iterator iter = polygons_.begin();
+           iter != polygons_.end(); ++iter) {
+        delete *iter;
+      }
+    }
+
+    // Member functions
+
+    const string &
+    getName() const
+    {
+      assert(hasName_);
+      return name_;
+    }
+
+    bool
+    hasName() const
+    {
+      return hasName_;
+    }
+
+    void
+    addContact(Contact &&contact)
+    {
+      contacts_.push_back(std::move(contact));
+    }
+
+    const vector<Contact> &
+    getContacts() const
+    {
+      return contacts_;
+    }
+
+    void
+    addWire(Wire *wire)
+    {
+      wires_.push_back(wire);
+    }
+
+    const vector<Wire *> &
+    getWires() const
+    {
+      return wires_;
+    }
+
+    void
+    addVia(const Hole &via)
+    {
+      assert(via.isVia());
+      vias_.add(via.getX().value(), via.getY(), via.getDrill(),
+                via.getDiameter(), via.getShape(), via.isAlwaysStopped());
+    }
+
+    const ViaColumns &
+    getVias() const
+    {
+      return vias_;
+    }
+
+    ViaColumns &
+    getVias()
+    {
+      return vias_;
+    }
+
+    void
+    addPolygon(Polygon *polygon)
+    {
+      polygons_.push_back(polygon);
+    }
+
+    const vector<Polygon *> &
+    getPolygons() const
+    {
+      return polygons_;
+    }
+
+    bool
+    tryHandleAttribute(const Attribute &attribute)
+    {
+      const boost::string_ref name = attribute.getName();
+      if (NAME == name) {
+        assert(!hasName_);
+        name_ = attribute.copyValue();
+        hasName_ = true;
+        return true;
+      }
+      if ((CLASS == name) || (AIRWIRESHIDDEN == name)) {
+        // NOTE: routing/display settings, no equivalent in the output.
+        return true;
+      }
+      return false;
+    }
+
+  private:
+
+    // Data members
+
+    string name_;
+    vector<Contact> contacts_;
+    vector<Wire *> wires_;
+    ViaColumns vias_;
+    vector<Polygon *> polygons_;
+    bool hasName_;
+  };
+
+  typedef unordered_map<PackageKey, Package *,
+                        boost::hash<PackageKey> > PackageIndex;
+
+  /**
+   * Location on a copper layer, quantized so that coincident wire
+   * endpoints and vias compare equal.
+   */
+  class CopperPoint
+  {
+  public:
+
+    // Constructors/destructors
+
+    CopperPoint(const unsigned layer,
+                const double x,
+                const double y)
+      : layer_(layer), x_(quantize(x)), y_(quantize(y))
+    {
+    }
+
+    CopperPoint(const unsigned layer,
+                const CopperPoint &point)
+      : layer_(layer), x_(point.x_), y_(point.y_)
+    {
+    }
+
+    // Member functions
+
+    double
+    getX() const
+    {
+      return x_ / STEPS_PER_MM;
+    }
+
+    double
+    getY() const
+    {
+      return y_ / STEPS_PER_MM;
+    }
+
+    bool
+    operator==(const CopperPoint &other) const
+    {
+      return (layer_ == other.layer_) && (x_ == other.x_) && (y_ == other.y_);
+    }
+
+    size_t
+    hash() const
+    {
+      size_t seed = 0;
+      boost::hash_combine(seed, layer_);
+      boost::hash_combine(seed, x_);
+      boost::hash_combine(seed, y_);
+      return seed;
+    }
+
+  private:
+
+    // Member functions
+
+    static int64_t
+    quantize(const double mm)
+    {
+      return static_cast<int64_t>(floor((mm * STEPS_PER_MM) + 0.5));
+    }
+
+    // Constants
+
+    static constexpr double STEPS_PER_MM = 10000.0;  // 0.1um
+
+    // Data members
+
+    unsigned layer_;
+    int64_t x_;
+    int64_t y_;
+  };
+
+  class CopperPointHash
+  {
+  public:
+    size_t
+    operator()(const CopperPoint &point) const
+    {
+      return point.hash();
+    }
+  };
+
+  typedef unordered_map<CopperPoint, uint32_t, CopperPointHash> CopperNodes;
+  typedef unordered_set<PackageKey, boost::hash<PackageKey> > PackageKeySet;
+
+  /**
+   * Where pcb draws text to cover the box Eagle draws it in, in Eagle
+   * coordinates.
+   */
+  struct TextPlacement
+  {
+    // Data members
+
+    /** Corner where reading starts, pcb's origin of the text. */
+    double x;
+    double y;
+    /** Quarter turns counterclockwise of the reading direction. */
+    uint8_t direction;
+    unsigned scale;
+    BoundingBox bounds;
+  };
+
+  /**
+   * gEDA pcb layers, created when first used.  Eagle layers 1-5 map to
+   * the copper layers of the same number and Eagle layer 16 to the
+   * solder side layer, see LAYOUT_GROUPS; the silk layers follow the
+   * copper ones.
+   */
+  class CopperLayers
+  {
+  public:
+
+    // Constructors/destructors
+
+    /**
+     * With a budget, lines are spilled to spillFile in chunks when the
+     * process nears its limit (checked every so many lines added, see
+     * noteLineAdded()) and streamed back by print().
+     */
+    CopperLayers(const MemoryBudget *budget,
+                 SpillFile *spillFile)
+      : layers_(COMPONENT_SILK_GEDA_LAYER + 1, NULL),
+        budget_(budget),
+        spillFile_(spillFile),
+        spilled_(COMPONENT_SILK_GEDA_LAYER + 1),
+        addedCount_(0)
+    {
+    }
+
+    ~CopperLayers()
+    {
+      for (vector<geda_pcb::Layer *>::iterator iter = layers_.begin();
+           iter != layers_.end(); ++iter) {
+        delete *iter;
+      }
+    }
+
+    // Member functions
+
+    /**
+     * gEDA layer for an Eagle copper layer, or NULL if there is none.
+     */
+    geda_pcb::Layer *
+    get(const unsigned eagleLayer)
+    {
+      unsigned number = eagleLayer;
+      string name;
+      if (TOP_LAYER == eagleLayer) {
+        name = "component";
+      }
+      else if (BOTTOM_LAYER == eagleLayer) {
+        number = SOLDER_GEDA_LAYER;
+        name = "solder";
+      }
+      else if (SOLDER_GEDA_LAYER > eagleLayer) {
+        ostringstream strm;
+        strm << "inner" << eagleLayer;
+        name = strm.str();
+      }
+      else {
+        ++skipped_[eagleLayer];
+        return NULL;
+      }
+      return getLayer(number, name);
+    }
+
+    /**
+     * gEDA layer for text on an Eagle layer, or NULL if there is none.
+     * Silk screen, names and values go to the silk of their side, other
+     * layers which aren't copper are documentation only.
+     */
+    geda_pcb::Layer *
+    getForText(const unsigned eagleLayer)
+    {
+      switch (eagleLayer) {
+      case TPLACE_LAYER:
+      case TNAMES_LAYER:
+      case TVALUES_LAYER:
+        return getLayer(COMPONENT_SILK_GEDA_LAYER, "silk");
+      case BPLACE_LAYER:
+      case BNAMES_LAYER:
+      case BVALUES_LAYER:
+        return getLayer(SOLDER_SILK_GEDA_LAYER, "silk");
+      default:
+        return isCopperLayer(eagleLayer) ? get(eagleLayer) : NULL;
+      }
+    }
+
+    void
+    noteLineAdded()
+    {
+      if ((NULL == budget_) || (NULL == spillFile_) ||
+          (0 != (++addedCount_ % CHECK_INTERVAL)) || (!budget_->isNearLimit())) {
+        return;
+      }
+      spill();
+    }
+
+    void
+    print(ostream &strm) const
+    {
+      for (size_t number = 0; number < layers_.size(); ++number) {
+        const geda_pcb::Layer *layer = layers_[number];
+        if (NULL == layer) {
+          continue;
+        }
+        layer->printStart(strm);
+        for (vector<SpillFile::Extent>::const_iterator extent =
+               spilled_[number].begin();
+             extent != spilled_[number].end(); ++extent) {
+          string error;
+          if (!spillFile_->copy(*extent, strm, error)) {
+            getLog() << "ERR " << error << endl;
+            strm.setstate(ios::badbit);
+          }
+        }
+        layer->printObjects(strm);
+        layer->printEnd(strm);
+      }
+      for (map<unsigned, unsigned>::const_iterator entry = skipped_.begin();
+           entry != skipped_.end(); ++entry) {
+        getLog() << "WARN " << entry->second << " objects on Eagle layer "
+             << entry->first << " have no gEDA layer" << endl;
+      }
+    }
+
+  private:
+
+    // Constants
+
+    static const unsigned SOLDER_GEDA_LAYER = 6;
+    // NOTE: pcb numbers the silk layers after all 8 copper layers of
+    // LAYOUT_GROUPS, solder side first.
+    static const unsigned SOLDER_SILK_GEDA_LAYER = 9;
+    static const unsigned COMPONENT_SILK_GEDA_LAYER = 10;
+    /** Lines added between checks of the memory use. */
+    static const size_t CHECK_INTERVAL = 4096;
+    /** Lines spilled at a time. */
+    static const size_t SPILL_CHUNK_LINES = 65536;
+
+    // Member functions
+
+    geda_pcb::Layer *
+    getLayer(const unsigned number,
+             const string &name)
+    {
+      if (NULL == layers_[number]) {
+        layers_[number] = new geda_pcb::Layer(number, name);
+      }
+      return layers_[number];
+    }
+
+    /**
+     * Move every line held in memory to the spill file.  Lines only
+     * precede other objects in a layer, so spilled chunks followed by
+     * what is left keep the output order.
+     */
+    void
+    spill()
+    {
+      ostringstream chunk;
+      for (size_t number = 0; number < layers_.size(); ++number) {
+        geda_pcb::Layer *layer = layers_[number];
+        if (NULL == layer) {
+          continue;
+        }
+        const size_t count = layer->getLineCount();
+        const size_t spilledCount = spilled_[number].size();
+        for (size_t first = 0; first < count; first += SPILL_CHUNK_LINES) {
+          chunk.str("");
+          layer->printLines(chunk, first, min(count, first + SPILL_CHUNK_LINES));
+          SpillFile::Extent extent;
+          string error;
+          if (!spillFile_->append(chunk.str(), extent, error)) {
+            // NOTE: the lines of this layer stay in memory, chunks of it
+            // already written are just left unused.
+            getLog() << "WARN " << error << ", no longer limiting memory" << endl;
+            spilled_[number].resize(spilledCount);
+            budget_ = NULL;
+            return;
+          }
+          spilled_[number].push_back(extent);
+        }
+        layer->releaseLines();
+      }
+      MemoryBudget::releaseFreeMemory();
+    }
+
+    // Data members
+
+    vector<geda_pcb::Layer *> layers_;
+    map<unsigned, unsigned> skipped_;
+    const MemoryBudget *budget_;
+    SpillFile *spillFile_;
+    /** Chunks of the lines of each layer spilled, in order. */
+    vector<vector<SpillFile::Extent> > spilled_;
+    size_t addedCount_;
+  };
+
+  /**
+   * Straight piece of the copper of a signal, used to pre-clear pours
+   * and to check clearances.  A via is a zero length segment on all
+   * layers, and so is a pin; an SMD pad is the segment pcb strokes it
+   * with.
+   */
+  class CopperSegment
+  {
+  public:
+
+    // Constructors/destructors
+
+    CopperSegment(const unsigned layer,
+                  const int64_t signal,
+                  const ClipPoint &start,
+                  const ClipPoint &end,
+                  const double radius,
+                  const int64_t element = -1,
+                  const uint32_t pad = 0)
+      : layer_(layer), signal_(signal), start_(start), end_(end),
+        radius_(radius), element_(element), pad_(pad)
+    {
+    }
+
+    // Member functions
+
+    unsigned
+    getLayer() const
+    {
+      return layer_;
+    }
+
+    /**
+     * Index of the owning signal, negative for the board, or NO_SIGNAL
+     * for a pad which no signal connects.
+     */
+    int64_t
+    getSignal() const
+    {
+      return signal_;
+    }
+
+    /**
+     * Index of the element whose pad this is, negative for routed
+     * copper.
+     */
+    int64_t
+    getElement() const
+    {
+      return element_;
+    }
+
+    /**
+     * Index of the pad in the geometry of the element's package.
+     */
+    uint32_t
+    getPad() const
+    {
+      assert(0 <= element_);
+      return pad_;
+    }
+
+    ClipPoint
+    getCenter() const
+    {
+      return ClipPoint((start_.x + end_.x) / 2.0, (start_.y + end_.y) / 2.0);
+    }
+
+    BoundingBox
+    getBounds() const
+    {
+      BoundingBox bounds;
+      bounds.add(start_.x, start_.y);
+      bounds.add(end_.x, end_.y);
+      return bounds.expand(radius_);
+    }
+
+    /**
+     * Whether the copper of other is on the same layer, vias being on
+     * all of them.
+     */
+    bool
+    isOnLayerOf(const CopperSegment &other) const
+    {
+      return (layer_ == other.layer_) || (VIA_LAYERS == layer_) ||
+        (VIA_LAYERS == other.layer_);
+    }
+
+    /**
+     * Distance between the copper of this and other, negative where
+     * they overlap, with the point midway between them.
+     */
+    double
+    getGap(const CopperSegment &other,
+           ClipPoint &location) const
+    {
+      ClipPoint closest;
+      ClipPoint otherClosest;
+      if (getCrossing(start_, end_, other.start_, other.end_, closest)) {
+        otherClosest = closest;
+      }
+      else {
+        // NOTE: the closest points of segments which don't cross
+        // include an end of one of them.
+        double distance = -1.0;
+        const ClipPoint *ends[4] = {
+          &start_, &end_, &other.start_, &other.end_
+        };
+        for (unsigned index = 0; index < 4; ++index) {
+          const bool isOwn = (2 > index);
+          const ClipPoint point = isOwn ?
+            getClosestPoint(other.start_, other.end_, *ends[index]) :
+            getClosestPoint(start_, end_, *ends[index]);
+          const double candidate =
+            hypot(point.x - ends[index]->x, point.y - ends[index]->y);
+          if ((0.0 > distance) || (candidate < distance)) {
+            distance = candidate;
+            closest = isOwn ? *ends[index] : point;
+            otherClosest = isOwn ? point : *ends[index];
+          }
+        }
+      }
+      location = ClipPoint((closest.x + otherClosest.x) / 2.0,
+                           (closest.y + otherClosest.y) / 2.0);
+      return hypot(closest.x - otherClosest.x, closest.y - otherClosest.y) -
+        radius_ - other.radius_;
+    }
+
+    /**
+     * Outline of the copper grown by a clearance (circumscribed, so the
+     * approximation never cuts into the clearance).
+     */
+    void
+    getOutline(const double clearance,
+               Contour &outline) const
+    {
+      outline.clear();
+      const double radius =
+        (radius_ + clearance) / cos(M_PI / OUTLINE_SEGMENTS);
+      const double direction = atan2(end_.y - start_.y, end_.x - start_.x);
+      const double step = (2.0 * M_PI) / OUTLINE_SEGMENTS;
+      for (unsigned cap = 0; cap < 2; ++cap) {
+        const ClipPoint &center = (0 == cap) ? end_ : start_;
+        const double first = direction - (M_PI / 2.0) + (cap * M_PI);
+        for (unsigned index = 0; index <= (OUTLINE_SEGMENTS / 2); ++index) {
+          const double angle = first + (index * step);
+          outline.push_back(ClipPoint(center.x + (radius * cos(angle)),
+                                      center.y + (radius * sin(angle))));
+        }
+      }
+    }
+
+  private:
+
+    // Constants
+
+    static const unsigned OUTLINE_SEGMENTS = 16;
+
+    // Member functions
+
+    static ClipPoint
+    getClosestPoint(const ClipPoint &start,
+                    const ClipPoint &end,
+                    const ClipPoint &point)
+    {
+      const double dx = end.x - start.x;
+      const double dy = end.y - start.y;
+      const double lengthSquared = (dx * dx) + (dy * dy);
+      if (0.0 == lengthSquared) {
+        return start;
+      }
+      const double along =
+        max(0.0, min(1.0, (((point.x - start.x) * dx) +
+                           ((point.y - start.y) * dy)) / lengthSquared));
+      return ClipPoint(start.x + (along * dx), start.y + (along * dy));
+    }
+
+    /**
+     * Point where two segments properly cross, if they do.
+     */
+    static bool
+    getCrossing(const ClipPoint &start,
+                const ClipPoint &end,
+                const ClipPoint &otherStart,
+                const ClipPoint &otherEnd,
+                ClipPoint &crossing)
+    {
+      const double dx = end.x - start.x;
+      const double dy = end.y - start.y;
+      const double otherDx = otherEnd.x - otherStart.x;
+      const double otherDy = otherEnd.y - otherStart.y;
+      const double denominator = (dx * otherDy) - (dy * otherDx);
+      if (0.0 == denominator) {
+        return false;
+      }
+      const double along = (((otherStart.x - start.x) * otherDy) -
+                            ((otherStart.y - start.y) * otherDx)) / denominator;
+      const double otherAlong = (((otherStart.x - start.x) * dy) -
+                                 ((otherStart.y - start.y) * dx)) / denominator;
+      if ((0.0 > along) || (1.0 < along) ||
+          (0.0 > otherAlong) || (1.0 < otherAlong)) {
+        return false;
+      }
+      crossing = ClipPoint(start.x + (along * dx), start.y + (along * dy));
+      return true;
+    }
+
+    // Data members
+
+    unsigned layer_;
+    int64_t signal_;
+    ClipPoint start_;
+    ClipPoint end_;
+    double radius_;
+    int64_t element_;
+    uint32_t pad_;
+  };
+
+  /**
+   * Pair of CopperSegments closer than the clearance, see
+   * checkClearances().
+   */
+  struct ClearanceViolation
+  {
+    bool
+    operator<(const ClearanceViolation &other) const
+    {
+      return (first < other.first) ||
+        ((first == other.first) && (second < other.second));
+    }
+
+    uint32_t first;
+    uint32_t second;
+    double gap;
+    ClipPoint location;
+  };
+
+  // Member functions
+
+  /**
+   * Add the pads, lines and circles of a package to a gEDA Element, xs
+   * and ys being the geometry coordinates transformed by rotation.
+   */
+  static void
+  addGeometry(geda_pcb::Element &element,
+              const PackageGeometry &geometry,
+              const vector<double> &xs,
+              const vector<double> &ys,
+              const Rotation &rotation)
+  {
+    // Pad shapes are transformed once per placement, not once per pad.
+    const vector<PadShape> &shapes = geometry.getPadShapes();
+    vector<double> offsetXs(shapes.size());
+    vector<double> offsetYs(shapes.size());
+    for (size_t shape = 0; shape < shapes.size(); ++shape) {
+      offsetXs[shape] = shapes[shape].offsetX;
+      offsetYs[shape] = shapes[shape].offsetY;
+    }
+    if (!shapes.empty()) {
+      rotation.apply(&offsetXs[0], &offsetYs[0], shapes.size());
+    }
+    const vector<uint32_t> &shapeIndices = geometry.getPadShapeIndices();
+    const vector<string> &names = geometry.getPadNames();
+    const size_t firstPad = geometry.getFirstPad();
+    const Millimeters clearance(2.0 * DEFAULT_CLEARANCE);
+    for (size_t pad = 0; pad < shapeIndices.size(); ++pad) {
+      const size_t center = firstPad + pad;
+      const PadShape &shape = shapes[shapeIndices[pad]];
+      const double offsetX = offsetXs[shapeIndices[pad]];
+      const double offsetY = offsetYs[shapeIndices[pad]];
+      if (0.0 == shape.drill) {
+        string flags = shape.isSquare ? "square" : "";
+        if (shape.isBottom != rotation.isMirrored()) {
+          flags += flags.empty() ? "onsolder" : ",onsolder";
+        }
+        if (!shape.isPasted) {
+          flags += flags.empty() ? "nopaste" : ",nopaste";
+        }
+        element.addElement(new geda_pcb::Pad(Millimeters(xs[center] - offsetX),
+                                             Millimeters(offsetY - ys[center]),
+                                             Millimeters(xs[center] + offsetX),
+                                             Millimeters(-ys[center] - offsetY),
+                                             Millimeters(shape.thickness),
+                                             clearance,
+                                             Millimeters(shape.mask),
+                                             names[pad], names[pad], flags));
+      }
+      else {
+        element.addElement(new geda_pcb::Pin(Millimeters(xs[center]),
+                                             Millimeters(-ys[center]),
+                                             Millimeters(shape.thickness),
+                                             clearance,
+                                             Millimeters(shape.mask),
+                                             Millimeters(shape.drill),
+                                             names[pad], names[pad],
+                                             shape.isSquare ? "square" :
+                                             (shape.isOctagon ? "octagon" : "")));
+      }
+    }
+    const vector<double> &lineWidths = geometry.getLineWidths();
+    for (size_t line = 0; line < lineWidths.size(); ++line) {
+      const size_t start = 2 * line;
+      element.addElement(new geda_pcb::ElementLine(Millimeters(xs[start]),
+                                                   Millimeters(-ys[start]),
+                                                   Millimeters(xs[start + 1]),
+                                                   Millimeters(-ys[start + 1]),
+                                                   Millimeters(lineWidths[line])));
+    }
+    const vector<double> &radii = geometry.getCircleRadii();
+    const vector<double> &circleWidths = geometry.getCircleWidths();
+    for (size_t circle = 0; circle < radii.size(); ++circle) {
+      const size_t center = (2 * lineWidths.size()) + circle;
+      element.addElement(new geda_pcb::ElementArc(Millimeters(xs[center]),
+                                                  Millimeters(-ys[center]),
+                                                  Millimeters(radii[circle]),
+                                                  Millimeters(radii[circle]),
+                                                  0, 360,
+                                                  Millimeters(circleWidths[circle])));
+    }
+  }
+
+  /**
+   * Snap the coordinates of objects to a grid, gathered into a single
+   * column so that the snap is one batched pass.
+   */
+  template <typename T> static void
+  snapAll(const vector<T *> &objects,
+          const GridSnap &snap)
+  {
+    vector<double> coordinates(T::COORDINATE_COUNT * objects.size());
+    for (size_t index = 0; index < objects.size(); ++index) {
+      objects[index]->getCoordinates(&coordinates[T::COORDINATE_COUNT * index]);
+    }
+    snap.apply(coordinates.data(), coordinates.size());
+    for (size_t index = 0; index < objects.size(); ++index) {
+      objects[index]->setCoordinates(&coordinates[T::COORDINATE_COUNT * index]);
+    }
+  }
+
+  static void
+  snapPolygons(const vector<Polygon *> &polygons,
+               const GridSnap &snap)
+  {
+    for (vector<Polygon *>::const_iterator polygon = polygons.begin();
+         polygon != polygons.end(); ++polygon) {
+      (*polygon)->snap(snap);
+    }
+  }
+
+  static ostream *&
+  getLogSlot()
+  {
+    static thread_local ostream *log = NULL;
+    return log;
+  }
+
+  void
+  dumpExceptionDetails(const char *errorType,
+                       const SAXParseException &exc)
+  {
+    // cerr << errorType << " in file " << StrX(exc.getSystemId()) << ", line "
+    //      << exc.getLineNumber() << ", char " << exc.getColumnNumber()
+    //      << ": " << StrX(exc.getMessage()) << endl;
+    getLog() << errorType << " in file " << exc.getSystemId() << ", line "
+         << exc.getLineNumber() << ", char " << exc.getColumnNumber()
+         << ": " << exc.getMessage() << endl;
+  }
+
+  void
+  handleStart(const string &name,
+              const AttributeBuffer &attributes)
+  {
+    pollLimits();
+    ++elementCounts_[name];
+    const Context context = getContext();
+    const ElementType type = TRANSITIONS.getElementType(name);
+    const Transition *transition = &TRANSITIONS.get(context, type);
+    if (INVALID_CONTEXT == transition->context) {
+      reportNestingError(name, context);
+      transition = &TRANSITIONS.get(IGNORED_CONTEXT, OTHER_ELEMENT);
+    }
+    else if ((NULL != recorder_) && isRecorded(context, type)) {
+      recorder_->startElement(name);
+      const unsigned count = attributes.getLength();
+      for (unsigned index = 0; index < count; ++index) {
+        recorder_->addAttribute(attributes.getName(index),
+                                attributes.getValue(index));
+      }
+    }
+    if (isRecordingOnly_) {
+      if (SECTION_ELEMENT == type) {
+        sectionContexts_.push_back(context);
+      }
+    }
+    else if (NULL != transition->start) {
+      (this->*transition->start)(attributes);
+    }
+    contexts_.push_back(transition);
+  }
+
+  void
+  handleEnd()
+  {
+    assert(!contexts_.empty());
+    const Transition *transition = contexts_.back();
+    contexts_.pop_back();
+    if ((NULL != recorder_) && isRecorded(getContext(), transition->type)) {
+      recorder_->endElement();
+    }
+    if ((!isRecordingOnly_) && (NULL != transition->end)) {
+      (this->*transition->end)();
+    }
+  }
+
+  void
+  handleCharacters(const boost::string_ref &chars)
+  {
+    switch (getContext()) {
+    case TEXT_CONTEXT:
+      if (NULL != recorder_) {
+        recorder_->addCharacters(chars);
+      }
+      if (isRecordingOnly_) {
+        break;
+      }
+      assert(NULL != currentText_);
+      currentText_->handleCharacters(chars);
+      break;
+    case IGNORED_CONTEXT:
+      // Do nothing
+      break;
+    default:
+      getLog() << "WARN " << chars.size() << " unexpected characters: '"
+           << chars << "'" << endl;
+      break;
+    }
+  }
+
+  /**
+   * Whether an element is part of a model snapshot: only the elements
+   * which the conversion handles are, not their ignored content.
+   */
+  static bool
+  isRecorded(const Context parent,
+             const ElementType type)
+  {
+    return (OTHER_ELEMENT != type) && (IGNORED_CONTEXT != parent);
+  }
+
+  void
+  pollLimits() const
+  {
+    if (NULL != limits_) {
+      limits_->poll();
+    }
+  }
+
+  Context
+  getContext() const
+  {
+    return contexts_.empty() ? DOCUMENT_CONTEXT : contexts_.back()->context;
+  }
+
+  void
+  reportNestingError(const string &element,
+                     const Context context)
+  {
+    const XMLSSize_t lineNumber =
+      (NULL != locator_) ? locator_->getLineNumber() : 0;
+    const XMLSSize_t columnNumber =
+      (NULL != locator_) ? locator_->getColumnNumber() : 0;
+    const NestingError error(element, context, lineNumber, columnNumber);
+    if (isRecordingOnly_) {
+      nestingErrors_.push_back(error);
+    }
+    else {
+      addNestingError(error);
+    }
+  }
+
+  // State machine actions, see TransitionTable.
+
+  void
+  startText(const AttributeBuffer &attributes)
+  {
+    getLog() << "DBG starting text";
+    if (NULL != locator_) {
+      getLog() << " at " << locator_->getLineNumber() << endl;
+    }
+    else {
+      getLog() << endl;
+    }
+    assert(NULL == currentText_);
+    currentText_ = new Text;
+    handleTextDefinition(attributes);
+  }
+
+  void
+  finishText()
+  {
+    getLog() << "DBG ending text" << endl;
+    assert(NULL != currentText_);
+    setTextMetrics(*currentText_);
+    if (NULL != currentPackage_) {
+      currentPackage_->addText(currentText_);
+    }
+    else {
+      board_.addText(currentText_);
+    }
+    currentText_ = NULL;
+  }
+
+  void
+  finishLibrary()
+  {
+    currentLibraryName_.clear();
+  }
+
+  void
+  startPackage(const AttributeBuffer &attributes)
+  {
+    assert(NULL == currentPackage_);
+    currentPackage_ = new Package;
+    handlePackageDefinition(attributes);
+  }
+
+  void
+  finishPackage()
+  {
+    assert(NULL != currentPackage_);
+    currentPackage_->buildGeometry();
+    indexPackage(currentPackage_);
+    currentPackage_ = NULL;
+  }
+
+  void
+  startSignal(const AttributeBuffer &attributes)
+  {
+    assert(NULL == currentSignal_);
+    currentSignal_ = new Signal;
+    handleSignalDefinition(attributes);
+  }
+
+  void
+  finishSignal()
+  {
+    assert(NULL != currentSignal_);
+    addSignal(currentSignal_);
+    currentSignal_ = NULL;
+  }
+
+  void
+  startPolygon(const AttributeBuffer &attributes)
+  {
+    assert(NULL == currentPolygon_);
+    currentPolygon_ = new Polygon;
+    handlePolygonDefinition(attributes);
+  }
+
+  void
+  finishPolygon()
+  {
+    assert(NULL != currentPolygon_);
+    if (NULL != currentPackage_) {
+      currentPackage_->addPolygon(currentPolygon_);
+    }
+    else if (NULL != currentSignal_) {
+      currentSignal_->addPolygon(currentPolygon_);
+    }
+    else {
+      board_.addPolygon(currentPolygon_);
+    }
+    currentPolygon_ = NULL;
+  }
+
+  // TODO: is it necessary to have a list of all layer definitions, or
+  // will a fixed mapping from Eagle layers to pcb layers suffice?
+  //
+  // void
+  // handleLayerDefinition(const AttributeBuffer &attributes)
+  // {
+  //   bool isActive = false;
+  //   const unsigned count = attributes.getLength();
+  //   for (unsigned index = 0; index < count; ++index) {
+  //     Attribute attribute(attributes, index);
+  //     // TODO: assert that CDATA or ENUMERATION are the only types?
+      
+  //     if ((ACTIVE == attribute.getName()) && (YES == attribute.getValue())) {
+  //       isActive = true;
+  //     }
+  //     else if (NUMBER == attribute.getName()) {
+  //       layerNumber = attribute.getValue();
+  //     }
+  //     else if (NAME == attribute.getName()) {
+  //       layerName = attribute.getValue();
+  //     }
+  //   }
+  //   if (isActive) {
+  //     layerNames_[layerNumber] = attribute.getName();
+  //   }
+  // }
+
+  void
+  handleTextDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentText_);
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (currentText_->tryHandleAttribute(attribute)) {
+        continue;
+      }
+      else if ((FONT == attribute.getName()) ||
+               (ALIGN == attribute.getName())) {
+        // TODO: handle this if possible
+        continue;
+      }
+      else {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in text definition" << endl;
+      }
+    }
+    // NOTE: wait until the end of the text definition to save the
+    // text value since the characters are not defined along with the
+    // other attributes.
+  }
+
+  void
+  handleWireDefinition(const AttributeBuffer &attributes)
+  {
+    Wire *wire = new Wire;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!wire->tryHandleAttribute(attribute)) {
+        if (CAP == attribute.getName()) {
+          // Handle 'cap' attribute, the only instances observed have the
+          // value 'flat' and 'round'
+          // cerr << "WARN ignoring 'cap' value '" << value << "' in wire "
+          //      << "definition" << endl;
+        }
+        else if (STYLE == attribute.getName()) {
+          // NOTE: Possibly specific to rendering of wires; the only
+          // instance observed has the value 'shortdash'
+        }
+        else {
+          getLog() << "WARN unexpected attribute '" << attribute.getName()
+               << "' in wire definition" << endl;
+        }
+      }
+    }
+    if (NULL != currentPackage_) {
+      currentPackage_->addWire(wire);
+    }
+    else if (NULL != currentSignal_) {
+      currentSignal_->addWire(wire);
+    }
+    else {
+      board_.addWire(wire);
+    }
+  }
+
+  void
+  handleGridDefinition(const AttributeBuffer &attributes)
+  {
+    Grid grid;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!grid.tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in grid definition" << endl;
+      }
+    }
+    grid_ = grid;
+  }
+
+  void
+  handleParamDefinition(const AttributeBuffer &attributes)
+  {
+    string name;
+    string value;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (NAME == attribute.getName()) {
+        name = attribute.copyValue();
+      }
+      else if (VALUE == attribute.getName()) {
+        value = attribute.copyValue();
+      }
+      else {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in design rule parameter" << endl;
+      }
+    }
+    if (!designRules_.trySetParameter(name, value.c_str())) {
+      getLog() << "WARN malformed design rule " << name << " '" << value
+           << "'" << endl;
+    }
+  }
+
+  void
+  handleHoleDefinition(const AttributeBuffer &attributes)
+  {
+    Hole *hole = new Hole(false);  // Not a Via
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!hole->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in hole definition" << endl;
+      }
+    }
+    if (NULL != currentPackage_) {
+      currentPackage_->addHole(hole);
+    }
+    else {
+      board_.addHole(hole);
+    }
+  }
+
+  void
+  handleSmdDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentPackage_);
+    Smd *smd = new Smd;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!smd->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in smd definition" << endl;
+      }
+    }
+    if (!smd->isComplete()) {
+      getLog() << "WARN incomplete smd definition" << endl;
+      delete smd;
+      return;
+    }
+    currentPackage_->addSmd(smd);
+  }
+
+  void
+  handlePadDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentPackage_);
+    Pad *pad = new Pad;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!pad->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in pad definition" << endl;
+      }
+    }
+    if (!pad->isComplete()) {
+      getLog() << "WARN incomplete pad definition" << endl;
+      delete pad;
+      return;
+    }
+    currentPackage_->addPad(pad);
+  }
+
+  void
+  handleRectangleDefinition(const AttributeBuffer &attributes)
+  {
+    // NOTE: attributes of a rectangle are the same as a wire, but it
+    // needs to go on a different list.
+    Rectangle *rectangle = new Rectangle;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!rectangle->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in rectangle definition" << endl;
+      }
+    }
+    if (NULL != currentPackage_) {
+      currentPackage_->addRectangle(rectangle);
+    }
+    else {
+      board_.addRectangle(rectangle);
+    }
+  }
+
+  void
+  handleCircleDefinition(const AttributeBuffer &attributes)
+  {
+    Circle *circle = new Circle;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!circle->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in circle definition" << endl;
+      }
+    }
+    if (NULL != currentPackage_) {
+      currentPackage_->addCircle(circle);
+    }
+    else {
+      board_.addCircle(circle);
+    }
+  }
+
+  void
+  handleLibraryDefinition(const AttributeBuffer &attributes)
+  {
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (NAME == attribute.getName()) {
+        currentLibraryName_ = attribute.copyValue();
+      }
+      else {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in library definition" << endl;
+      }
+    }
+  }
+
+  void
+  handlePackageDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentPackage_);
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!currentPackage_->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in package definition" << endl;
+      }
+    }
+  }
+
+  /**
+   * Add a completed package to the (library, package) index used to
+   * resolve element placements.
+   */
+  void
+  indexPackage(Package *package)
+  {
+    if (!package->hasName()) {
+      getLog() << "WARN package without a name in library '"
+           << currentLibraryName_ << "'" << endl;
+      delete package;
+      return;
+    }
+    const PackageKey key(currentLibraryName_, package->getName());
+    const pair<PackageIndex::iterator, bool> result =
+      packageIndex_.insert(make_pair(key, package));
+    if (result.second) {
+      return;
+    }
+    if (!isReplacing_) {
+      getLog() << "WARN duplicate package '" << key.second << "' in library '"
+           << key.first << "'" << endl;
+      delete package;
+      return;
+    }
+    delete result.first->second;
+    result.first->second = package;
+    replacedPackages_.insert(key);
+  }
+
+  void
+  handleSignalDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentSignal_);
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!currentSignal_->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in signal definition" << endl;
+      }
+    }
+  }
+
+  void
+  handleContactRefDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentSignal_);
+    Signal::Contact contact;
+    bool hasElement = false;
+    bool hasPad = false;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (ELEMENT == attribute.getName()) {
+        contact.first = attribute.copyValue();
+        hasElement = true;
+      }
+      else if (PAD == attribute.getName()) {
+        contact.second = attribute.copyValue();
+        hasPad = true;
+      }
+      else if ((ROUTE == attribute.getName()) ||
+               (ROUTETAG == attribute.getName())) {
+        // NOTE: routing settings, no equivalent in the output.
+      }
+      else {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in contactref definition" << endl;
+      }
+    }
+    if (hasElement && hasPad) {
+      currentSignal_->addContact(std::move(contact));
+    }
+    else {
+      getLog() << "WARN incomplete contactref definition" << endl;
+    }
+  }
+
+  void
+  handleViaDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentSignal_);
+    Hole via(true);
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!via.tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in via definition" << endl;
+      }
+    }
+    if ((!via.hasX()) || (!via.hasY()) || (!via.hasDrill())) {
+      getLog() << "WARN incomplete via definition" << endl;
+      return;
+    }
+    currentSignal_->addVia(via);
+  }
+
+  void
+  handlePolygonDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentPolygon_);
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!currentPolygon_->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in polygon definition" << endl;
+      }
+    }
+  }
+
+  void
+  handleVertexDefinition(const AttributeBuffer &attributes)
+  {
+    assert(NULL != currentPolygon_);
+    double x = 0.0;
+    double y = 0.0;
+    double curve = 0.0;
+    bool hasX = false;
+    bool hasY = false;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      const char * const value = attribute.getValueCString();
+      if (X == attribute.getName()) {
+        x = atof(value);
+        hasX = true;
+      }
+      else if (Y == attribute.getName()) {
+        y = atof(value);
+        hasY = true;
+      }
+      else if (CURVE == attribute.getName()) {
+        curve = atof(value);
+      }
+      else {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in vertex definition" << endl;
+      }
+    }
+    if (hasX && hasY) {
+      currentPolygon_->addVertex(x, y, curve);
+    }
+    else {
+      getLog() << "WARN incomplete vertex definition" << endl;
+    }
+  }
+
+  void
+  addSignal(Signal *signal)
+  {
+    if (!signal->hasName()) {
+      getLog() << "WARN signal without a name" << endl;
+      delete signal;
+      return;
+    }
+    const pair<unordered_map<string, size_t>::iterator, bool> result =
+      signalIndex_.insert(make_pair(signal->getName(), signals_.size()));
+    if (result.second) {
+      signals_.push_back(signal);
+    }
+    else if (isReplacing_) {
+      delete signals_[result.first->second];
+      signals_[result.first->second] = signal;
+    }
+    else {
+      getLog() << "WARN duplicate signal '" << signal->getName() << "'" << endl;
+      delete signal;
+    }
+  }
+
+  void
+  handleElementDefinition(const AttributeBuffer &attributes)
+  {
+    Element *element = new Element;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      if (!element->tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in element definition" << endl;
+      }
+    }
+    if (!element->isComplete()) {
+      getLog() << "WARN incomplete element definition" << endl;
+      delete element;
+      currentElement_ = NULL;
+      return;
+    }
+    // NOTE: libraries precede elements in a board file, so the package
+    // can always be resolved here.
+    const PackageIndex::const_iterator entry =
+      packageIndex_.find(PackageKey(element->getLibraryName(),
+                                    element->getPackageName()));
+    if (packageIndex_.end() == entry) {
+      getLog() << "WARN element '" << element->getName()
+           << "' refers to unknown package '" << element->getPackageName()
+           << "' in library '" << element->getLibraryName() << "'" << endl;
+    }
+    else {
+      element->setPackage(entry->second);
+    }
+    elements_.push_back(element);
+    currentElement_ = element;
+  }
+
+  void
+  finishElement()
+  {
+    currentElement_ = NULL;
+  }
+
+  /**
+   * Handle an attribute of an element, of which only a smashed name
+   * (i.e. one placed separately from the package) is converted.
+   */
+  void
+  handleElementAttributeDefinition(const AttributeBuffer &attributes)
+  {
+    Text text;
+    bool isName = false;
+    bool isDisplayed = true;
+    const unsigned count = attributes.getLength();
+    for (unsigned index = 0; index < count; ++index) {
+      Attribute attribute(attributes, index);
+      const boost::string_ref name = attribute.getName();
+      if (NAME == name) {
+        isName = (NAME_ATTRIBUTE == attribute.getValue());
+      }
+      else if (DISPLAY == name) {
+        isDisplayed = (OFF != attribute.getValue());
+      }
+      else if ((VALUE == name) || (CONSTANT == name)) {
+        // NOTE: the value is that of the element.
+      }
+      else if (!text.tryHandleAttribute(attribute)) {
+        getLog() << "WARN unexpected attribute '" << attribute.getName()
+             << "' in element attribute definition" << endl;
+      }
+    }
+    if ((NULL == currentElement_) || (!isName) || (!isDisplayed) ||
+        (!text.hasX()) || (!text.hasY()) || (!text.hasSize())) {
+      return;
+    }
+    setTextMetrics(text);
+    currentElement_->setNameText(text);
+  }
+
+  /**
+   * Look up the gEDA size of text, computing it only for sizes not
+   * seen before.
+   */
+  void
+  setTextMetrics(Text &text)
+  {
+    if (text.hasSize()) {
+      text.setMetricsIndex(textMetrics_.getIndex(text.getSize(),
+                                                 text.hasRatio() ?
+                                                 text.getRatio() :
+                                                 DEFAULT_TEXT_RATIO));
+    }
+  }
+
+  static bool
+  isCopperLayer(const unsigned layer)
+  {
+    return (TOP_LAYER <= layer) && (BOTTOM_LAYER >= layer);
+  }
+
+  /**
+   * Id of the copper node at a point, adding it (owned by the given
+   * signal) if necessary.
+   */
+  static uint32_t
+  getCopperNode(const CopperPoint &point,
+                const uint32_t signal,
+                CopperNodes &nodes,
+                UnionFind &copper,
+                vector<uint32_t> &owners)
+  {
+    const pair<CopperNodes::iterator, bool> result =
+      nodes.insert(make_pair(point, static_cast<uint32_t>(owners.size())));
+    if (result.second) {
+      owners.push_back(signal);
+      copper.resize(owners.size());
+    }
+    return result.first->second;
+  }
+
+  /**
+   * Append the points (excluding the end points) approximating an Eagle
+   * arc from (x1, y1) to (x2, y2) which sweeps the given number of
+   * degrees counterclockwise (clockwise when negative).
+   */
+  static void
+  appendArc(const double x1,
+            const double y1,
+            const double x2,
+            const double y2,
+            const double curve,
+            Contour &points)
+  {
+    const double chord = hypot(x2 - x1, y2 - y1);
+    const double sweep = curve * (M_PI / 180.0);
+    if ((0.0 == chord) || (0.0 == sin(sweep / 2.0))) {
+      return;
+    }
+    // Center is on the perpendicular bisector of the chord, to the
+    // left of it for counterclockwise sweeps of less than 180 degrees.
+    const double offset = (chord / 2.0) / tan(sweep / 2.0);
+    const double centerX = ((x1 + x2) / 2.0) - (offset * (y2 - y1) / chord);
+    const double centerY = ((y1 + y2) / 2.0) + (offset * (x2 - x1) / chord);
+    const double radius = hypot(x1 - centerX, y1 - centerY);
+    const double start = atan2(y1 - centerY, x1 - centerX);
+    const unsigned count =
+      static_cast<unsigned>(ceil(fabs(curve) / ARC_STEP_DEGREES));
+    for (unsigned index = 1; index < count; ++index) {
+      const double angle = start + ((sweep * index) / count);
+      points.push_back(ClipPoint(centerX + (radius * cos(angle)),
+                                 centerY + (radius * sin(angle))));
+    }
+  }
+
+  /**
+   * Points along a wire, more than two if it is curved.
+   */
+  static void
+  getWirePoints(const Wire &wire,
+                Contour &points)
+  {
+    points.clear();
+    points.push_back(ClipPoint(wire.getX1(), wire.getY1()));
+    if (wire.hasCurve()) {
+      appendArc(wire.getX1(), wire.getY1(), wire.getX2(), wire.getY2(),
+                wire.getCurve(), points);
+    }
+    points.push_back(ClipPoint(wire.getX2(), wire.getY2()));
+  }
+
+  /**
+   * Add the board text on copper and silk screen layers.
+   */
+  void
+  addTexts(const double originY,
+           CopperLayers &layers) const
+  {
+    const vector<Text *> &texts = board_.getTexts();
+    for (vector<Text *>::const_iterator iter = texts.begin();
+         iter != texts.end(); ++iter) {
+      const Text &text = **iter;
+      TextPlacement placement;
+      if ((!text.hasLayer()) || (!tryPlaceText(text, placement))) {
+        continue;
+      }
+      geda_pcb::Layer *layer = layers.getForText(text.getLayer());
+      if (NULL == layer) {
+        continue;
+      }
+      const bool isOnSolder = (BOTTOM_LAYER == text.getLayer()) ||
+        (BPLACE_LAYER == text.getLayer()) ||
+        (BNAMES_LAYER == text.getLayer()) ||
+        (BVALUES_LAYER == text.getLayer());
+      layer->addText(geda_pcb::Text(Millimeters(placement.x),
+                                    Millimeters(originY - placement.y),
+                                    placement.direction,
+                                    placement.scale,
+                                    text.getString(),
+                                    isOnSolder ? "onsolder" : ""));
+    }
+  }
+
+  /**
+   * Placement of board text, returns false for text which can't be
+   * drawn (lacking a position, size or string).
+   */
+  bool
+  tryPlaceText(const Text &text,
+               TextPlacement &placement) const
+  {
+    if ((!text.hasX()) || (!text.hasY()) || (!text.hasMetrics()) ||
+        (!text.hasString())) {
+      return false;
+    }
+    placement = placeText(text, text.getString(), text.getX().value(),
+                          text.getY(),
+                          text.hasRotation() ? text.getRotation() : Rotation());
+    return true;
+  }
+
+  /**
+   * Placement of the name of an element, where it was smashed or else
+   * where its package puts it; returns false if it has no name text.
+   */
+  bool
+  tryPlaceName(const Element &element,
+               TextPlacement &placement) const
+  {
+    if (element.hasNameText()) {
+      const Text &text = element.getNameText();
+      placement = placeText(text, element.getName(), text.getX().value(),
+                            text.getY(),
+                            text.hasRotation() ? text.getRotation() : Rotation());
+      return true;
+    }
+    const Package *package = element.getPackage();
+    const Text *text = (NULL == package) ? NULL : package->getNameText();
+    if (NULL == text) {
+      return false;
+    }
+    const Rotation rotation =
+      element.hasRotation() ? element.getRotation() : Rotation();
+    double x = text->getX().value();
+    double y = text->getY();
+    rotation.apply(x, y);
+    placement = placeText(*text, element.getName(),
+                          element.getX().value() + x, element.getY() + y,
+                          Rotation::compose(rotation, text->hasRotation() ?
+                                            text->getRotation() : Rotation()));
+    return true;
+  }
+
+  /**
+   * Place value in the size and style of text, anchored at (x, y) and
+   * turned by rotation as Eagle draws it with the default (bottom
+   * left) alignment.
+   *
+   * NOTE: pcb only turns text by quarter turns, other angles are
+   * rounded to the nearest.
+   */
+  TextPlacement
+  placeText(const Text &text,
+            const string &value,
+            const double x,
+            const double y,
+            const Rotation &rotation) const
+  {
+    const TextMetrics &metrics = textMetrics_.get(text.getMetricsIndex());
+    const double width = metrics.getWidth(value);
+    unsigned turns =
+      static_cast<unsigned>(floor((rotation.getDegrees() / 90.0) + 0.5)) % 4;
+    double xs[] = { 0.0, width, width, 0.0 };
+    double ys[] = { metrics.height, metrics.height, 0.0, 0.0 };
+    Rotation(90.0 * turns, rotation.isMirrored()).apply(xs, ys, 4);
+    // Corner where reading starts, at the top of the characters.
+    size_t corner = 0;
+    if ((!rotation.isSpin()) && (2 <= turns)) {
+      // NOTE: unless spun, Eagle keeps text readable by turning it over
+      // within the same box.
+      turns -= 2;
+      corner = 2;
+    }
+    TextPlacement placement;
+    placement.x = x + xs[corner];
+    placement.y = y + ys[corner];
+    placement.direction = (turns + (rotation.isMirrored() ? 2 : 0)) % 4;
+    placement.scale = metrics.scale;
+    for (size_t index = 0; index < 4; ++index) {
+      placement.bounds.add(x + xs[index], y + ys[index]);
+    }
+    placement.bounds = placement.bounds.expand(metrics.stroke / 2.0);
+    return placement;
+  }
+
+  static void
+  addLines(const vector<Wire *> &wires,
+           const double originY,
+           CopperLayers &layers)
+  {
+    Contour points;
+    for (vector<Wire *>::const_iterator iter = wires.begin();
+         iter != wires.end(); ++iter) {
+      const Wire &wire = **iter;
+      if ((!wire.hasLayer()) || (!isCopperLayer(wire.getLayer()))) {
+        continue;
+      }
+      geda_pcb::Layer *layer = layers.get(wire.getLayer());
+      if (NULL == layer) {
+        continue;
+      }
+      getWirePoints(wire, points);
+      for (size_t index = 1; index < points.size(); ++index) {
+        const ClipPoint &start = points[index - 1];
+        const ClipPoint &end = points[index];
+        layer->addLine(geda_pcb::Line(Millimeters(start.x),
+                                      Millimeters(originY - start.y),
+                                      Millimeters(end.x),
+                                      Millimeters(originY - end.y),
+                                      Millimeters(wire.getWidth()),
+                                      Millimeters(2.0 * DEFAULT_CLEARANCE),
+                                      "clearline"));
+        layers.noteLineAdded();
+      }
+    }
+  }
+
+  /**
+   * Add the straight pieces of the routed copper and the pads to a
+   * spatial index, each grown by margin.
+   */
+  void
+  indexCopper(vector<CopperSegment> &segments,
+              SpatialGrid &grid,
+              const double margin) const
+  {
+    Contour points;
+    for (int64_t index = -1; index < static_cast<int64_t>(signals_.size());
+         ++index) {
+      const vector<Wire *> &wires =
+        (0 > index) ? board_.getWires() : signals_[index]->getWires();
+      for (vector<Wire *>::const_iterator iter = wires.begin();
+           iter != wires.end(); ++iter) {
+        const Wire &wire = **iter;
+        if ((!wire.hasLayer()) || (!isCopperLayer(wire.getLayer()))) {
+          continue;
+        }
+        getWirePoints(wire, points);
+        for (size_t point = 1; point < points.size(); ++point) {
+          segments.push_back(CopperSegment(wire.getLayer(), index,
+                                           points[point - 1], points[point],
+                                           wire.getWidth() / 2.0));
+        }
+      }
+      if (0 > index) {
+        continue;
+      }
+      const ViaColumns &vias = signals_[index]->getVias();
+      for (size_t via = 0; via < vias.size(); ++via) {
+        const ClipPoint center(vias.getX(via), vias.getY(via));
+        const double diameter =
+          designRules_.getViaDiameter(vias.getDrill(via),
+                                      vias.getDiameter(via));
+        segments.push_back(CopperSegment(VIA_LAYERS, index, center, center,
+                                         diameter / 2.0));
+      }
+    }
+    addPadCopper(segments);
+    for (uint32_t index = 0; index < segments.size(); ++index) {
+      grid.insert(index, segments[index].getBounds().expand(margin));
+    }
+  }
+
+  /**
+   * Append the copper of the pads of every placed element, in board
+   * coordinates and owned by the signal whose contactref names the pad
+   * (NO_SIGNAL if none does).
+   *
+   * NOTE: the corners of square pads are approximated by round ends,
+   * the segments being those pcb strokes the pads with.
+   */
+  void
+  addPadCopper(vector<CopperSegment> &segments) const
+  {
+    map<Signal::Contact, int64_t> contactSignals;
+    for (size_t index = 0; index < signals_.size(); ++index) {
+      const vector<Signal::Contact> &contacts = signals_[index]->getContacts();
+      for (vector<Signal::Contact>::const_iterator contact = contacts.begin();
+           contact != contacts.end(); ++contact) {
+        contactSignals.insert(make_pair(*contact, index));
+      }
+    }
+    Signal::Contact contact;
+    for (size_t index = 0; index < elements_.size(); ++index) {
+      const Element &element = *elements_[index];
+      const Package *package = element.getPackage();
+      if (NULL == package) {
+        continue;
+      }
+      const PackageGeometry &geometry = package->getGeometry();
+      const vector<string> &names = geometry.getPadNames();
+      if (names.empty()) {
+        continue;
+      }
+      const Rotation rotation =
+        element.hasRotation() ? element.getRotation() : Rotation();
+      const vector<double>::const_iterator firstX =
+        geometry.getXs().begin() + geometry.getFirstPad();
+      const vector<double>::const_iterator firstY =
+        geometry.getYs().begin() + geometry.getFirstPad();
+      vector<double> xs(firstX, firstX + names.size());
+      vector<double> ys(firstY, firstY + names.size());
+      rotation.apply(&xs[0], &ys[0], xs.size());
+      const vector<PadShape> &shapes = geometry.getPadShapes();
+      const vector<uint32_t> &shapeIndices = geometry.getPadShapeIndices();
+      contact.first = element.getName();
+      for (uint32_t pad = 0; pad < names.size(); ++pad) {
+        const PadShape &shape = shapes[shapeIndices[pad]];
+        double offsetX = shape.offsetX;
+        double offsetY = shape.offsetY;
+        rotation.apply(offsetX, offsetY);
+        const double x = element.getX().value() + xs[pad];
+        const double y = element.getY() + ys[pad];
+        unsigned layer = VIA_LAYERS;
+        if (0.0 == shape.drill) {
+          layer = (shape.isBottom != rotation.isMirrored()) ?
+            BOTTOM_LAYER : TOP_LAYER;
+        }
+        contact.second = names[pad];
+        const map<Signal::Contact, int64_t>::const_iterator signal =
+          contactSignals.find(contact);
+        segments.push_back(CopperSegment(layer,
+                                         (contactSignals.end() == signal) ?
+                                         NO_SIGNAL : signal->second,
+                                         ClipPoint(x - offsetX, y - offsetY),
+                                         ClipPoint(x + offsetX, y + offsetY),
+                                         shape.thickness / 2.0, index, pad));
+      }
+    }
+  }
+
+  /**
+   * Thread body of checkClearances(), checks cells until there are
+   * none left.  bounds are those the segments were indexed with.
+   */
+  void
+  checkCellClearances(const vector<CopperSegment> &segments,
+                      const vector<BoundingBox> &bounds,
+                      const SpatialGrid &grid,
+                      const vector<SpatialGrid::Cell> &cells,
+                      atomic<size_t> &nextCell,
+                      vector<ClearanceViolation> &violations) const
+  {
+    for (size_t index = nextCell++; index < cells.size(); index = nextCell++) {
+      const SpatialGrid::Cell &cell = cells[index];
+      const vector<uint32_t> &ids = *cell.ids;
+      for (size_t first = 0; first < ids.size(); ++first) {
+        const CopperSegment &segment = segments[ids[first]];
+        const BoundingBox &box = bounds[ids[first]];
+        for (size_t second = first + 1; second < ids.size(); ++second) {
+          const CopperSegment &other = segments[ids[second]];
+          const BoundingBox &otherBox = bounds[ids[second]];
+          if ((segment.getSignal() == other.getSignal()) ||
+              (!segment.isOnLayerOf(other)) || (!box.intersects(otherBox))) {
+            continue;
+          }
+          // NOTE: a pair is in every cell both boxes overlap, it is
+          // only checked in the one holding the corner of the overlap.
+          if ((cell.column != grid.toCell(max(box.getMinX(), otherBox.getMinX()))) ||
+              (cell.row != grid.toCell(max(box.getMinY(), otherBox.getMinY())))) {
+            continue;
+          }
+          ClearanceViolation violation;
+          violation.gap = segment.getGap(other, violation.location);
+          if (violation.gap < (DEFAULT_CLEARANCE - CLEARANCE_TOLERANCE)) {
+            violation.first = min(ids[first], ids[second]);
+            violation.second = max(ids[first], ids[second]);
+            violations.push_back(violation);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Description of the owner of a CopperSegment for reports.
+   */
+  string
+  describeCopper(const CopperSegment &segment) const
+  {
+    if (0 <= segment.getElement()) {
+      const Element &element = *elements_[segment.getElement()];
+      const string pad = "pad '" + element.getName() + "-" +
+        element.getPackage()->getGeometry().getPadNames()[segment.getPad()] +
+        "'";
+      if (0 > segment.getSignal()) {
+        return pad;
+      }
+      return pad + " of signal '" + signals_[segment.getSignal()]->getName() +
+        "'";
+    }
+    if (0 > segment.getSignal()) {
+      return "board copper";
+    }
+    const string kind = (VIA_LAYERS == segment.getLayer()) ? "via" : "wire";
+    return kind + " of signal '" + signals_[segment.getSignal()]->getName() + "'";
+  }
+
+  static BoundingBox
+  getBounds(const Contour &contour)
+  {
+    BoundingBox bounds;
+    for (Contour::const_iterator point = contour.begin();
+         point != contour.end(); ++point) {
+      bounds.add(point->x, point->y);
+    }
+    return bounds;
+  }
+
+  static void
+  addPolygon(const string &flags,
+             const Contour &outer,
+             const vector<Contour> &holes,
+             const double originY,
+             geda_pcb::Layer &layer)
+  {
+    geda_pcb::Polygon polygon(flags);
+    for (Contour::const_iterator point = outer.begin(); point != outer.end();
+         ++point) {
+      polygon.addPoint(Millimeters(point->x), Millimeters(originY - point->y));
+    }
+    for (vector<Contour>::const_iterator hole = holes.begin();
+         hole != holes.end(); ++hole) {
+      polygon.addHole();
+      for (Contour::const_iterator point = hole->begin(); point != hole->end();
+           ++point) {
+        polygon.addHolePoint(Millimeters(point->x),
+                             Millimeters(originY - point->y));
+      }
+    }
+    layer.addPolygon(std::move(polygon));
+  }
+
+  /**
+   * Convert the pours, see printLayers().
+   */
+  void
+  addPolygons(const double originY,
+              const bool isPreClearing,
+              CopperLayers &layers) const
+  {
+    // Pours along with their signal (negative for the board), and
+    // cutouts.
+    vector<pair<const Polygon *, int64_t> > pours;
+    vector<const Polygon *> cutouts;
+    for (int64_t index = -1; index < static_cast<int64_t>(signals_.size());
+         ++index) {
+      const vector<Polygon *> &polygons =
+        (0 > index) ? board_.getPolygons() : signals_[index]->getPolygons();
+      for (vector<Polygon *>::const_iterator iter = polygons.begin();
+           iter != polygons.end(); ++iter) {
+        const Polygon &polygon = **iter;
+        if ((!polygon.hasLayer()) || (!isCopperLayer(polygon.getLayer()))) {
+          continue;
+        }
+        if (Polygon::CUTOUT_POUR == polygon.getPour()) {
+          cutouts.push_back(&polygon);
+        }
+        else {
+          // NOTE: hatched pours are output as solid.
+          pours.push_back(make_pair(&polygon, index));
+        }
+      }
+    }
+    if (pours.empty()) {
+      return;
+    }
+    vector<Contour> cutoutContours(cutouts.size());
+    vector<BoundingBox> cutoutBounds(cutouts.size());
+    for (size_t index = 0; index < cutouts.size(); ++index) {
+      cutouts[index]->getContour(cutoutContours[index]);
+      cutoutBounds[index] = getBounds(cutoutContours[index]);
+    }
+    vector<CopperSegment> segments;
+    SpatialGrid grid(CLEARANCE_GRID_CELL);
+    if (isPreClearing) {
+      indexCopper(segments, grid, 0.0);
+    }
+
+    const string flags(isPreClearing ? "" : "clearpoly");
+    ScanlineClipper clipper;
+    Contour contour;
+    Contour obstacle;
+    vector<ClipRegion> regions;
+    vector<uint32_t> nearby;
+    for (vector<pair<const Polygon *, int64_t> >::const_iterator pour =
+           pours.begin(); pour != pours.end(); ++pour) {
+      pollLimits();
+      const Polygon &polygon = *pour->first;
+      geda_pcb::Layer *layer = layers.get(polygon.getLayer());
+      if (NULL == layer) {
+        continue;
+      }
+      polygon.getContour(contour);
+      if (3 > contour.size()) {
+        getLog() << "WARN polygon with fewer than 3 vertices" << endl;
+        continue;
+      }
+      const BoundingBox bounds = getBounds(contour);
+      clipper.clear();
+      clipper.setSubject(contour);
+      bool isClipped = false;
+      for (size_t index = 0; index < cutouts.size(); ++index) {
+        if ((cutouts[index]->getLayer() == polygon.getLayer()) &&
+            cutoutBounds[index].intersects(bounds)) {
+          clipper.addObstacle(cutoutContours[index]);
+          isClipped = true;
+        }
+      }
+      if (isPreClearing) {
+        const double isolate = max(polygon.getIsolate(), DEFAULT_CLEARANCE);
+        const BoundingBox area = bounds.expand(isolate);
+        grid.query(area, nearby);
+        for (vector<uint32_t>::const_iterator id = nearby.begin();
+             id != nearby.end(); ++id) {
+          const CopperSegment &segment = segments[*id];
+          if ((segment.getSignal() == pour->second) ||
+              ((VIA_LAYERS != segment.getLayer()) &&
+               (polygon.getLayer() != segment.getLayer())) ||
+              (!segment.getBounds().intersects(area))) {
+            continue;
+          }
+          pollLimits();
+          segment.getOutline(isolate, obstacle);
+          clipper.addObstacle(obstacle);
+          isClipped = true;
+        }
+      }
+      if (!isClipped) {
+        addPolygon(flags, contour, vector<Contour>(), originY, *layer);
+        continue;
+      }
+      clipper.subtract(regions);
+      for (vector<ClipRegion>::const_iterator region = regions.begin();
+           region != regions.end(); ++region) {
+        addPolygon(flags, region->outer, region->holes, originY, *layer);
+      }
+    }
+  }
+
+  // Constants
+
+  // attribute types
+  static const string CDATA;
+  static const string ENUMERATION;
+  // Eagle element and attribute names
+  static const string LAYERS;
+  static const string LAYER;
+  static const string NUMBER;
+  static const string NAME;
+  static const string ACTIVE;
+  static const string YES;
+  static const string NO;
+  static const string BOARD;
+  static const string PLAIN;
+  static const string TEXT;
+  static const string WIRE;
+  static const string HOLE;
+  static const string RECTANGLE;
+  static const string CIRCLE;
+  static const string X;
+  static const string Y;
+  static const string X1;
+  static const string Y1;
+  static const string X2;
+  static const string Y2;
+  static const string SIZE;
+  static const string RATIO;
+  static const string ROTATION;
+  static const string FONT;
+  static const string ALIGN;
+  static const string DESCRIPTION;
+  static const string LANGUAGE;
+  static const string EN;
+  static const string DE;
+  static const string NOTE;
+  static const string WIDTH;
+  static const string CURVE;
+  static const string DRILL;
+  static const string CAP;
+  static const string STYLE;
+  static const string RADIUS;
+  static const string LIBRARIES;
+  static const string LIBRARY;
+  static const string PACKAGES;
+  static const string PACKAGE;
+  static const string SMD;
+  static const string PAD;
+  static const string ELEMENTS;
+  static const string ELEMENT;
+  static const string VALUE;
+  static const string LOCKED;
+  static const string SMASHED;
+  static const string SIGNALS;
+  static const string SIGNAL;
+  static const string CONTACTREF;
+  static const string VIA;
+  static const string CLASS;
+  static const string AIRWIRESHIDDEN;
+  static const string ROUTE;
+  static const string ROUTETAG;
+  static const string EXTENT;
+  static const string DIAMETER;
+  static const string SHAPE;
+  static const string ALWAYSSTOP;
+  static const string POLYGON;
+  static const string VERTEX;
+  static const string ISOLATE;
+  static const string POUR;
+  static const string SOLID;
+  static const string HATCH;
+  static const string CUTOUT;
+  static const string SPACING;
+  static const string RANK;
+  static const string ORPHANS;
+  static const string THERMALS;
+  static const string GRID;
+  static const string DISTANCE;
+  static const string UNITDIST;
+  static const string UNIT;
+  static const string DISPLAY;
+  static const string MULTIPLE;
+  static const string ALTDISTANCE;
+  static const string ALTUNITDIST;
+  static const string ALTUNIT;
+  static const string DESIGNRULES;
+  static const string PARAM;
+  static const string ATTRIBUTE;
+  static const string CONSTANT;
+  static const string OFF;
+  static const string NAME_ATTRIBUTE;
+  static const string NAME_PLACEHOLDER;
+  static const string DX;
+  static const string DY;
+  static const string ROUNDNESS;
+  static const string STOP;
+  static const string CREAM;
+  static const string FIRST;
+  static const string SQUARE;
+  static const string ROUND;
+  static const string OCTAGON;
+  static const string LONG;
+  static const string OFFSET;
+  // Eagle layer numbers
+  static const unsigned TOP_LAYER = 1;
+  static const unsigned BOTTOM_LAYER = 16;
+  static const unsigned DIMENSION_LAYER = 20;
+  // NOTE: pseudo layer number for vias, which connect all copper layers.
+  static const unsigned VIA_LAYERS = 0;
+  // Owner of the copper of pads which no signal connects, see
+  // CopperSegment.
+  static const int64_t NO_SIGNAL = -2;
+  static const unsigned TPLACE_LAYER = 21;
+  static const unsigned BPLACE_LAYER = 22;
+  static const unsigned TNAMES_LAYER = 25;
+  static const unsigned BNAMES_LAYER = 26;
+  static const unsigned TVALUES_LAYER = 27;
+  static const unsigned BVALUES_LAYER = 28;
+  // Stroke width (in percent of the size) of text without a ratio.
+  static constexpr double DEFAULT_TEXT_RATIO = 8.0;
+  // Copper clearances (in mm) where the board file doesn't specify
+  // them, Eagle's default minimum distances.
+  static constexpr double DEFAULT_CLEARANCE = 0.2032;  // 8 mil
+  // Solder mask expansion (in mm) either side of a pad, Eagle's default
+  // stop frame.
+  static constexpr double STOP_MARGIN = 0.1016;  // 4 mil
+  // Annular ring of pads without a diameter, as a fraction of the drill
+  // limited to a range (in mm), Eagle's default restring.
+  static constexpr double RESTRING_RATIO = 0.25;
+  static constexpr double MIN_RESTRING = 0.254;  // 10 mil
+  static constexpr double MAX_RESTRING = 0.508;  // 20 mil
+  // Maximum angle (in degrees) of the chords approximating an arc.
+  static constexpr double ARC_STEP_DEGREES = 10.0;
+  // Size (in mm) of the spatial index cells used to find the copper
+  // near a pour, or near other copper when checking clearances.
+  static constexpr double CLEARANCE_GRID_CELL = 2.54;
+  // Slack (in mm) for rounding when checking clearances.
+  static constexpr double CLEARANCE_TOLERANCE = 1e-6;
+  static const TransitionTable TRANSITIONS;
+
+  // Data members
+
+  LocatorManager *locator_;
+
+  // Per element scratch buffers, see startElement.
+  string elementName_;
+  AttributeBuffer attributes_;
+  string characters_;
+  CapacityCounter<AllocationStatistics::ATTRIBUTE_TAG> scratchCounter_;
+  ModelWriter *recorder_;
+  bool isRecordingOnly_;
+  vector<Context> sectionContexts_;
+  const MemoryBudget *memoryBudget_;
+  SpillFile *spillFile_;
+  RequestLimits *limits_;
+
+  CountMap elementCounts_;
+  // CountMap layerCounts_;
+  StringMap layerNames_;
+
+  Grid grid_;
+  DesignRules designRules_;
+  Board board_;
+  PackageIndex packageIndex_;  // NOTE: owns the packages.
+  PackageKeySet replacedPackages_;
+  vector<Signal *> signals_;
+  unordered_map<string, size_t> signalIndex_;
+  vector<Element *> elements_;
+
+  // Transitions taken by the enclosing elements, innermost last.
+  vector<const Transition *> contexts_;
+  vector<NestingError> nestingErrors_;
+
+  bool isReplacing_;
+  bool isIncludingTextExtents_;
+  TextMetricsTable textMetrics_;
+
+  // Current variables used when definitions cross multiple elements.
+  Text *currentText_;
+  Package *currentPackage_;
+  string currentLibraryName_;
+  Signal *currentSignal_;
+  Polygon *currentPolygon_;
+  Element *currentElement_;
+};
+
+/**
+ * Output the layout file elements which precede the board contents,
+ * including the grid of the parsed board.
+ */
+void
+printHeader(ostream &strm,
+            const SAXHandler &handler);
+
+/**
+ * Apply the parser configuration shared by all conversions.
+ */
+void
+configureParser(SAXParser &parser);
+
+/**
+ * Print the layout of a parsed board, snapped to the grid first if
+ * options ask for it, with warnings going to log.  This and
+ * checkBoard() are what convertBoard() does with the board once it is
+ * parsed; the command line and --serve parse boards their own ways
+ * but convert them through the same steps.
+ */
+void
+printLayout(ostream &strm,
+            SAXHandler &handler,
+            const ConversionOptions &options,
+            ostream &log);
+
+/**
+ * Run the checks options ask for on a parsed board, reporting to log
+ * and counting what they find in statistics.
+ */
+void
+checkBoard(const SAXHandler &handler,
+           const ConversionOptions &options,
+           ostream &log,
+           ConversionStatistics &statistics);
+
+}
+
+#endif
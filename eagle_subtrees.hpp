@@ -0,0 +1,425 @@
+// Location and content hashes of the independently convertible subtrees
+// of an Eagle board file.
+// Copyright 2014 by Brian Davis.
+
+#ifndef eagle_subtrees_HEADER
+#define eagle_subtrees_HEADER
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace jrl
+{
+
+/**
+ * Incremental 64 bit FNV-1a hash.
+ */
+class ContentHash
+{
+public:
+
+  // Constructors/destructors
+
+  ContentHash()
+    : hash_(OFFSET_BASIS)
+  {
+  }
+
+  // Member functions
+
+  void
+  update(const char *bytes,
+         const std::size_t length)
+  {
+    for (std::size_t index = 0; index < length; ++index) {
+      hash_ ^= static_cast<unsigned char>(bytes[index]);
+      hash_ *= PRIME;
+    }
+  }
+
+  std::uint64_t
+  get() const
+  {
+    return hash_;
+  }
+
+private:
+
+  // Constants
+
+  static const std::uint64_t OFFSET_BASIS = 14695981039346656037ULL;
+  static const std::uint64_t PRIME = 1099511628211ULL;
+
+  // Data members
+
+  std::uint64_t hash_;
+};
+
+/**
+ * Byte range and content hash of one subtree of an Eagle board file.
+ *
+ * NOTE: names are kept exactly as written in the file (i.e. with any
+ * entity references unexpanded), they are only used to match subtrees
+ * between revisions of the same file.
+ */
+class Subtree
+{
+public:
+
+  // Types
+
+  enum Kind {
+    PLAIN,
+    LIBRARY,
+    PACKAGE,
+    ELEMENTS,
+    SIGNAL
+  };
+
+  // Constructors/destructors
+
+  Subtree(const Kind kind,
+          const std::size_t begin)
+    : kind_(kind), begin_(begin), contentBegin_(begin), end_(begin),
+      hash_(0), library_(-1)
+  {
+  }
+
+  // Member functions
+
+  Kind
+  getKind() const
+  {
+    return kind_;
+  }
+
+  /**
+   * Offset of the start tag.
+   */
+  std::size_t
+  getBegin() const
+  {
+    return begin_;
+  }
+
+  /**
+   * Offset just past the start tag.
+   */
+  std::size_t
+  getContentBegin() const
+  {
+    return contentBegin_;
+  }
+
+  /**
+   * Offset just past the end tag.
+   */
+  std::size_t
+  getEnd() const
+  {
+    return end_;
+  }
+
+  const std::string &
+  getName() const
+  {
+    return name_;
+  }
+
+  /**
+   * Content hash; for a library this covers everything except its
+   * packages, which are hashed separately.
+   */
+  std::uint64_t
+  getHash() const
+  {
+    return hash_;
+  }
+
+  /**
+   * Index of the enclosing library subtree (packages only, otherwise
+   * negative).
+   */
+  int
+  getLibrary() const
+  {
+    return library_;
+  }
+
+  /**
+   * Unique key used to match subtrees between revisions of a file.
+   */
+  std::string
+  getKey(const std::vector<Subtree> &subtrees) const
+  {
+    std::string key(1, static_cast<char>('0' + kind_));
+    if (0 <= library_) {
+      key += subtrees[library_].getName();
+      key += '\0';
+    }
+    key += name_;
+    return key;
+  }
+
+private:
+
+  // Friends
+
+  friend class SubtreeScanner;
+
+  // Data members
+
+  Kind kind_;
+  std::size_t begin_;
+  std::size_t contentBegin_;
+  std::size_t end_;
+  std::uint64_t hash_;
+  int library_;
+  std::string name_;
+};
+
+/**
+ * Lightweight scan of the markup of an Eagle board file which locates
+ * the <plain>, <library>, <package>, <elements> and <signal> subtrees
+ * and hashes their content without parsing it.  Everything outside of
+ * those subtrees (layers, design rules, etc.) is covered by a single
+ * remainder hash.
+ */
+class SubtreeScanner
+{
+public:
+
+  // Constructors/destructors
+
+  SubtreeScanner()
+    : remainderHash_(0)
+  {
+  }
+
+  // Member functions
+
+  /**
+   * Scan a complete document, returns false if the markup is not
+   * structured as expected.
+   */
+  bool
+  scan(const char * const document,
+       const std::size_t length)
+  {
+    subtrees_.clear();
+    ContentHash remainder;
+    ContentHash library;
+    int currentLibrary = -1;
+    int current = -1;
+    std::size_t gapStart = 0;
+    std::size_t pos = 0;
+    while (pos < length) {
+      const char *next =
+        static_cast<const char *>(memchr(document + pos, '<', length - pos));
+      if (NULL == next) {
+        break;
+      }
+      const std::size_t tagStart = next - document;
+      const std::size_t tagEnd = findTagEnd(document, length, tagStart);
+      if (std::string::npos == tagEnd) {
+        return false;
+      }
+      pos = tagEnd;
+      const bool isClose = ('/' == document[tagStart + 1]);
+      const std::size_t nameStart = tagStart + (isClose ? 2 : 1);
+      Subtree::Kind kind;
+      if (!tryGetKind(document, tagEnd, nameStart, kind)) {
+        continue;
+      }
+      const bool isSelfClosing = ('/' == document[tagEnd - 2]);
+      const bool isLibrary = (Subtree::LIBRARY == kind);
+      if (!isClose) {
+        if (isLibrary ? (0 <= currentLibrary) : (0 <= current)) {
+          return false;
+        }
+        if ((Subtree::PACKAGE == kind) != (0 <= currentLibrary)) {
+          // Packages only matter inside of a library.
+          continue;
+        }
+        Subtree subtree(kind, tagStart);
+        subtree.contentBegin_ = tagEnd;
+        subtree.name_ = getName(document, tagStart, tagEnd);
+        subtree.library_ = isLibrary ? -1 : currentLibrary;
+        subtrees_.push_back(subtree);
+        if (isLibrary) {
+          currentLibrary = subtrees_.size() - 1;
+          library = ContentHash();
+          // NOTE: library content outside of its packages is hashed
+          // both as part of the library and as part of the remainder.
+          remainder.update(document + gapStart, tagStart - gapStart);
+          gapStart = tagStart;
+        }
+        else {
+          current = subtrees_.size() - 1;
+          flushGap(document, gapStart, tagStart, remainder,
+                   (0 <= currentLibrary) ? &library : NULL);
+        }
+        if (!isSelfClosing) {
+          continue;
+        }
+      }
+      if (isLibrary) {
+        if (0 > currentLibrary) {
+          return false;
+        }
+        flushGap(document, gapStart, tagEnd, remainder, &library);
+        subtrees_[currentLibrary].end_ = tagEnd;
+        subtrees_[currentLibrary].hash_ = library.get();
+        currentLibrary = -1;
+      }
+      else if ((0 <= current) && (kind == subtrees_[current].kind_)) {
+        Subtree &subtree = subtrees_[current];
+        subtree.end_ = tagEnd;
+        ContentHash hash;
+        hash.update(document + subtree.begin_, tagEnd - subtree.begin_);
+        subtree.hash_ = hash.get();
+        gapStart = tagEnd;
+        current = -1;
+      }
+    }
+    if ((0 <= current) || (0 <= currentLibrary)) {
+      return false;
+    }
+    remainder.update(document + gapStart, length - gapStart);
+    remainderHash_ = remainder.get();
+    return true;
+  }
+
+  const std::vector<Subtree> &
+  getSubtrees() const
+  {
+    return subtrees_;
+  }
+
+  std::uint64_t
+  getRemainderHash() const
+  {
+    return remainderHash_;
+  }
+
+private:
+
+  // Member functions
+
+  /**
+   * Offset just past the '>' ending the markup which starts at
+   * tagStart, or npos if it is not terminated.
+   */
+  static std::size_t
+  findTagEnd(const char * const document,
+             const std::size_t length,
+             const std::size_t tagStart)
+  {
+    const char *terminator = ">";
+    if (0 == strncmp(document + tagStart, "<!--", 4)) {
+      terminator = "-->";
+    }
+    else if (0 == strncmp(document + tagStart, "<![CDATA[", 9)) {
+      terminator = "]]>";
+    }
+    else if ('?' == document[tagStart + 1]) {
+      terminator = "?>";
+    }
+    const std::size_t terminatorLength = strlen(terminator);
+    char quote = '\0';
+    for (std::size_t pos = tagStart + 1; pos < length; ++pos) {
+      const char current = document[pos];
+      if ('\0' != quote) {
+        if (current == quote) {
+          quote = '\0';
+        }
+      }
+      else if ((1 == terminatorLength) && (('"' == current) || ('\'' == current))) {
+        quote = current;
+      }
+      else if ((current == terminator[0]) &&
+               (pos + terminatorLength <= length) &&
+               (0 == strncmp(document + pos, terminator, terminatorLength))) {
+        return pos + terminatorLength;
+      }
+    }
+    return std::string::npos;
+  }
+
+  static bool
+  tryGetKind(const char * const document,
+             const std::size_t tagEnd,
+             const std::size_t nameStart,
+             Subtree::Kind &kind)
+  {
+    static const struct {
+      const char *name;
+      Subtree::Kind kind;
+    } NAMES[] = {
+      { "plain", Subtree::PLAIN },
+      { "library", Subtree::LIBRARY },
+      { "package", Subtree::PACKAGE },
+      { "elements", Subtree::ELEMENTS },
+      { "signal", Subtree::SIGNAL }
+    };
+    for (std::size_t index = 0; index < sizeof(NAMES) / sizeof(NAMES[0]); ++index) {
+      const std::size_t nameLength = strlen(NAMES[index].name);
+      if ((nameStart + nameLength < tagEnd) &&
+          (0 == strncmp(document + nameStart, NAMES[index].name, nameLength)) &&
+          (NULL != strchr(" \t\r\n/>", document[nameStart + nameLength]))) {
+        kind = NAMES[index].kind;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static std::string
+  getName(const char * const document,
+          const std::size_t tagStart,
+          const std::size_t tagEnd)
+  {
+    const std::string tag(document + tagStart, tagEnd - tagStart);
+    std::size_t pos = 0;
+    while (std::string::npos != (pos = tag.find("name=", pos))) {
+      const char previous = tag[pos - 1];
+      pos += 5;
+      if ((' ' == previous) || ('\t' == previous) ||
+          ('\r' == previous) || ('\n' == previous)) {
+        const char quote = tag[pos];
+        const std::size_t end = tag.find(quote, pos + 1);
+        if (std::string::npos == end) {
+          break;
+        }
+        return tag.substr(pos + 1, end - pos - 1);
+      }
+    }
+    return std::string();
+  }
+
+  static void
+  flushGap(const char * const document,
+           std::size_t &gapStart,
+           const std::size_t gapEnd,
+           ContentHash &remainder,
+           ContentHash * const library)
+  {
+    remainder.update(document + gapStart, gapEnd - gapStart);
+    if (NULL != library) {
+      library->update(document + gapStart, gapEnd - gapStart);
+    }
+    gapStart = gapEnd;
+  }
+
+  // Data members
+
+  std::vector<Subtree> subtrees_;
+  std::uint64_t remainderHash_;
+};
+
+}
+
+#endif
@@ -0,0 +1,323 @@
+// Rotation/mirror transforms associated with the Eagle 'rot' attribute.
+// Copyright 2014 by Brian Davis.
+
+#ifndef eagle_transform_HEADER
+#define eagle_transform_HEADER
+
+#include <cmath>
+#include <cstdlib>
+#include <cstddef>
+#include <type_traits>
+
+namespace jrl
+{
+
+/**
+ * Rotation by a whole number of quarter turns counterclockwise.  Each
+ * specialization is a swap and/or negation, no trigonometry required.
+ */
+template <unsigned QUARTER_TURNS>
+struct QuarterTurn;
+
+template <>
+struct QuarterTurn<0>
+{
+  template <typename T> static void
+  apply(T &, T &)
+  {
+  }
+};
+
+template <>
+struct QuarterTurn<1>
+{
+  template <typename T> static void
+  apply(T &x, T &y)
+  {
+    const T oldX = x;
+    x = -y;
+    y = oldX;
+  }
+};
+
+template <>
+struct QuarterTurn<2>
+{
+  template <typename T> static void
+  apply(T &x, T &y)
+  {
+    x = -x;
+    y = -y;
+  }
+};
+
+template <>
+struct QuarterTurn<3>
+{
+  template <typename T> static void
+  apply(T &x, T &y)
+  {
+    const T oldX = x;
+    x = y;
+    y = -oldX;
+  }
+};
+
+/**
+ * Orthogonal Eagle transform: optional mirror about the Y axis
+ * followed by a rotation of QUARTER_TURNS * 90 degrees.
+ */
+template <unsigned QUARTER_TURNS, bool IS_MIRRORED>
+struct OrthogonalTransform
+{
+  template <typename T> static void
+  apply(T &x, T &y)
+  {
+    if (IS_MIRRORED) {
+      x = -x;
+    }
+    QuarterTurn<QUARTER_TURNS>::apply(x, y);
+  }
+
+  template <typename T> static void
+  apply(T * const xs, T * const ys, const std::size_t count)
+  {
+    for (std::size_t index = 0; index < count; ++index) {
+      apply(xs[index], ys[index]);
+    }
+  }
+};
+
+/**
+ * Decoded form of the Eagle 'rot' attribute.
+ *
+ * Eagle writes rotations as [M][S]R<degrees>, e.g. "R90", "MR180" or
+ * "SR45".  'M' mirrors the object (i.e. places it on the opposite side
+ * of the board) and 'S' spins text so that it is not kept upright.
+ * Geometry is mirrored about the Y axis first and then rotated
+ * counterclockwise by the angle.
+ */
+class Rotation
+{
+public:
+
+  // Types
+
+  // Orthogonal orientations are encoded as the number of quarter turns
+  // plus a mirror bit so that they can be dispatched with a switch.
+  enum Orientation {
+    R0 = 0,
+    R90 = 1,
+    R180 = 2,
+    R270 = 3,
+    MR0 = 4,
+    MR90 = 5,
+    MR180 = 6,
+    MR270 = 7,
+    ARBITRARY = 8
+  };
+
+  // Constructors/destructors
+
+  Rotation()
+    : degrees_(0.0), cos_(1.0), sin_(0.0), orientation_(R0),
+      isMirrored_(false), isSpin_(false)
+  {
+  }
+
+  Rotation(const double degrees,
+           const bool isMirrored,
+           const bool isSpin = false)
+    : degrees_(0.0), cos_(1.0), sin_(0.0), orientation_(R0),
+      isMirrored_(isMirrored), isSpin_(isSpin)
+  {
+    setDegrees(degrees);
+  }
+
+  // Member functions
+
+  /**
+   * Parse an Eagle rotation string, returns false (leaving the object
+   * unmodified) if the string is malformed.
+   */
+  bool
+  tryParse(const char *value)
+  {
+    bool isMirrored = false;
+    bool isSpin = false;
+    for (; ('M' == *value) || ('S' == *value); ++value) {
+      if ('M' == *value) {
+        isMirrored = true;
+      }
+      else {
+        isSpin = true;
+      }
+    }
+    if ('R' != *value) {
+      return false;
+    }
+    ++value;
+    char *end = NULL;
+    const double degrees = strtod(value, &end);
+    if ((end == value) || ('\0' != *end)) {
+      return false;
+    }
+    isMirrored_ = isMirrored;
+    isSpin_ = isSpin;
+    setDegrees(degrees);
+    return true;
+  }
+
+  double
+  getDegrees() const
+  {
+    return degrees_;
+  }
+
+  bool
+  isMirrored() const
+  {
+    return isMirrored_;
+  }
+
+  bool
+  isSpin() const
+  {
+    return isSpin_;
+  }
+
+  Orientation
+  getOrientation() const
+  {
+    return orientation_;
+  }
+
+  bool
+  isOrthogonal() const
+  {
+    return ARBITRARY != orientation_;
+  }
+
+  /**
+   * Transform a single point in place.
+   */
+  template <typename T> void
+  apply(T &x, T &y) const
+  {
+    apply(&x, &y, 1);
+  }
+
+  /**
+   * Transform count points in place.  The orientation is dispatched
+   * once, so orthogonal transforms of large batches reduce to a loop of
+   * swaps and negations.
+   */
+  template <typename T> void
+  apply(T * const xs, T * const ys, const std::size_t count) const
+  {
+    switch (orientation_) {
+    case R0:
+      break;
+    case R90:
+      OrthogonalTransform<1, false>::apply(xs, ys, count);
+      break;
+    case R180:
+      OrthogonalTransform<2, false>::apply(xs, ys, count);
+      break;
+    case R270:
+      OrthogonalTransform<3, false>::apply(xs, ys, count);
+      break;
+    case MR0:
+      OrthogonalTransform<0, true>::apply(xs, ys, count);
+      break;
+    case MR90:
+      OrthogonalTransform<1, true>::apply(xs, ys, count);
+      break;
+    case MR180:
+      OrthogonalTransform<2, true>::apply(xs, ys, count);
+      break;
+    case MR270:
+      OrthogonalTransform<3, true>::apply(xs, ys, count);
+      break;
+    case ARBITRARY:
+      applyMatrix(xs, ys, count);
+      break;
+    }
+  }
+
+  /**
+   * Combined transform equivalent to applying inner and then outer.
+   *
+   * NOTE: mirroring reverses the sense of any rotation applied before
+   * it, i.e. M * R(a) == R(-a) * M.
+   */
+  static Rotation
+  compose(const Rotation &outer,
+          const Rotation &inner)
+  {
+    const double degrees = outer.isMirrored_ ?
+      (outer.degrees_ - inner.degrees_) : (outer.degrees_ + inner.degrees_);
+    return Rotation(degrees, outer.isMirrored_ != inner.isMirrored_,
+                    inner.isSpin_);
+  }
+
+private:
+
+  // Member functions
+
+  void
+  setDegrees(const double degrees)
+  {
+    degrees_ = fmod(degrees, 360.0);
+    if (degrees_ < 0.0) {
+      degrees_ += 360.0;
+    }
+    const double quarterTurns = degrees_ / 90.0;
+    if (floor(quarterTurns) == quarterTurns) {
+      // NOTE: 90 degree multiples are exact in binary floating point,
+      // so the comparison above is safe.
+      const unsigned turns = static_cast<unsigned>(quarterTurns) % 4;
+      orientation_ = static_cast<Orientation>(turns | (isMirrored_ ? 4 : 0));
+      cos_ = (0 == turns) ? 1.0 : ((2 == turns) ? -1.0 : 0.0);
+      sin_ = (1 == turns) ? 1.0 : ((3 == turns) ? -1.0 : 0.0);
+    }
+    else {
+      orientation_ = ARBITRARY;
+      const double radians = degrees_ * M_PI / 180.0;
+      cos_ = cos(radians);
+      sin_ = sin(radians);
+    }
+  }
+
+  template <typename T> static T
+  fromDouble(const double value)
+  {
+    return std::is_integral<T>::value ?
+      static_cast<T>(floor(value + 0.5)) : static_cast<T>(value);
+  }
+
+  template <typename T> void
+  applyMatrix(T * const xs, T * const ys, const std::size_t count) const
+  {
+    const double mirror = isMirrored_ ? -1.0 : 1.0;
+    for (std::size_t index = 0; index < count; ++index) {
+      const double x = mirror * xs[index];
+      const double y = ys[index];
+      xs[index] = fromDouble<T>((cos_ * x) - (sin_ * y));
+      ys[index] = fromDouble<T>((sin_ * x) + (cos_ * y));
+    }
+  }
+
+  // Data members
+
+  double degrees_;  // Normalized to [0, 360)
+  double cos_;
+  double sin_;
+  Orientation orientation_;
+  bool isMirrored_;
+  bool isSpin_;
+};
+
+}
+
+#endif
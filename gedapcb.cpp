@@ -1,7 +1,24 @@
 // Implementations associated with gEDA pcb board file format.
 // Copyright 2014 by Brian Davis
 
+// Standard C library includes
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+// STL includes
 #include <iostream>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Boost includes
+#include <boost/units/io.hpp>
+#include <boost/units/systems/si.hpp>
+#include <boost/units/base_units/us/mil.hpp>
+
+// Local includes
 #include "boost_unit_extras.hpp"
 #include "gedapcb.hpp"
 
@@ -9,55 +26,139 @@ using namespace std;
 using namespace jrl;
 using namespace jrl::geda_pcb;
 
+ostream &
+jrl::operator<<(ostream &strm, const Centimils &length)
+{
+  strm << static_cast<long>(floor(length.value() + 0.5));
+  return strm;
+}
+
 void
-PCB::print(ostream &strm)
+PCB::print(ostream &strm) const
 {
   strm << "PCB[\"" << name_ << "\" "
        << width_ << " " << height_ << "]" << endl;
 }
 
-Layer::~Layer()
+void
+Layer::addLine(Line &&line)
 {
-  for (Iter iter = printables_.begin(); iter != printables_.end(); ++iter) {
-    delete *iter;
+  lines_.push_back(std::move(line));
+}
+
+void
+Layer::addPolygon(Polygon &&polygon)
+{
+  polygons_.push_back(std::move(polygon));
+}
+
+void
+Layer::addText(Text &&text)
+{
+  texts_.push_back(std::move(text));
+}
+
+namespace
+{
+
+/**
+ * Layer visitor which outputs each object on its own line.
+ */
+class LayerPrinter
+{
+public:
+
+  // Constructors/destructors
+
+  explicit LayerPrinter(ostream &strm)
+    : strm_(strm)
+  {
   }
+
+  // Member functions
+
+  template <typename Object> void
+  operator()(const Object &object)
+  {
+    strm_ << "\t";
+    object.print(strm_);
+    strm_ << endl;
+  }
+
+private:
+
+  // Data members
+
+  ostream &strm_;
+};
+
 }
 
 void
-Layer::addElement(Printable *printable)
+Layer::print(ostream &strm) const
 {
-  printables_.push_back(printable);
+  printStart(strm);
+  printObjects(strm);
+  printEnd(strm);
 }
 
 void
-Layer::print(ostream &strm) const;
+Layer::printStart(ostream &strm) const
 {
-  strm << "Layer (" << number_ <<  " \"" << name_ << "\")" << endl
+  strm << "Layer(" << static_cast<unsigned>(number_) <<  " \"" << name_
+       << "\")" << endl
        << "(" << endl;
-  for (Iter iter = printables_.begin(); iter != printables_.end(); ++iter) {
-    strm << "\t" << *iter << endl;
-  }
+}
+
+void
+Layer::printObjects(ostream &strm) const
+{
+  LayerPrinter printer(strm);
+  visit(printer);
+}
+
+void
+Layer::printEnd(ostream &strm) const
+{
   strm << ")" << endl;
 }
 
+void
+Layer::printLines(ostream &strm,
+                  const size_t first,
+                  const size_t last) const
+{
+  assert((first <= last) && (last <= lines_.size()));
+  LayerPrinter printer(strm);
+  for (size_t index = first; index < last; ++index) {
+    printer(lines_[index]);
+  }
+}
+
+void
+Layer::releaseLines()
+{
+  vector<Line>().swap(lines_);
+}
+
 ostream &
-operator<<(ostream &strm, const Layer &layer)
+geda_pcb::operator<<(ostream &strm, const Layer &layer)
 {
   layer.print(strm);
   return strm;
 }
 
 void
-HasLineValues::printLinePortion(ostream &strm)
+HasLineValues::printLinePortion(ostream &strm) const
 {
-  strm << " \"" << thickness_ << "\""
-       << " \"" << clearance_ << "\"";
+  strm << " " << thickness_
+       << " " << clearance_;
 }
 
 void
-HasEndpoints::printEndPoints(ostream &strm)
+HasEndpoints::printEndPoints(ostream &strm) const
 {
-  strm << " " << rX1_
+  strm << rX1_
        << " " << rY1_
        << " " << rX2_
        << " " << rY2_;
@@ -69,7 +170,7 @@ Line::print(ostream &strm) const
   strm << "Line[";
   HasEndpoints::printEndPoints(strm);
   HasLineValues::printLinePortion(strm);
-  strm << " " << flags_
+  strm << " \"" << flags_ << "\""
        << "]";
 }
 
@@ -85,7 +186,7 @@ PadOrPin::print2(ostream &strm) const
 {
   strm << " \"" << name_ << "\""
        << " \"" << number_ << "\""
-       << " " << flags_;
+       << " \"" << flags_ << "\"";
 }
 
 void
@@ -93,8 +194,8 @@ Pad::print(ostream &strm) const
 {
   strm << "Pad["
        << rX1_
-       << " " << rY1_;
-       << " " << rX2_;
+       << " " << rY1_
+       << " " << rX2_
        << " " << rY2_;
   PadOrPin::print1(strm);
   PadOrPin::print2(strm);
@@ -113,23 +214,251 @@ Pin::print(ostream &strm) const
   strm << "]";
 }
 
+void
+Via::print(ostream &strm) const
+{
+  strm << "Via["
+       << x_
+       << " " << y_;
+  HasLineValues::printLinePortion(strm);
+  strm << " " << mask_
+       << " " << drill_
+       << " \"" << name_ << "\""
+       << " \"" << flags_ << "\""
+       << "]";
+}
+
 ostream &
-operator<<(ostream &strm, const Line &line)
+geda_pcb::operator<<(ostream &strm, const Line &line)
 {
   line.print(strm);
   return strm;
 }
 
+void
+Polygon::addPoint(const Centimils &x,
+                  const Centimils &y)
+{
+  points_.push_back(make_pair(x, y));
+}
+
+void
+Polygon::addHole()
+{
+  holes_.push_back(Points());
+}
+
+void
+Polygon::addHolePoint(const Centimils &x,
+                      const Centimils &y)
+{
+  assert(!holes_.empty());
+  holes_.back().push_back(make_pair(x, y));
+}
+
+void
+Polygon::printPoints(ostream &strm,
+                     const Points &points,
+                     const char *indent)
+{
+  static const size_t POINTS_PER_LINE = 4;
+  for (size_t index = 0; index < points.size(); ++index) {
+    if (0 == (index % POINTS_PER_LINE)) {
+      if (0 != index) {
+        strm << endl;
+      }
+      strm << indent;
+    }
+    else {
+      strm << " ";
+    }
+    strm << "[" << points[index].first << " " << points[index].second << "]";
+  }
+  strm << endl;
+}
+
+void
+Polygon::print(ostream &strm) const
+{
+  strm << "Polygon(\"" << flags_ << "\")" << endl
+       << "\t(" << endl;
+  printPoints(strm, points_, "\t\t");
+  for (vector<Points>::const_iterator hole = holes_.begin();
+       hole != holes_.end(); ++hole) {
+    strm << "\t\tHole (" << endl;
+    printPoints(strm, *hole, "\t\t\t");
+    strm << "\t\t)" << endl;
+  }
+  strm << "\t)";
+}
+
 ostream &
-operator<<(ostream &strm, const Pad &pad)
+geda_pcb::operator<<(ostream &strm, const Polygon &polygon)
+{
+  polygon.print(strm);
+  return strm;
+}
+
+void
+Text::print(ostream &strm) const
+{
+  strm << "Text["
+       << x_
+       << " " << y_
+       << " " << static_cast<unsigned>(direction_)
+       << " " << scale_
+       << " \"";
+  // NOTE: pcb reads a backslash as escaping the next character.
+  for (string::const_iterator iter = string_.begin();
+       iter != string_.end(); ++iter) {
+    if (('"' == *iter) || ('\\' == *iter)) {
+      strm << '\\';
+    }
+    strm << *iter;
+  }
+  strm << "\" \"" << flags_ << "\"]";
+}
+
+ostream &
+geda_pcb::operator<<(ostream &strm, const Text &text)
+{
+  text.print(strm);
+  return strm;
+}
+
+ostream &
+geda_pcb::operator<<(ostream &strm, const Pad &pad)
 {
   pad.print(strm);
   return strm;
 }
 
 ostream &
-operator<<(ostream &strm, const Pin &pin)
+geda_pcb::operator<<(ostream &strm, const Pin &pin)
 {
   pin.print(strm);
   return strm;
 }
+
+ostream &
+geda_pcb::operator<<(ostream &strm, const Via &via)
+{
+  via.print(strm);
+  return strm;
+}
+
+void
+ElementLine::print(ostream &strm) const
+{
+  strm << "ElementLine[";
+  HasEndpoints::printEndPoints(strm);
+  strm << " " << thickness_
+       << "]";
+}
+
+void
+ElementArc::print(ostream &strm) const
+{
+  strm << "ElementArc["
+       << rX_
+       << " " << rY_
+       << " " << width_
+       << " " << height_
+       << " " << startAngle_
+       << " " << deltaAngle_
+       << " " << thickness_
+       << "]";
+}
+
+Element::~Element()
+{
+  for (Iter iter = printables_.begin(); iter != printables_.end(); ++iter) {
+    delete *iter;
+  }
+}
+
+void
+Element::addElement(Printable *printable)
+{
+  printables_.push_back(printable);
+}
+
+void
+Element::print(ostream &strm) const
+{
+  strm << "Element["
+       << "\"" << flags_ << "\""
+       << " \"" << description_ << "\""
+       << " \"" << name_ << "\""
+       << " \"" << value_ << "\""
+       << " " << mX_
+       << " " << mY_
+       << " " << tX_
+       << " " << tY_
+       << " " << static_cast<unsigned>(tDir_)
+       << " " << tScale_
+       << " \"" << tFlags_ << "\""
+       << "]" << endl
+       << "(" << endl;
+  for (Iter iter = printables_.begin(); iter != printables_.end(); ++iter) {
+    strm << "\t";
+    (*iter)->print(strm);
+    strm << endl;
+  }
+  strm << ")" << endl;
+}
+
+ostream &
+geda_pcb::operator<<(ostream &strm, const Element &element)
+{
+  element.print(strm);
+  return strm;
+}
+
+void
+Net::addConnection(const string &connection)
+{
+  connections_.push_back(connection);
+}
+
+void
+Net::print(ostream &strm) const
+{
+  strm << "\tNet(\"" << name_ << "\" \"" << style_ << "\")" << endl
+       << "\t(" << endl;
+  for (Iter iter = connections_.begin(); iter != connections_.end(); ++iter) {
+    strm << "\t\tConnect(\"" << *iter << "\")" << endl;
+  }
+  strm << "\t)" << endl;
+}
+
+NetList::~NetList()
+{
+  for (Iter iter = nets_.begin(); iter != nets_.end(); ++iter) {
+    delete *iter;
+  }
+}
+
+void
+NetList::addNet(Net *net)
+{
+  nets_.push_back(net);
+}
+
+void
+NetList::print(ostream &strm) const
+{
+  strm << "NetList()" << endl
+       << "(" << endl;
+  for (Iter iter = nets_.begin(); iter != nets_.end(); ++iter) {
+    (*iter)->print(strm);
+  }
+  strm << ")" << endl;
+}
+
+ostream &
+geda_pcb::operator<<(ostream &strm, const NetList &netList)
+{
+  netList.print(strm);
+  return strm;
+}
@@ -1,8 +1,18 @@
 // Class definitions associated with gEDA pcb board file format.
 // Copyright 2014 by Brian Davis
 
+#ifndef gedapcb_HEADER
+#define gedapcb_HEADER
+
 namespace jrl
 {
+
+// Lengths in the bracketed gEDA pcb record formats are integral
+// centimils without a unit suffix, so this overrides the boost::units
+// output operator for Centimils.
+std::ostream &
+operator<<(std::ostream &strm, const Centimils &length);
+
 namespace geda_pcb
 {
 
@@ -10,10 +20,17 @@ class Printable
 {
 public:
 
+  // Constructors/destructors
+
+  virtual
+  ~Printable()
+  {
+  }
+
   // Member functions
 
   virtual void
-  print(std::ostream &strm) const;
+  print(std::ostream &strm) const = 0;
 };
 
 class PCB : public Printable
@@ -48,55 +65,13 @@ private:
   const Centimils &height_;
 };
 
-std::ostream &
+inline std::ostream &
 operator<<(std::ostream &strm, const PCB &pcb)
 {
   pcb.print(strm);
   return strm;
 }
 
-class Layer
-{
-public:
-
-  // Constructors/destructors
-
-  Layer(const std::uint8_t number,
-	const std::string &name)
-    : number_(number), name_(name)
-  {
-  }
-
-  ~Layer();
-
-  // Member functions
-
-  // TODO: error checking, probably need a class interposed between
-  // Printable and Layer to cover the class that are legal to add to a
-  // layer.
-  void
-  addElement(Printable *printable);
-
-  void
-  print(std::ostream &strm) const;
-
-private:
-
-  // Types
-
-  typedef std::list<Printable *> Printables;
-  typedef std::list<Printable *>::const_iterator Iter;
-
-  // Data members
-
-  const std::uint8_t number_;
-  const std::string name_;
-  Printables printables_;
-};
-
-std::ostream &
-operator<<(std::ostream &strm, const Layer &layer);
-
 class HasLineValues
 {
 protected:
@@ -174,6 +149,8 @@ public:
   {
   }
 
+  Line(Line &&) = default;
+
   ~Line()
   {
   }
@@ -191,6 +168,226 @@ private:
   const std::string flags_;  // Symbolic or numerical flags.
 };
 
+std::ostream &
+operator<<(std::ostream &strm, const Line &line);
+
+class Polygon : public Printable
+{
+public:
+
+  // Constructors/destructors
+
+  Polygon(const std::string &flags)
+    : flags_(flags)
+  {
+  }
+
+  Polygon(Polygon &&) = default;
+
+  ~Polygon()
+  {
+  }
+
+  // Member functions
+
+  void
+  addPoint(const Centimils &x,
+           const Centimils &y);
+
+  // NOTE: subsequent calls to addHolePoint() add to the new hole.
+  void
+  addHole();
+
+  void
+  addHolePoint(const Centimils &x,
+               const Centimils &y);
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Types
+
+  typedef std::vector<std::pair<Centimils, Centimils> > Points;
+
+  // Member functions
+
+  static void
+  printPoints(std::ostream &strm,
+              const Points &points,
+              const char *indent);
+
+  // Data members
+
+  // NOTE: documentary comments are taken from gEDA pcb manual.
+  const std::string flags_;  // Symbolic or numerical flags.
+  Points points_;  // Vertices of the polygon, in absolute coordinates.
+  std::vector<Points> holes_;  // Areas within the polygon which are
+                               // not filled.
+};
+
+std::ostream &
+operator<<(std::ostream &strm, const Polygon &polygon);
+
+class Text : public Printable
+{
+public:
+
+  // Constructors/destructors
+
+  Text(const Centimils &x,
+       const Centimils &y,
+       const std::uint8_t direction,
+       const unsigned scale,
+       const std::string &string,
+       const std::string &flags)
+    : x_(x), y_(y), direction_(direction), scale_(scale), string_(string),
+      flags_(flags)
+  {
+  }
+
+  Text(Text &&) = default;
+
+  ~Text()
+  {
+  }
+
+  // Member functions
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Data members
+
+  // NOTE: documentary comments are taken from gEDA pcb manual.
+  const Centimils x_;  // Location of the upper left corner of the text.
+  const Centimils y_;
+  const std::uint8_t direction_;  // 0 means text is drawn left to right,
+                                  // 1 means up, 2 means right to left
+                                  // (i.e. upside down), and 3 means
+                                  // down.
+  const unsigned scale_;  // Size of the text, as a percentage of the
+                          // "default" size of the font.
+  const std::string string_;  // The string to draw.
+  const std::string flags_;  // Symbolic or numerical flags.
+};
+
+std::ostream &
+operator<<(std::ostream &strm, const Text &text);
+
+/**
+ * Contents of a gEDA pcb layer, kept by type in contiguous vectors and
+ * output in the order pcb itself writes them (lines, text, then
+ * polygons).
+ * Objects are moved into the layer, which owns them.
+ */
+class Layer
+{
+public:
+
+  // Constructors/destructors
+
+  Layer(const std::uint8_t number,
+	const std::string &name)
+    : number_(number), name_(name)
+  {
+  }
+
+  Layer(Layer &&) = default;
+
+  Layer(const Layer &) = delete;
+
+  Layer &
+  operator=(const Layer &) = delete;
+
+  // Member functions
+
+  void
+  addLine(Line &&line);
+
+  void
+  addPolygon(Polygon &&polygon);
+
+  void
+  addText(Text &&text);
+
+  /** Number of lines held by the layer. */
+  std::size_t
+  getLineCount() const
+  {
+    return lines_.size();
+  }
+
+  /**
+   * Output lines [first, last) only, e.g. to hold them elsewhere before
+   * dropping them with releaseLines().
+   */
+  void
+  printLines(std::ostream &strm,
+             const std::size_t first,
+             const std::size_t last) const;
+
+  /**
+   * Drop the lines and free their memory.
+   */
+  void
+  releaseLines();
+
+  /**
+   * Call visitor(object) for every object of the layer, in output
+   * order.
+   */
+  template <typename Visitor> void
+  visit(Visitor &visitor) const
+  {
+    for (std::vector<Line>::const_iterator line = lines_.begin();
+         line != lines_.end(); ++line) {
+      visitor(*line);
+    }
+    for (std::vector<Text>::const_iterator text = texts_.begin();
+         text != texts_.end(); ++text) {
+      visitor(*text);
+    }
+    for (std::vector<Polygon>::const_iterator polygon = polygons_.begin();
+         polygon != polygons_.end(); ++polygon) {
+      visitor(*polygon);
+    }
+  }
+
+  void
+  print(std::ostream &strm) const;
+
+  /**
+   * Output the layer in parts, with the objects themselves (or lines
+   * held elsewhere) in between: print() is printStart() followed by
+   * the objects and printEnd().
+   */
+  void
+  printStart(std::ostream &strm) const;
+
+  void
+  printObjects(std::ostream &strm) const;
+
+  void
+  printEnd(std::ostream &strm) const;
+
+private:
+
+  // Data members
+
+  const std::uint8_t number_;
+  const std::string name_;
+  std::vector<Line> lines_;
+  std::vector<Text> texts_;
+  std::vector<Polygon> polygons_;
+};
+
+std::ostream &
+operator<<(std::ostream &strm, const Layer &layer);
+
 class PadOrPin : protected HasLineValues
 {
 protected:
@@ -200,7 +397,7 @@ protected:
   PadOrPin(const Centimils &thickness,
 	   const Centimils &clearance,
 	   const Centimils &mask,const std::string &name,
-	   const std::uint16_t number,
+	   const std::string &number,
 	   const std::string &flags)
     : HasLineValues(thickness, clearance), mask_(mask), name_(name),
       number_(number), flags_(flags)
@@ -224,7 +421,7 @@ protected:
   // NOTE: documentary comments are taken from gEDA pcb manual.
   const Centimils mask_;  // Diameter of solder mask opening.
   const std::string name_;  // Name of pin.
-  const std::uint16_t number_;  // Number of pin.
+  const std::string number_;  // Number of pin.
   const std::string flags_;  // Symbolic or numerical flags.
 };
 
@@ -242,7 +439,7 @@ public:
       const Centimils &clearance,
       const Centimils &mask,
       const std::string &name,
-      const std::uint16_t number,
+      const std::string &number,
       const std::string &flags)
     : PadOrPin(thickness, clearance, mask, name, number, flags),
       rX1_(rX1), rY1_(rY1), rX2_(rX2), rY2_(rY2)
@@ -282,7 +479,7 @@ public:
       const Centimils &mask,
       const Centimils &drill,
       const std::string &name,
-      const std::uint16_t number,
+      const std::string &number,
       const std::string &flags)
     : PadOrPin(thickness, clearance, mask, name, number, flags),
       rX_(rX), rY_(rY), drill_(drill)
@@ -310,5 +507,272 @@ private:
 std::ostream&
 operator<<(std::ostream &strm, const Pin &pin);
 
+class Via : public Printable, private HasLineValues
+{
+public:
+
+  // Constructors/destructors
+
+  Via(const Centimils &x,
+      const Centimils &y,
+      const Centimils &thickness,
+      const Centimils &clearance,
+      const Centimils &mask,
+      const Centimils &drill,
+      const std::string &name,
+      const std::string &flags)
+    : HasLineValues(thickness, clearance), x_(x), y_(y), mask_(mask),
+      drill_(drill), name_(name), flags_(flags)
+  {
+  }
+
+  ~Via()
+  {
+  }
+
+  // Member functions
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Data members
+
+  // NOTE: documentary comments are taken from gEDA pcb manual.
+  const Centimils x_;  // Coordinates of center.
+  const Centimils y_;
+  const Centimils mask_;  // Diameter of solder mask opening.
+  const Centimils drill_;  // Diameter of drill.
+  const std::string name_;  // Name of via.
+  const std::string flags_;  // Symbolic or numerical flags.
+};
+
+std::ostream&
+operator<<(std::ostream &strm, const Via &via);
+
+class ElementLine : public Printable, private HasEndpoints
+{
+public:
+
+  // Constructors/destructors
+
+  ElementLine(const Centimils &rX1,
+              const Centimils &rY1,
+              const Centimils &rX2,
+              const Centimils &rY2,
+              const Centimils &thickness)
+    : HasEndpoints(rX1, rY1, rX2, rY2), thickness_(thickness)
+  {
+  }
+
+  ~ElementLine()
+  {
+  }
+
+  // Member functions
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Data members
+
+  // NOTE: documentary comments are taken from gEDA pcb manual.
+  const Centimils thickness_;  // Width of the silk for this line.
+};
+
+class ElementArc : public Printable
+{
+public:
+
+  // Constructors/destructors
+
+  ElementArc(const Centimils &rX,
+             const Centimils &rY,
+             const Centimils &width,
+             const Centimils &height,
+             const int startAngle,
+             const int deltaAngle,
+             const Centimils &thickness)
+    : rX_(rX), rY_(rY), width_(width), height_(height),
+      startAngle_(startAngle), deltaAngle_(deltaAngle),
+      thickness_(thickness)
+  {
+  }
+
+  ~ElementArc()
+  {
+  }
+
+  // Member functions
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Data members
+
+  // NOTE: documentary comments are taken from gEDA pcb manual.
+  const Centimils rX_;  // Center of the arc, relative to the element's
+                        // mark.
+  const Centimils rY_;
+  const Centimils width_;  // The width and height, from the center to
+                           // the edge.
+  const Centimils height_;
+  const int startAngle_;  // The angle of one end of the arc, in
+                          // degrees.
+  const int deltaAngle_;  // The sweep of the arc, in degrees.
+  const Centimils thickness_;  // The width of the silk line which
+                               // forms the arc.
+};
+
+class Element : public Printable
+{
+public:
+
+  // Constructors/destructors
+
+  Element(const std::string &flags,
+          const std::string &description,
+          const std::string &name,
+          const std::string &value,
+          const Centimils &mX,
+          const Centimils &mY,
+          const Centimils &tX,
+          const Centimils &tY,
+          const std::uint8_t tDir,
+          const unsigned tScale,
+          const std::string &tFlags)
+    : flags_(flags), description_(description), name_(name),
+      value_(value), mX_(mX), mY_(mY), tX_(tX), tY_(tY), tDir_(tDir),
+      tScale_(tScale), tFlags_(tFlags)
+  {
+  }
+
+  ~Element();
+
+  // Member functions
+
+  // NOTE: takes ownership of the element contents (pins, pads and
+  // silk).
+  void
+  addElement(Printable *printable);
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Types
+
+  typedef std::list<Printable *> Printables;
+  typedef std::list<Printable *>::const_iterator Iter;
+
+  // Data members
+
+  // NOTE: documentary comments are taken from gEDA pcb manual.
+  const std::string flags_;  // Symbolic or numeric flags, for the
+                             // element as a whole.
+  const std::string description_;  // The description of the element.
+  const std::string name_;  // The name of the element, usually the
+                            // reference designator.
+  const std::string value_;  // The value of the element.
+  const Centimils mX_;  // The location of the element's mark.
+  const Centimils mY_;
+  const Centimils tX_;  // The location of the name of the element,
+                        // relative to the mark.
+  const Centimils tY_;
+  const std::uint8_t tDir_;  // The rotation of the name, 0 means
+                             // "horizontal".
+  const unsigned tScale_;  // The scale of the name, 100 means "default".
+  const std::string tFlags_;  // Flags controlling the name.
+  Printables printables_;
+};
+
+std::ostream &
+operator<<(std::ostream &strm, const Element &element);
+
+class Net : public Printable
+{
+public:
+
+  // Constructors/destructors
+
+  Net(const std::string &name,
+      const std::string &style)
+    : name_(name), style_(style)
+  {
+  }
+
+  ~Net()
+  {
+  }
+
+  // Member functions
+
+  // NOTE: connections are of the form "refdes-pinnumber".
+  void
+  addConnection(const std::string &connection);
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Types
+
+  typedef std::list<std::string> Connections;
+  typedef std::list<std::string>::const_iterator Iter;
+
+  // Data members
+
+  // NOTE: documentary comments are taken from gEDA pcb manual.
+  const std::string name_;  // The name of this net.
+  const std::string style_;  // The routing style that should be used
+                             // when autorouting this net.
+  Connections connections_;
+};
+
+class NetList : public Printable
+{
+public:
+
+  // Constructors/destructors
+
+  NetList()
+  {
+  }
+
+  ~NetList();
+
+  // Member functions
+
+  // NOTE: takes ownership of the net.
+  void
+  addNet(Net *net);
+
+  virtual void
+  print(std::ostream &strm) const;
+
+private:
+
+  // Types
+
+  typedef std::list<Net *> Nets;
+  typedef std::list<Net *>::const_iterator Iter;
+
+  // Data members
+
+  Nets nets_;
+};
+
+std::ostream &
+operator<<(std::ostream &strm, const NetList &netList);
+
 }
 }
+
+#endif
@@ -0,0 +1,107 @@
+// Snapping of coordinates to the Eagle drawing grid.
+// Copyright 2014 by Brian Davis.
+
+#ifndef grid_snap_HEADER
+#define grid_snap_HEADER
+
+#include <cstddef>
+#include <cstring>
+
+namespace jrl
+{
+
+/**
+ * Rounds coordinates (in mm) to the nearest multiple of a grid pitch,
+ * removing the noise left by converting between the metric and
+ * imperial units Eagle designs mix.
+ */
+class GridSnap
+{
+public:
+
+  // Constructors/destructors
+
+  explicit GridSnap(const double pitch)
+    : pitch_(pitch), inversePitch_(1.0 / pitch)
+  {
+  }
+
+  // Member functions
+
+  double
+  getPitch() const
+  {
+    return pitch_;
+  }
+
+  /**
+   * Snap a single value.
+   *
+   * NOTE: rounds by adding and subtracting 1.5 * 2^52, which leaves
+   * the nearest integer in the low bits of the mantissa.  Unlike
+   * round() this is plain arithmetic, so loops of it are vectorized
+   * without needing SSE4.1 or fast math; it is exact for the 2^51 grid
+   * steps either side of the origin, i.e. any board.
+   */
+  double
+  apply(const double value) const
+  {
+    return ((value * inversePitch_ + ROUNDING_MAGIC) - ROUNDING_MAGIC) *
+      pitch_;
+  }
+
+  /**
+   * Snap count values in place, e.g. a coordinate column.
+   */
+  void
+  apply(double * const values,
+        const std::size_t count) const
+  {
+    for (std::size_t index = 0; index < count; ++index) {
+      values[index] = apply(values[index]);
+    }
+  }
+
+  /**
+   * Length in mm of one of the Eagle units "mic", "mm", "mil" or
+   * "inch", false for any other unit.
+   */
+  static bool
+  tryGetUnitLength(const char * const unit,
+                   double &millimeters)
+  {
+    static const struct
+    {
+      const char *name;
+      double millimeters;
+    } UNITS[] = {
+      { "mic", 0.001 },
+      { "mm", 1.0 },
+      { "mil", 0.0254 },
+      { "inch", 25.4 }
+    };
+    for (std::size_t index = 0; index < sizeof(UNITS) / sizeof(UNITS[0]);
+         ++index) {
+      if (0 == std::strcmp(UNITS[index].name, unit)) {
+        millimeters = UNITS[index].millimeters;
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+
+  // Constants
+
+  static constexpr double ROUNDING_MAGIC = 6755399441055744.0;  // 1.5 * 2^52
+
+  // Data members
+
+  double pitch_;
+  double inversePitch_;
+};
+
+}
+
+#endif
@@ -0,0 +1,141 @@
+// String interning table.
+// Copyright 2014 by Brian Davis.
+
+#ifndef interner_HEADER
+#define interner_HEADER
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "allocation_stats.hpp"
+
+namespace jrl
+{
+
+/**
+ * Maps strings to dense integer ids (in order of first appearance) so
+ * that they can be used to index flat arrays.  Its memory is counted
+ * under AllocationStatistics::STRING_TAG.
+ */
+class Interner
+{
+public:
+
+  // Constructors/destructors
+
+  Interner()
+    : stringBytes_(0)
+  {
+  }
+
+  ~Interner()
+  {
+    AllocationStatistics::remove(AllocationStatistics::STRING_TAG, stringBytes_);
+  }
+
+  Interner(const Interner &) = delete;
+
+  Interner &
+  operator=(const Interner &) = delete;
+
+  // Member functions
+
+  std::uint32_t
+  intern(const std::string &value)
+  {
+    // NOTE: looked up first, since insert() allocates a node even when
+    // the value is already there.
+    const Ids::const_iterator entry = ids_.find(value);
+    if (ids_.end() != entry) {
+      return entry->second;
+    }
+    const std::pair<Ids::iterator, bool> result =
+      ids_.insert(std::make_pair(value, static_cast<std::uint32_t>(values_.size())));
+    if (result.second) {
+      // NOTE: keys of an unordered_map are never moved, so it is safe
+      // to keep pointers to them.
+      values_.push_back(&result.first->first);
+      countString(result.first->first);
+    }
+    return result.first->second;
+  }
+
+  bool
+  tryFind(const std::string &value,
+          std::uint32_t &id) const
+  {
+    const Ids::const_iterator entry = ids_.find(value);
+    if (ids_.end() == entry) {
+      return false;
+    }
+    id = entry->second;
+    return true;
+  }
+
+  const std::string &
+  get(const std::uint32_t id) const
+  {
+    return *values_[id];
+  }
+
+  std::size_t
+  size() const
+  {
+    return values_.size();
+  }
+
+  void
+  clear()
+  {
+    ids_.clear();
+    values_.clear();
+    AllocationStatistics::remove(AllocationStatistics::STRING_TAG, stringBytes_);
+    stringBytes_ = 0;
+  }
+
+private:
+
+  // Types
+
+  typedef std::unordered_map<std::string, std::uint32_t,
+                             std::hash<std::string>,
+                             std::equal_to<std::string>,
+                             CountingAllocator<std::pair<const std::string,
+                                                         std::uint32_t>,
+                                               AllocationStatistics::STRING_TAG> > Ids;
+
+  // Member functions
+
+  /**
+   * Count the characters of a key, unless they are held within the
+   * string itself by the small string optimization.
+   */
+  void
+  countString(const std::string &value)
+  {
+    const char * const data = value.data();
+    const char * const object = reinterpret_cast<const char *>(&value);
+    if ((data < object) || (object + sizeof(value) <= data)) {
+      const std::size_t bytes = value.capacity() + 1;
+      AllocationStatistics::add(AllocationStatistics::STRING_TAG, bytes);
+      stringBytes_ += bytes;
+    }
+  }
+
+  // Data members
+
+  Ids ids_;
+  std::vector<const std::string *,
+              CountingAllocator<const std::string *,
+                                AllocationStatistics::STRING_TAG> > values_;
+  std::size_t stringBytes_;
+};
+
+}
+
+#endif
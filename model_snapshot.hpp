@@ -0,0 +1,574 @@
+// Binary snapshot of a parsed Eagle document.
+// Copyright 2014 by Brian Davis.
+
+#ifndef model_snapshot_HEADER
+#define model_snapshot_HEADER
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/utility/string_ref.hpp>
+
+#include "interner.hpp"
+
+namespace jrl
+{
+
+/**
+ * Layout shared by ModelWriter and ModelReader.
+ *
+ * A snapshot holds the parse events which matter to the conversion
+ * (element starts with their attributes, character data and element
+ * ends), already transcoded to UTF-8, as flat columns:
+ *
+ *   EVENT_TYPES       uint8_t per event
+ *   EVENT_STRINGS     uint32_t per event, element name (for both start
+ *                     and end events) or character data
+ *   EVENT_ATTRIBUTES  uint32_t per event plus one, first attribute of
+ *                     each event (the attributes of event i are
+ *                     [column[i], column[i + 1]))
+ *   ATTRIBUTE_NAMES   uint32_t per attribute
+ *   ATTRIBUTE_VALUES  uint32_t per attribute
+ *   STRING_OFFSETS    uint32_t per distinct string plus one
+ *   STRING_DATA       the strings, each NUL terminated
+ *
+ * Strings are referred to by their index in STRING_OFFSETS.  The file
+ * starts with a Header followed by a Section entry for each column,
+ * and every column starts on a multiple of 8 bytes, so a mapped file is
+ * used in place.  Integers are in host byte order: a snapshot is a
+ * local intermediate file, not an interchange format.
+ */
+class ModelLayout
+{
+public:
+
+  // Types
+
+  enum EventType {
+    START_EVENT,
+    END_EVENT,
+    CHARACTERS_EVENT
+  };
+
+  enum SectionKind {
+    EVENT_TYPES,
+    EVENT_STRINGS,
+    EVENT_ATTRIBUTES,
+    ATTRIBUTE_NAMES,
+    ATTRIBUTE_VALUES,
+    STRING_OFFSETS,
+    STRING_DATA,
+    SECTION_COUNT
+  };
+
+  struct Header
+  {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byteOrder;
+    std::uint32_t sectionCount;
+    std::uint32_t reserved;
+  };
+
+  struct Section
+  {
+    std::uint32_t kind;
+    std::uint32_t reserved;
+    std::uint64_t offset;
+    std::uint64_t size;
+  };
+
+  // Constants
+
+  // NOTE: bump the version whenever the layout changes.
+  static const std::uint32_t VERSION = 1;
+  static const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+  static const std::size_t ALIGNMENT = 8;
+
+  // Member functions
+
+  static const char *
+  getMagic()
+  {
+    return "E2GMODEL";
+  }
+};
+
+/**
+ * Accumulates parse events and writes them as a snapshot.
+ */
+class ModelWriter
+{
+public:
+
+  // Constructors/destructors
+
+  ModelWriter()
+  {
+    eventAttributes_.push_back(0);
+  }
+
+  // Member functions
+
+  /**
+   * Start an element, its attributes are added with addAttribute().
+   */
+  void
+  startElement(const boost::string_ref &name)
+  {
+    openElements_.push_back(intern(name));
+    addEvent(ModelLayout::START_EVENT, openElements_.back());
+  }
+
+  void
+  addAttribute(const boost::string_ref &name,
+               const boost::string_ref &value)
+  {
+    attributeNames_.push_back(intern(name));
+    attributeValues_.push_back(intern(value));
+    eventAttributes_.back() = static_cast<std::uint32_t>(attributeNames_.size());
+  }
+
+  void
+  endElement()
+  {
+    addEvent(ModelLayout::END_EVENT, openElements_.back());
+    openElements_.pop_back();
+  }
+
+  void
+  addCharacters(const boost::string_ref &chars)
+  {
+    addEvent(ModelLayout::CHARACTERS_EVENT, intern(chars));
+  }
+
+  std::size_t
+  getEventCount() const
+  {
+    return eventTypes_.size();
+  }
+
+  /**
+   * Write the snapshot, replacing the file atomically.  Returns false
+   * with a description of the problem in error on failure.
+   */
+  bool
+  write(const std::string &path,
+        std::string &error) const
+  {
+    std::string image;
+    serialize(image);
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath.c_str(),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(image.data(), image.size());
+    file.close();
+    if (!file) {
+      error = "unable to write '" + temporaryPath + "'";
+      std::remove(temporaryPath.c_str());
+      return false;
+    }
+    if (0 != std::rename(temporaryPath.c_str(), path.c_str())) {
+      error = "unable to rename '" + temporaryPath + "' to '" + path + "'";
+      std::remove(temporaryPath.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Build the snapshot in memory, see ModelReader::load().
+   */
+  void
+  serialize(std::string &image) const
+  {
+    std::vector<std::uint32_t> stringOffsets;
+    std::string stringData;
+    for (std::size_t id = 0; id < strings_.size(); ++id) {
+      stringOffsets.push_back(static_cast<std::uint32_t>(stringData.size()));
+      stringData += strings_.get(static_cast<std::uint32_t>(id));
+      stringData.push_back('\0');
+    }
+    stringOffsets.push_back(static_cast<std::uint32_t>(stringData.size()));
+
+    const void *data[ModelLayout::SECTION_COUNT] = {
+      eventTypes_.data(), eventStrings_.data(), eventAttributes_.data(),
+      attributeNames_.data(), attributeValues_.data(),
+      stringOffsets.data(), stringData.data()
+    };
+    ModelLayout::Section sections[ModelLayout::SECTION_COUNT];
+    sections[ModelLayout::EVENT_TYPES].size = eventTypes_.size();
+    sections[ModelLayout::EVENT_STRINGS].size =
+      eventStrings_.size() * sizeof(std::uint32_t);
+    sections[ModelLayout::EVENT_ATTRIBUTES].size =
+      eventAttributes_.size() * sizeof(std::uint32_t);
+    sections[ModelLayout::ATTRIBUTE_NAMES].size =
+      attributeNames_.size() * sizeof(std::uint32_t);
+    sections[ModelLayout::ATTRIBUTE_VALUES].size =
+      attributeValues_.size() * sizeof(std::uint32_t);
+    sections[ModelLayout::STRING_OFFSETS].size =
+      stringOffsets.size() * sizeof(std::uint32_t);
+    sections[ModelLayout::STRING_DATA].size = stringData.size();
+
+    ModelLayout::Header header;
+    std::memcpy(header.magic, ModelLayout::getMagic(), sizeof(header.magic));
+    header.version = ModelLayout::VERSION;
+    header.byteOrder = ModelLayout::BYTE_ORDER_MARK;
+    header.sectionCount = ModelLayout::SECTION_COUNT;
+    header.reserved = 0;
+    std::uint64_t offset = align(sizeof(header) + sizeof(sections));
+    for (std::uint32_t kind = 0; kind < ModelLayout::SECTION_COUNT; ++kind) {
+      sections[kind].kind = kind;
+      sections[kind].reserved = 0;
+      sections[kind].offset = offset;
+      offset = align(offset + sections[kind].size);
+    }
+
+    image.clear();
+    image.reserve(offset);
+    image.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    image.append(reinterpret_cast<const char *>(sections), sizeof(sections));
+    for (std::uint32_t kind = 0; kind < ModelLayout::SECTION_COUNT; ++kind) {
+      image.resize(sections[kind].offset, '\0');
+      image.append(static_cast<const char *>(data[kind]), sections[kind].size);
+    }
+  }
+
+private:
+
+  // Member functions
+
+  static std::uint64_t
+  align(const std::uint64_t offset)
+  {
+    return (offset + ModelLayout::ALIGNMENT - 1) &
+      ~static_cast<std::uint64_t>(ModelLayout::ALIGNMENT - 1);
+  }
+
+  std::uint32_t
+  intern(const boost::string_ref &value)
+  {
+    // NOTE: scratch key so that known strings don't allocate.
+    key_.assign(value.data(), value.size());
+    return strings_.intern(key_);
+  }
+
+  void
+  addEvent(const ModelLayout::EventType type,
+           const std::uint32_t string)
+  {
+    eventTypes_.push_back(static_cast<std::uint8_t>(type));
+    eventStrings_.push_back(string);
+    eventAttributes_.push_back(eventAttributes_.back());
+  }
+
+  // Data members
+
+  Interner strings_;
+  std::string key_;
+  std::vector<std::uint8_t> eventTypes_;
+  std::vector<std::uint32_t> eventStrings_;
+  std::vector<std::uint32_t> eventAttributes_;
+  std::vector<std::uint32_t> attributeNames_;
+  std::vector<std::uint32_t> attributeValues_;
+  std::vector<std::uint32_t> openElements_;
+};
+
+/**
+ * Read only view of a snapshot file, which is mapped into memory and
+ * used in place: opening only validates the layout.
+ */
+class ModelReader
+{
+public:
+
+  // Constructors/destructors
+
+  ModelReader()
+    : mapping_(NULL), size_(0), isMapped_(false), eventCount_(0),
+      attributeCount_(0),
+      stringCount_(0), eventTypes_(NULL), eventStrings_(NULL),
+      eventAttributes_(NULL), attributeNames_(NULL), attributeValues_(NULL),
+      stringOffsets_(NULL), stringData_(NULL)
+  {
+  }
+
+  ModelReader(const ModelReader &) = delete;
+
+  ModelReader &
+  operator=(const ModelReader &) = delete;
+
+  ~ModelReader()
+  {
+    close();
+  }
+
+  // Member functions
+
+  /**
+   * Map and validate a snapshot file.  Returns false with a description
+   * of the problem in error if it can't be used.
+   */
+  bool
+  open(const std::string &path,
+       std::string &error)
+  {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (0 > fd) {
+      error = "unable to open '" + path + "'";
+      return false;
+    }
+    struct stat status;
+    if ((0 != ::fstat(fd, &status)) || (0 == status.st_size)) {
+      ::close(fd);
+      error = "unable to read '" + path + "'";
+      return false;
+    }
+    void *mapping = ::mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (MAP_FAILED == mapping) {
+      error = "unable to map '" + path + "'";
+      return false;
+    }
+    mapping_ = static_cast<const char *>(mapping);
+    size_ = status.st_size;
+    isMapped_ = true;
+    if (!validate(error)) {
+      error = "'" + path + "' is not a usable model snapshot: " + error;
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * Validate a snapshot built by ModelWriter::serialize(), which must
+   * outlive this reader and be 8 byte aligned (as heap allocations
+   * are).
+   */
+  bool
+  load(const std::string &image,
+       std::string &error)
+  {
+    close();
+    mapping_ = image.data();
+    size_ = image.size();
+    if ((0 != (reinterpret_cast<std::uintptr_t>(mapping_) %
+               ModelLayout::ALIGNMENT)) || (!validate(error))) {
+      if (error.empty()) {
+        error = "misaligned";
+      }
+      error = "not a usable model snapshot: " + error;
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void
+  close()
+  {
+    if (isMapped_) {
+      ::munmap(const_cast<char *>(mapping_), size_);
+    }
+    mapping_ = NULL;
+    size_ = 0;
+    isMapped_ = false;
+    eventCount_ = attributeCount_ = stringCount_ = 0;
+  }
+
+  std::size_t
+  getEventCount() const
+  {
+    return eventCount_;
+  }
+
+  ModelLayout::EventType
+  getEventType(const std::size_t event) const
+  {
+    return static_cast<ModelLayout::EventType>(eventTypes_[event]);
+  }
+
+  /**
+   * Element name of a start or end event, or the characters of a
+   * characters event.
+   */
+  boost::string_ref
+  getEventString(const std::size_t event) const
+  {
+    return getString(eventStrings_[event]);
+  }
+
+  std::size_t
+  getFirstAttribute(const std::size_t event) const
+  {
+    return eventAttributes_[event];
+  }
+
+  std::size_t
+  getAttributeCount(const std::size_t event) const
+  {
+    return eventAttributes_[event + 1] - eventAttributes_[event];
+  }
+
+  boost::string_ref
+  getAttributeName(const std::size_t attribute) const
+  {
+    return getString(attributeNames_[attribute]);
+  }
+
+  /**
+   * NOTE: the value is NUL terminated, as all strings are.
+   */
+  boost::string_ref
+  getAttributeValue(const std::size_t attribute) const
+  {
+    return getString(attributeValues_[attribute]);
+  }
+
+private:
+
+  // Member functions
+
+  boost::string_ref
+  getString(const std::uint32_t id) const
+  {
+    return boost::string_ref(stringData_ + stringOffsets_[id],
+                             stringOffsets_[id + 1] - stringOffsets_[id] - 1);
+  }
+
+  template <typename T> bool
+  getSection(const ModelLayout::Section *sections,
+             const ModelLayout::SectionKind kind,
+             const T *&column,
+             std::size_t &count,
+             std::string &error) const
+  {
+    const ModelLayout::Section &section = sections[kind];
+    if ((section.kind != static_cast<std::uint32_t>(kind)) ||
+        (0 != (section.offset % ModelLayout::ALIGNMENT)) ||
+        (0 != (section.size % sizeof(T))) ||
+        (section.offset > size_) || (section.size > size_ - section.offset)) {
+      error = "bad section table";
+      return false;
+    }
+    column = reinterpret_cast<const T *>(mapping_ + section.offset);
+    count = section.size / sizeof(T);
+    return true;
+  }
+
+  static bool
+  isBelow(const std::uint32_t *column,
+          const std::size_t count,
+          const std::size_t limit)
+  {
+    for (std::size_t index = 0; index < count; ++index) {
+      if (column[index] >= limit) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool
+  validate(std::string &error)
+  {
+    const std::size_t tableSize = sizeof(ModelLayout::Header) +
+      (ModelLayout::SECTION_COUNT * sizeof(ModelLayout::Section));
+    if (size_ < tableSize) {
+      error = "truncated";
+      return false;
+    }
+    const ModelLayout::Header &header =
+      *reinterpret_cast<const ModelLayout::Header *>(mapping_);
+    if (0 != std::memcmp(header.magic, ModelLayout::getMagic(),
+                         sizeof(header.magic))) {
+      error = "bad magic";
+      return false;
+    }
+    if ((ModelLayout::VERSION != header.version) ||
+        (ModelLayout::BYTE_ORDER_MARK != header.byteOrder) ||
+        (ModelLayout::SECTION_COUNT != header.sectionCount)) {
+      error = "unsupported version";
+      return false;
+    }
+    const ModelLayout::Section *sections =
+      reinterpret_cast<const ModelLayout::Section *>(mapping_ + sizeof(header));
+    std::size_t count = 0;
+    std::size_t stringBytes = 0;
+    if ((!getSection(sections, ModelLayout::EVENT_TYPES, eventTypes_,
+                     eventCount_, error)) ||
+        (!getSection(sections, ModelLayout::EVENT_STRINGS, eventStrings_,
+                     count, error)) || (count != eventCount_) ||
+        (!getSection(sections, ModelLayout::EVENT_ATTRIBUTES, eventAttributes_,
+                     count, error)) || (count != eventCount_ + 1) ||
+        (!getSection(sections, ModelLayout::ATTRIBUTE_NAMES, attributeNames_,
+                     attributeCount_, error)) ||
+        (!getSection(sections, ModelLayout::ATTRIBUTE_VALUES, attributeValues_,
+                     count, error)) || (count != attributeCount_) ||
+        (!getSection(sections, ModelLayout::STRING_OFFSETS, stringOffsets_,
+                     stringCount_, error)) || (0 == stringCount_) ||
+        (!getSection(sections, ModelLayout::STRING_DATA, stringData_,
+                     stringBytes, error))) {
+      if (error.empty()) {
+        error = "inconsistent section sizes";
+      }
+      return false;
+    }
+    --stringCount_;  // NOTE: the last offset is the end of the data.
+    for (std::size_t id = 0; id < stringCount_; ++id) {
+      if ((stringOffsets_[id] >= stringOffsets_[id + 1]) ||
+          (stringOffsets_[id + 1] > stringBytes) ||
+          ('\0' != stringData_[stringOffsets_[id + 1] - 1])) {
+        error = "bad string table";
+        return false;
+      }
+    }
+    for (std::size_t event = 0; event < eventCount_; ++event) {
+      if ((eventTypes_[event] > ModelLayout::CHARACTERS_EVENT) ||
+          (eventAttributes_[event] > eventAttributes_[event + 1])) {
+        error = "bad event";
+        return false;
+      }
+    }
+    if ((eventAttributes_[eventCount_] > attributeCount_) ||
+        (!isBelow(eventStrings_, eventCount_, stringCount_)) ||
+        (!isBelow(attributeNames_, attributeCount_, stringCount_)) ||
+        (!isBelow(attributeValues_, attributeCount_, stringCount_))) {
+      error = "bad string reference";
+      return false;
+    }
+    return true;
+  }
+
+  // Data members
+
+  const char *mapping_;
+  std::size_t size_;
+  bool isMapped_;
+  std::size_t eventCount_;
+  std::size_t attributeCount_;
+  std::size_t stringCount_;
+  const std::uint8_t *eventTypes_;
+  const std::uint32_t *eventStrings_;
+  const std::uint32_t *eventAttributes_;
+  const std::uint32_t *attributeNames_;
+  const std::uint32_t *attributeValues_;
+  const std::uint32_t *stringOffsets_;
+  const char *stringData_;
+};
+
+}
+
+#endif
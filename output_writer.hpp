@@ -0,0 +1,928 @@
+// Output written from large buffers on a separate thread.
+// Copyright 2014 by Brian Davis.
+
+#ifndef output_writer_HEADER
+#define output_writer_HEADER
+
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define output_writer_HAVE_IO_URING
+#endif
+#endif
+#endif
+
+#include "allocation_stats.hpp"
+
+namespace jrl
+{
+
+#ifdef output_writer_HAVE_IO_URING
+
+/**
+ * Minimal io_uring instance for vectored writes, driven through the raw
+ * system calls so that liburing isn't needed.
+ */
+class WriteRing
+{
+public:
+
+  // Constructors/destructors
+
+  WriteRing()
+    : fd_(-1),
+      sqRing_(MAP_FAILED),
+      sqRingSize_(0),
+      cqRing_(MAP_FAILED),
+      cqRingSize_(0),
+      sqes_(NULL),
+      sqesSize_(0),
+      entryCount_(0)
+  {
+  }
+
+  ~WriteRing()
+  {
+    close();
+  }
+
+  WriteRing(const WriteRing &) = delete;
+
+  WriteRing &
+  operator=(const WriteRing &) = delete;
+
+  // Member functions
+
+  /**
+   * Set up a ring of (at least) entryCount submissions, returns false
+   * if the kernel doesn't support io_uring or doesn't allow it.
+   */
+  bool
+  open(const unsigned entryCount)
+  {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entryCount, &params));
+    if (0 > fd_) {
+      return false;
+    }
+    entryCount_ = params.sq_entries;
+    sqRingSize_ = params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+    cqRingSize_ = params.cq_off.cqes +
+      (params.cq_entries * sizeof(struct io_uring_cqe));
+    const bool isSingleMap = (0 != (params.features & IORING_FEAT_SINGLE_MMAP));
+    if (isSingleMap) {
+      sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = ::mmap(NULL, sqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == sqRing_) {
+      close();
+      return false;
+    }
+    if (isSingleMap) {
+      cqRing_ = sqRing_;
+    }
+    else {
+      cqRing_ = ::mmap(NULL, cqRingSize_, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (MAP_FAILED == cqRing_) {
+        close();
+        return false;
+      }
+    }
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(NULL, sqesSize_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (MAP_FAILED == sqes) {
+      close();
+      return false;
+    }
+    sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    char *cq = static_cast<char *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  bool
+  isOpen() const
+  {
+    return 0 <= fd_;
+  }
+
+  unsigned
+  getEntryCount() const
+  {
+    return entryCount_;
+  }
+
+  /**
+   * Queue a write of count vectors at offset, returns false if the
+   * submission queue is full.  The vectors must stay valid until the
+   * write completes.
+   */
+  bool
+  addWrite(const int fd,
+           const struct iovec *vectors,
+           const unsigned count,
+           const std::uint64_t offset,
+           const std::uint64_t tag)
+  {
+    const unsigned tail = *sqTail_;
+    if (entryCount_ == tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE)) {
+      return false;
+    }
+    const unsigned index = tail & sqMask_;
+    struct io_uring_sqe &sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITEV;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<std::uint64_t>(vectors);
+    sqe.len = count;
+    sqe.off = offset;
+    sqe.user_data = tag;
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  /**
+   * Submit the queued writes and wait for at least waitCount of them
+   * to complete.  Returns false if the ring failed.
+   */
+  bool
+  submit(const unsigned waitCount)
+  {
+    for (;;) {
+      const unsigned submitCount =
+        *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+      const long result = ::syscall(__NR_io_uring_enter, fd_, submitCount,
+                                    waitCount, IORING_ENTER_GETEVENTS,
+                                    NULL, 0);
+      if (0 <= result) {
+        return true;
+      }
+      if ((EINTR != errno) && (EAGAIN != errno) && (EBUSY != errno)) {
+        return false;
+      }
+      if ((0 < waitCount) && hasCompletion()) {
+        return true;
+      }
+    }
+  }
+
+  /**
+   * Take a completed write, with the tag it was added with and its
+   * result (bytes written or a negated errno).
+   */
+  bool
+  takeCompletion(std::uint64_t &tag,
+                 std::int32_t &result)
+  {
+    const unsigned head = *cqHead_;
+    if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+      return false;
+    }
+    const struct io_uring_cqe &cqe = cqes_[head & cqMask_];
+    tag = cqe.user_data;
+    result = cqe.res;
+    __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+private:
+
+  // Member functions
+
+  bool
+  hasCompletion() const
+  {
+    return *cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  }
+
+  void
+  close()
+  {
+    if (NULL != sqes_) {
+      ::munmap(sqes_, sqesSize_);
+      sqes_ = NULL;
+    }
+    if ((MAP_FAILED != cqRing_) && (cqRing_ != sqRing_)) {
+      ::munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = MAP_FAILED;
+    if (MAP_FAILED != sqRing_) {
+      ::munmap(sqRing_, sqRingSize_);
+      sqRing_ = MAP_FAILED;
+    }
+    if (0 <= fd_) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  // Data members
+
+  int fd_;
+  void *sqRing_;
+  std::size_t sqRingSize_;
+  void *cqRing_;
+  std::size_t cqRingSize_;
+  struct io_uring_sqe *sqes_;
+  std::size_t sqesSize_;
+  unsigned entryCount_;
+  unsigned *sqHead_;
+  unsigned *sqTail_;
+  unsigned sqMask_;
+  unsigned *sqArray_;
+  unsigned *cqHead_;
+  unsigned *cqTail_;
+  unsigned cqMask_;
+  struct io_uring_cqe *cqes_;
+};
+
+#endif
+
+/**
+ * Writes buffers on its own thread, so that producing output overlaps
+ * with the system calls writing it.
+ *
+ * Output is produced into page aligned buffers of a fixed, large size
+ * taken from a bounded pool (see OutputFile), so a producer which gets
+ * ahead of the disk blocks instead of using unbounded memory.  Each
+ * full buffer is queued with the file offset it belongs at; the writer
+ * thread takes everything queued at once and writes it through io_uring
+ * when the kernel allows, and otherwise with pwritev(2), combining
+ * adjacent buffers of a file into single calls.  Output which can't be
+ * written by offset, such as a pipe, is written in order with
+ * writev(2).
+ *
+ * One writer may be shared by any number of files and threads.
+ */
+class OutputWriter
+{
+public:
+
+  // Types
+
+  enum Backend {
+    IO_URING_BACKEND,
+    PWRITEV_BACKEND
+  };
+
+  struct Statistics
+  {
+    std::uint64_t bytes;
+    /** System calls which wrote, or submitted writes. */
+    std::uint64_t writeCount;
+    /** Time producers waited for a free buffer. */
+    double stallSeconds;
+  };
+
+  /**
+   * A destination of writes, see OutputFile.
+   */
+  struct Target
+  {
+    int fd;
+    /** Buffers queued but not yet written, guarded by the writer. */
+    std::size_t pendingCount;
+    /** First errno of a failed write, guarded by the writer. */
+    int error;
+  };
+
+  // Constants
+
+  static const std::size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+  static const std::size_t DEFAULT_BUFFER_COUNT = 8;
+
+  // Constructors/destructors
+
+  explicit OutputWriter(const std::size_t bufferSize = DEFAULT_BUFFER_SIZE,
+                        const std::size_t bufferCount = DEFAULT_BUFFER_COUNT,
+                        const bool isRingAllowed = true)
+    : bufferSize_(bufferSize),
+      bufferCount_(bufferCount),
+      allocatedCount_(0),
+      backend_(PWRITEV_BACKEND),
+      isStopping_(false),
+      bytes_(0),
+      writeCount_(0),
+      stall_(0)
+  {
+#ifdef output_writer_HAVE_IO_URING
+    if (isRingAllowed && ring_.open(RING_SIZE)) {
+      backend_ = IO_URING_BACKEND;
+    }
+#else
+    (void)isRingAllowed;
+#endif
+    thread_ = std::thread(&OutputWriter::run, this);
+  }
+
+  /**
+   * Finish the queued writes and stop the writer thread.
+   */
+  ~OutputWriter()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      isStopping_ = true;
+      queued_.notify_one();
+    }
+    thread_.join();
+    for (std::vector<char *>::iterator buffer = freeBuffers_.begin();
+         buffer != freeBuffers_.end(); ++buffer) {
+      std::free(*buffer);
+      AllocationStatistics::remove(AllocationStatistics::OUTPUT_TAG, bufferSize_);
+    }
+  }
+
+  OutputWriter(const OutputWriter &) = delete;
+
+  OutputWriter &
+  operator=(const OutputWriter &) = delete;
+
+  // Member functions
+
+  Backend
+  getBackend() const
+  {
+    return backend_.load();
+  }
+
+  const char *
+  getBackendName() const
+  {
+    return (IO_URING_BACKEND == backend_.load()) ? "io_uring" : "pwritev";
+  }
+
+  std::size_t
+  getBufferSize() const
+  {
+    return bufferSize_;
+  }
+
+  Statistics
+  getStatistics()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Statistics statistics;
+    statistics.bytes = bytes_;
+    statistics.writeCount = writeCount_;
+    statistics.stallSeconds = stall_.count();
+    return statistics;
+  }
+
+  /**
+   * Take a buffer of getBufferSize() bytes, waiting for one to be
+   * written if they are all in use.
+   */
+  char *
+  acquire()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (freeBuffers_.empty() && (allocatedCount_ == bufferCount_)) {
+      const Clock::time_point start = Clock::now();
+      while (freeBuffers_.empty() && (allocatedCount_ == bufferCount_)) {
+        released_.wait(lock);
+      }
+      stall_ += Clock::now() - start;
+    }
+    if (!freeBuffers_.empty()) {
+      char *buffer = freeBuffers_.back();
+      freeBuffers_.pop_back();
+      return buffer;
+    }
+    void *buffer = NULL;
+    if (0 != ::posix_memalign(&buffer, ALIGNMENT, bufferSize_)) {
+      throw std::bad_alloc();
+    }
+    AllocationStatistics::add(AllocationStatistics::OUTPUT_TAG, bufferSize_);
+    ++allocatedCount_;
+    return static_cast<char *>(buffer);
+  }
+
+  /**
+   * Return a buffer taken with acquire() without writing it.
+   */
+  void
+  release(char *buffer)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    freeBuffers_.push_back(buffer);
+    released_.notify_one();
+  }
+
+  /**
+   * Queue size bytes of buffer to be written to target at offset, or
+   * after what was queued before if offset is negative.  The buffer is
+   * released once written.
+   */
+  void
+  submit(Target &target,
+         char *buffer,
+         const std::size_t size,
+         const std::int64_t offset)
+  {
+    const Request request = { &target, buffer, size, offset };
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++target.pendingCount;
+    queue_.push_back(request);
+    queued_.notify_one();
+  }
+
+  /**
+   * Wait until everything queued for target is written, returns the
+   * errno of the first failed write or 0.
+   */
+  int
+  wait(Target &target)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (0 < target.pendingCount) {
+      written_.wait(lock);
+    }
+    return target.error;
+  }
+
+private:
+
+  // Types
+
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::duration<double> Seconds;
+
+  struct Request
+  {
+    Target *target;
+    char *buffer;
+    std::size_t size;
+    std::int64_t offset;
+  };
+
+  // Constants
+
+  /** Buffers are aligned for direct I/O and whole page writes. */
+  static const std::size_t ALIGNMENT = 4096;
+  static const unsigned RING_SIZE = 64;
+
+  // Member functions
+
+  /**
+   * Thread body, writes whatever is queued until stopped.
+   */
+  void
+  run()
+  {
+    std::vector<Request> batch;
+    std::vector<int> errors;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (queue_.empty() && (!isStopping_)) {
+          queued_.wait(lock);
+        }
+        if (queue_.empty()) {
+          return;
+        }
+        batch.assign(queue_.begin(), queue_.end());
+        queue_.clear();
+      }
+
+      errors.assign(batch.size(), 0);
+      std::uint64_t writeCount = 0;
+      std::vector<bool> isKept(batch.size(), false);
+#ifdef output_writer_HAVE_IO_URING
+      if (IO_URING_BACKEND == backend_) {
+        writeCount += writeRing(batch, errors, isKept);
+      }
+      else
+#endif
+      {
+        writeCount += writeVectors(batch, errors);
+      }
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (std::size_t index = 0; index < batch.size(); ++index) {
+        Target &target = *batch[index].target;
+        if ((0 != errors[index]) && (0 == target.error)) {
+          target.error = errors[index];
+        }
+        if (0 == errors[index]) {
+          bytes_ += batch[index].size;
+        }
+        --target.pendingCount;
+        if (isKept[index]) {
+          // Still owned by the kernel after a failed ring, never reused.
+          --allocatedCount_;
+        }
+        else {
+          freeBuffers_.push_back(batch[index].buffer);
+        }
+      }
+      writeCount_ += writeCount;
+      released_.notify_all();
+      written_.notify_all();
+    }
+  }
+
+  /**
+   * Write a batch with (p)writev, combining runs of buffers which are
+   * adjacent in the same file.  Returns the number of system calls.
+   */
+  std::uint64_t
+  writeVectors(const std::vector<Request> &batch,
+               std::vector<int> &errors)
+  {
+    std::uint64_t writeCount = 0;
+    std::vector<struct iovec> vectors;
+    std::size_t first = 0;
+    while (first < batch.size()) {
+      const Request &request = batch[first];
+      vectors.clear();
+      std::size_t last = first;
+      std::int64_t end = request.offset;
+      for (; (last < batch.size()) && (vectors.size() < static_cast<std::size_t>(IOV_MAX)); ++last) {
+        const Request &next = batch[last];
+        if ((next.target != request.target) ||
+            ((0 <= request.offset) && (next.offset != end))) {
+          break;
+        }
+        const struct iovec vector = { next.buffer, next.size };
+        vectors.push_back(vector);
+        end += next.size;
+      }
+      const int error =
+        writeAll(request.target->fd, &vectors[0], vectors.size(),
+                 request.offset, writeCount);
+      for (std::size_t index = first; index < last; ++index) {
+        errors[index] = error;
+      }
+      first = last;
+    }
+    return writeCount;
+  }
+
+#ifdef output_writer_HAVE_IO_URING
+  /**
+   * Write a batch through the ring, ordered output directly.  Writes
+   * which fail or fall short in the ring are completed with pwritev.
+   * Returns the number of system calls.
+   */
+  std::uint64_t
+  writeRing(const std::vector<Request> &batch,
+            std::vector<int> &errors,
+            std::vector<bool> &isKept)
+  {
+    std::uint64_t writeCount = 0;
+    std::vector<struct iovec> vectors(batch.size());
+    std::vector<bool> isDone(batch.size(), false);
+    std::size_t next = 0;
+    std::size_t inFlightCount = 0;
+    while ((next < batch.size()) || (0 < inFlightCount)) {
+      for (; next < batch.size(); ++next) {
+        const Request &request = batch[next];
+        vectors[next].iov_base = request.buffer;
+        vectors[next].iov_len = request.size;
+        if (0 > request.offset) {
+          errors[next] = writeAll(request.target->fd, &vectors[next], 1, -1,
+                                  writeCount);
+          isDone[next] = true;
+          continue;
+        }
+        if (!ring_.addWrite(request.target->fd, &vectors[next], 1,
+                            request.offset, next)) {
+          break;
+        }
+        ++inFlightCount;
+      }
+      if (0 == inFlightCount) {
+        continue;
+      }
+      ++writeCount;
+      if (!ring_.submit(1)) {
+        // The kernel may still own the buffers in flight, so they are
+        // given up rather than reused; later batches use pwritev.
+        backend_ = PWRITEV_BACKEND;
+        for (std::size_t index = 0; index < next; ++index) {
+          if (!isDone[index]) {
+            errors[index] = EIO;
+            isKept[index] = true;
+          }
+        }
+        std::vector<Request> rest(batch.begin() + next, batch.end());
+        std::vector<int> restErrors(rest.size(), 0);
+        writeCount += writeVectors(rest, restErrors);
+        std::copy(restErrors.begin(), restErrors.end(), errors.begin() + next);
+        return writeCount;
+      }
+      std::uint64_t tag = 0;
+      std::int32_t result = 0;
+      while (ring_.takeCompletion(tag, result)) {
+        --inFlightCount;
+        isDone[tag] = true;
+        const Request &request = batch[tag];
+        const std::size_t written = (0 > result) ? 0 : result;
+        if (written < request.size) {
+          struct iovec rest = {
+            request.buffer + written, request.size - written
+          };
+          errors[tag] = writeAll(request.target->fd, &rest, 1,
+                                 request.offset + written, writeCount);
+        }
+      }
+    }
+    return writeCount;
+  }
+#endif
+
+  /**
+   * Write all of count vectors at offset, or in order if offset is
+   * negative.  Returns 0 or the errno of the failure.
+   */
+  static int
+  writeAll(const int fd,
+           struct iovec *vectors,
+           std::size_t count,
+           std::int64_t offset,
+           std::uint64_t &writeCount)
+  {
+    while (0 < count) {
+      ++writeCount;
+      const ssize_t written = (0 > offset) ?
+        ::writev(fd, vectors, count) : ::pwritev(fd, vectors, count, offset);
+      if (0 > written) {
+        if (EINTR == errno) {
+          continue;
+        }
+        return errno;
+      }
+      if (0 == written) {
+        return EIO;
+      }
+      if (0 <= offset) {
+        offset += written;
+      }
+      std::size_t rest = written;
+      while ((0 < count) && (rest >= vectors->iov_len)) {
+        rest -= vectors->iov_len;
+        ++vectors;
+        --count;
+      }
+      if (0 < count) {
+        vectors->iov_base = static_cast<char *>(vectors->iov_base) + rest;
+        vectors->iov_len -= rest;
+      }
+    }
+    return 0;
+  }
+
+  // Data members
+
+  std::size_t bufferSize_;
+  std::size_t bufferCount_;
+  std::size_t allocatedCount_;
+  std::vector<char *> freeBuffers_;
+  // NOTE: the writer thread falls back to pwritev when the ring fails,
+  // while callers may be reading it.
+  std::atomic<Backend> backend_;
+#ifdef output_writer_HAVE_IO_URING
+  WriteRing ring_;
+#endif
+  std::deque<Request> queue_;
+  bool isStopping_;
+  std::uint64_t bytes_;
+  std::uint64_t writeCount_;
+  Seconds stall_;
+  std::mutex mutex_;
+  std::condition_variable queued_;
+  std::condition_variable released_;
+  std::condition_variable written_;
+  std::thread thread_;
+};
+
+/**
+ * Stream buffer which hands its output to an OutputWriter a whole
+ * buffer at a time, for use with std::ostream.
+ *
+ * Unlike a file stream, sync() (so std::endl and std::flush) doesn't
+ * write anything: output is only written as buffers fill and by
+ * close(), which waits for it and reports whether it was all written.
+ */
+class OutputFile : public std::streambuf
+{
+public:
+
+  // Constructors/destructors
+
+  explicit OutputFile(OutputWriter &writer)
+    : writer_(writer),
+      isOwningFd_(false),
+      offset_(-1)
+  {
+    target_.fd = -1;
+    target_.pendingCount = 0;
+    target_.error = 0;
+  }
+
+  ~OutputFile()
+  {
+    std::string error;
+    close(error);
+  }
+
+  OutputFile(const OutputFile &) = delete;
+
+  OutputFile &
+  operator=(const OutputFile &) = delete;
+
+  // Member functions
+
+  /**
+   * Create or truncate the file at path.
+   */
+  bool
+  open(const std::string &path,
+       std::string &error)
+  {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                          0666);
+    if (0 > fd) {
+      error = "unable to open '" + path + "': " + std::strerror(errno);
+      return false;
+    }
+    name_ = path;
+    target_.fd = fd;
+    isOwningFd_ = true;
+    offset_ = 0;
+    return true;
+  }
+
+  /**
+   * Write to an open descriptor (e.g. stdout) from its current
+   * position, which is advanced past the output by close().
+   */
+  void
+  attach(const int fd,
+         const std::string &name)
+  {
+    name_ = name;
+    target_.fd = fd;
+    isOwningFd_ = false;
+    offset_ = -1;
+    struct stat status;
+    const int flags = ::fcntl(fd, F_GETFL);
+    if ((0 == ::fstat(fd, &status)) && S_ISREG(status.st_mode) &&
+        (0 <= flags) && (0 == (flags & O_APPEND))) {
+      offset_ = ::lseek(fd, 0, SEEK_CUR);
+    }
+  }
+
+  bool
+  isOpen() const
+  {
+    return 0 <= target_.fd;
+  }
+
+  /**
+   * Queue the buffered output without waiting for it to be written.
+   */
+  void
+  submit()
+  {
+    handOver();
+  }
+
+  /**
+   * Write what is left in the buffer and wait for all the output,
+   * returns false with a description of the problem in error if any of
+   * it couldn't be written.
+   */
+  bool
+  close(std::string &error)
+  {
+    if (!isOpen()) {
+      return true;
+    }
+    handOver();
+    const int writeError = writer_.wait(target_);
+    bool isWritten = (0 == writeError);
+    if (!isWritten) {
+      error = "unable to write '" + name_ + "': " + std::strerror(writeError);
+    }
+    if (isOwningFd_) {
+      if ((0 != ::close(target_.fd)) && isWritten) {
+        error = "unable to write '" + name_ + "': " + std::strerror(errno);
+        isWritten = false;
+      }
+    }
+    else if (0 <= offset_) {
+      ::lseek(target_.fd, offset_, SEEK_SET);
+    }
+    target_.fd = -1;
+    target_.error = 0;
+    return isWritten;
+  }
+
+protected:
+
+  // Member functions
+
+  virtual int_type
+  overflow(int_type character)
+  {
+    if (!isOpen()) {
+      return traits_type::eof();
+    }
+    handOver();
+    char *buffer = writer_.acquire();
+    setp(buffer, buffer + writer_.getBufferSize());
+    if (!traits_type::eq_int_type(character, traits_type::eof())) {
+      *pptr() = traits_type::to_char_type(character);
+      pbump(1);
+    }
+    return traits_type::not_eof(character);
+  }
+
+  virtual int
+  sync()
+  {
+    return 0;
+  }
+
+private:
+
+  // Member functions
+
+  /**
+   * Queue the current buffer, if any.
+   */
+  void
+  handOver()
+  {
+    char *buffer = pbase();
+    if (NULL == buffer) {
+      return;
+    }
+    const std::size_t size = pptr() - buffer;
+    setp(NULL, NULL);
+    if (0 == size) {
+      writer_.release(buffer);
+      return;
+    }
+    writer_.submit(target_, buffer, size, offset_);
+    if (0 <= offset_) {
+      offset_ += size;
+    }
+  }
+
+  // Data members
+
+  OutputWriter &writer_;
+  OutputWriter::Target target_;
+  std::string name_;
+  bool isOwningFd_;
+  /** Offset of the next buffer, negative for in order output. */
+  std::int64_t offset_;
+};
+
+}
+
+#endif
@@ -0,0 +1,275 @@
+// Directory of model snapshots keyed by the content of their input.
+// Copyright 2014 by Brian Davis.
+
+#ifndef parse_cache_HEADER
+#define parse_cache_HEADER
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "eagle_subtrees.hpp"
+#include "model_snapshot.hpp"
+
+namespace jrl
+{
+
+/**
+ * Cache of parsed documents.
+ *
+ * Each entry is a model snapshot (see ModelWriter) named after a hash
+ * of the input bytes, the snapshot format version and the converter
+ * version, so an entry is only found again for identical input read
+ * by a converter which records the same events.  Entries are written
+ * atomically, so several processes may share a directory; the
+ * statistics are merged on a best effort basis and may miss counts
+ * from concurrent runs.
+ *
+ * Once a store takes the directory over its capacity the least
+ * recently used entries (by modification time, which a hit refreshes)
+ * are removed until it fits again.
+ */
+class ParseCache
+{
+public:
+
+  // Types
+
+  struct Statistics
+  {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::uint64_t stores;
+    std::uint64_t evictions;
+    std::uint64_t entryCount;
+    std::uint64_t byteCount;
+  };
+
+  // Constructors/destructors
+
+  ParseCache(const std::string &directory,
+             const std::uint64_t capacity)
+    : directory_(directory),
+      capacity_(capacity)
+  {
+    statistics_.hits = 0;
+    statistics_.misses = 0;
+    statistics_.stores = 0;
+    statistics_.evictions = 0;
+    statistics_.entryCount = 0;
+    statistics_.byteCount = 0;
+  }
+
+  // Member functions
+
+  /**
+   * Create the cache directory if needed and load the statistics kept
+   * in it.  Returns false with a description of the problem in error
+   * if the directory can't be used.
+   */
+  bool
+  open(std::string &error)
+  {
+    if ((0 != ::mkdir(directory_.c_str(), 0777)) && (EEXIST != errno)) {
+      error = "unable to create cache directory '" + directory_ + "'";
+      return false;
+    }
+    struct stat status;
+    if ((0 != ::stat(directory_.c_str(), &status)) || !S_ISDIR(status.st_mode)) {
+      error = "'" + directory_ + "' is not a directory";
+      return false;
+    }
+    std::ifstream input(getStatisticsPath().c_str());
+    input >> statistics_.hits >> statistics_.misses
+          >> statistics_.stores >> statistics_.evictions;
+    if (!input) {
+      statistics_.hits = 0;
+      statistics_.misses = 0;
+      statistics_.stores = 0;
+      statistics_.evictions = 0;
+    }
+    scan(NULL);
+    return true;
+  }
+
+  /**
+   * Key for a document, covering everything which decides the events
+   * recorded for it.
+   */
+  static std::uint64_t
+  computeKey(const std::string &document,
+             const std::string &converterVersion)
+  {
+    ContentHash hash;
+    const std::uint32_t formatVersion = ModelLayout::VERSION;
+    hash.update(reinterpret_cast<const char *>(&formatVersion),
+                sizeof(formatVersion));
+    hash.update(converterVersion.c_str(), converterVersion.size() + 1);
+    hash.update(document.data(), document.size());
+    return hash.get();
+  }
+
+  /**
+   * Map the entry for key into model.  A damaged entry is removed and
+   * counted as a miss.
+   */
+  bool
+  lookup(const std::uint64_t key,
+         ModelReader &model)
+  {
+    const std::string path = getEntryPath(key);
+    std::string error;
+    if (!model.open(path, error)) {
+      if (0 == ::access(path.c_str(), F_OK)) {
+        std::remove(path.c_str());
+      }
+      ++statistics_.misses;
+      return false;
+    }
+    // Refresh the modification time, which orders eviction.
+    ::utimensat(AT_FDCWD, path.c_str(), NULL, 0);
+    ++statistics_.hits;
+    return true;
+  }
+
+  /**
+   * Add the snapshot for key, then evict entries beyond the capacity.
+   */
+  bool
+  store(const std::uint64_t key,
+        const ModelWriter &model,
+        std::string &error)
+  {
+    if (!model.write(getEntryPath(key), error)) {
+      return false;
+    }
+    ++statistics_.stores;
+    std::vector<Entry> entries;
+    scan(&entries);
+    std::sort(entries.begin(), entries.end());
+    for (std::vector<Entry>::const_iterator entry = entries.begin();
+         (entry != entries.end()) && (statistics_.byteCount > capacity_);
+         ++entry) {
+      if (0 == std::remove(entry->second.c_str())) {
+        ++statistics_.evictions;
+        --statistics_.entryCount;
+        statistics_.byteCount -= entry->first.second;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Persist the counters for the next run.
+   */
+  void
+  saveStatistics() const
+  {
+    const std::string path = getStatisticsPath();
+    const std::string temporaryPath = path + ".tmp";
+    {
+      std::ofstream output(temporaryPath.c_str(), std::ios::out | std::ios::trunc);
+      output << statistics_.hits << ' ' << statistics_.misses << ' '
+             << statistics_.stores << ' ' << statistics_.evictions << std::endl;
+      if (!output) {
+        return;
+      }
+    }
+    std::rename(temporaryPath.c_str(), path.c_str());
+  }
+
+  const Statistics &
+  getStatistics() const
+  {
+    return statistics_;
+  }
+
+  std::string
+  getEntryPath(const std::uint64_t key) const
+  {
+    char name[sizeof(key) * 2 + 1];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(key));
+    return directory_ + "/" + name + ENTRY_SUFFIX;
+  }
+
+private:
+
+  // Types
+
+  /** ((modification time, size), path), ordered oldest first. */
+  typedef std::pair<std::pair<std::int64_t, std::uint64_t>, std::string> Entry;
+
+  // Constants
+
+  static constexpr const char *ENTRY_SUFFIX = ".model";
+  static constexpr const char *STATISTICS_NAME = "statistics";
+
+  // Member functions
+
+  std::string
+  getStatisticsPath() const
+  {
+    return directory_ + "/" + STATISTICS_NAME;
+  }
+
+  /**
+   * Count the entries in the directory, optionally listing them.
+   */
+  void
+  scan(std::vector<Entry> *entries)
+  {
+    statistics_.entryCount = 0;
+    statistics_.byteCount = 0;
+    DIR *directory = ::opendir(directory_.c_str());
+    if (NULL == directory) {
+      return;
+    }
+    const std::string suffix(ENTRY_SUFFIX);
+    for (struct dirent *entry = ::readdir(directory); NULL != entry;
+         entry = ::readdir(directory)) {
+      const std::string name(entry->d_name);
+      if ((name.size() <= suffix.size()) ||
+          (0 != name.compare(name.size() - suffix.size(), suffix.size(), suffix))) {
+        continue;
+      }
+      const std::string path = directory_ + "/" + name;
+      struct stat status;
+      if ((0 != ::stat(path.c_str(), &status)) || !S_ISREG(status.st_mode)) {
+        continue;
+      }
+      ++statistics_.entryCount;
+      statistics_.byteCount += status.st_size;
+      if (NULL != entries) {
+        const std::int64_t modified =
+          static_cast<std::int64_t>(status.st_mtim.tv_sec) * 1000000000LL +
+          status.st_mtim.tv_nsec;
+        entries->push_back(Entry(std::make_pair(modified,
+                                                static_cast<std::uint64_t>(status.st_size)),
+                                 path));
+      }
+    }
+    ::closedir(directory);
+  }
+
+  // Data members
+
+  std::string directory_;
+  std::uint64_t capacity_;
+  Statistics statistics_;
+};
+
+}
+
+#endif
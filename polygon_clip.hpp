@@ -0,0 +1,620 @@
+// Scanline polygon clipping.
+// Copyright 2014 by Brian Davis.
+
+#ifndef polygon_clip_HEADER
+#define polygon_clip_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace jrl
+{
+
+/**
+ * Vertex of a polygon contour.
+ */
+struct ClipPoint
+{
+  ClipPoint()
+    : x(0.0), y(0.0)
+  {
+  }
+
+  ClipPoint(const double px,
+            const double py)
+    : x(px + 0.0), y(py + 0.0)  // NOTE: normalizes -0.0
+  {
+  }
+
+  bool
+  operator==(const ClipPoint &other) const
+  {
+    return (x == other.x) && (y == other.y);
+  }
+
+  double x;
+  double y;
+};
+
+typedef std::vector<ClipPoint> Contour;
+
+/**
+ * Connected area resulting from clipping: an outer contour
+ * (counterclockwise) and any holes within it (clockwise).
+ */
+struct ClipRegion
+{
+  Contour outer;
+  std::vector<Contour> holes;
+};
+
+/**
+ * Signed area of a closed contour, positive when counterclockwise.
+ */
+inline double
+getSignedArea(const Contour &contour)
+{
+  double area = 0.0;
+  for (std::size_t index = 0, previous = contour.size() - 1;
+       index < contour.size(); previous = index++) {
+    area += (contour[previous].x * contour[index].y) -
+      (contour[index].x * contour[previous].y);
+  }
+  return 0.5 * area;
+}
+
+/**
+ * Even-odd point in polygon test.
+ */
+inline bool
+isInside(const Contour &contour,
+         const ClipPoint &point)
+{
+  bool isInside = false;
+  for (std::size_t index = 0, previous = contour.size() - 1;
+       index < contour.size(); previous = index++) {
+    const ClipPoint &a = contour[previous];
+    const ClipPoint &b = contour[index];
+    if (((a.y > point.y) != (b.y > point.y)) &&
+        (point.x < a.x + ((point.y - a.y) * (b.x - a.x) / (b.y - a.y)))) {
+      isInside = !isInside;
+    }
+  }
+  return isInside;
+}
+
+/**
+ * Subtracts the union of a set of obstacle polygons from a subject
+ * polygon with a single sweep of a horizontal scanline.
+ *
+ * The plane is cut into bands at every vertex and every crossing of two
+ * edges, so that within a band the edges are ordered and the result is
+ * a set of trapezoids bounded by a left and a right edge.  The
+ * boundaries of the trapezoids are then stitched back together into
+ * contours.  Edge positions at each band boundary are computed once and
+ * shared by the bands above and below it, so the stitching can use
+ * exact comparisons.
+ *
+ * The subject uses the even-odd rule, obstacles are unioned regardless
+ * of their orientation.
+ */
+class ScanlineClipper
+{
+public:
+
+  // Member functions
+
+  void
+  clear()
+  {
+    edges_.clear();
+  }
+
+  void
+  setSubject(const Contour &subject)
+  {
+    addContour(subject, true);
+  }
+
+  void
+  addObstacle(const Contour &obstacle)
+  {
+    addContour(obstacle, false);
+  }
+
+  /**
+   * Compute the subject minus the obstacles.
+   */
+  void
+  subtract(std::vector<ClipRegion> &regions)
+  {
+    regions.clear();
+    segments_.clear();
+    sweep();
+    std::vector<Contour> contours;
+    stitch(contours);
+
+    std::vector<Contour> holes;
+    for (std::vector<Contour>::iterator contour = contours.begin();
+         contour != contours.end(); ++contour) {
+      if (0.0 < getSignedArea(*contour)) {
+        regions.push_back(ClipRegion());
+        regions.back().outer.swap(*contour);
+      }
+      else {
+        holes.push_back(Contour());
+        holes.back().swap(*contour);
+      }
+    }
+    std::vector<double> areas(regions.size());
+    for (std::size_t index = 0; index < regions.size(); ++index) {
+      areas[index] = getSignedArea(regions[index].outer);
+    }
+    for (std::vector<Contour>::iterator hole = holes.begin();
+         hole != holes.end(); ++hole) {
+      // Assign to the smallest enclosing outer contour.
+      ClipRegion *owner = NULL;
+      double ownerArea = 0.0;
+      for (std::size_t index = 0; index < regions.size(); ++index) {
+        if (((NULL == owner) || (areas[index] < ownerArea)) &&
+            isInside(regions[index].outer, (*hole)[0])) {
+          owner = &regions[index];
+          ownerArea = areas[index];
+        }
+      }
+      if (NULL != owner) {
+        owner->holes.push_back(Contour());
+        owner->holes.back().swap(*hole);
+      }
+    }
+  }
+
+private:
+
+  // Types
+
+  struct Edge
+  {
+    double xLow;
+    double yLow;
+    double xHigh;
+    double yHigh;
+    double dxdy;
+    int winding;  // +1 for upward edges of counterclockwise contours
+    bool isSubject;
+  };
+
+  struct Interval
+  {
+    Interval(const double l,
+             const double r)
+      : left(l), right(r)
+    {
+    }
+
+    double left;
+    double right;
+  };
+
+  struct Segment
+  {
+    Segment(const ClipPoint &f,
+            const ClipPoint &t)
+      : from(f), to(t)
+    {
+    }
+
+    ClipPoint from;
+    ClipPoint to;
+  };
+
+  class SegmentOrder
+  {
+  public:
+    explicit SegmentOrder(const std::vector<Segment> &segments)
+      : segments_(segments)
+    {
+    }
+
+    bool
+    operator()(const std::uint32_t a,
+               const std::uint32_t b) const
+    {
+      return isBefore(segments_[a].from, segments_[b].from);
+    }
+
+    bool
+    operator()(const std::uint32_t a,
+               const ClipPoint &b) const
+    {
+      return isBefore(segments_[a].from, b);
+    }
+
+  private:
+    static bool
+    isBefore(const ClipPoint &a,
+             const ClipPoint &b)
+    {
+      return (a.y < b.y) || ((a.y == b.y) && (a.x < b.x));
+    }
+
+    const std::vector<Segment> &segments_;
+  };
+
+  class EdgeOrder
+  {
+  public:
+    EdgeOrder(const std::vector<Edge> &edges,
+              const std::vector<double> &xs)
+      : edges_(edges), xs_(xs)
+    {
+    }
+
+    bool
+    operator()(const std::uint32_t a,
+               const std::uint32_t b) const
+    {
+      if (xs_[a] != xs_[b]) {
+        return xs_[a] < xs_[b];
+      }
+      return edges_[a].dxdy < edges_[b].dxdy;
+    }
+
+  private:
+    const std::vector<Edge> &edges_;
+    const std::vector<double> &xs_;
+  };
+
+  class EdgeStart
+  {
+  public:
+    bool
+    operator()(const Edge &a,
+               const Edge &b) const
+    {
+      return a.yLow < b.yLow;
+    }
+  };
+
+  typedef std::vector<Interval> Intervals;
+
+  // Member functions
+
+  void
+  addContour(const Contour &contour,
+             const bool isSubject)
+  {
+    if (3 > contour.size()) {
+      return;
+    }
+    const int orientation = (0.0 > getSignedArea(contour)) ? -1 : 1;
+    for (std::size_t index = 0, previous = contour.size() - 1;
+         index < contour.size(); previous = index++) {
+      const ClipPoint &a = contour[previous];
+      const ClipPoint &b = contour[index];
+      if (a.y == b.y) {
+        // Horizontal edges never bound a band.
+        continue;
+      }
+      Edge edge;
+      const bool isUpward = (a.y < b.y);
+      const ClipPoint &low = isUpward ? a : b;
+      const ClipPoint &high = isUpward ? b : a;
+      edge.xLow = low.x;
+      edge.yLow = low.y;
+      edge.xHigh = high.x;
+      edge.yHigh = high.y;
+      edge.dxdy = (high.x - low.x) / (high.y - low.y);
+      edge.winding = (isUpward ? 1 : -1) * orientation;
+      edge.isSubject = isSubject;
+      edges_.push_back(edge);
+    }
+  }
+
+  static double
+  getX(const Edge &edge,
+       const double y)
+  {
+    if (y == edge.yLow) {
+      return edge.xLow;
+    }
+    if (y == edge.yHigh) {
+      return edge.xHigh;
+    }
+    return edge.xLow + ((y - edge.yLow) * edge.dxdy);
+  }
+
+  void
+  sweep()
+  {
+    if (edges_.empty()) {
+      return;
+    }
+    std::stable_sort(edges_.begin(), edges_.end(), EdgeStart());
+    std::vector<double> ys;
+    ys.reserve(2 * edges_.size());
+    for (std::vector<Edge>::const_iterator edge = edges_.begin();
+         edge != edges_.end(); ++edge) {
+      ys.push_back(edge->yLow);
+      ys.push_back(edge->yHigh);
+    }
+    std::sort(ys.begin(), ys.end());
+    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+    std::vector<double> xBottom(edges_.size());
+    std::vector<double> xTop(edges_.size());
+    std::vector<std::uint32_t> active;
+    Intervals previousTops;
+    Intervals bottoms;
+    Intervals tops;
+    double previousY = ys[0];
+    std::size_t nextEdge = 0;
+    std::size_t nextY = 0;
+    double y0 = ys[0];
+    for (;;) {
+      std::size_t kept = 0;
+      for (std::size_t index = 0; index < active.size(); ++index) {
+        if (edges_[active[index]].yHigh > y0) {
+          active[kept++] = active[index];
+        }
+      }
+      active.resize(kept);
+      while ((nextEdge < edges_.size()) && (edges_[nextEdge].yLow <= y0)) {
+        xBottom[nextEdge] = edges_[nextEdge].xLow;
+        active.push_back(nextEdge++);
+      }
+      if (active.empty()) {
+        addHorizontals(previousTops, Intervals(), previousY);
+        previousTops.clear();
+        if (edges_.size() == nextEdge) {
+          break;
+        }
+        y0 = edges_[nextEdge].yLow;
+        continue;
+      }
+      while (ys[nextY] <= y0) {
+        ++nextY;
+      }
+      double y1 = ys[nextY];
+
+      // NOTE: the first crossing within the band is always between
+      // edges which are adjacent at its bottom.
+      std::sort(active.begin(), active.end(), EdgeOrder(edges_, xBottom));
+      for (std::size_t index = 1; index < active.size(); ++index) {
+        const Edge &a = edges_[active[index - 1]];
+        const Edge &b = edges_[active[index]];
+        const double closing = a.dxdy - b.dxdy;
+        if (0.0 < closing) {
+          const double y = y0 +
+            ((xBottom[active[index]] - xBottom[active[index - 1]]) / closing);
+          if ((y0 < y) && (y < y1)) {
+            y1 = y;
+          }
+        }
+      }
+      for (std::size_t index = 0; index < active.size(); ++index) {
+        xTop[active[index]] = getX(edges_[active[index]], y1);
+      }
+      for (std::size_t index = 1; index < active.size(); ++index) {
+        // Edges which cross at the top of the band must meet exactly
+        // (otherwise rounding can leave them in the wrong order for the
+        // next band), keeping any value which is a vertex.
+        const std::uint32_t a = active[index - 1];
+        const std::uint32_t b = active[index];
+        if ((xTop[a] > xTop[b]) ||
+            ((edges_[a].dxdy > edges_[b].dxdy) &&
+             (xTop[b] - xTop[a] <= CROSSING_TOLERANCE))) {
+          const double x = (y1 == edges_[a].yHigh) ? xTop[a] :
+            (y1 == edges_[b].yHigh) ? xTop[b] : 0.5 * (xTop[a] + xTop[b]);
+          xTop[a] = x;
+          xTop[b] = x;
+        }
+      }
+
+      bottoms.clear();
+      tops.clear();
+      unsigned parity = 0;
+      int winding = 0;
+      bool isInside = false;
+      std::uint32_t left = 0;
+      for (std::size_t index = 0; index < active.size(); ++index) {
+        const std::uint32_t current = active[index];
+        const Edge &edge = edges_[current];
+        if (edge.isSubject) {
+          parity ^= 1;
+        }
+        else {
+          winding += edge.winding;
+        }
+        const bool isNowInside = (0 != parity) && (0 == winding);
+        if (isNowInside && (!isInside)) {
+          left = current;
+        }
+        else if (isInside && (!isNowInside)) {
+          addSegment(ClipPoint(xTop[left], y1), ClipPoint(xBottom[left], y0));
+          addSegment(ClipPoint(xBottom[current], y0),
+                     ClipPoint(xTop[current], y1));
+          bottoms.push_back(Interval(xBottom[left], xBottom[current]));
+          tops.push_back(Interval(xTop[left], xTop[current]));
+        }
+        isInside = isNowInside;
+      }
+      if (previousY != y0) {
+        addHorizontals(previousTops, Intervals(), previousY);
+        previousTops.clear();
+      }
+      addHorizontals(previousTops, bottoms, y0);
+      previousTops.swap(tops);
+      previousY = y1;
+
+      for (std::size_t index = 0; index < active.size(); ++index) {
+        xBottom[active[index]] = xTop[active[index]];
+      }
+      y0 = y1;
+    }
+  }
+
+  /**
+   * Boundary along a band boundary: where the area is only below it
+   * runs right to left, where the area is only above it runs left to
+   * right.
+   */
+  void
+  addHorizontals(const Intervals &below,
+                 const Intervals &above,
+                 const double y)
+  {
+    Intervals difference;
+    subtract(below, above, difference);
+    for (Intervals::const_iterator iter = difference.begin();
+         iter != difference.end(); ++iter) {
+      addSegment(ClipPoint(iter->right, y), ClipPoint(iter->left, y));
+    }
+    subtract(above, below, difference);
+    for (Intervals::const_iterator iter = difference.begin();
+         iter != difference.end(); ++iter) {
+      addSegment(ClipPoint(iter->left, y), ClipPoint(iter->right, y));
+    }
+  }
+
+  /**
+   * Difference of two sorted lists of disjoint intervals.
+   */
+  static void
+  subtract(const Intervals &from,
+           const Intervals &removed,
+           Intervals &difference)
+  {
+    difference.clear();
+    std::size_t next = 0;
+    for (Intervals::const_iterator iter = from.begin(); iter != from.end();
+         ++iter) {
+      double current = iter->left;
+      while ((next < removed.size()) && (removed[next].right <= current)) {
+        ++next;
+      }
+      for (std::size_t index = next;
+           (index < removed.size()) && (removed[index].left < iter->right);
+           ++index) {
+        if (removed[index].left > current) {
+          difference.push_back(Interval(current, removed[index].left));
+        }
+        current = std::max(current, removed[index].right);
+      }
+      if (current < iter->right) {
+        difference.push_back(Interval(current, iter->right));
+      }
+    }
+  }
+
+  void
+  addSegment(const ClipPoint &from,
+             const ClipPoint &to)
+  {
+    if (!(from == to)) {
+      segments_.push_back(Segment(from, to));
+    }
+  }
+
+  /**
+   * Join the boundary segments end to start into closed contours.
+   */
+  void
+  stitch(std::vector<Contour> &contours) const
+  {
+    // Segments ordered by start point, searched for the successor of
+    // each segment.
+    const SegmentOrder order(segments_);
+    std::vector<std::uint32_t> starts(segments_.size());
+    for (std::uint32_t index = 0; index < segments_.size(); ++index) {
+      starts[index] = index;
+    }
+    std::sort(starts.begin(), starts.end(), order);
+    std::vector<bool> isUsed(segments_.size(), false);
+    for (std::uint32_t first = 0; first < segments_.size(); ++first) {
+      if (isUsed[first]) {
+        continue;
+      }
+      Contour contour;
+      std::uint32_t current = first;
+      for (;;) {
+        isUsed[current] = true;
+        contour.push_back(segments_[current].from);
+        const ClipPoint &end = segments_[current].to;
+        if (end == segments_[first].from) {
+          break;
+        }
+        std::vector<std::uint32_t>::const_iterator next =
+          std::lower_bound(starts.begin(), starts.end(), end, order);
+        while ((starts.end() != next) && (segments_[*next].from == end) &&
+               isUsed[*next]) {
+          ++next;
+        }
+        if ((starts.end() == next) || (!(segments_[*next].from == end))) {
+          // NOTE: only possible with degenerate input, drop the
+          // partial contour.
+          contour.clear();
+          break;
+        }
+        current = *next;
+      }
+      simplify(contour);
+      if (3 <= contour.size()) {
+        contours.push_back(Contour());
+        contours.back().swap(contour);
+      }
+    }
+  }
+
+  /**
+   * Remove the vertices introduced along straight edges by the band
+   * boundaries.
+   */
+  static void
+  simplify(Contour &contour)
+  {
+    bool isChanged = true;
+    while (isChanged && (3 <= contour.size())) {
+      isChanged = false;
+      Contour result;
+      result.reserve(contour.size());
+      const std::size_t size = contour.size();
+      for (std::size_t index = 0; index < size; ++index) {
+        const ClipPoint &previous =
+          result.empty() ? contour[size - 1] : result.back();
+        const ClipPoint &current = contour[index];
+        const ClipPoint &next = contour[(index + 1) % size];
+        const double ax = current.x - previous.x;
+        const double ay = current.y - previous.y;
+        const double bx = next.x - current.x;
+        const double by = next.y - current.y;
+        const double scale = (ax * ax) + (ay * ay) + (bx * bx) + (by * by);
+        if (std::fabs((ax * by) - (ay * bx)) <= COLLINEAR_TOLERANCE * scale) {
+          isChanged = true;
+          continue;
+        }
+        result.push_back(current);
+      }
+      contour.swap(result);
+    }
+  }
+
+  // Constants
+
+  static constexpr double COLLINEAR_TOLERANCE = 1e-12;
+  // NOTE: absolute, in contour units (i.e. mm for board coordinates).
+  static constexpr double CROSSING_TOLERANCE = 1e-9;
+
+  // Data members
+
+  std::vector<Edge> edges_;
+  std::vector<Segment> segments_;
+};
+
+}
+
+#endif
@@ -0,0 +1,262 @@
+// Uniform grid spatial index.
+// Copyright 2014 by Brian Davis.
+
+#ifndef spatial_grid_HEADER
+#define spatial_grid_HEADER
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace jrl
+{
+
+/**
+ * Axis aligned bounding box.
+ */
+class BoundingBox
+{
+public:
+
+  // Constructors/destructors
+
+  BoundingBox()
+    : minX_(0.0), minY_(0.0), maxX_(0.0), maxY_(0.0), isEmpty_(true)
+  {
+  }
+
+  BoundingBox(const double minX,
+              const double minY,
+              const double maxX,
+              const double maxY)
+    : minX_(minX), minY_(minY), maxX_(maxX), maxY_(maxY), isEmpty_(false)
+  {
+  }
+
+  // Member functions
+
+  void
+  add(const double x,
+      const double y)
+  {
+    if (isEmpty_) {
+      minX_ = maxX_ = x;
+      minY_ = maxY_ = y;
+      isEmpty_ = false;
+      return;
+    }
+    minX_ = std::min(minX_, x);
+    minY_ = std::min(minY_, y);
+    maxX_ = std::max(maxX_, x);
+    maxY_ = std::max(maxY_, y);
+  }
+
+  /**
+   * Copy grown by margin on every side.
+   */
+  BoundingBox
+  expand(const double margin) const
+  {
+    return BoundingBox(minX_ - margin, minY_ - margin,
+                       maxX_ + margin, maxY_ + margin);
+  }
+
+  bool
+  intersects(const BoundingBox &other) const
+  {
+    return (!isEmpty_) && (!other.isEmpty_) &&
+      (minX_ <= other.maxX_) && (other.minX_ <= maxX_) &&
+      (minY_ <= other.maxY_) && (other.minY_ <= maxY_);
+  }
+
+  bool
+  isEmpty() const
+  {
+    return isEmpty_;
+  }
+
+  double
+  getMinX() const
+  {
+    return minX_;
+  }
+
+  double
+  getMinY() const
+  {
+    return minY_;
+  }
+
+  double
+  getMaxX() const
+  {
+    return maxX_;
+  }
+
+  double
+  getMaxY() const
+  {
+    return maxY_;
+  }
+
+private:
+
+  // Data members
+
+  double minX_;
+  double minY_;
+  double maxX_;
+  double maxY_;
+  bool isEmpty_;
+};
+
+/**
+ * Uniform grid of square cells, each holding the ids of the items whose
+ * bounding boxes overlap it.  Queries only visit the cells overlapped by
+ * the query box, so the cost is proportional to the local density
+ * rather than to the total number of items.
+ */
+class SpatialGrid
+{
+public:
+
+  // Types
+
+  struct Cell
+  {
+    std::int64_t column;
+    std::int64_t row;
+    /** Items overlapping the cell, in insertion order. */
+    const std::vector<std::uint32_t> *ids;
+  };
+
+  // Constructors/destructors
+
+  explicit SpatialGrid(const double cellSize)
+    : cellSize_(cellSize), stamp_(0)
+  {
+  }
+
+  // Member functions
+
+  double
+  getCellSize() const
+  {
+    return cellSize_;
+  }
+
+  /**
+   * Add an item, ids are expected to be dense.
+   */
+  void
+  insert(const std::uint32_t id,
+         const BoundingBox &box)
+  {
+    if (stamps_.size() <= id) {
+      stamps_.resize(id + 1, 0);
+    }
+    const std::int64_t minColumn = toCell(box.getMinX());
+    const std::int64_t maxColumn = toCell(box.getMaxX());
+    const std::int64_t minRow = toCell(box.getMinY());
+    const std::int64_t maxRow = toCell(box.getMaxY());
+    for (std::int64_t row = minRow; row <= maxRow; ++row) {
+      for (std::int64_t column = minColumn; column <= maxColumn; ++column) {
+        cells_[getKey(column, row)].push_back(id);
+      }
+    }
+  }
+
+  /**
+   * Ids of all items whose cells overlap the box (each reported once,
+   * the caller is expected to do any exact test).
+   */
+  void
+  query(const BoundingBox &box,
+        std::vector<std::uint32_t> &ids) const
+  {
+    ids.clear();
+    if (0 == ++stamp_) {
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      stamp_ = 1;
+    }
+    const std::int64_t minColumn = toCell(box.getMinX());
+    const std::int64_t maxColumn = toCell(box.getMaxX());
+    const std::int64_t minRow = toCell(box.getMinY());
+    const std::int64_t maxRow = toCell(box.getMaxY());
+    for (std::int64_t row = minRow; row <= maxRow; ++row) {
+      for (std::int64_t column = minColumn; column <= maxColumn; ++column) {
+        const Cells::const_iterator cell = cells_.find(getKey(column, row));
+        if (cells_.end() == cell) {
+          continue;
+        }
+        for (std::vector<std::uint32_t>::const_iterator id = cell->second.begin();
+             id != cell->second.end(); ++id) {
+          if (stamp_ != stamps_[*id]) {
+            stamps_[*id] = stamp_;
+            ids.push_back(*id);
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * All the occupied cells, e.g. to process them independently; valid
+   * until the next insert().
+   */
+  void
+  getCells(std::vector<Cell> &cells) const
+  {
+    cells.clear();
+    cells.reserve(cells_.size());
+    for (Cells::const_iterator cell = cells_.begin(); cell != cells_.end();
+         ++cell) {
+      const Cell entry = {
+        static_cast<std::int32_t>(cell->first >> 32),
+        static_cast<std::int32_t>(cell->first & 0xffffffffU),
+        &cell->second
+      };
+      cells.push_back(entry);
+    }
+  }
+
+  /**
+   * Column (or row) of the cells holding a coordinate.
+   */
+  std::int64_t
+  toCell(const double coordinate) const
+  {
+    return static_cast<std::int64_t>(std::floor(coordinate / cellSize_));
+  }
+
+private:
+
+  // Types
+
+  typedef std::unordered_map<std::uint64_t, std::vector<std::uint32_t> > Cells;
+
+  // Member functions
+
+  static std::uint64_t
+  getKey(const std::int64_t column,
+         const std::int64_t row)
+  {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(column)) << 32) |
+      static_cast<std::uint32_t>(row);
+  }
+
+  // Data members
+
+  const double cellSize_;
+  Cells cells_;
+  // NOTE: per-item stamps used to report each item once per query.
+  mutable std::vector<std::uint32_t> stamps_;
+  mutable std::uint32_t stamp_;
+};
+
+}
+
+#endif
@@ -0,0 +1,274 @@
+// Temporary file for output held back under a memory limit.
+// Copyright 2014 by Brian Davis.
+
+#ifndef spill_file_HEADER
+#define spill_file_HEADER
+
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace jrl
+{
+
+/**
+ * Tracks the resident memory of the process against a limit, so that
+ * large intermediate results can be moved out of memory before the
+ * limit is reached.
+ */
+class MemoryBudget
+{
+public:
+
+  // Constructors/destructors
+
+  explicit MemoryBudget(const std::uint64_t limit)
+    : limit_(limit)
+  {
+  }
+
+  // Member functions
+
+  std::uint64_t
+  getLimit() const
+  {
+    return limit_;
+  }
+
+  /**
+   * Whether the resident memory is within a margin of the limit, which
+   * leaves room for the output still to be produced.
+   */
+  bool
+  isNearLimit() const
+  {
+    return getResidentBytes() >= (limit_ / 8) * 7;
+  }
+
+  /**
+   * Hand memory freed after spilling back to the system, so that the
+   * resident size actually drops.
+   */
+  static void
+  releaseFreeMemory()
+  {
+#if defined(__GLIBC__)
+    ::malloc_trim(0);
+#endif
+  }
+
+  /** Current resident size of the process. */
+  static std::uint64_t
+  getResidentBytes()
+  {
+    std::FILE *file = std::fopen("/proc/self/statm", "r");
+    if (NULL == file) {
+      return 0;
+    }
+    unsigned long long size = 0;
+    unsigned long long resident = 0;
+    const int count = std::fscanf(file, "%llu %llu", &size, &resident);
+    std::fclose(file);
+    return (2 == count) ?
+      resident * static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE)) : 0;
+  }
+
+  /** Largest resident size of the process so far. */
+  static std::uint64_t
+  getPeakResidentBytes()
+  {
+    struct rusage usage;
+    if (0 != ::getrusage(RUSAGE_SELF, &usage)) {
+      return 0;
+    }
+    return static_cast<std::uint64_t>(usage.ru_maxrss) << 10;
+  }
+
+private:
+
+  // Data members
+
+  std::uint64_t limit_;
+};
+
+/**
+ * Anonymous temporary file to which chunks of bytes are appended and
+ * later streamed back through a memory mapping, so that reading them
+ * back doesn't need a buffer of their size either.
+ *
+ * The file is unlinked as soon as it is created, so it never outlives
+ * the process, however that ends.
+ */
+class SpillFile
+{
+public:
+
+  // Types
+
+  struct Extent
+  {
+    std::uint64_t offset;
+    std::uint64_t size;
+  };
+
+  // Constructors/destructors
+
+  explicit SpillFile(const std::string &directory)
+    : directory_(directory), fd_(-1), size_(0), chunkCount_(0)
+  {
+  }
+
+  ~SpillFile()
+  {
+    if (0 <= fd_) {
+      ::close(fd_);
+    }
+  }
+
+  SpillFile(const SpillFile &) = delete;
+
+  SpillFile &
+  operator=(const SpillFile &) = delete;
+
+  // Member functions
+
+  /**
+   * Directory for spill files: $TMPDIR, or /tmp.
+   */
+  static std::string
+  getDefaultDirectory()
+  {
+    const char *directory = std::getenv("TMPDIR");
+    return ((NULL == directory) || ('\0' == *directory)) ? "/tmp" : directory;
+  }
+
+  /**
+   * Append bytes, returning where they were stored in extent.  The
+   * file is created by the first append.
+   */
+  bool
+  append(const std::string &bytes,
+         Extent &extent,
+         std::string &error)
+  {
+    if ((0 > fd_) && (!create(error))) {
+      return false;
+    }
+    extent.offset = size_;
+    extent.size = bytes.size();
+    const char *data = bytes.data();
+    std::size_t rest = bytes.size();
+    while (0 < rest) {
+      const ssize_t written = ::pwrite(fd_, data, rest, size_);
+      if (0 > written) {
+        if (EINTR == errno) {
+          continue;
+        }
+        error = std::string("unable to write spill file: ") +
+          std::strerror(errno);
+        return false;
+      }
+      data += written;
+      rest -= written;
+      size_ += written;
+    }
+    ++chunkCount_;
+    return true;
+  }
+
+  /**
+   * Write the bytes of an extent to strm, mapping them a window at a
+   * time.
+   */
+  bool
+  copy(const Extent &extent,
+       std::ostream &strm,
+       std::string &error) const
+  {
+    const std::uint64_t pageSize = ::sysconf(_SC_PAGESIZE);
+    const std::uint64_t windowSize = WINDOW_SIZE;
+    std::uint64_t position = extent.offset;
+    const std::uint64_t end = extent.offset + extent.size;
+    while (position < end) {
+      const std::uint64_t start = position - (position % pageSize);
+      const std::size_t length =
+        static_cast<std::size_t>(std::min(end - start, windowSize));
+      void *mapping = ::mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd_, start);
+      if (MAP_FAILED == mapping) {
+        error = std::string("unable to map spill file: ") +
+          std::strerror(errno);
+        return false;
+      }
+      ::madvise(mapping, length, MADV_SEQUENTIAL);
+      const std::size_t skip = static_cast<std::size_t>(position - start);
+      strm.write(static_cast<const char *>(mapping) + skip, length - skip);
+      ::munmap(mapping, length);
+      position = start + length;
+    }
+    return true;
+  }
+
+  /** Bytes spilled so far. */
+  std::uint64_t
+  getSize() const
+  {
+    return size_;
+  }
+
+  std::uint64_t
+  getChunkCount() const
+  {
+    return chunkCount_;
+  }
+
+private:
+
+  // Constants
+
+  /** Bytes mapped at a time when streaming an extent back. */
+  static const std::size_t WINDOW_SIZE = 16 << 20;
+
+  // Member functions
+
+  bool
+  create(std::string &error)
+  {
+    std::string path = directory_ + "/eagle2gedapcb-spill-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    fd_ = ::mkstemp(&name[0]);
+    if (0 > fd_) {
+      error = "unable to create spill file in '" + directory_ + "': " +
+        std::strerror(errno);
+      return false;
+    }
+    ::unlink(&name[0]);
+    return true;
+  }
+
+  // Data members
+
+  std::string directory_;
+  int fd_;
+  std::uint64_t size_;
+  std::uint64_t chunkCount_;
+};
+
+}
+
+#endif
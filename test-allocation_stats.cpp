@@ -0,0 +1,74 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// STL includes
+#include <vector>
+
+// Local includes
+#include "allocation_stats.hpp"
+#include "interner.hpp"
+
+namespace
+{
+
+class Record : public jrl::AllocationCounted<jrl::AllocationStatistics::MODEL_TAG>
+{
+public:
+  double x;
+  double y;
+};
+
+}
+
+TEST_CASE("allocations counted per tag", "[allocation_stats]") {
+  jrl::AllocationStatistics::enable();
+  typedef jrl::AllocationStatistics Statistics;
+
+  SECTION("container allocations are counted") {
+    const Statistics::Counters before = Statistics::get(Statistics::OUTPUT_TAG);
+    {
+      std::vector<int, jrl::CountingAllocator<int, Statistics::OUTPUT_TAG> > values;
+      values.reserve(1000);
+      REQUIRE((before.current + 4000) ==
+              Statistics::get(Statistics::OUTPUT_TAG).current);
+    }
+    const Statistics::Counters after = Statistics::get(Statistics::OUTPUT_TAG);
+    REQUIRE(before.current == after.current);
+    REQUIRE(4000 <= after.peak);
+    REQUIRE((before.count + 1) == after.count);
+  }
+
+  SECTION("objects are counted with their own size") {
+    const Statistics::Counters before = Statistics::get(Statistics::MODEL_TAG);
+    Record *record = new Record;
+    REQUIRE((before.current + static_cast<std::int64_t>(sizeof(Record))) ==
+            Statistics::get(Statistics::MODEL_TAG).current);
+    delete record;
+    REQUIRE(before.current == Statistics::get(Statistics::MODEL_TAG).current);
+  }
+
+  SECTION("reused buffers are counted by capacity") {
+    const Statistics::Counters before = Statistics::get(Statistics::ATTRIBUTE_TAG);
+    {
+      jrl::CapacityCounter<Statistics::ATTRIBUTE_TAG> counter;
+      counter.update(100);
+      counter.update(100);
+      counter.update(300);
+      REQUIRE((before.current + 300) ==
+              Statistics::get(Statistics::ATTRIBUTE_TAG).current);
+      REQUIRE((before.count + 2) == Statistics::get(Statistics::ATTRIBUTE_TAG).count);
+    }
+    REQUIRE(before.current == Statistics::get(Statistics::ATTRIBUTE_TAG).current);
+  }
+
+  SECTION("interned strings are counted until released") {
+    const Statistics::Counters before = Statistics::get(Statistics::STRING_TAG);
+    {
+      jrl::Interner interner;
+      interner.intern("a signal name longer than any small string buffer");
+      interner.intern("a signal name longer than any small string buffer");
+      REQUIRE(before.current < Statistics::get(Statistics::STRING_TAG).current);
+    }
+    REQUIRE(before.current == Statistics::get(Statistics::STRING_TAG).current);
+  }
+}
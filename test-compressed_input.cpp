@@ -0,0 +1,67 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Standard C library includes
+#include <cstdio>
+#include <fcntl.h>
+#include <zlib.h>
+
+// STL includes
+#include <string>
+
+// Local includes
+#include "compressed_input.hpp"
+
+static std::string
+readAll(const std::string &path,
+        std::string &error)
+{
+  jrl::DecompressingReader reader(::open(path.c_str(), O_RDONLY), true);
+  std::string result;
+  char block[1000];
+  std::size_t count;
+  while (0 < (count = reader.read(block, sizeof(block)))) {
+    result.append(block, count);
+  }
+  REQUIRE(result.size() == reader.getPosition());
+  REQUIRE(result.size() == reader.getStatistics().outputBytes);
+  REQUIRE(0 < reader.getStatistics().readCount);
+  error = reader.getError();
+  return result;
+}
+
+TEST_CASE("input decompressed on a separate thread", "[compressed]") {
+  const std::string path = "test-compressed_input.tmp";
+  std::string document;
+  for (int index = 0; index < 100000; ++index) {
+    document += "<wire x1=\"" + std::to_string(index) + "\"/>\n";
+  }
+  std::string error;
+
+  SECTION("plain input is passed through") {
+    FILE *file = std::fopen(path.c_str(), "wb");
+    std::fwrite(document.data(), 1, document.size(), file);
+    std::fclose(file);
+    REQUIRE(document == readAll(path, error));
+    REQUIRE(error.empty());
+  }
+
+  SECTION("gzip input is decompressed") {
+    gzFile file = ::gzopen(path.c_str(), "wb");
+    ::gzwrite(file, document.data(), document.size());
+    ::gzclose(file);
+    REQUIRE(document == readAll(path, error));
+    REQUIRE(error.empty());
+  }
+
+  SECTION("truncated gzip input is reported") {
+    gzFile file = ::gzopen(path.c_str(), "wb");
+    ::gzwrite(file, document.data(), document.size());
+    ::gzclose(file);
+    REQUIRE(0 == ::truncate(path.c_str(), 100));
+    readAll(path, error);
+    REQUIRE_FALSE(error.empty());
+  }
+
+  std::remove(path.c_str());
+}
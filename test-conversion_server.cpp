@@ -0,0 +1,128 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Standard C library includes
+#include <unistd.h>
+
+// STL includes
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <thread>
+
+// Local includes
+#include "conversion_server.hpp"
+
+namespace
+{
+
+/**
+ * Answers with the request body reversed.
+ */
+class ReversingConverter : public jrl::ConversionServer::Converter
+{
+public:
+
+  virtual void
+  convert(const unsigned worker,
+          const jrl::ServerMessage &request,
+          jrl::ServerMessage &response)
+  {
+    if (request.has("option", "fail")) {
+      throw std::runtime_error("failed");
+    }
+    response.setCommand("OK");
+    response.add("worker", std::to_string(worker));
+    response.getBody().assign(request.getBody().rbegin(),
+                              request.getBody().rend());
+  }
+};
+
+}
+
+TEST_CASE("conversion requests served over a socket", "[server]") {
+  const std::string path = "test-conversion_server.sock";
+  ReversingConverter converter;
+  jrl::ConversionServer server(path, 2, 1 << 20, converter);
+  std::string error;
+  REQUIRE(server.open(error));
+  std::thread acceptor(&jrl::ConversionServer::run, &server);
+
+  const int fd = jrl::MessageChannel::connect(path, error);
+  REQUIRE(0 <= fd);
+  jrl::MessageChannel channel(fd);
+  jrl::ServerMessage request;
+  jrl::ServerMessage response;
+
+  SECTION("requests on a connection are answered in turn") {
+    request.setCommand(jrl::ConversionServer::CONVERT_COMMAND);
+    request.add("option", "check-nets");
+    for (int index = 0; index < 3; ++index) {
+      request.getBody() = std::string(100000, 'a') + std::to_string(index);
+      REQUIRE(channel.write(request, error));
+      REQUIRE(channel.read(response, 1 << 20, error));
+      REQUIRE("OK" == response.getCommand());
+      REQUIRE((std::to_string(index) + std::string(100000, 'a')) ==
+              response.getBody());
+    }
+  }
+
+  SECTION("failures are reported") {
+    request.setCommand(jrl::ConversionServer::CONVERT_COMMAND);
+    request.add("option", "fail");
+    REQUIRE(channel.write(request, error));
+    REQUIRE(channel.read(response, 1 << 20, error));
+    REQUIRE("ERROR failed" == response.getCommand());
+
+    request.setCommand("HELLO");
+    REQUIRE(channel.write(request, error));
+    REQUIRE(channel.read(response, 1 << 20, error));
+    REQUIRE("ERROR unknown command 'HELLO'" == response.getCommand());
+  }
+
+  SECTION("oversize requests are refused") {
+    request.setCommand(jrl::ConversionServer::CONVERT_COMMAND);
+    request.getBody() = std::string((1 << 20) + 1, 'a');
+    channel.write(request, error);
+    REQUIRE(channel.read(response, 1 << 20, error));
+    REQUIRE(0 == response.getCommand().find("ERROR message body"));
+  }
+
+  ::close(fd);
+  server.stop();
+  acceptor.join();
+}
+
+TEST_CASE("request limits", "[server]") {
+  jrl::AllocationStatistics::enable();
+
+  SECTION("time") {
+    jrl::RequestLimits limits(std::chrono::milliseconds(0), 1 << 20);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    REQUIRE_THROWS_AS(limits.check(), jrl::RequestLimitExceeded);
+  }
+
+  SECTION("memory") {
+    jrl::RequestLimits limits(std::chrono::seconds(60), 1000);
+    REQUIRE_NOTHROW(limits.check());
+    {
+      std::vector<char, jrl::CountingAllocator<char, jrl::AllocationStatistics::MODEL_TAG> >
+        values(2000);
+      REQUIRE_THROWS_AS(limits.check(), jrl::RequestLimitExceeded);
+    }
+    REQUIRE_NOTHROW(limits.check());
+    REQUIRE(2000 == limits.getPeakBytes());
+  }
+  SECTION("input and output are charged") {
+    jrl::RequestLimits limits(std::chrono::seconds(60), 100000);
+    REQUIRE_NOTHROW(limits.charge(40000));
+    jrl::RequestOutputBuffer buffer(limits);
+    std::ostream output(&buffer);
+    output.exceptions(std::ios::badbit);
+    output << std::string(1000, 'x') << 42;
+    output.flush();
+    REQUIRE(std::string(1000, 'x') + "42" == buffer.release());
+    REQUIRE_THROWS_AS(output << std::string(100000, 'y'),
+                      jrl::RequestLimitExceeded);
+  }
+}
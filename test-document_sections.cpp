@@ -0,0 +1,46 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// STL includes
+#include <string>
+
+// Local includes
+#include "document_sections.hpp"
+
+TEST_CASE("splitting a board into sections", "[sections]") {
+  const std::string document =
+    "<?xml version=\"1.0\"?>\n"
+    "<!DOCTYPE eagle SYSTEM \"eagle.dtd\">\n"
+    "<eagle><drawing><board>\n"
+    "<plain><wire x1=\"0\"/>\n</plain>\n"
+    "<libraries><library name=\"a\"><packages>"
+    "<package name=\"p\"/></packages></library></libraries>\n"
+    "<signals>\n<signal name=\"s1\"/>\n<signal name=\"s2\"/>\n</signals>\n"
+    "</board></drawing></eagle>\n";
+  jrl::SectionSplitter splitter;
+  REQUIRE(splitter.split(document));
+  const std::vector<jrl::SectionSplitter::Section> &sections =
+    splitter.getSections();
+
+  SECTION("adjacent signals form one section") {
+    REQUIRE(3 == sections.size());
+    REQUIRE(jrl::Subtree::PLAIN == sections[0].kind);
+    REQUIRE(4 == sections[0].line);
+    REQUIRE(jrl::Subtree::LIBRARY == sections[1].kind);
+    REQUIRE(jrl::Subtree::SIGNAL == sections[2].kind);
+    REQUIRE(8 == sections[2].line);
+    REQUIRE("<signals><signal name=\"s1\"/>\n<signal name=\"s2\"/></signals>" ==
+            splitter.getFragment(document, 2));
+  }
+
+  SECTION("the skeleton keeps the lines but not the sections") {
+    const std::string &skeleton = splitter.getSkeleton();
+    REQUIRE(std::string::npos == skeleton.find("DOCTYPE"));
+    REQUIRE(std::string::npos == skeleton.find("<wire"));
+    REQUIRE(std::string::npos == skeleton.find("<signal "));
+    REQUIRE(std::count(document.begin(), document.end(), '\n') ==
+            std::count(skeleton.begin(), skeleton.end(), '\n'));
+    REQUIRE(std::string::npos !=
+            skeleton.find("<board>\n<eagle2gedapcb-section/>\n\n"));
+  }
+}
@@ -0,0 +1,499 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Standard C library includes
+#include <cstring>
+
+// STL includes
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Local includes
+#include "eagle_converter.hpp"
+#include "eagle_converter.h"
+
+namespace
+{
+
+const char *BOARD =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<eagle version=\"6.5.0\">\n"
+  "<drawing>\n"
+  "<layers>\n"
+  "<layer number=\"1\" name=\"Top\" color=\"4\" fill=\"1\"/>\n"
+  "<layer number=\"16\" name=\"Bottom\" color=\"1\" fill=\"1\"/>\n"
+  "</layers>\n"
+  "<board>\n"
+  "<plain>\n"
+  "<wire x1=\"0\" y1=\"0\" x2=\"50\" y2=\"0\" width=\"0\" layer=\"20\"/>\n"
+  "</plain>\n"
+  "<signals>\n"
+  "<signal name=\"A\">\n"
+  "<wire x1=\"1\" y1=\"1\" x2=\"10\" y2=\"1\" width=\"0.3\" layer=\"1\"/>\n"
+  "</signal>\n"
+  "<signal name=\"B\">\n"
+  "<wire x1=\"10\" y1=\"1\" x2=\"10\" y2=\"9\" width=\"0.3\" layer=\"1\"/>\n"
+  "</signal>\n"
+  "</signals>\n"
+  "</board>\n"
+  "</drawing>\n"
+  "</eagle>\n";
+
+const char *VIA_BOARD =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<eagle version=\"6.5.0\">\n"
+  "<drawing>\n"
+  "<board>\n"
+  "<plain>\n"
+  "<wire x1=\"0\" y1=\"0\" x2=\"0\" y2=\"10\" width=\"0\" layer=\"20\"/>\n"
+  "</plain>\n"
+  "<autorouter>\n"
+  "<pass name=\"Default\">\n"
+  "<param name=\"RoutingGrid\" value=\"50mil\"/>\n"
+  "</pass>\n"
+  "</autorouter>\n"
+  "<designrules name=\"default\">\n"
+  "<param name=\"rlMinViaOuter\" value=\"10mil\"/>\n"
+  "<param name=\"mlViaStopLimit\" value=\"0.3mm\"/>\n"
+  "</designrules>\n"
+  "<signals>\n"
+  "<signal name=\"A\">\n"
+  "<via x=\"2.54\" y=\"7.46\" extent=\"1-16\" drill=\"0.3\"/>\n"
+  "<via x=\"2.54\" y=\"0\" extent=\"1-16\" drill=\"0.8\""
+  " diameter=\"2\" shape=\"octagon\"/>\n"
+  "</signal>\n"
+  "</signals>\n"
+  "</board>\n"
+  "</drawing>\n"
+  "</eagle>\n";
+
+const char *TEXT_BOARD =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<eagle version=\"6.5.0\">\n"
+  "<drawing>\n"
+  "<board>\n"
+  "<plain>\n"
+  "<wire x1=\"0\" y1=\"0\" x2=\"0\" y2=\"10\" width=\"0\" layer=\"20\"/>\n"
+  "<text x=\"1\" y=\"10\" size=\"1.27\" layer=\"21\">TOP</text>\n"
+  "<text x=\"1\" y=\"1\" size=\"1.27\" layer=\"16\" rot=\"MR0\">B</text>\n"
+  "<text x=\"1\" y=\"1\" size=\"1.27\" layer=\"51\">DOCUMENTATION</text>\n"
+  "</plain>\n"
+  "<libraries>\n"
+  "<library name=\"l\">\n"
+  "<packages>\n"
+  "<package name=\"P\">\n"
+  "<smd name=\"1\" x=\"0\" y=\"0\" dx=\"1\" dy=\"1\" layer=\"1\"/>\n"
+  "<text x=\"0\" y=\"1\" size=\"1.27\" layer=\"25\">&gt;NAME</text>\n"
+  "</package>\n"
+  "</packages>\n"
+  "</library>\n"
+  "</libraries>\n"
+  "<elements>\n"
+  "<element name=\"U1\" library=\"l\" package=\"P\" value=\"\" x=\"5\" y=\"5\"/>\n"
+  "<element name=\"U2\" library=\"l\" package=\"P\" value=\"\" x=\"5\" y=\"2\">\n"
+  "<attribute name=\"NAME\" x=\"6\" y=\"1\" size=\"1.27\" layer=\"25\""
+  " rot=\"R180\"/>\n"
+  "</element>\n"
+  "</elements>\n"
+  "</board>\n"
+  "</drawing>\n"
+  "</eagle>\n";
+
+const char *PAD_BOARD =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<eagle version=\"6.5.0\">\n"
+  "<drawing>\n"
+  "<board>\n"
+  "<plain>\n"
+  "<wire x1=\"0\" y1=\"0\" x2=\"0\" y2=\"20\" width=\"0\" layer=\"20\"/>\n"
+  "</plain>\n"
+  "<libraries>\n"
+  "<library name=\"l\">\n"
+  "<packages>\n"
+  "<package name=\"P\">\n"
+  "<smd name=\"1\" x=\"-1\" y=\"0\" dx=\"1\" dy=\"0.5\" layer=\"1\"/>\n"
+  "<pad name=\"2\" x=\"1\" y=\"0\" drill=\"0.8\"/>\n"
+  "</package>\n"
+  "</packages>\n"
+  "</library>\n"
+  "</libraries>\n"
+  "<elements>\n"
+  "<element name=\"U1\" library=\"l\" package=\"P\" value=\"\" x=\"5\" y=\"5\""
+  " rot=\"R90\"/>\n"
+  "<element name=\"U2\" library=\"l\" package=\"P\" value=\"\" x=\"15\" y=\"5\""
+  " rot=\"MR0\"/>\n"
+  "</elements>\n"
+  "<signals>\n"
+  "<signal name=\"A\">\n"
+  "<contactref element=\"U1\" pad=\"1\"/>\n"
+  "</signal>\n"
+  "<signal name=\"B\">\n"
+  "<contactref element=\"U2\" pad=\"1\"/>\n"
+  "<polygon width=\"0.2\" layer=\"1\">\n"
+  "<vertex x=\"2\" y=\"2\"/>\n"
+  "<vertex x=\"8\" y=\"2\"/>\n"
+  "<vertex x=\"8\" y=\"8\"/>\n"
+  "<vertex x=\"2\" y=\"8\"/>\n"
+  "</polygon>\n"
+  "<wire x1=\"10\" y1=\"4\" x2=\"5\" y2=\"4\" width=\"0.2\" layer=\"1\"/>\n"
+  "</signal>\n"
+  "</signals>\n"
+  "</board>\n"
+  "</drawing>\n"
+  "</eagle>\n";
+
+// NOTE: signal A's wires meet beside signal B, and C comes between the
+// two reports of that; D and E come closest across a cell boundary of
+// the clearance check's index (at 10.16 mm).
+const char *CLEARANCE_BOARD =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<eagle version=\"6.5.0\">\n"
+  "<drawing>\n"
+  "<board>\n"
+  "<plain>\n"
+  "<wire x1=\"0\" y1=\"0\" x2=\"0\" y2=\"20\" width=\"0\" layer=\"20\"/>\n"
+  "</plain>\n"
+  "<libraries>\n"
+  "<library name=\"l\">\n"
+  "<packages>\n"
+  "<package name=\"P\">\n"
+  "<smd name=\"1\" x=\"0\" y=\"0\" dx=\"1\" dy=\"1\" layer=\"1\"/>\n"
+  "</package>\n"
+  "</packages>\n"
+  "</library>\n"
+  "</libraries>\n"
+  "<elements>\n"
+  "<element name=\"U1\" library=\"l\" package=\"P\" value=\"\" x=\"20\" y=\"5\"/>\n"
+  "</elements>\n"
+  "<signals>\n"
+  "<signal name=\"A\">\n"
+  "<contactref element=\"U1\" pad=\"1\"/>\n"
+  "<wire x1=\"1\" y1=\"5\" x2=\"5\" y2=\"5\" width=\"0.2\" layer=\"1\"/>\n"
+  "<wire x1=\"5\" y1=\"5\" x2=\"9\" y2=\"5\" width=\"0.2\" layer=\"1\"/>\n"
+  "</signal>\n"
+  "<signal name=\"B\">\n"
+  "<wire x1=\"5\" y1=\"5.3\" x2=\"5\" y2=\"9\" width=\"0.2\" layer=\"1\"/>\n"
+  "<wire x1=\"15\" y1=\"5.65\" x2=\"25\" y2=\"5.65\" width=\"0.1\""
+  " layer=\"1\"/>\n"
+  "</signal>\n"
+  "<signal name=\"C\">\n"
+  "<wire x1=\"2\" y1=\"5.25\" x2=\"2\" y2=\"9\" width=\"0.2\" layer=\"1\"/>\n"
+  "</signal>\n"
+  "<signal name=\"D\">\n"
+  "<wire x1=\"7\" y1=\"15\" x2=\"10.1\" y2=\"15\" width=\"0.05\""
+  " layer=\"16\"/>\n"
+  "</signal>\n"
+  "<signal name=\"E\">\n"
+  "<wire x1=\"10.2\" y1=\"15\" x2=\"13\" y2=\"15\" width=\"0.05\""
+  " layer=\"16\"/>\n"
+  "</signal>\n"
+  "</signals>\n"
+  "</board>\n"
+  "</drawing>\n"
+  "</eagle>\n";
+
+struct Conversion
+{
+  bool isConverted;
+  std::string output;
+  jrl::ConversionReport report;
+};
+
+void
+convert(const std::string &board,
+        const jrl::ConversionOptions &options,
+        Conversion &conversion)
+{
+  std::ostringstream output;
+  conversion.isConverted = jrl::convertBoard(board.data(), board.size(),
+                                             options, output,
+                                             conversion.report);
+  conversion.output = output.str();
+}
+
+size_t
+countWarnings(const jrl::ConversionReport &report)
+{
+  size_t count = 0;
+  for (size_t index = 0; index < report.diagnostics.size(); ++index) {
+    if (jrl::Diagnostic::WARNING_SEVERITY ==
+        report.diagnostics[index].severity) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+std::vector<std::string>
+getWarnings(const jrl::ConversionReport &report)
+{
+  std::vector<std::string> warnings;
+  for (size_t index = 0; index < report.diagnostics.size(); ++index) {
+    if (jrl::Diagnostic::WARNING_SEVERITY ==
+        report.diagnostics[index].severity) {
+      warnings.push_back(report.diagnostics[index].message);
+    }
+  }
+  return warnings;
+}
+
+size_t
+appendOutput(void *context,
+             const char *data,
+             size_t size)
+{
+  static_cast<std::string *>(context)->append(data, size);
+  return size;
+}
+
+size_t
+refuseOutput(void *,
+             const char *,
+             size_t)
+{
+  return 0;
+}
+
+}
+
+TEST_CASE("boards converted from memory", "[converter]") {
+  jrl::ConversionOptions options;
+  options.isCheckingNets = true;
+
+  SECTION("a board converts with its own diagnostics") {
+    Conversion conversion;
+    convert(BOARD, options, conversion);
+    REQUIRE(conversion.isConverted);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("FileVersion[20070407]"));
+    const jrl::ConversionStatistics &statistics =
+      conversion.report.statistics;
+    REQUIRE(std::strlen(BOARD) == statistics.inputBytes);
+    REQUIRE(conversion.output.size() == statistics.outputBytes);
+    REQUIRE(0 == statistics.errorCount);
+    REQUIRE(1 == statistics.shortCount);
+    REQUIRE(1 == countWarnings(conversion.report));
+  }
+
+  SECTION("conversions on different threads are independent") {
+    std::string misplaced = BOARD;
+    const std::string signals = "<signals>";
+    misplaced.insert(misplaced.find(signals) + signals.size(),
+                     "<layers></layers>");
+    std::vector<Conversion> conversions(8);
+    std::vector<std::thread> threads;
+    for (size_t index = 0; index < conversions.size(); ++index) {
+      threads.push_back(std::thread(convert,
+                                    (0 == index % 2) ? BOARD : misplaced,
+                                    std::ref(options),
+                                    std::ref(conversions[index])));
+    }
+    for (size_t index = 0; index < threads.size(); ++index) {
+      threads[index].join();
+    }
+    for (size_t index = 2; index < conversions.size(); ++index) {
+      const Conversion &first = conversions[index % 2];
+      const Conversion &conversion = conversions[index];
+      REQUIRE(first.output == conversion.output);
+      REQUIRE(first.report.diagnostics.size() ==
+              conversion.report.diagnostics.size());
+      REQUIRE(first.report.statistics.errorCount ==
+              conversion.report.statistics.errorCount);
+    }
+    REQUIRE(0 == conversions[0].report.statistics.errorCount);
+    REQUIRE(0 < conversions[1].report.statistics.errorCount);
+    REQUIRE(1 == countWarnings(conversions[0].report));
+  }
+}
+
+TEST_CASE("vias sized by the design rules", "[converter]") {
+  Conversion conversion;
+  convert(VIA_BOARD, jrl::ConversionOptions(), conversion);
+  REQUIRE(conversion.isConverted);
+  REQUIRE(0 == conversion.report.statistics.errorCount);
+
+  SECTION("a via without a diameter gets the minimum restring, and is "
+          "tented within the stop limit") {
+    REQUIRE(std::string::npos !=
+            conversion.output.find("Via[10000 10000 3181 1600 0 1181 \"\" \"\"]"));
+  }
+
+  SECTION("a drawn diameter and shape are kept") {
+    REQUIRE(std::string::npos !=
+            conversion.output.find("Via[10000 39370 7874 1600 8674 3150 \"\" "
+                                   "\"octagon\"]"));
+  }
+}
+
+TEST_CASE("text scaled to the gEDA font", "[converter]") {
+  Conversion conversion;
+  jrl::ConversionOptions options;
+
+  SECTION("silk screen text goes to the silk of its side") {
+    convert(TEXT_BOARD, options, conversion);
+    REQUIRE(conversion.isConverted);
+    REQUIRE(0 == conversion.report.statistics.errorCount);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("Layer(10 \"silk\")\n"
+                                   "(\n"
+                                   "\tText[3937 -4600 0 115 \"TOP\" \"\"]\n"));
+    REQUIRE(std::string::npos ==
+            conversion.output.find("DOCUMENTATION"));
+  }
+
+  SECTION("mirrored text on the bottom copper reads from the other side") {
+    convert(TEXT_BOARD, options, conversion);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("Layer(6 \"solder\")\n"
+                                   "(\n"
+                                   "\tText[3937 30833 2 115 \"B\" "
+                                   "\"onsolder\"]\n"));
+  }
+
+  SECTION("element names are placed like the name of the package") {
+    convert(TEXT_BOARD, options, conversion);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("\"U1\" \"\" 19685 19685 0 -8537 0 115 "
+                                   "\"\"]"));
+  }
+
+  SECTION("smashed names are kept readable") {
+    convert(TEXT_BOARD, options, conversion);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("\"U2\" \"\" 19685 31496 -3423 3937 0 115 "
+                                   "\"\"]"));
+  }
+
+  SECTION("text extents move the top edge of the board") {
+    options.isIncludingTextExtents = true;
+    convert(TEXT_BOARD, options, conversion);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("\tText[3937 460 0 115 \"TOP\" \"\"]\n"));
+  }
+}
+
+TEST_CASE("pads and pins of placed elements", "[converter]") {
+  Conversion conversion;
+  jrl::ConversionOptions options;
+
+  SECTION("pads are transformed with their element") {
+    convert(PAD_BOARD, options, conversion);
+    REQUIRE(conversion.isConverted);
+    REQUIRE(0 == conversion.report.statistics.errorCount);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("Element[\"\" \"P\" \"U1\" \"\" 19685 59055 "
+                                   "0 0 0 100 \"\"]\n"
+                                   "(\n"
+                                   "\tPad[0 4921 0 2953 1969 1600 2769 \"1\" "
+                                   "\"1\" \"square\"]\n"
+                                   "\tPin[0 -3937 5150 1600 5950 3150 \"2\" "
+                                   "\"2\" \"\"]\n"));
+  }
+
+  SECTION("mirrored elements and their pads are on the solder side") {
+    convert(PAD_BOARD, options, conversion);
+    REQUIRE(std::string::npos !=
+            conversion.output.find("Element[\"onsolder\" \"P\" \"U2\" \"\" "
+                                   "59055 59055 0 0 0 100 \"\"]\n"
+                                   "(\n"
+                                   "\tPad[4921 0 2953 0 1969 1600 2769 \"1\" "
+                                   "\"1\" \"square,onsolder\"]\n"
+                                   "\tPin[-3937 0 5150 1600 5950 3150 \"2\" "
+                                   "\"2\" \"\"]\n"));
+  }
+
+  SECTION("pre-cleared pours keep clear of the pads of other signals") {
+    options.isPreClearingPolygons = true;
+    convert(PAD_BOARD, options, conversion);
+    // NOTE: around the SMD pad of signal A (at 16 mm down the
+    // layout), and around the unconnected pin (at 14 mm).
+    REQUIRE(std::string::npos !=
+            conversion.output.find("\t\tHole (\n"
+                                   "\t\t\t[19685 65796] [18989 65657] "));
+    REQUIRE(std::string::npos !=
+            conversion.output.find("\t\tHole (\n"
+                                   "\t\t\t[19685 58559] [18368 58297] "));
+  }
+
+  SECTION("copper onto the pad of another signal shorts it") {
+    options.isCheckingNets = true;
+    options.isCheckingClearance = true;
+    convert(PAD_BOARD, options, conversion);
+    REQUIRE(1 == conversion.report.statistics.shortCount);
+    REQUIRE(1 == conversion.report.statistics.clearanceViolationCount);
+    REQUIRE(2 == countWarnings(conversion.report));
+  }
+}
+
+TEST_CASE("clearances checked between signals", "[converter]") {
+  jrl::ConversionOptions options;
+  options.isCheckingClearance = true;
+
+  SECTION("each violation is reported once with its location") {
+    for (unsigned threadCount = 1; threadCount <= 4; threadCount *= 4) {
+      options.threadCount = threadCount;
+      Conversion conversion;
+      convert(CLEARANCE_BOARD, options, conversion);
+      REQUIRE(conversion.isConverted);
+      REQUIRE(4 == conversion.report.statistics.clearanceViolationCount);
+      const std::vector<std::string> warnings =
+        getWarnings(conversion.report);
+      REQUIRE(4 == warnings.size());
+      REQUIRE("clearance violation between wire of signal 'A' and wire of "
+              "signal 'B' on layer 1 at (5, 5.15) mm, gap 0.1 mm of "
+              "0.2032 mm" == warnings[0]);
+      REQUIRE("clearance violation between wire of signal 'A' and wire of "
+              "signal 'C' on layer 1 at (2, 5.125) mm, gap 0.05 mm of "
+              "0.2032 mm" == warnings[1]);
+      REQUIRE("clearance violation between wire of signal 'B' and pad "
+              "'U1-1' of signal 'A' on layer 1 at (20, 5.325) mm, gap 0.1 mm "
+              "of 0.2032 mm" == warnings[2]);
+      REQUIRE("clearance violation between wire of signal 'D' and wire of "
+              "signal 'E' on layer 16 at (10.15, 15) mm, gap 0.05 mm of "
+              "0.2032 mm" == warnings[3]);
+    }
+  }
+}
+
+TEST_CASE("boards converted through the C interface", "[converter]") {
+  eagle2gedapcb_options options;
+  eagle2gedapcb_options_init(&options);
+  options.check_nets = 1;
+  eagle2gedapcb_report *report = NULL;
+
+  SECTION("output is passed to the write function") {
+    std::string output;
+    REQUIRE(eagle2gedapcb_convert(BOARD, std::strlen(BOARD), &options,
+                                  appendOutput, &output, &report));
+    REQUIRE(NULL != report);
+    eagle2gedapcb_statistics statistics;
+    eagle2gedapcb_report_statistics(report, &statistics);
+    REQUIRE(output.size() == statistics.output_bytes);
+    REQUIRE(1 == statistics.short_count);
+    size_t warningCount = 0;
+    for (size_t index = 0;
+         index < eagle2gedapcb_report_diagnostic_count(report); ++index) {
+      if (EAGLE2GEDAPCB_WARNING ==
+          eagle2gedapcb_report_diagnostic_severity(report, index)) {
+        ++warningCount;
+        REQUIRE(NULL != std::strstr(
+                  eagle2gedapcb_report_diagnostic_message(report, index),
+                  "short"));
+      }
+    }
+    REQUIRE(1 == warningCount);
+  }
+
+  SECTION("a failing write function fails the conversion") {
+    REQUIRE_FALSE(eagle2gedapcb_convert(BOARD, std::strlen(BOARD), &options,
+                                        refuseOutput, NULL, &report));
+    REQUIRE(NULL != report);
+    eagle2gedapcb_statistics statistics;
+    eagle2gedapcb_report_statistics(report, &statistics);
+    REQUIRE(0 == statistics.output_bytes);
+  }
+
+  eagle2gedapcb_report_free(report);
+}
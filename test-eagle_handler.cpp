@@ -0,0 +1,80 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Standard C library includes
+#include <cstdio>
+
+// STL includes
+#include <sstream>
+#include <string>
+
+// Local includes
+#include "eagle_handler.hpp"
+
+TEST_CASE("content split into chunks", "[handler]") {
+  const std::string path = "test-eagle_handler.model";
+  std::string error;
+  jrl::ModelWriter writer;
+  writer.startElement("board");
+  writer.startElement("plain");
+  writer.startElement("wire");
+  writer.addAttribute("x1", "0");
+  writer.addAttribute("y1", "0");
+  writer.addAttribute("x2", "0");
+  writer.addAttribute("y2", "10");
+  writer.addAttribute("width", "0");
+  writer.addAttribute("layer", "20");
+  writer.endElement();
+  writer.startElement("text");
+  writer.addAttribute("x", "1");
+  writer.addAttribute("y", "10");
+  writer.addAttribute("size", "1.27");
+  writer.addAttribute("layer", "21");
+  // NOTE: SAX may deliver content in any number of chunks.
+  writer.addCharacters("T");
+  writer.addCharacters("O");
+  writer.addCharacters("P");
+  writer.endElement();
+  writer.endElement();
+  writer.startElement("libraries");
+  writer.startElement("library");
+  writer.addAttribute("name", "l");
+  writer.startElement("packages");
+  writer.startElement("package");
+  writer.addAttribute("name", "P");
+  writer.startElement("description");
+  writer.addCharacters("<b>Package</b>");
+  writer.addCharacters(" description");
+  writer.endElement();
+  writer.endElement();
+  writer.endElement();
+  writer.startElement("description");
+  writer.addCharacters("Library description");
+  writer.endElement();
+  writer.endElement();
+  writer.endElement();
+  writer.endElement();
+  REQUIRE(writer.write(path, error));
+  jrl::ModelReader reader;
+  REQUIRE(reader.open(path, error));
+
+  std::ostringstream log;
+  jrl::SAXHandler::LogScope logScope(log);
+  jrl::SAXHandler handler;
+  REQUIRE(handler.replay(reader));
+
+  SECTION("text chunks are concatenated") {
+    std::ostringstream output;
+    jrl::ConversionOptions options;
+    jrl::printLayout(output, handler, options, log);
+    REQUIRE(std::string::npos !=
+            output.str().find("\tText[3937 -4600 0 115 \"TOP\" \"\"]\n"));
+  }
+
+  SECTION("descriptions are skipped without complaint") {
+    REQUIRE(std::string::npos == log.str().find("WARN"));
+    REQUIRE(std::string::npos == log.str().find("ERR"));
+  }
+
+  std::remove(path.c_str());
+}
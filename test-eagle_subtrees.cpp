@@ -0,0 +1,154 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// STL includes
+#include <string>
+#include <vector>
+
+// Local includes
+#include "eagle_subtrees.hpp"
+
+namespace
+{
+
+const std::string BOARD =
+  "<eagle><drawing><layers><layer number=\"1\"/></layers><board>"
+  "<plain><wire x1=\"0\"/></plain>"
+  "<libraries>"
+  "<library name=\"L\"><description>d</description><packages>"
+  "<package name=\"P1\"><smd name=\"1\"/></package>"
+  "<package name=\"P2\"/>"
+  "</packages></library>"
+  "</libraries>"
+  "<elements><element name=\"U1\"/></elements>"
+  "<signals>"
+  "<signal name=\"A\"><wire x1=\"1\"/></signal>"
+  "<signal name=\"B\"/>"
+  "</signals>"
+  "</board></drawing></eagle>";
+
+std::string
+replace(const std::string &document,
+        const std::string &from,
+        const std::string &to)
+{
+  std::string result = document;
+  const std::size_t pos = result.find(from);
+  REQUIRE(std::string::npos != pos);
+  result.replace(pos, from.size(), to);
+  return result;
+}
+
+void
+scan(const std::string &document,
+     jrl::SubtreeScanner &scanner)
+{
+  REQUIRE(scanner.scan(document.data(), document.size()));
+}
+
+}
+
+TEST_CASE("subtrees located and hashed", "[subtrees]") {
+  jrl::SubtreeScanner scanner;
+  scan(BOARD, scanner);
+  const std::vector<jrl::Subtree> &subtrees = scanner.getSubtrees();
+
+  SECTION("subtrees are found in document order with their extents") {
+    REQUIRE(7 == subtrees.size());
+    REQUIRE(jrl::Subtree::PLAIN == subtrees[0].getKind());
+    REQUIRE(jrl::Subtree::LIBRARY == subtrees[1].getKind());
+    REQUIRE(jrl::Subtree::PACKAGE == subtrees[2].getKind());
+    REQUIRE(jrl::Subtree::PACKAGE == subtrees[3].getKind());
+    REQUIRE(jrl::Subtree::ELEMENTS == subtrees[4].getKind());
+    REQUIRE(jrl::Subtree::SIGNAL == subtrees[5].getKind());
+    REQUIRE(jrl::Subtree::SIGNAL == subtrees[6].getKind());
+    const std::string plain = "<plain><wire x1=\"0\"/></plain>";
+    REQUIRE(BOARD.find(plain) == subtrees[0].getBegin());
+    REQUIRE(BOARD.find(plain) + 7 == subtrees[0].getContentBegin());
+    REQUIRE(BOARD.find(plain) + plain.size() == subtrees[0].getEnd());
+    const std::string package = "<package name=\"P2\"/>";
+    REQUIRE(BOARD.find(package) == subtrees[3].getBegin());
+    REQUIRE(BOARD.find(package) + package.size() ==
+            subtrees[3].getContentBegin());
+    REQUIRE(BOARD.find(package) + package.size() == subtrees[3].getEnd());
+    const std::string library = "</library>";
+    REQUIRE(BOARD.find(library) + library.size() == subtrees[1].getEnd());
+  }
+
+  SECTION("packages are keyed under their library") {
+    REQUIRE("L" == subtrees[1].getName());
+    REQUIRE(1 == subtrees[2].getLibrary());
+    REQUIRE(0 > subtrees[1].getLibrary());
+    REQUIRE(0 > subtrees[5].getLibrary());
+    REQUIRE(std::string("2L\0P1", 5) == subtrees[2].getKey(subtrees));
+    REQUIRE("1L" == subtrees[1].getKey(subtrees));
+    REQUIRE("4A" == subtrees[5].getKey(subtrees));
+    REQUIRE("3" == subtrees[4].getKey(subtrees));
+  }
+
+  SECTION("only the changed subtree changes its hash") {
+    jrl::SubtreeScanner changed;
+    scan(replace(BOARD, "<wire x1=\"1\"/>", "<wire x1=\"2\"/>"), changed);
+    REQUIRE(subtrees[5].getHash() != changed.getSubtrees()[5].getHash());
+    for (std::size_t index = 0; index < 5; ++index) {
+      REQUIRE(subtrees[index].getHash() ==
+              changed.getSubtrees()[index].getHash());
+    }
+    REQUIRE(scanner.getRemainderHash() == changed.getRemainderHash());
+  }
+
+  SECTION("content outside of the subtrees changes the remainder hash") {
+    jrl::SubtreeScanner changed;
+    scan(replace(BOARD, "number=\"1\"", "number=\"16\""), changed);
+    REQUIRE(scanner.getRemainderHash() != changed.getRemainderHash());
+    for (std::size_t index = 0; index < subtrees.size(); ++index) {
+      REQUIRE(subtrees[index].getHash() ==
+              changed.getSubtrees()[index].getHash());
+    }
+  }
+
+  SECTION("a library hash covers everything except its packages") {
+    jrl::SubtreeScanner changed;
+    scan(replace(BOARD, "<description>d", "<description>e"), changed);
+    REQUIRE(subtrees[1].getHash() != changed.getSubtrees()[1].getHash());
+    REQUIRE(subtrees[2].getHash() == changed.getSubtrees()[2].getHash());
+
+    jrl::SubtreeScanner package;
+    scan(replace(BOARD, "<smd name=\"1\"/>", "<smd name=\"2\"/>"), package);
+    REQUIRE(subtrees[1].getHash() == package.getSubtrees()[1].getHash());
+    REQUIRE(subtrees[2].getHash() != package.getSubtrees()[2].getHash());
+  }
+}
+
+TEST_CASE("markup which isn't a tag", "[subtrees]") {
+  jrl::SubtreeScanner scanner;
+
+  SECTION("'>' in quoted attributes doesn't end the tag") {
+    scan(replace(BOARD, "<signal name=\"A\">", "<signal name=\"A>B\">"),
+         scanner);
+    REQUIRE(7 == scanner.getSubtrees().size());
+    REQUIRE("A>B" == scanner.getSubtrees()[5].getName());
+    scan(replace(BOARD, "<wire x1=\"1\"/>", "<wire x1='>'/>"), scanner);
+    REQUIRE(7 == scanner.getSubtrees().size());
+  }
+
+  SECTION("comments and CDATA may contain tags") {
+    scan(replace(BOARD, "<signals>",
+                 "<signals><!-- <signal name=\"C\"> -> --><![CDATA[</signal>]]>"),
+         scanner);
+    REQUIRE(7 == scanner.getSubtrees().size());
+    REQUIRE("A" == scanner.getSubtrees()[5].getName());
+    scan(replace(BOARD, "<wire x1=\"1\"/>", "<![CDATA[</signal> > ]]>"),
+         scanner);
+    REQUIRE(7 == scanner.getSubtrees().size());
+    REQUIRE(jrl::Subtree::SIGNAL == scanner.getSubtrees()[6].getKind());
+  }
+
+  SECTION("truncated documents are rejected") {
+    const std::size_t signal = BOARD.find("<signal name=\"A\">");
+    REQUIRE_FALSE(scanner.scan(BOARD.data(), signal + 5));
+    REQUIRE_FALSE(scanner.scan(BOARD.data(), signal + 20));
+    const std::size_t library = BOARD.find("</library>");
+    REQUIRE_FALSE(scanner.scan(BOARD.data(), library));
+  }
+}
@@ -0,0 +1,77 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Local includes
+#include "eagle_transform.hpp"
+
+TEST_CASE("parsing of Eagle rotation strings", "[transform]") {
+  jrl::Rotation rotation;
+
+  SECTION("plain rotation") {
+    REQUIRE(rotation.tryParse("R90"));
+    REQUIRE(90.0 == rotation.getDegrees());
+    REQUIRE(!rotation.isMirrored());
+    REQUIRE(jrl::Rotation::R90 == rotation.getOrientation());
+  }
+
+  SECTION("mirrored rotation") {
+    REQUIRE(rotation.tryParse("MR180"));
+    REQUIRE(rotation.isMirrored());
+    REQUIRE(jrl::Rotation::MR180 == rotation.getOrientation());
+  }
+
+  SECTION("spin and arbitrary angle") {
+    REQUIRE(rotation.tryParse("SR45"));
+    REQUIRE(rotation.isSpin());
+    REQUIRE(!rotation.isOrthogonal());
+  }
+
+  SECTION("malformed rotation") {
+    REQUIRE(!rotation.tryParse("90"));
+    REQUIRE(!rotation.tryParse("R90x"));
+    REQUIRE(jrl::Rotation::R0 == rotation.getOrientation());
+  }
+}
+
+TEST_CASE("application of Eagle rotations", "[transform]") {
+  SECTION("orthogonal rotations are exact on integers") {
+    jrl::Rotation rotation(270.0, false);
+    int x = 3;
+    int y = 1;
+    rotation.apply(x, y);
+    REQUIRE(1 == x);
+    REQUIRE(-3 == y);
+  }
+
+  SECTION("mirror is applied before rotation") {
+    jrl::Rotation rotation(90.0, true);
+    int x = 3;
+    int y = 1;
+    rotation.apply(x, y);
+    REQUIRE(-1 == x);
+    REQUIRE(-3 == y);
+  }
+
+  SECTION("arbitrary angles use the general matrix") {
+    jrl::Rotation rotation(45.0, false);
+    double x = 1.0;
+    double y = 1.0;
+    rotation.apply(x, y);
+    REQUIRE(x == Approx(0.0).margin(1e-9));
+    REQUIRE(y == Approx(sqrt(2.0)));
+  }
+
+  SECTION("composition matches sequential application") {
+    const jrl::Rotation outer(90.0, true);
+    const jrl::Rotation inner(30.0, false);
+    double x1 = 2.0;
+    double y1 = 0.5;
+    inner.apply(x1, y1);
+    outer.apply(x1, y1);
+    double x2 = 2.0;
+    double y2 = 0.5;
+    jrl::Rotation::compose(outer, inner).apply(x2, y2);
+    REQUIRE(x1 == Approx(x2));
+    REQUIRE(y1 == Approx(y2));
+  }
+}
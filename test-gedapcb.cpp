@@ -7,6 +7,10 @@
 // STL includes
 #include <iostream>
 #include <list>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 // Boost includes
 #include <boost/units/io.hpp>
@@ -24,3 +28,130 @@ TEST_CASE("tests of objects representing gEDA pcb elements", "[gedapcb]") {
     std::cout << pcb;
   }
 }
+
+TEST_CASE("tests of gEDA pcb element output", "[gedapcb]") {
+  jrl::geda_pcb::Element element("", "R0805", "R1", "10k", 10000, 20000,
+                                 0, 0, 0, 100, "");
+  element.addElement(new jrl::geda_pcb::ElementLine(-100, -200, 100, -200, 600));
+
+  SECTION("printing element object") {
+    std::ostringstream strm;
+    strm << element;
+    REQUIRE(strm.str() ==
+            "Element[\"\" \"R0805\" \"R1\" \"10k\" 10000 20000 0 0 0 100 \"\"]\n"
+            "(\n"
+            "\tElementLine[-100 -200 100 -200 600]\n"
+            ")\n");
+  }
+
+  SECTION("printing pads and pins named like Eagle pads") {
+    element.addElement(new jrl::geda_pcb::Pad(-3740, 394, -3740, -394, 5118,
+                                              1600, 5918, "A1", "A1",
+                                              "square"));
+    element.addElement(new jrl::geda_pcb::Pin(0, 0, 5150, 1600, 5950, 3150,
+                                              "GND", "GND", "octagon"));
+    std::ostringstream strm;
+    strm << element;
+    REQUIRE(strm.str() ==
+            "Element[\"\" \"R0805\" \"R1\" \"10k\" 10000 20000 0 0 0 100 \"\"]\n"
+            "(\n"
+            "\tElementLine[-100 -200 100 -200 600]\n"
+            "\tPad[-3740 394 -3740 -394 5118 1600 5918 \"A1\" \"A1\" \"square\"]\n"
+            "\tPin[0 0 5150 1600 5950 3150 \"GND\" \"GND\" \"octagon\"]\n"
+            ")\n");
+  }
+}
+
+TEST_CASE("tests of gEDA pcb via output", "[gedapcb]") {
+  jrl::geda_pcb::Via via(59055, 98425, 3175, 1600, 3975, 1575, "", "square");
+
+  SECTION("printing via object") {
+    std::ostringstream strm;
+    strm << via;
+    REQUIRE(strm.str() == "Via[59055 98425 3175 1600 3975 1575 \"\" \"square\"]");
+  }
+}
+
+TEST_CASE("tests of gEDA pcb text output", "[gedapcb]") {
+  jrl::geda_pcb::Text text(19685, 131475, 1, 158, "say \"\\n\"", "onsolder");
+
+  SECTION("printing text object") {
+    std::ostringstream strm;
+    strm << text;
+    REQUIRE(strm.str() ==
+            "Text[19685 131475 1 158 \"say \\\"\\\\n\\\"\" \"onsolder\"]");
+  }
+}
+
+TEST_CASE("tests of gEDA pcb netlist output", "[gedapcb]") {
+  jrl::geda_pcb::NetList netList;
+  jrl::geda_pcb::Net *net = new jrl::geda_pcb::Net("GND", "(unknown)");
+  net->addConnection("R1-1");
+  netList.addNet(net);
+
+  SECTION("printing netlist object") {
+    std::ostringstream strm;
+    strm << netList;
+    REQUIRE(strm.str() ==
+            "NetList()\n"
+            "(\n"
+            "\tNet(\"GND\" \"(unknown)\")\n"
+            "\t(\n"
+            "\t\tConnect(\"R1-1\")\n"
+            "\t)\n"
+            ")\n");
+  }
+}
+
+TEST_CASE("tests of gEDA pcb polygon output", "[gedapcb]") {
+  jrl::geda_pcb::Polygon polygon("clearpoly");
+  polygon.addPoint(0, 0);
+  polygon.addPoint(1000, 0);
+  polygon.addPoint(1000, 1000);
+  polygon.addPoint(0, 1000);
+  polygon.addPoint(0, 500);
+  polygon.addHole();
+  polygon.addHolePoint(200, 200);
+  polygon.addHolePoint(400, 200);
+  polygon.addHolePoint(400, 400);
+
+  SECTION("printing polygon object") {
+    std::ostringstream strm;
+    strm << polygon;
+    REQUIRE(strm.str() ==
+            "Polygon(\"clearpoly\")\n"
+            "\t(\n"
+            "\t\t[0 0] [1000 0] [1000 1000] [0 1000]\n"
+            "\t\t[0 500]\n"
+            "\t\tHole (\n"
+            "\t\t\t[200 200] [400 200] [400 400]\n"
+            "\t\t)\n"
+            "\t)");
+  }
+}
+
+TEST_CASE("tests of gEDA pcb layer output", "[gedapcb]") {
+  jrl::geda_pcb::Layer layer(1, "component");
+  jrl::geda_pcb::Polygon polygon("clearpoly");
+  polygon.addPoint(0, 0);
+  polygon.addPoint(1000, 0);
+  polygon.addPoint(1000, 1000);
+  layer.addPolygon(std::move(polygon));
+  layer.addLine(jrl::geda_pcb::Line(0, 0, 500, 0, 1000, 2000, "clearline"));
+  layer.addText(jrl::geda_pcb::Text(100, 200, 0, 100, "GND", ""));
+
+  SECTION("printing layer object") {
+    std::ostringstream strm;
+    strm << layer;
+    REQUIRE(strm.str() ==
+            "Layer(1 \"component\")\n"
+            "(\n"
+            "\tLine[0 0 500 0 1000 2000 \"clearline\"]\n"
+            "\tText[100 200 0 100 \"GND\" \"\"]\n"
+            "\tPolygon(\"clearpoly\")\n"
+            "\t(\n"
+            "\t\t[0 0] [1000 0] [1000 1000]\n"
+            "\t)\n"
+            ")\n");
+  }
+}
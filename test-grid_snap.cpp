@@ -0,0 +1,49 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// STL includes
+#include <vector>
+
+// Local includes
+#include "grid_snap.hpp"
+
+TEST_CASE("snapping of coordinates to a grid", "[grid]") {
+  SECTION("values round to the nearest grid point") {
+    const jrl::GridSnap snap(0.635);  // 25 mil
+    REQUIRE(snap.apply(0.6) == Approx(0.635));
+    REQUIRE(snap.apply(-0.96) == Approx(-1.27));
+    REQUIRE(snap.apply(100.0) == Approx(99.695));
+    REQUIRE(0.0 == snap.apply(0.3));
+  }
+
+  SECTION("columns snap like single values") {
+    const jrl::GridSnap snap(0.1);
+    std::vector<double> values;
+    for (int index = -50; index < 50; ++index) {
+      values.push_back(index * 0.0371);
+    }
+    std::vector<double> snapped(values);
+    snap.apply(snapped.data(), snapped.size());
+    for (size_t index = 0; index < values.size(); ++index) {
+      REQUIRE(snap.apply(values[index]) == snapped[index]);
+    }
+  }
+
+  SECTION("snapping is idempotent") {
+    const jrl::GridSnap snap(0.0254 * 5);
+    const double once = snap.apply(12.3456);
+    REQUIRE(once == snap.apply(once));
+  }
+
+  SECTION("Eagle units") {
+    double millimeters = 0.0;
+    REQUIRE(jrl::GridSnap::tryGetUnitLength("mil", millimeters));
+    REQUIRE(0.0254 == millimeters);
+    REQUIRE(jrl::GridSnap::tryGetUnitLength("inch", millimeters));
+    REQUIRE(25.4 == millimeters);
+    REQUIRE(jrl::GridSnap::tryGetUnitLength("mic", millimeters));
+    REQUIRE(0.001 == millimeters);
+    REQUIRE_FALSE(jrl::GridSnap::tryGetUnitLength("furlong", millimeters));
+    REQUIRE(0.001 == millimeters);
+  }
+}
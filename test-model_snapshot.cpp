@@ -0,0 +1,59 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Standard C library includes
+#include <cstdio>
+
+// STL includes
+#include <fstream>
+#include <string>
+
+// Local includes
+#include "model_snapshot.hpp"
+
+TEST_CASE("model snapshot round trip", "[model]") {
+  const std::string path = "test-model_snapshot.model";
+  std::string error;
+  jrl::ModelWriter writer;
+  writer.startElement("wire");
+  writer.addAttribute("x1", "1.27");
+  writer.addAttribute("layer", "1");
+  writer.endElement();
+  writer.startElement("text");
+  writer.addCharacters("R1");
+  writer.endElement();
+  REQUIRE(5 == writer.getEventCount());
+  REQUIRE(writer.write(path, error));
+
+  SECTION("events and attributes are read back") {
+    jrl::ModelReader reader;
+    REQUIRE(reader.open(path, error));
+    REQUIRE(5 == reader.getEventCount());
+    REQUIRE(jrl::ModelLayout::START_EVENT == reader.getEventType(0));
+    REQUIRE("wire" == reader.getEventString(0));
+    REQUIRE(2 == reader.getAttributeCount(0));
+    const std::size_t first = reader.getFirstAttribute(0);
+    REQUIRE("x1" == reader.getAttributeName(first));
+    REQUIRE("1.27" == reader.getAttributeValue(first));
+    REQUIRE("layer" == reader.getAttributeName(first + 1));
+    REQUIRE(jrl::ModelLayout::END_EVENT == reader.getEventType(1));
+    REQUIRE("wire" == reader.getEventString(1));
+    REQUIRE(jrl::ModelLayout::CHARACTERS_EVENT == reader.getEventType(3));
+    REQUIRE("R1" == reader.getEventString(3));
+  }
+
+  SECTION("truncated snapshots are rejected") {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    out.write(contents.data(), contents.size() / 2);
+    out.close();
+    jrl::ModelReader reader;
+    REQUIRE_FALSE(reader.open(path, error));
+    REQUIRE_FALSE(error.empty());
+  }
+
+  std::remove(path.c_str());
+}
@@ -0,0 +1,114 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Standard C library includes
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+// STL includes
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <string>
+
+// Local includes
+#include "output_writer.hpp"
+
+static std::string
+readFile(const std::string &path)
+{
+  std::ifstream in(path.c_str(), std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(in)),
+                     std::istreambuf_iterator<char>());
+}
+
+static std::string
+writeLines(jrl::OutputFile &file)
+{
+  std::string expected;
+  std::ostream output(&file);
+  for (int index = 0; index < 10000; ++index) {
+    const std::string line = "ElementLine[" + std::to_string(index) + "]";
+    output << line << std::endl;
+    expected += line + "\n";
+  }
+  return expected;
+}
+
+TEST_CASE("output written from buffers on a separate thread", "[output]") {
+  const std::string path = "test-output_writer.tmp";
+  std::string error;
+
+  SECTION("files are written through either backend") {
+    for (int isRingAllowed = 0; isRingAllowed < 2; ++isRingAllowed) {
+      std::string expected;
+      {
+        // NOTE: tiny buffers so that writes queue up and are combined.
+        jrl::OutputWriter writer(4096, 3, 0 != isRingAllowed);
+        jrl::OutputFile file(writer);
+        REQUIRE(file.open(path, error));
+        expected = writeLines(file);
+        REQUIRE(file.close(error));
+        REQUIRE(expected.size() == writer.getStatistics().bytes);
+        REQUIRE(0 < writer.getStatistics().writeCount);
+        if (!isRingAllowed) {
+          REQUIRE(jrl::OutputWriter::PWRITEV_BACKEND == writer.getBackend());
+        }
+      }
+      REQUIRE(expected == readFile(path));
+    }
+  }
+
+  SECTION("appending output is written in order") {
+    {
+      std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+      out << "header\n";
+    }
+    const int fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    REQUIRE(0 <= fd);
+    std::string expected;
+    {
+      jrl::OutputWriter writer(4096, 2);
+      jrl::OutputFile file(writer);
+      file.attach(fd, path);
+      expected = writeLines(file);
+      REQUIRE(file.close(error));
+    }
+    ::close(fd);
+    REQUIRE(("header\n" + expected) == readFile(path));
+  }
+
+  SECTION("files are written concurrently") {
+    const std::string otherPath = "test-output_writer-other.tmp";
+    jrl::OutputWriter writer(4096, 2);
+    jrl::OutputFile file(writer);
+    jrl::OutputFile otherFile(writer);
+    REQUIRE(file.open(path, error));
+    REQUIRE(otherFile.open(otherPath, error));
+    std::ostream output(&file);
+    std::ostream otherOutput(&otherFile);
+    std::string expected;
+    std::string otherExpected;
+    for (int index = 0; index < 5000; ++index) {
+      output << index << '\n';
+      expected += std::to_string(index) + "\n";
+      otherOutput << -index << '\n';
+      otherExpected += std::to_string(-index) + "\n";
+    }
+    REQUIRE(file.close(error));
+    REQUIRE(otherFile.close(error));
+    REQUIRE(expected == readFile(path));
+    REQUIRE(otherExpected == readFile(otherPath));
+    std::remove(otherPath.c_str());
+  }
+
+  SECTION("unwritable files are reported") {
+    jrl::OutputWriter writer;
+    jrl::OutputFile file(writer);
+    REQUIRE_FALSE(file.open("test-output_writer.missing/file", error));
+    REQUIRE_FALSE(error.empty());
+  }
+
+  std::remove(path.c_str());
+}
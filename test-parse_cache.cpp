@@ -0,0 +1,52 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Standard C library includes
+#include <cstdio>
+#include <unistd.h>
+
+// STL includes
+#include <string>
+
+// Local includes
+#include "parse_cache.hpp"
+
+TEST_CASE("parse cache lookup and eviction", "[cache]") {
+  const std::string directory = "test-parse_cache.d";
+  std::string error;
+  jrl::ModelWriter model;
+  model.startElement("board");
+  model.endElement();
+  const std::uint64_t first = jrl::ParseCache::computeKey("<board/>", "1");
+  const std::uint64_t second = jrl::ParseCache::computeKey("<board />", "1");
+
+  SECTION("keys depend on the converter version") {
+    REQUIRE(first != jrl::ParseCache::computeKey("<board/>", "2"));
+  }
+
+  SECTION("stored entries are found again") {
+    jrl::ParseCache cache(directory, 1 << 20);
+    REQUIRE(cache.open(error));
+    jrl::ModelReader reader;
+    REQUIRE_FALSE(cache.lookup(first, reader));
+    REQUIRE(cache.store(first, model, error));
+    REQUIRE(cache.lookup(first, reader));
+    REQUIRE(2 == reader.getEventCount());
+    REQUIRE(1 == cache.getStatistics().hits);
+    REQUIRE(1 == cache.getStatistics().misses);
+    REQUIRE(1 == cache.getStatistics().entryCount);
+  }
+
+  SECTION("stores beyond the capacity evict the oldest entries") {
+    jrl::ParseCache cache(directory, 1);
+    REQUIRE(cache.open(error));
+    REQUIRE(cache.store(first, model, error));
+    REQUIRE(cache.store(second, model, error));
+    REQUIRE(0 == cache.getStatistics().entryCount);
+    REQUIRE(2 == cache.getStatistics().evictions);
+  }
+
+  std::remove(jrl::ParseCache(directory, 0).getEntryPath(first).c_str());
+  std::remove(jrl::ParseCache(directory, 0).getEntryPath(second).c_str());
+  ::rmdir(directory.c_str());
+}
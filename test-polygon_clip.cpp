@@ -0,0 +1,100 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// STL includes
+#include <vector>
+
+// Local includes
+#include "polygon_clip.hpp"
+#include "spatial_grid.hpp"
+
+static jrl::Contour
+makeRectangle(const double minX,
+              const double minY,
+              const double maxX,
+              const double maxY)
+{
+  jrl::Contour contour;
+  contour.push_back(jrl::ClipPoint(minX, minY));
+  contour.push_back(jrl::ClipPoint(maxX, minY));
+  contour.push_back(jrl::ClipPoint(maxX, maxY));
+  contour.push_back(jrl::ClipPoint(minX, maxY));
+  return contour;
+}
+
+static double
+getArea(const std::vector<jrl::ClipRegion> &regions)
+{
+  double area = 0.0;
+  for (std::vector<jrl::ClipRegion>::const_iterator region = regions.begin();
+       region != regions.end(); ++region) {
+    area += jrl::getSignedArea(region->outer);
+    for (std::vector<jrl::Contour>::const_iterator hole = region->holes.begin();
+         hole != region->holes.end(); ++hole) {
+      area += jrl::getSignedArea(*hole);
+    }
+  }
+  return area;
+}
+
+TEST_CASE("scanline subtraction of obstacles from a polygon", "[clip]") {
+  jrl::ScanlineClipper clipper;
+  std::vector<jrl::ClipRegion> regions;
+  clipper.setSubject(makeRectangle(0, 0, 10, 10));
+
+  SECTION("obstacle inside the subject becomes a hole") {
+    clipper.addObstacle(makeRectangle(2, 2, 4, 4));
+    clipper.subtract(regions);
+    REQUIRE(1 == regions.size());
+    REQUIRE(4 == regions[0].outer.size());
+    REQUIRE(1 == regions[0].holes.size());
+    REQUIRE(96.0 == Approx(getArea(regions)));
+  }
+
+  SECTION("obstacle across the subject splits it") {
+    clipper.addObstacle(makeRectangle(-1, 4, 11, 6));
+    clipper.subtract(regions);
+    REQUIRE(2 == regions.size());
+    REQUIRE(80.0 == Approx(getArea(regions)));
+  }
+
+  SECTION("overlapping obstacles are unioned") {
+    clipper.addObstacle(makeRectangle(2, 2, 6, 6));
+    clipper.addObstacle(makeRectangle(4, 4, 8, 8));
+    clipper.subtract(regions);
+    REQUIRE(1 == regions.size());
+    REQUIRE(1 == regions[0].holes.size());
+    REQUIRE(8 == regions[0].holes[0].size());
+    REQUIRE(72.0 == Approx(getArea(regions)));
+  }
+
+  SECTION("crossing edges are split") {
+    jrl::Contour diamond;
+    diamond.push_back(jrl::ClipPoint(5, -2));
+    diamond.push_back(jrl::ClipPoint(12, 5));
+    diamond.push_back(jrl::ClipPoint(5, 12));
+    diamond.push_back(jrl::ClipPoint(-2, 5));
+    clipper.addObstacle(diamond);
+    clipper.subtract(regions);
+    REQUIRE(4 == regions.size());
+    REQUIRE(18.0 == Approx(getArea(regions)));
+  }
+}
+
+TEST_CASE("uniform grid spatial index", "[clip]") {
+  jrl::SpatialGrid grid(1.0);
+  grid.insert(0, jrl::BoundingBox(0.5, 0.5, 2.5, 0.7));
+  grid.insert(1, jrl::BoundingBox(5.0, 5.0, 5.5, 5.5));
+  std::vector<std::uint32_t> ids;
+
+  SECTION("items spanning several cells are reported once") {
+    grid.query(jrl::BoundingBox(0.0, 0.0, 3.0, 1.0), ids);
+    REQUIRE(1 == ids.size());
+    REQUIRE(0 == ids[0]);
+  }
+
+  SECTION("distant items are not reported") {
+    grid.query(jrl::BoundingBox(4.2, 4.2, 4.8, 4.8), ids);
+    REQUIRE(ids.empty());
+  }
+}
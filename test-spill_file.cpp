@@ -0,0 +1,47 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// STL includes
+#include <sstream>
+#include <string>
+
+// Local includes
+#include "spill_file.hpp"
+
+TEST_CASE("bytes spilled to a temporary file", "[spill]") {
+  jrl::SpillFile file(jrl::SpillFile::getDefaultDirectory());
+  std::string error;
+
+  SECTION("chunks are read back as written") {
+    std::string first;
+    for (int index = 0; index < 100000; ++index) {
+      first += "Line[" + std::to_string(index) + "]\n";
+    }
+    const std::string second = "second chunk\n";
+    jrl::SpillFile::Extent firstExtent;
+    jrl::SpillFile::Extent secondExtent;
+    REQUIRE(file.append(first, firstExtent, error));
+    REQUIRE(file.append(second, secondExtent, error));
+    REQUIRE(2 == file.getChunkCount());
+    REQUIRE((first.size() + second.size()) == file.getSize());
+
+    // NOTE: the second chunk doesn't start on a page boundary.
+    std::ostringstream strm;
+    REQUIRE(file.copy(secondExtent, strm, error));
+    REQUIRE(file.copy(firstExtent, strm, error));
+    REQUIRE((second + first) == strm.str());
+  }
+
+  SECTION("an unusable directory is reported") {
+    jrl::SpillFile missing("test-spill_file.missing");
+    jrl::SpillFile::Extent extent;
+    REQUIRE_FALSE(missing.append("bytes", extent, error));
+    REQUIRE_FALSE(error.empty());
+  }
+}
+
+TEST_CASE("memory use measured against a limit", "[spill]") {
+  REQUIRE(0 < jrl::MemoryBudget::getResidentBytes());
+  REQUIRE(jrl::MemoryBudget(1).isNearLimit());
+  REQUIRE_FALSE(jrl::MemoryBudget(UINT64_C(1) << 50).isNearLimit());
+}
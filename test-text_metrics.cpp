@@ -0,0 +1,41 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Local includes
+#include "text_metrics.hpp"
+
+TEST_CASE("scaling of Eagle text to the gEDA font", "[text]") {
+  SECTION("text the size of the gEDA font keeps its scale") {
+    // 48 mil high with 8 mil strokes, the gEDA font at scale 100.
+    const jrl::TextMetrics metrics =
+      jrl::TextMetricsTable::compute(1.2192, 100.0 / 6.0);
+    REQUIRE(100 == metrics.scale);
+    REQUIRE(metrics.height == Approx(1.016));
+    REQUIRE(metrics.stroke == Approx(0.2032));
+  }
+
+  SECTION("thicker strokes leave less height between centerlines") {
+    const jrl::TextMetrics thin = jrl::TextMetricsTable::compute(1.778, 8.0);
+    const jrl::TextMetrics thick = jrl::TextMetricsTable::compute(1.778, 20.0);
+    REQUIRE(161 == thin.scale);
+    REQUIRE(140 == thick.scale);
+    REQUIRE(thin.getWidth(3) == Approx(3 * 0.8128 * 1.61));
+    REQUIRE(thin.getWidth("R12") == thin.getWidth(3));
+    // Two characters, the first taking two bytes.
+    REQUIRE(thin.getWidth("\xc2\xb5" "F") == thin.getWidth(2));
+  }
+
+  SECTION("tiny text still has a scale") {
+    REQUIRE(1 == jrl::TextMetricsTable::compute(0.001, 8.0).scale);
+  }
+
+  SECTION("each size and ratio is computed once") {
+    jrl::TextMetricsTable table;
+    const std::size_t first = table.getIndex(1.778, 8.0);
+    const std::size_t second = table.getIndex(1.27, 8.0);
+    REQUIRE(first != second);
+    REQUIRE(first == table.getIndex(1.778, 8.0));
+    REQUIRE(2 == table.size());
+    REQUIRE(161 == table.get(first).scale);
+  }
+}
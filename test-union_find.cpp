@@ -0,0 +1,35 @@
+#define CATCH_CONFIG_MAIN
+#include <Catch/catch.hpp>
+
+// Local includes
+#include "union_find.hpp"
+#include "interner.hpp"
+
+TEST_CASE("union-find connectivity", "[union_find]") {
+  jrl::UnionFind sets;
+  sets.resize(5);
+
+  SECTION("ids start out disjoint") {
+    REQUIRE(sets.find(0) != sets.find(1));
+  }
+
+  SECTION("merging is transitive") {
+    REQUIRE(sets.unite(0, 1));
+    REQUIRE(sets.unite(3, 1));
+    REQUIRE(!sets.unite(0, 3));
+    REQUIRE(sets.find(0) == sets.find(3));
+    REQUIRE(sets.find(2) != sets.find(3));
+  }
+}
+
+TEST_CASE("string interning", "[union_find]") {
+  jrl::Interner interner;
+
+  SECTION("ids are dense and stable") {
+    REQUIRE(0 == interner.intern("R1-1"));
+    REQUIRE(1 == interner.intern("R1-2"));
+    REQUIRE(0 == interner.intern("R1-1"));
+    REQUIRE(2 == interner.size());
+    REQUIRE("R1-2" == interner.get(1));
+  }
+}
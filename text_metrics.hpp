@@ -0,0 +1,143 @@
+// Metrics of the gEDA pcb default font, for converting Eagle text.
+// Copyright 2014 by Brian Davis.
+
+#ifndef text_metrics_HEADER
+#define text_metrics_HEADER
+
+#include <cmath>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace jrl
+{
+
+/**
+ * Size (in mm) of text in the pcb default font at one gEDA scale.
+ */
+struct TextMetrics
+{
+  // Member functions
+
+  /** Width of a line of count characters. */
+  double
+  getWidth(const std::size_t count) const
+  {
+    return count * advance;
+  }
+
+  /** Width of a line of UTF-8 text. */
+  double
+  getWidth(const std::string &text) const
+  {
+    std::size_t count = 0;
+    for (std::string::const_iterator iter = text.begin();
+         iter != text.end(); ++iter) {
+      // NOTE: continuation bytes don't start a character.
+      if (0x80 != (static_cast<unsigned char>(*iter) & 0xc0)) {
+        ++count;
+      }
+    }
+    return getWidth(count);
+  }
+
+  // Data members
+
+  /** Percentage of the default font size. */
+  unsigned scale;
+  /** Height of capitals, measured between stroke centerlines. */
+  double height;
+  /** Distance between the origins of successive characters. */
+  double advance;
+  double stroke;
+};
+
+/**
+ * Maps Eagle text sizes and ratios to gEDA scales.  A board uses few
+ * distinct sizes however much text it has, so the metrics of each are
+ * computed once and text refers to them by index.
+ *
+ * Eagle draws its vector font with strokes of ratio percent of the
+ * size inside a box size high, i.e. size * (1 - ratio / 100) between
+ * centerlines; pcb scales one font whose capitals are 40 mil between
+ * centerlines at scale 100, stroke width included.  Text is scaled so
+ * that the centerline heights agree, which also makes the outer
+ * heights agree for Eagle's ratio closest to pcb's.
+ *
+ * NOTE: the pcb default font is proportional; the advance is that of
+ * its typical letter or digit, close enough for bounding boxes.
+ */
+class TextMetricsTable
+{
+public:
+
+  // Member functions
+
+  /**
+   * Index of the metrics of text of size (in mm) and ratio (stroke
+   * width in percent of the size), computing them if they are new.
+   */
+  std::size_t
+  getIndex(const double size,
+           const double ratio)
+  {
+    const std::pair<std::map<Key, std::size_t>::iterator, bool> entry =
+      index_.insert(std::make_pair(Key(size, ratio), metrics_.size()));
+    if (entry.second) {
+      metrics_.push_back(compute(size, ratio));
+    }
+    return entry.first->second;
+  }
+
+  const TextMetrics &
+  get(const std::size_t index) const
+  {
+    return metrics_[index];
+  }
+
+  std::size_t
+  size() const
+  {
+    return metrics_.size();
+  }
+
+  static TextMetrics
+  compute(const double size,
+          const double ratio)
+  {
+    const double height = size * (1.0 - (ratio / 100.0));
+    const double scale = std::floor((100.0 * height / FONT_HEIGHT) + 0.5);
+    TextMetrics metrics;
+    metrics.scale = (1.0 > scale) ? 1 : static_cast<unsigned>(scale);
+    const double factor = metrics.scale / 100.0;
+    metrics.height = FONT_HEIGHT * factor;
+    metrics.advance = FONT_ADVANCE * factor;
+    metrics.stroke = FONT_STROKE * factor;
+    return metrics;
+  }
+
+private:
+
+  // Types
+
+  // (size, ratio)
+  typedef std::pair<double, double> Key;
+
+  // Constants
+
+  // The pcb default font at scale 100, in mm.
+  static constexpr double FONT_HEIGHT = 1.016;  // 40 mil
+  static constexpr double FONT_ADVANCE = 0.8128;  // 32 mil
+  static constexpr double FONT_STROKE = 0.2032;  // 8 mil
+
+  // Data members
+
+  std::vector<TextMetrics> metrics_;
+  std::map<Key, std::size_t> index_;
+};
+
+}
+
+#endif
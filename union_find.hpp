@@ -0,0 +1,88 @@
+// Disjoint set (union-find) structure used for connectivity.
+// Copyright 2014 by Brian Davis.
+
+#ifndef union_find_HEADER
+#define union_find_HEADER
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace jrl
+{
+
+/**
+ * Union-find over dense integer ids, stored as flat arrays so that it
+ * scales linearly with the number of ids.  Uses union by rank and path
+ * halving.
+ */
+class UnionFind
+{
+public:
+
+  // Member functions
+
+  std::size_t
+  size() const
+  {
+    return parent_.size();
+  }
+
+  /**
+   * Grow to cover ids [0, count), each new id starts as its own set.
+   */
+  void
+  resize(const std::size_t count)
+  {
+    for (std::size_t id = parent_.size(); id < count; ++id) {
+      parent_.push_back(static_cast<std::uint32_t>(id));
+      rank_.push_back(0);
+    }
+  }
+
+  std::uint32_t
+  find(std::uint32_t id)
+  {
+    while (parent_[id] != id) {
+      parent_[id] = parent_[parent_[id]];
+      id = parent_[id];
+    }
+    return id;
+  }
+
+  /**
+   * Merge the sets containing the two ids, returns false if they were
+   * already in the same set.
+   */
+  bool
+  unite(const std::uint32_t first,
+        const std::uint32_t second)
+  {
+    std::uint32_t firstRoot = find(first);
+    std::uint32_t secondRoot = find(second);
+    if (firstRoot == secondRoot) {
+      return false;
+    }
+    if (rank_[firstRoot] < rank_[secondRoot]) {
+      const std::uint32_t swapped = firstRoot;
+      firstRoot = secondRoot;
+      secondRoot = swapped;
+    }
+    parent_[secondRoot] = firstRoot;
+    if (rank_[firstRoot] == rank_[secondRoot]) {
+      ++rank_[firstRoot];
+    }
+    return true;
+  }
+
+private:
+
+  // Data members
+
+  std::vector<std::uint32_t> parent_;
+  std::vector<std::uint8_t> rank_;
+};
+
+}
+
+#endif